@@ -57,6 +57,7 @@
       'sources': [
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
+        'latency_stats_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
       ],
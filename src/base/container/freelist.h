@@ -65,13 +65,15 @@ class FreeList {
 
   FreeList(FreeList&& other) noexcept
       : pool_(std::move(other.pool_)),
+        spare_(std::move(other.spare_)),
         next_in_chunk_(other.next_in_chunk_),
         chunk_size_(other.chunk_size_),
         allocator_(std::move(other.allocator_)) {
     static_assert(std::is_nothrow_move_constructible_v<decltype(pool_)>);
-    // Only need to clear the pool because Destroy is no-op if the pool is
+    // Only need to clear the pools because Destroy is no-op if they are
     // empty.
     other.pool_.clear();
+    other.spare_.clear();
   }
 
   FreeList& operator=(FreeList&& other) noexcept {
@@ -79,6 +81,7 @@ class FreeList {
     // Destroy `this` freelist and move `other` over.
     Destroy();
     pool_ = std::move(other.pool_);
+    spare_ = std::move(other.spare_);
     next_in_chunk_ = other.next_in_chunk_;
     chunk_size_ = other.chunk_size_;
     static_assert(
@@ -86,6 +89,7 @@ class FreeList {
         "std::allocator is supposed to propagate on move assignments.");
     allocator_ = std::move(other.allocator_);
     other.pool_.clear();
+    other.spare_.clear();
     return *this;
   }
 
@@ -94,15 +98,31 @@ class FreeList {
   void Free() {
     Destroy();
     pool_.clear();
+    spare_.clear();
+    next_in_chunk_ = std::numeric_limits<size_type>::max();
+  }
+
+  // Destroys all the objects like Free(), but keeps the chunks to reuse them
+  // for the following allocations.
+  void Clear() {
+    DestroyObjects();
+    // Reuses the chunks in the same order.
+    spare_.insert(spare_.end(), pool_.rbegin(), pool_.rend());
+    pool_.clear();
     next_in_chunk_ = std::numeric_limits<size_type>::max();
   }
 
   T* absl_nonnull Alloc() {
     if (next_in_chunk_ >= chunk_size_) {
       next_in_chunk_ = 0;
-      // Allocate the chunk with the allocate and delay the constructions until
-      // the objects are actually requested.
-      pool_.push_back(allocator_traits::allocate(allocator_, chunk_size_));
+      if (!spare_.empty()) {
+        pool_.push_back(spare_.back());
+        spare_.pop_back();
+      } else {
+        // Allocate the chunk with the allocate and delay the constructions
+        // until the objects are actually requested.
+        pool_.push_back(allocator_traits::allocate(allocator_, chunk_size_));
+      }
     }
 
     // Default construct T.
@@ -119,7 +139,9 @@ class FreeList {
       return (pool_.size() - 1) * chunk_size_ + next_in_chunk_;
     }
   }
-  constexpr size_type capacity() const { return pool_.size() * chunk_size_; }
+  constexpr size_type capacity() const {
+    return (pool_.size() + spare_.size()) * chunk_size_;
+  }
   constexpr size_type chunk_size() const { return chunk_size_; }
 
   allocator_type get_allocator() const { return allocator_; }
@@ -128,6 +150,7 @@ class FreeList {
     static_assert(std::is_nothrow_swappable_v<decltype(pool_)>);
     using std::swap;
     swap(pool_, other.pool_);
+    swap(spare_, other.spare_);
     swap(next_in_chunk_, other.next_in_chunk_);
     swap(chunk_size_, other.chunk_size_);
     if constexpr (allocator_traits::propagate_on_container_swap::value) {
@@ -141,6 +164,19 @@ class FreeList {
   // Destroys the freelist so it's ready to be destructed or overwritten by
   // move.
   void Destroy() {
+    DestroyObjects();
+
+    // Deallocate the chunks in the pool.
+    for (T* chunk : pool_) {
+      allocator_traits::deallocate(allocator_, chunk, chunk_size_);
+    }
+    for (T* chunk : spare_) {
+      allocator_traits::deallocate(allocator_, chunk, chunk_size_);
+    }
+  }
+
+  // Destructs the objects without deallocating the chunks.
+  void DestroyObjects() {
     if constexpr (!std::is_trivially_destructible_v<T>) {
       // Destruct all elements. Skip this entirely if T is trivially
       // destructible.
@@ -155,14 +191,11 @@ class FreeList {
         }
       }
     }
-
-    // Deallocate the chunks in the pool.
-    for (T* chunk : pool_) {
-      allocator_traits::deallocate(allocator_, chunk, chunk_size_);
-    }
   }
 
   std::vector<T*> pool_;
+  // The chunks kept by Clear(), which are reused before allocating new ones.
+  std::vector<T*> spare_;
   size_type next_in_chunk_ = std::numeric_limits<size_type>::max();
   size_type chunk_size_;
   allocator_type allocator_;
@@ -180,6 +213,13 @@ class ObjectPool {
     freelist_.Free();
   }
 
+  // Destroys all the objects like Free(), but keeps the memory for the
+  // following allocations.
+  void Clear() {
+    released_.clear();
+    freelist_.Clear();
+  }
+
   T* Alloc() {
     if (!released_.empty()) {
       T* result = released_.back();
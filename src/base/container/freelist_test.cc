@@ -117,6 +117,39 @@ TEST_F(FreeListTest, FreeListAllocResetFree) {
   EXPECT_GT(Stub::destructed(), 0);
 }
 
+TEST_F(FreeListTest, ClearKeepsChunks) {
+  FreeList<Stub> list(4);
+  std::vector<Stub *> allocated;
+  for (int i = 0; i < 10; ++i) {
+    allocated.push_back(list.Alloc());
+  }
+  EXPECT_EQ(list.capacity(), 12);
+
+  list.Clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.capacity(), 12);
+  EXPECT_EQ(Stub::destructed(), 10);
+
+  // The chunks are reused in the same order.
+  for (int i = 0; i < 10; ++i) {
+    Stub *p = list.Alloc();
+    EXPECT_EQ(p, allocated[i]);
+    EXPECT_FALSE(p->IsUsed());
+  }
+  EXPECT_EQ(list.capacity(), 12);
+  for (int i = 0; i < 3; ++i) {
+    list.Alloc();
+  }
+  EXPECT_EQ(list.capacity(), 16);
+  EXPECT_EQ(list.size(), 13);
+
+  FreeList<Stub> other(std::move(list));
+  other.Clear();
+  EXPECT_EQ(other.capacity(), 16);
+  other.Free();
+  EXPECT_EQ(other.capacity(), 0);
+}
+
 TEST_F(FreeListTest, FreeFirst) {
   FreeList<Stub> list(10);
   list.Free();
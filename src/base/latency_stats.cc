@@ -0,0 +1,121 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/latency_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "absl/base/attributes.h"
+#include "absl/base/no_destructor.h"
+#include "absl/container/btree_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+struct Registry {
+  absl::Mutex mutex;
+  // btree_map keeps the snapshot sorted by name.
+  absl::btree_map<std::string, LatencyStats::Stage, std::less<>> stages
+      ABSL_GUARDED_BY(mutex);
+  absl::btree_map<std::string, int64_t, std::less<>> counters
+      ABSL_GUARDED_BY(mutex);
+};
+
+Registry &GetRegistry() {
+  static absl::NoDestructor<Registry> registry;
+  return *registry;
+}
+
+}  // namespace
+
+ABSL_CONST_INIT std::atomic<bool> LatencyStats::enabled_ = false;
+
+void LatencyStats::Record(absl::string_view stage, absl::Duration elapsed) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Registry &registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  auto it = registry.stages.find(stage);
+  if (it == registry.stages.end()) {
+    it = registry.stages.emplace(stage, Stage{.name = std::string(stage)})
+             .first;
+  }
+  Stage &entry = it->second;
+  ++entry.count;
+  entry.total += elapsed;
+  entry.max = std::max(entry.max, elapsed);
+}
+
+void LatencyStats::Increment(absl::string_view counter, int64_t delta) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Registry &registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  auto it = registry.counters.find(counter);
+  if (it == registry.counters.end()) {
+    it = registry.counters.emplace(counter, 0).first;
+  }
+  it->second += delta;
+}
+
+LatencyStats::Snapshot LatencyStats::TakeSnapshot() {
+  Snapshot snapshot;
+  Registry &registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  snapshot.stages.reserve(registry.stages.size());
+  for (const auto &[name, stage] : registry.stages) {
+    snapshot.stages.push_back(stage);
+  }
+  snapshot.counters.reserve(registry.counters.size());
+  for (const auto &[name, value] : registry.counters) {
+    snapshot.counters.push_back({.name = name, .value = value});
+  }
+  registry.stages.clear();
+  registry.counters.clear();
+  return snapshot;
+}
+
+void LatencyStats::Clear() {
+  Registry &registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  registry.stages.clear();
+  registry.counters.clear();
+}
+
+}  // namespace mozc
@@ -0,0 +1,129 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_LATENCY_STATS_H_
+#define MOZC_BASE_LATENCY_STATS_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT: for steady_clock
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+
+// Process-wide latency timers and counters for the stages of the conversion
+// pipeline. Recording is disabled by default; while it is disabled, a
+// ScopedLatencyTimer or Increment() costs a single relaxed atomic load.
+//
+// Stage and counter names are free-form and are conventionally prefixed with
+// the module, e.g. "converter/viterbi" or "rewriter/EmojiRewriter".
+class LatencyStats {
+ public:
+  struct Stage {
+    std::string name;
+    uint64_t count = 0;
+    absl::Duration total;
+    absl::Duration max;
+  };
+
+  struct Counter {
+    std::string name;
+    int64_t value = 0;
+  };
+
+  // Stages and counters sorted by name.
+  struct Snapshot {
+    std::vector<Stage> stages;
+    std::vector<Counter> counters;
+  };
+
+  LatencyStats() = delete;
+
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Adds one sample of `elapsed` to `stage`. Does nothing when disabled.
+  static void Record(absl::string_view stage, absl::Duration elapsed);
+
+  // Adds `delta` to `counter`. Does nothing when disabled.
+  static void Increment(absl::string_view counter, int64_t delta = 1);
+
+  // Returns the statistics recorded so far and clears them.
+  static Snapshot TakeSnapshot();
+
+  static void Clear();
+
+ private:
+  ABSL_CONST_INIT static std::atomic<bool> enabled_;
+};
+
+// Records the lifetime of this object to `stage` of LatencyStats, measured by
+// the monotonic clock, so it is not affected by mocking or adjusting Clock.
+// `stage` must outlive this object.
+//
+// {
+//   ScopedLatencyTimer timer("converter/make_lattice");
+//   MakeLattice(...);
+// }
+class ScopedLatencyTimer {
+ public:
+  explicit ScopedLatencyTimer(absl::string_view stage)
+      : stage_(stage),
+        start_(LatencyStats::IsEnabled() ? std::chrono::steady_clock::now()
+                                         : kDisabled) {}
+
+  ScopedLatencyTimer(const ScopedLatencyTimer &) = delete;
+  ScopedLatencyTimer &operator=(const ScopedLatencyTimer &) = delete;
+
+  ~ScopedLatencyTimer() {
+    if (start_ != kDisabled) {
+      LatencyStats::Record(
+          stage_, absl::FromChrono(std::chrono::steady_clock::now() - start_));
+    }
+  }
+
+ private:
+  static constexpr std::chrono::steady_clock::time_point kDisabled =
+      std::chrono::steady_clock::time_point::min();
+
+  absl::string_view stage_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_LATENCY_STATS_H_
@@ -0,0 +1,128 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/latency_stats.h"
+
+#include "absl/time/time.h"
+#include "base/clock_mock.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::AllOf;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::IsEmpty;
+
+class LatencyStatsTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    LatencyStats::Clear();
+    LatencyStats::SetEnabled(true);
+  }
+
+  void TearDown() override {
+    LatencyStats::SetEnabled(false);
+    LatencyStats::Clear();
+  }
+};
+
+TEST_F(LatencyStatsTest, Record) {
+  LatencyStats::Record("b", absl::Milliseconds(3));
+  LatencyStats::Record("a", absl::Milliseconds(1));
+  LatencyStats::Record("b", absl::Milliseconds(5));
+
+  const LatencyStats::Snapshot snapshot = LatencyStats::TakeSnapshot();
+  ASSERT_EQ(snapshot.stages.size(), 2);
+  EXPECT_EQ(snapshot.stages[0].name, "a");
+  EXPECT_EQ(snapshot.stages[0].count, 1);
+  EXPECT_EQ(snapshot.stages[0].total, absl::Milliseconds(1));
+  EXPECT_EQ(snapshot.stages[1].name, "b");
+  EXPECT_EQ(snapshot.stages[1].count, 2);
+  EXPECT_EQ(snapshot.stages[1].total, absl::Milliseconds(8));
+  EXPECT_EQ(snapshot.stages[1].max, absl::Milliseconds(5));
+
+  // The snapshot clears the statistics.
+  EXPECT_THAT(LatencyStats::TakeSnapshot().stages, IsEmpty());
+}
+
+TEST_F(LatencyStatsTest, ScopedTimer) {
+  // The timer uses the monotonic clock, so moving Clock doesn't affect it.
+  ScopedClockMock clock(absl::UnixEpoch());
+  {
+    ScopedLatencyTimer timer("stage");
+    clock->Advance(absl::Hours(1));
+  }
+  {
+    ScopedLatencyTimer timer("stage");
+    clock->SetTime(absl::UnixEpoch());
+  }
+
+  const LatencyStats::Snapshot snapshot = LatencyStats::TakeSnapshot();
+  ASSERT_EQ(snapshot.stages.size(), 1);
+  EXPECT_EQ(snapshot.stages[0].name, "stage");
+  EXPECT_EQ(snapshot.stages[0].count, 2);
+  EXPECT_GE(snapshot.stages[0].total, absl::ZeroDuration());
+  EXPECT_LT(snapshot.stages[0].total, absl::Hours(1));
+}
+
+TEST_F(LatencyStatsTest, Counters) {
+  LatencyStats::Increment("nodes", 10);
+  LatencyStats::Increment("nodes", 5);
+  LatencyStats::Increment("calls");
+
+  EXPECT_THAT(
+      LatencyStats::TakeSnapshot().counters,
+      ElementsAre(AllOf(Field(&LatencyStats::Counter::name, "calls"),
+                        Field(&LatencyStats::Counter::value, 1)),
+                  AllOf(Field(&LatencyStats::Counter::name, "nodes"),
+                        Field(&LatencyStats::Counter::value, 15))));
+}
+
+TEST_F(LatencyStatsTest, Disabled) {
+  LatencyStats::SetEnabled(false);
+  {
+    ScopedLatencyTimer timer("stage");
+    // Enabling in the middle of the scope doesn't record a bogus sample.
+    LatencyStats::SetEnabled(true);
+  }
+  LatencyStats::SetEnabled(false);
+  LatencyStats::Record("stage", absl::Seconds(1));
+  LatencyStats::Increment("counter");
+
+  const LatencyStats::Snapshot snapshot = LatencyStats::TakeSnapshot();
+  EXPECT_THAT(snapshot.stages, IsEmpty());
+  EXPECT_THAT(snapshot.counters, IsEmpty());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -98,6 +98,7 @@ constexpr absl::Duration kDeleteSessionOnDestructorTimeout = absl::Seconds(1);
 
 Client::Client()
     : id_(0),
+      use_persistent_connection_(true),
       server_launcher_(new ServerLauncher),
       timeout_(kDefaultTimeout),
       server_status_(SERVER_UNKNOWN),
@@ -454,6 +455,7 @@ bool Client::CreateSession() {
   input.set_type(commands::Input::CREATE_SESSION);
 
   *input.mutable_capability() = client_capability_;
+  input.mutable_capability()->set_candidate_delta(true);
 
   commands::ApplicationInfo *info = input.mutable_application_info();
   DCHECK(info);
@@ -649,7 +651,74 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
   std::string request;
   input.SerializeToString(&request);
 
-  // Call IPC
+  // Reuse the connection of the previous call in the persistent mode.
+  std::unique_ptr<IPCClientInterface> client =
+      std::move(persistent_ipc_client_);
+  const bool reused = client != nullptr && client->Connected();
+  if (!reused) {
+    client = NewIPCClient();
+    if (client == nullptr) {
+      return false;
+    }
+    if (use_persistent_connection_ &&
+        !client->EnablePersistentConnection(timeout_)) {
+      // Fall back to a connection per call for the rest of the session.
+      use_persistent_connection_ = false;
+      if (!client->Connected()) {
+        return Call(input, output);
+      }
+    }
+  }
+
+  bool succeeded = false;
+  if (client->IsPersistentConnection()) {
+    if (client->SendRequest(request, timeout_)) {
+      succeeded = client->ReceiveResponse(&response_, timeout_);
+    } else if (reused && client->GetLastIPCError() == IPC_NO_CONNECTION) {
+      // The server has closed the idle connection, e.g. it was restarted.
+      // The request has not been delivered, so retry with a new connection.
+      MOZC_VLOG(1) << "The persistent connection has been closed";
+      return Call(input, output);
+    }
+  } else {
+    succeeded = client->Call(request, &response_, timeout_);
+  }
+
+  if (!succeeded) {
+    LOG(ERROR) << "Call failure" << input.DebugString();
+    if (client->GetLastIPCError() == IPC_TIMEOUT_ERROR) {
+      server_status_ = SERVER_TIMEOUT;
+    } else {
+      // server crash
+      server_status_ = SERVER_SHUTDOWN;
+    }
+    return false;
+  }
+
+  if (client->IsPersistentConnection()) {
+    persistent_ipc_client_ = std::move(client);
+  }
+
+  if (!output->ParseFromString(response_)) {
+    LOG(ERROR) << "Parse failure of the result of the request:"
+               << input.DebugString();
+    server_status_ = SERVER_BROKEN_MESSAGE;
+    return false;
+  }
+  candidate_delta_decoder_.Decode(output);
+
+  DCHECK(server_status_ == SERVER_OK ||
+         server_status_ == SERVER_INVALID_SESSION ||
+         server_status_ == SERVER_SHUTDOWN ||
+         server_status_ == SERVER_UNKNOWN /* during StartServer() */)
+      << " " << server_status_;
+
+  MOZC_VLOG(2) << "commands::Output: " << std::endl << *output;
+
+  return true;
+}
+
+std::unique_ptr<IPCClientInterface> Client::NewIPCClient() {
   std::unique_ptr<IPCClientInterface> client(client_factory_->NewClient(
       kServerAddress, server_launcher_->server_program()));
 
@@ -667,7 +736,7 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
   if (client == nullptr) {
     LOG(ERROR) << "Cannot make client object";
     server_status_ = SERVER_FATAL;
-    return false;
+    return nullptr;
   }
 
   if (!client->Connected()) {
@@ -677,7 +746,7 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
     if (server_status_ != SERVER_UNKNOWN) {
       server_status_ = SERVER_SHUTDOWN;
     }
-    return false;
+    return nullptr;
   }
 
   server_protocol_version_ = client->GetServerProtocolVersion();
@@ -686,36 +755,10 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
 
   if (server_protocol_version_ != IPC_PROTOCOL_VERSION) {
     LOG(ERROR) << "Server version mismatch. skipped to update the status here";
-    return false;
+    return nullptr;
   }
 
-  if (!client->Call(request, &response_, timeout_)) {
-    LOG(ERROR) << "Call failure" << input.DebugString();
-    if (client->GetLastIPCError() == IPC_TIMEOUT_ERROR) {
-      server_status_ = SERVER_TIMEOUT;
-    } else {
-      // server crash
-      server_status_ = SERVER_SHUTDOWN;
-    }
-    return false;
-  }
-
-  if (!output->ParseFromString(response_)) {
-    LOG(ERROR) << "Parse failure of the result of the request:"
-               << input.DebugString();
-    server_status_ = SERVER_BROKEN_MESSAGE;
-    return false;
-  }
-
-  DCHECK(server_status_ == SERVER_OK ||
-         server_status_ == SERVER_INVALID_SESSION ||
-         server_status_ == SERVER_SHUTDOWN ||
-         server_status_ == SERVER_UNKNOWN /* during StartServer() */)
-      << " " << server_status_;
-
-  MOZC_VLOG(2) << "commands::Output: " << std::endl << *output;
-
-  return true;
+  return client;
 }
 
 bool Client::StartServer() {
@@ -736,6 +779,7 @@ void Client::InitInput(commands::Input *input) const {
   if (preferences_ != nullptr) {
     *input->mutable_config() = *preferences_;
   }
+  candidate_delta_decoder_.FillInput(input);
 }
 
 bool Client::CheckVersionOrRestartServerInternal(const commands::Input &input,
@@ -47,6 +47,7 @@
         '<(mozc_oss_src_dir)/ipc/ipc.gyp:ipc',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:config_proto',
+        '<(mozc_oss_src_dir)/session/session_base.gyp:candidate_delta',
         '<(mozc_oss_src_dir)/session/session_base.gyp:key_info_util',
       ],
       'export_dependent_settings': [
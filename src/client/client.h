@@ -48,6 +48,7 @@
 #include "ipc/ipc.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/candidate_delta.h"
 #include "testing/friend_test.h"
 
 // The obsolete and unmaintained *main.cc files (server_launcher_main.cc and
@@ -108,6 +109,7 @@ class Client : public ClientInterface {
 
   void SetIPCClientFactory(IPCClientFactoryInterface *client_factory) override {
     client_factory_ = client_factory;
+    persistent_ipc_client_.reset();
   }
 
   // set ServerLauncher.
@@ -228,6 +230,10 @@ class Client : public ClientInterface {
   // just return false.
   bool Call(const commands::Input &input, commands::Output *output);
 
+  // Creates a new connection to the server and updates the server status and
+  // versions. Returns nullptr if the connection is not available.
+  std::unique_ptr<IPCClientInterface> NewIPCClient();
+
   // first invoke Call() command and check the
   // protocol_version. When protocol version mismatch,
   // client goes to FATAL state
@@ -260,6 +266,10 @@ class Client : public ClientInterface {
 
   uint64_t id_;
   IPCClientFactoryInterface *client_factory_;
+  // The connection kept open across Call()s in the persistent mode.
+  std::unique_ptr<IPCClientInterface> persistent_ipc_client_;
+  // False if the server doesn't support the persistent mode.
+  bool use_persistent_connection_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<config::Config> preferences_;
   std::unique_ptr<commands::Request> request_;
@@ -275,6 +285,8 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+  // Restores the candidates the server omits from Output.
+  session::CandidateDeltaDecoder candidate_delta_decoder_;
 };
 
 class ClientFactory {
@@ -32,6 +32,7 @@
 #include <cstddef>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -42,6 +43,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "composer/char_chunk.h"
@@ -52,7 +54,61 @@
 namespace mozc {
 namespace composer {
 
-void Composition::Erase() { chunks_.clear(); }
+Composition::StringCache::StringCache(const StringCache &other) {
+  absl::MutexLock other_lock(&other.mutex_);
+  strings_ = other.strings_;
+  expanded_ = other.expanded_;
+}
+
+Composition::StringCache &Composition::StringCache::operator=(
+    const StringCache &other) {
+  if (this == &other) {
+    return *this;
+  }
+  // Copies under the lock of `other` first to avoid holding both locks.
+  absl::flat_hash_map<Key, std::string> strings;
+  std::optional<ExpandedStrings> expanded;
+  {
+    absl::MutexLock other_lock(&other.mutex_);
+    strings = other.strings_;
+    expanded = other.expanded_;
+  }
+  absl::MutexLock lock(&mutex_);
+  strings_ = std::move(strings);
+  expanded_ = std::move(expanded);
+  return *this;
+}
+
+void Composition::StringCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  strings_.clear();
+  expanded_.reset();
+}
+
+std::string Composition::StringCache::GetString(
+    Key key, absl::FunctionRef<std::string()> compute) {
+  absl::MutexLock lock(&mutex_);
+  auto [it, inserted] = strings_.try_emplace(key);
+  if (inserted) {
+    it->second = compute();
+  }
+  return it->second;
+}
+
+Composition::StringCache::ExpandedStrings
+Composition::StringCache::GetExpandedStrings(
+    absl::FunctionRef<ExpandedStrings()> compute) {
+  absl::MutexLock lock(&mutex_);
+  if (!expanded_.has_value()) {
+    expanded_ = compute();
+  }
+  return *expanded_;
+}
+
+void Composition::Erase() {
+  cache_.Clear();
+  chunks_.clear();
+}
 
 size_t Composition::InsertAt(size_t pos, std::string input) {
   CompositionInput composition_input;
@@ -73,6 +129,7 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
     return pos;
   }
 
+  cache_.Clear();
   CharChunkList::iterator right_chunk = MaybeSplitChunkAt(pos);
   while (right_chunk != chunks_.end() &&
          right_chunk->GetLength(input_t12r_) == 0) {
@@ -104,6 +161,7 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
 
 // Deletes a right-hand character of the composition at the position.
 size_t Composition::DeleteAt(const size_t position) {
+  cache_.Clear();
   const size_t original_size = GetLength();
   size_t new_position = position;
   // We have to perform deletion repeatedly because there might be 0-length
@@ -207,6 +265,7 @@ void Composition::SetTransliterator(
     return;
   }
 
+  cache_.Clear();
   size_t inner_position_from;
   auto chunk_it =
       GetChunkAt(position_from, Transliterators::LOCAL, &inner_position_from);
@@ -239,6 +298,14 @@ size_t Composition::GetLength() const {
 std::string Composition::GetStringWithModes(
     Transliterators::Transliterator transliterator,
     const TrimMode trim_mode) const {
+  return cache_.GetString({transliterator, trim_mode}, [&] {
+    return GetStringWithModesInternal(transliterator, trim_mode);
+  });
+}
+
+std::string Composition::GetStringWithModesInternal(
+    Transliterators::Transliterator transliterator,
+    const TrimMode trim_mode) const {
   if (chunks_.empty()) {
     // This is not an error. For example, the composition should be empty for
     // the first keydown event after turning on the IME.
@@ -270,6 +337,12 @@ std::string Composition::GetStringWithModes(
 
 std::pair<std::string, absl::btree_set<std::string>>
 Composition::GetExpandedStrings() const {
+  return cache_.GetExpandedStrings(
+      [this] { return GetExpandedStringsInternal(); });
+}
+
+std::pair<std::string, absl::btree_set<std::string>>
+Composition::GetExpandedStringsInternal() const {
   Transliterators::Transliterator transliterator = Transliterators::LOCAL;
   if (chunks_.empty()) {
     MOZC_VLOG(1) << "The composition size is zero.";
@@ -290,17 +363,9 @@ Composition::GetExpandedStrings() const {
 }
 
 std::string Composition::GetString() const {
-  if (chunks_.empty()) {
-    MOZC_VLOG(1) << "The composition size is zero.";
-    return std::string();
-  }
-
-  std::string composition;
-  for (CharChunkList::const_iterator it = chunks_.begin(); it != chunks_.end();
-       ++it) {
-    it->AppendResult(Transliterators::LOCAL, &composition);
-  }
-  return composition;
+  // Appending the results of all the chunks as is, this is identical to
+  // GetStringWithModes(LOCAL, ASIS) and shares the cache with it.
+  return GetStringWithModes(Transliterators::LOCAL, ASIS);
 }
 
 std::string Composition::GetStringWithTransliterator(
@@ -320,12 +385,21 @@ void Composition::GetPreedit(size_t position, std::string *left,
   Util::Utf8SubString(composition, position + 1, std::string::npos, right);
 }
 
-// This function is essentially a const function, but it cannot be const because
-// it outputs a mutable CharChunkList::iterator.  Const version is provided
-// below.
+// The caller may modify the chunk through the returned iterator, so the cache
+// is cleared.
 CharChunkList::iterator Composition::GetChunkAt(
     const size_t position, Transliterators::Transliterator transliterator,
     size_t *inner_position) {
+  cache_.Clear();
+  const CharChunkList::const_iterator it =
+      std::as_const(*this).GetChunkAt(position, transliterator, inner_position);
+  // Erasing the empty range converts the const_iterator to the iterator.
+  return chunks_.erase(it, it);
+}
+
+CharChunkList::const_iterator Composition::GetChunkAt(
+    const size_t position, Transliterators::Transliterator transliterator,
+    size_t *inner_position) const {
   if (chunks_.empty()) {
     *inner_position = 0;
     return chunks_.begin();
@@ -348,14 +422,6 @@ CharChunkList::iterator Composition::GetChunkAt(
   return it;
 }
 
-CharChunkList::const_iterator Composition::GetChunkAt(
-    size_t position, Transliterators::Transliterator transliterator,
-    size_t *inner_position) const {
-  // This const_cast is safe as GetChunkAt() above doesn't mutate any members.
-  return const_cast<Composition *>(this)->GetChunkAt(position, transliterator,
-                                                     inner_position);
-}
-
 size_t Composition::GetPosition(Transliterators::Transliterator transliterator,
                                 CharChunkList::const_iterator cur_it) const {
   size_t position = 0;
@@ -369,6 +435,7 @@ size_t Composition::GetPosition(Transliterators::Transliterator transliterator,
 // Return the iterator to the right side CharChunk at the `position`.
 // If the `position` is in the middle of a CharChunk, that CharChunk is split.
 CharChunkList::iterator Composition::MaybeSplitChunkAt(const size_t position) {
+  cache_.Clear();
   size_t inner_position;
   CharChunkList::iterator it =
       GetChunkAt(position, Transliterators::LOCAL, &inner_position);
@@ -395,6 +462,7 @@ void Composition::CombinePendingChunks(CharChunkList::iterator it,
   if (input.is_asis()) {
     return;
   }
+  cache_.Clear();
   // Combine |**it| and |**(--it)| into |**it| as long as possible.
   const absl::string_view next_input =
       input.conversion().empty() ? input.raw() : input.conversion();
@@ -415,6 +483,7 @@ void Composition::CombinePendingChunks(CharChunkList::iterator it,
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(
     CharChunkList::const_iterator it) {
+  cache_.Clear();
   return chunks_.insert(it, CharChunk(input_t12r_, table_));
 }
 
@@ -428,6 +497,7 @@ bool Composition::ShouldCommit() const {
 // Return charchunk to be inserted and iterator of the *next* char chunk.
 CharChunkList::iterator Composition::GetInsertionChunk(
     CharChunkList::iterator it) {
+  cache_.Clear();
   if (it == chunks_.begin()) {
     return InsertChunk(it);
   }
@@ -445,6 +515,7 @@ void Composition::SetInputMode(Transliterators::Transliterator transliterator) {
 
 void Composition::SetTable(std::shared_ptr<const Table> table) {
   DCHECK(table);
+  cache_.Clear();
   table_ = std::move(table);
 }
 
@@ -32,13 +32,18 @@
 
 #include <cstddef>
 #include <list>
+#include <optional>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
 #include "composer/char_chunk.h"
 #include "composer/composition_input.h"
 #include "composer/transliterators.h"
@@ -217,13 +222,45 @@ class Composition final {
   }
 
  private:
+  // Memoizes the strings derived from the chunks, which are requested several
+  // times per key event. Every non-const method of Composition that may
+  // modify the chunks clears the cache. The cache is guarded by a mutex so
+  // that const methods can be called from multiple threads.
+  class StringCache {
+   public:
+    using Key = std::pair<Transliterators::Transliterator, TrimMode>;
+    using ExpandedStrings =
+        std::pair<std::string, absl::btree_set<std::string>>;
+
+    StringCache() = default;
+    StringCache(const StringCache &other);
+    StringCache &operator=(const StringCache &other);
+
+    void Clear();
+
+    // Returns the cached string for `key`, or calls `compute` to fill it.
+    std::string GetString(Key key, absl::FunctionRef<std::string()> compute);
+    ExpandedStrings GetExpandedStrings(
+        absl::FunctionRef<ExpandedStrings()> compute);
+
+   private:
+    mutable absl::Mutex mutex_;
+    absl::flat_hash_map<Key, std::string> strings_ ABSL_GUARDED_BY(mutex_);
+    std::optional<ExpandedStrings> expanded_ ABSL_GUARDED_BY(mutex_);
+  };
+
   std::string GetStringWithModes(Transliterators::Transliterator transliterator,
                                  TrimMode trim_mode) const;
+  std::string GetStringWithModesInternal(
+      Transliterators::Transliterator transliterator, TrimMode trim_mode) const;
+  std::pair<std::string, absl::btree_set<std::string>>
+  GetExpandedStringsInternal() const;
 
   std::shared_ptr<const Table> table_;
   CharChunkList chunks_;
   Transliterators::Transliterator input_t12r_ =
       Transliterators::CONVERSION_STRING;
+  mutable StringCache cache_;
 };
 
 }  // namespace composer
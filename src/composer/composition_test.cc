@@ -778,6 +778,45 @@ TEST_F(CompositionTest, InsertKeyForN) {
   EXPECT_EQ(comp_str, "ny[NYA]");
 }
 
+TEST_F(CompositionTest, CachedStringsAreUpdatedByEdits) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("n", "ん", "");
+  table_->AddRule("na", "な", "");
+  table_->AddRule("ni", "に", "");
+
+  size_t pos = 0;
+  pos = composition_.InsertAt(pos, "k");
+  pos = composition_.InsertAt(pos, "a");
+  pos = composition_.InsertAt(pos, "n");
+  EXPECT_EQ(composition_.GetStringWithTrimMode(ASIS), "かn");
+  EXPECT_EQ(composition_.GetStringWithTrimMode(TRIM), "か");
+  EXPECT_EQ(composition_.GetExpandedStrings().first, "か");
+  // The second calls return the cached strings.
+  EXPECT_EQ(composition_.GetStringWithTrimMode(ASIS), "かn");
+  EXPECT_EQ(composition_.GetExpandedStrings().first, "か");
+
+  const Composition copy = composition_;
+
+  pos = composition_.InsertAt(pos, "i");
+  EXPECT_EQ(composition_.GetString(), "かに");
+  EXPECT_EQ(composition_.GetStringWithTrimMode(TRIM), "かに");
+  EXPECT_EQ(composition_.GetExpandedStrings().first, "かに");
+
+  pos = composition_.DeleteAt(0);
+  EXPECT_EQ(composition_.GetString(), "に");
+
+  composition_.SetTransliterator(0, composition_.GetLength(),
+                                 Transliterators::HALF_ASCII);
+  EXPECT_EQ(composition_.GetString(), "ni");
+
+  composition_.Erase();
+  EXPECT_EQ(composition_.GetString(), "");
+
+  // The copy is not affected by the edits.
+  EXPECT_EQ(copy.GetStringWithTrimMode(ASIS), "かn");
+  EXPECT_EQ(copy.GetExpandedStrings().first, "か");
+}
+
 TEST_F(CompositionTest, GetStringWithDisplayModeForKana) {
   size_t pos = 0;
   pos = composition_.InsertKeyAndPreeditAt(pos, "m", "も");
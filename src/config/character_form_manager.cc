@@ -43,6 +43,7 @@
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "base/config_file_stream.h"
 #include "base/number_util.h"
@@ -596,7 +597,12 @@ class CharacterFormManager::Data {
   CharacterFormManagerImpl *GetConversionManager() { return conversion_.get(); }
   NumberStyleManager *GetNumberStyleManager() { return number_style_.get(); }
 
+  // Guards the rules and `storage_`. The composers and the converters of the
+  // sessions on different threads read them concurrently.
+  absl::Mutex *mutex() { return &mutex_; }
+
  private:
+  absl::Mutex mutex_;
   std::unique_ptr<PreeditCharacterFormManagerImpl> preedit_;
   std::unique_ptr<ConversionCharacterFormManagerImpl> conversion_;
   std::unique_ptr<NumberStyleManager> number_style_;
@@ -659,17 +665,20 @@ std::string CharacterFormManager::ConvertWidth(std::string input,
 
 void CharacterFormManager::ConvertPreeditString(const absl::string_view input,
                                                 std::string *output) const {
+  absl::ReaderMutexLock lock(data_->mutex());
   data_->GetPreeditManager()->ConvertString(input, output);
 }
 
 void CharacterFormManager::ConvertConversionString(
     const absl::string_view input, std::string *output) const {
+  absl::ReaderMutexLock lock(data_->mutex());
   data_->GetConversionManager()->ConvertString(input, output);
 }
 
 bool CharacterFormManager::ConvertPreeditStringWithAlternative(
     const absl::string_view input, std::string *output,
     std::string *alternative_output) const {
+  absl::ReaderMutexLock lock(data_->mutex());
   return data_->GetPreeditManager()->ConvertStringWithAlternative(
       input, output, alternative_output);
 }
@@ -677,21 +686,25 @@ bool CharacterFormManager::ConvertPreeditStringWithAlternative(
 bool CharacterFormManager::ConvertConversionStringWithAlternative(
     const absl::string_view input, std::string *output,
     std::string *alternative_output) const {
+  absl::ReaderMutexLock lock(data_->mutex());
   return data_->GetConversionManager()->ConvertStringWithAlternative(
       input, output, alternative_output);
 }
 
 Config::CharacterForm CharacterFormManager::GetPreeditCharacterForm(
     const absl::string_view input) const {
+  absl::ReaderMutexLock lock(data_->mutex());
   return data_->GetPreeditManager()->GetCharacterForm(input);
 }
 
 Config::CharacterForm CharacterFormManager::GetConversionCharacterForm(
     const absl::string_view input) const {
+  absl::ReaderMutexLock lock(data_->mutex());
   return data_->GetConversionManager()->GetCharacterForm(input);
 }
 
 void CharacterFormManager::ClearHistory() {
+  absl::MutexLock lock(data_->mutex());
   // no need to call, as storage is shared
   // GetPreeditManager()->ClearHistory();
   MOZC_VLOG(1) << "CharacterFormManager::ClearHistory() is called";
@@ -699,6 +712,7 @@ void CharacterFormManager::ClearHistory() {
 }
 
 void CharacterFormManager::Clear() {
+  absl::MutexLock lock(data_->mutex());
   MOZC_VLOG(1) << "CharacterFormManager::Clear() is called";
   data_->GetConversionManager()->Clear();
   data_->GetPreeditManager()->Clear();
@@ -706,6 +720,7 @@ void CharacterFormManager::Clear() {
 
 void CharacterFormManager::SetCharacterForm(const absl::string_view input,
                                             Config::CharacterForm form) {
+  absl::MutexLock lock(data_->mutex());
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
   data_->GetConversionManager()->SetCharacterForm(input, form);
@@ -713,6 +728,7 @@ void CharacterFormManager::SetCharacterForm(const absl::string_view input,
 
 void CharacterFormManager::GuessAndSetCharacterForm(
     const absl::string_view input) {
+  absl::MutexLock lock(data_->mutex());
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
   data_->GetConversionManager()->GuessAndSetCharacterForm(input);
@@ -720,25 +736,30 @@ void CharacterFormManager::GuessAndSetCharacterForm(
 
 void CharacterFormManager::SetLastNumberStyle(
     const NumberFormStyle &form_style) {
+  absl::MutexLock lock(data_->mutex());
   data_->GetNumberStyleManager()->SetNumberStyle(form_style);
 }
 
 std::optional<const CharacterFormManager::NumberFormStyle>
 CharacterFormManager::GetLastNumberStyle() const {
+  absl::ReaderMutexLock lock(data_->mutex());
   return data_->GetNumberStyleManager()->GetNumberStyle();
 }
 
 void CharacterFormManager::AddPreeditRule(const absl::string_view input,
                                           Config::CharacterForm form) {
+  absl::MutexLock lock(data_->mutex());
   data_->GetPreeditManager()->AddRule(input, form);
 }
 
 void CharacterFormManager::AddConversionRule(const absl::string_view input,
                                              Config::CharacterForm form) {
+  absl::MutexLock lock(data_->mutex());
   data_->GetConversionManager()->AddRule(input, form);
 }
 
 void CharacterFormManager::SetDefaultRule() {
+  absl::MutexLock lock(data_->mutex());
   data_->GetPreeditManager()->SetDefaultRule();
   data_->GetConversionManager()->SetDefaultRule();
 }
@@ -0,0 +1,191 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/batch_converter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "base/thread.h"
+#include "base/util.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+
+BatchConverter::BatchConverter(
+    std::shared_ptr<const ConverterInterface> converter,
+    const commands::Request &request, const config::Config &config,
+    Options options)
+    : converter_(std::move(converter)),
+      request_(request),
+      config_(config),
+      options_(options),
+      segments_(std::max(options.num_threads, 1)) {
+  workers_.reserve(segments_.size() - 1);
+  for (size_t i = 0; i + 1 < segments_.size(); ++i) {
+    workers_.emplace_back([this, segments = &segments_[i]] {
+      WorkerLoop(segments);
+    });
+  }
+}
+
+BatchConverter::~BatchConverter() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+  }
+  for (Thread &worker : workers_) {
+    worker.Join();
+  }
+}
+
+std::vector<std::vector<std::string>> BatchConverter::Convert(
+    absl::Span<const std::string> readings) {
+  std::vector<std::vector<std::string>> results(readings.size());
+  {
+    absl::MutexLock lock(&mutex_);
+    readings_ = readings;
+    results_ = &results;
+    next_index_.store(0, std::memory_order_relaxed);
+    num_pending_ = workers_.size();
+  }
+  ConvertBatch(&segments_.back());
+  {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &BatchConverter::IsDone));
+    readings_ = {};
+    results_ = nullptr;
+  }
+  return results;
+}
+
+bool BatchConverter::HasWork() const { return stopped_ || num_pending_ > 0; }
+
+bool BatchConverter::IsDone() const {
+  return num_pending_ == 0 && num_busy_ == 0;
+}
+
+void BatchConverter::WorkerLoop(Segments *segments) {
+  mutex_.Lock();
+  while (true) {
+    mutex_.Await(absl::Condition(this, &BatchConverter::HasWork));
+    if (stopped_) {
+      break;
+    }
+    --num_pending_;
+    ++num_busy_;
+
+    mutex_.Unlock();
+    ConvertBatch(segments);
+    mutex_.Lock();
+
+    --num_busy_;
+  }
+  mutex_.Unlock();
+}
+
+void BatchConverter::ConvertBatch(Segments *segments) {
+  for (size_t i = next_index_.fetch_add(1, std::memory_order_relaxed);
+       i < readings_.size();
+       i = next_index_.fetch_add(1, std::memory_order_relaxed)) {
+    (*results_)[i] = ConvertReading(readings_[i], segments);
+  }
+}
+
+std::vector<std::string> BatchConverter::ConvertReading(
+    absl::string_view reading, Segments *segments) const {
+  std::vector<std::string> conversions;
+  if (reading.empty() || options_.num_conversions == 0) {
+    return conversions;
+  }
+
+  ConversionRequest::Options options = {
+      .request_type = ConversionRequest::CONVERSION,
+      .key = std::string(reading),
+      .enable_user_history_for_conversion = false,
+      .incognito_mode = true,
+  };
+  const ConversionRequest request = ConversionRequestBuilder()
+                                        .SetRequestView(request_)
+                                        .SetConfigView(config_)
+                                        .SetOptions(std::move(options))
+                                        .Build();
+  if (!converter_->StartConversion(request, segments)) {
+    return conversions;
+  }
+
+  std::string best;
+  for (const Segment &segment : segments->conversion_segments()) {
+    if (segment.candidates_size() == 0) {
+      return conversions;
+    }
+    best.append(segment.candidate(0).value);
+  }
+  conversions.push_back(std::move(best));
+  if (conversions.size() >= options_.num_conversions) {
+    return conversions;
+  }
+
+  // Merges the segments into one to get the alternatives of the whole reading.
+  if (segments->conversion_segments_size() > 1) {
+    const int offset_length =
+        Util::CharsLen(reading) -
+        Util::CharsLen(segments->conversion_segment(0).key());
+    if (!converter_->ResizeSegment(segments, request, 0, offset_length) ||
+        segments->conversion_segments_size() != 1) {
+      return conversions;
+    }
+  }
+  const Segment &segment = segments->conversion_segment(0);
+  for (size_t i = 0; i < segment.candidates_size() &&
+                     conversions.size() < options_.num_conversions;
+       ++i) {
+    const std::string &value = segment.candidate(i).value;
+    if (std::find(conversions.begin(), conversions.end(), value) ==
+        conversions.end()) {
+      conversions.push_back(value);
+    }
+  }
+  return conversions;
+}
+
+}  // namespace mozc
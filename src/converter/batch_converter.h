@@ -0,0 +1,121 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_CONVERTER_BATCH_CONVERTER_H_
+#define MOZC_CONVERTER_BATCH_CONVERTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "base/thread.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+
+namespace mozc {
+
+// Converts readings in bulk, e.g. for offline corpus processing, on multiple
+// threads sharing one converter. The conversions neither read nor update the
+// user history, so the converter is used read-only and the results don't
+// depend on the order or the number of threads. The worker threads live as
+// long as the BatchConverter, and each of them keeps its own Segments, whose
+// candidates and lattice nodes keep their memory across conversions.
+class BatchConverter {
+ public:
+  struct Options {
+    int num_threads = 1;
+    // The max number of conversions returned for each reading.
+    size_t num_conversions = 1;
+  };
+
+  BatchConverter(std::shared_ptr<const ConverterInterface> converter,
+                 const commands::Request &request, const config::Config &config,
+                 Options options);
+
+  BatchConverter(const BatchConverter &) = delete;
+  BatchConverter &operator=(const BatchConverter &) = delete;
+
+  ~BatchConverter();
+
+  // Returns the conversions for each of `readings` in the same order. The
+  // first conversion is the best segmented one, and the others are the best
+  // ones of the whole reading as a single segment. A reading that cannot be
+  // converted gets no conversions. The caller thread converts as well as the
+  // workers. Not thread-safe.
+  std::vector<std::vector<std::string>> Convert(
+      absl::Span<const std::string> readings);
+
+ private:
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool IsDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void WorkerLoop(Segments *segments);
+  // Converts the readings of the current batch until none is left.
+  void ConvertBatch(Segments *segments);
+  std::vector<std::string> ConvertReading(absl::string_view reading,
+                                          Segments *segments) const;
+
+  std::shared_ptr<const ConverterInterface> converter_;
+  const commands::Request request_;
+  const config::Config config_;
+  const Options options_;
+  // One for each thread. The last one is used by the caller of Convert().
+  std::vector<Segments> segments_;
+  std::vector<Thread> workers_;
+
+  // The current batch. They are set before `num_pending_` is, and the workers
+  // read them without the lock until they are done with the batch.
+  absl::Span<const std::string> readings_;
+  std::vector<std::vector<std::string>> *results_ = nullptr;
+  // The readings are handed out one by one, so that the threads stay busy even
+  // when the conversion time varies by reading.
+  std::atomic<size_t> next_index_ = 0;
+
+  absl::Mutex mutex_;
+  // The number of workers yet to start on the current batch. A worker may
+  // start on it more than once, which is harmless as the readings are handed
+  // out only once.
+  size_t num_pending_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The number of workers converting the current batch.
+  size_t num_busy_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_BATCH_CONVERTER_H_
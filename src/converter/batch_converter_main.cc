@@ -0,0 +1,204 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Converts readings in bulk and reports the throughput.
+//
+// batch_converter_main --engine_data_path=data_manager/oss/mozc.data
+//   --input=readings.txt --output=conversions.tsv --num_threads=16
+//
+// Each input line is a reading in Hiragana. Each output line is the reading
+// followed by its conversions, separated by tabs. The converter is built only
+// from the data file, so the user dictionary and the learning data in the user
+// profile are neither read nor written.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>  // NOLINT: for hardware_concurrency()
+#include <utility>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "base/file_stream.h"
+#include "base/init_mozc.h"
+#include "config/config_handler.h"
+#include "converter/batch_converter.h"
+#include "converter/converter.h"
+#include "converter/converter_interface.h"
+#include "converter/immutable_converter.h"
+#include "converter/immutable_converter_interface.h"
+#include "data_manager/data_manager.h"
+#include "dictionary/user_dictionary_stub.h"
+#include "engine/modules.h"
+#include "prediction/dictionary_predictor.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "rewriter/rewriter.h"
+
+ABSL_DECLARE_FLAG(bool, use_history_rewriter);
+
+ABSL_FLAG(std::string, engine_data_path, "data_manager/oss/mozc.data",
+          "Path to engine data file.");
+ABSL_FLAG(std::string, magic, "\xEFMOZC\r\n",
+          "Expected magic number of data file");
+ABSL_FLAG(std::string, input, "", "Input file of readings. Stdin if empty.");
+ABSL_FLAG(std::string, output, "", "Output file. Stdout if empty.");
+ABSL_FLAG(int32_t, num_threads, std::thread::hardware_concurrency(),
+          "Number of conversion threads.");
+ABSL_FLAG(int32_t, num_conversions, 1,
+          "Max number of conversions to output for each reading.");
+ABSL_FLAG(int32_t, batch_size, 10000,
+          "Number of readings to convert at once.");
+
+namespace mozc {
+namespace {
+
+void WriteConversions(
+    const std::vector<std::string> &readings,
+    const std::vector<std::vector<std::string>> &conversions,
+    std::ostream &os) {
+  for (size_t i = 0; i < readings.size(); ++i) {
+    os << readings[i];
+    if (!conversions[i].empty()) {
+      os << '\t' << absl::StrJoin(conversions[i], "\t");
+    }
+    os << '\n';
+  }
+}
+
+// Creates a converter without the components backed by the user profile, i.e.
+// the user dictionary, the user history predictor and the history rewriters.
+std::shared_ptr<const ConverterInterface> CreateConverter(
+    std::unique_ptr<const DataManager> data_manager) {
+  std::unique_ptr<engine::Modules> modules =
+      engine::ModulesPresetBuilder()
+          .PresetUserDictionary(
+              std::make_unique<dictionary::UserDictionaryStub>())
+          .Build(std::move(data_manager))
+          .value();
+  absl::SetFlag(&FLAGS_use_history_rewriter, false);
+  return std::make_shared<Converter>(
+      std::move(modules),
+      [](const engine::Modules &modules) {
+        return std::make_unique<ImmutableConverter>(modules);
+      },
+      [](const engine::Modules &modules, const ConverterInterface &converter,
+         const ImmutableConverterInterface &immutable_converter) {
+        return std::make_unique<prediction::DictionaryPredictor>(
+            modules, converter, immutable_converter);
+      },
+      [](const engine::Modules &modules) {
+        return std::make_unique<Rewriter>(modules);
+      });
+}
+
+void Run(BatchConverter &converter, std::istream &is, std::ostream &os) {
+  const size_t batch_size = std::max(absl::GetFlag(FLAGS_batch_size), 1);
+  size_t num_readings = 0;
+  size_t num_failures = 0;
+  absl::Duration conversion_time;
+
+  std::vector<std::string> readings;
+  std::string line;
+  bool eof = false;
+  while (!eof) {
+    readings.clear();
+    while (readings.size() < batch_size) {
+      if (std::getline(is, line).fail()) {
+        eof = true;
+        break;
+      }
+      readings.push_back(line);
+    }
+
+    const absl::Time start = absl::Now();
+    const std::vector<std::vector<std::string>> conversions =
+        converter.Convert(readings);
+    conversion_time += absl::Now() - start;
+
+    num_readings += readings.size();
+    for (const std::vector<std::string> &c : conversions) {
+      if (c.empty()) {
+        ++num_failures;
+      }
+    }
+    WriteConversions(readings, conversions, os);
+  }
+
+  const double seconds = absl::ToDoubleSeconds(conversion_time);
+  LOG(INFO) << "Converted " << num_readings << " readings (" << num_failures
+            << " failed) in " << conversion_time << ": "
+            << (seconds > 0 ? num_readings / seconds : 0) << " readings/sec";
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  absl::StatusOr<std::unique_ptr<const mozc::DataManager>> data_manager =
+      mozc::DataManager::CreateFromFile(absl::GetFlag(FLAGS_engine_data_path),
+                                        absl::GetFlag(FLAGS_magic));
+  CHECK_OK(data_manager);
+
+  mozc::BatchConverter converter(
+      mozc::CreateConverter(*std::move(data_manager)),
+      mozc::commands::Request::default_instance(),
+      mozc::config::ConfigHandler::DefaultConfig(),
+      {
+          .num_threads = absl::GetFlag(FLAGS_num_threads),
+          .num_conversions = static_cast<size_t>(
+              std::max(absl::GetFlag(FLAGS_num_conversions), 0)),
+      });
+
+  std::unique_ptr<mozc::InputFileStream> ifs;
+  if (!absl::GetFlag(FLAGS_input).empty()) {
+    ifs = std::make_unique<mozc::InputFileStream>(absl::GetFlag(FLAGS_input));
+  }
+  std::unique_ptr<mozc::OutputFileStream> ofs;
+  if (!absl::GetFlag(FLAGS_output).empty()) {
+    ofs = std::make_unique<mozc::OutputFileStream>(absl::GetFlag(FLAGS_output));
+  }
+  mozc::Run(converter, ifs ? *ifs : std::cin, ofs ? *ofs : std::cout);
+  return 0;
+}
@@ -0,0 +1,170 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/batch_converter.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Return;
+
+void AddSegment(absl::string_view key, absl::Span<const std::string> values,
+                Segments *segments) {
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  for (const std::string &value : values) {
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->key = std::string(key);
+    candidate->value = value;
+  }
+}
+
+// Converts "<n>" into two segments, "<n>" and "です", and merges them into one
+// with two alternatives.
+void SetUpConverter(MockConverter &converter) {
+  EXPECT_CALL(converter, StartConversion(_, _))
+      .WillRepeatedly([](const ConversionRequest &request, Segments *segments) {
+        segments->Clear();
+        const std::string key(request.key());
+        if (key == "x") {
+          return false;
+        }
+        AddSegment(key.substr(0, key.size() - 6), {"N"}, segments);
+        AddSegment("です", {"です", "デス"}, segments);
+        return true;
+      });
+  EXPECT_CALL(converter, ResizeSegment(_, _, 0, 2))
+      .WillRepeatedly([](Segments *segments, const ConversionRequest &request,
+                         size_t, int) {
+        segments->Clear();
+        const std::string key(request.key());
+        AddSegment(key, {"Nです", "N です", "Nデス"}, segments);
+        return true;
+      });
+}
+
+TEST(BatchConverterTest, Convert) {
+  auto mock = std::make_shared<MockConverter>();
+  SetUpConverter(*mock);
+  BatchConverter converter(mock, commands::Request(), config::Config(),
+                           {.num_threads = 1, .num_conversions = 3});
+
+  const std::vector<std::string> readings = {"1です", "x", ""};
+  EXPECT_THAT(converter.Convert(readings),
+              ElementsAre(ElementsAre("Nです", "N です", "Nデス"), IsEmpty(),
+                          IsEmpty()));
+}
+
+TEST(BatchConverterTest, BestConversionOnly) {
+  auto mock = std::make_shared<MockConverter>();
+  SetUpConverter(*mock);
+  EXPECT_CALL(*mock, ResizeSegment(_, _, _, _)).Times(0);
+  BatchConverter converter(mock, commands::Request(), config::Config(),
+                           {.num_threads = 1, .num_conversions = 1});
+
+  const std::vector<std::string> readings = {"1です"};
+  EXPECT_THAT(converter.Convert(readings), ElementsAre(ElementsAre("Nです")));
+}
+
+TEST(BatchConverterTest, ResultsKeepInputOrder) {
+  auto mock = std::make_shared<MockConverter>();
+  EXPECT_CALL(*mock, StartConversion(_, _))
+      .WillRepeatedly([](const ConversionRequest &request, Segments *segments) {
+        segments->Clear();
+        AddSegment(request.key(), {absl::StrCat("<", request.key(), ">")},
+                   segments);
+        return true;
+      });
+  BatchConverter converter(mock, commands::Request(), config::Config(),
+                           {.num_threads = 8, .num_conversions = 1});
+
+  std::vector<std::string> readings;
+  for (int i = 0; i < 1000; ++i) {
+    readings.push_back(absl::StrCat(i));
+  }
+  for (int trial = 0; trial < 2; ++trial) {
+    const std::vector<std::vector<std::string>> results =
+        converter.Convert(readings);
+    ASSERT_EQ(results.size(), readings.size());
+    for (size_t i = 0; i < readings.size(); ++i) {
+      EXPECT_THAT(results[i], ElementsAre(absl::StrCat("<", i, ">")));
+    }
+  }
+}
+
+TEST(BatchConverterTest, ManyBatches) {
+  auto mock = std::make_shared<MockConverter>();
+  EXPECT_CALL(*mock, StartConversion(_, _))
+      .WillRepeatedly([](const ConversionRequest &request, Segments *segments) {
+        segments->Clear();
+        AddSegment(request.key(), {absl::StrCat("<", request.key(), ">")},
+                   segments);
+        return true;
+      });
+  BatchConverter converter(mock, commands::Request(), config::Config(),
+                           {.num_threads = 4, .num_conversions = 1});
+
+  // The batches are smaller than the number of threads, so some of the
+  // workers get no readings.
+  for (int size = 0; size < 100; ++size) {
+    std::vector<std::string> readings;
+    for (int i = 0; i < size % 6; ++i) {
+      readings.push_back(absl::StrCat(size, "-", i));
+    }
+    const std::vector<std::vector<std::string>> results =
+        converter.Convert(readings);
+    ASSERT_EQ(results.size(), readings.size());
+    for (size_t i = 0; i < readings.size(); ++i) {
+      EXPECT_THAT(results[i], ElementsAre(absl::StrCat("<", readings[i], ">")));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mozc
@@ -60,6 +60,7 @@ void Candidate::Clear() {
   prefix.clear();
   suffix.clear();
   description.clear();
+  a11y_description.clear();
   usage_title.clear();
   usage_description.clear();
   cost = 0;
@@ -70,9 +71,11 @@ void Candidate::Clear() {
   usage_id = 0;
   attributes = 0;
   source_info = SOURCE_INFO_NONE;
+  category = DEFAULT_CATEGORY;
   style = NumberUtil::NumberString::DEFAULT_STYLE;
   command = DEFAULT_COMMAND;
   inner_segment_boundary.clear();
+  cost_before_rescoring = 0;
 #ifdef MOZC_CANDIDATE_DEBUG
   log.clear();
 #endif  // MOZC_CANDIDATE_DEBUG
@@ -43,13 +43,29 @@
 #include "absl/algorithm/container.h"
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
+#include "absl/flags/flag.h"
+#include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/bits.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/mmap.h"
+#include "base/strings/zstring_view.h"
 #include "data_manager/data_manager.h"
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
+
+ABSL_FLAG(bool, use_dense_connection_matrix, false,
+          "Expands the connection matrix into a dense array for faster "
+          "lookups at the cost of memory.");
+ABSL_FLAG(std::string, dense_connection_matrix_file, "",
+          "If set with --use_dense_connection_matrix, the dense connection "
+          "matrix is mapped from this file. The file is created if it doesn't "
+          "exist or doesn't match the connection data.");
 
 namespace mozc {
 namespace {
@@ -58,6 +74,20 @@ constexpr uint32_t kInvalidCacheKey = 0xFFFFFFFF;
 constexpr uint16_t kConnectorMagicNumber = 0xCDAB;
 constexpr uint8_t kInvalid1ByteCostValue = 255;
 
+// The value in the dense matrix for the costs not representable in int16_t,
+// e.g. kInvalidCost * resolution. They are looked up from the rows instead.
+constexpr int16_t kDenseMatrixOverflowCost =
+    std::numeric_limits<int16_t>::max();
+
+// The dense matrix file is formatted as follows:
+// +----------+----------+-------------+--------------------------+
+// | uint32_t | uint32_t |  uint64_t   | int16_t[lsize * lsize]   |
+// |  magic   |  lsize   | fingerprint | costs (rid * lsize + lid)|
+// +----------+----------+-------------+--------------------------+
+// The fingerprint is the one of the connection data the matrix is built from.
+constexpr uint32_t kDenseMatrixMagicNumber = 0x4D44435A;  // "ZCDM"
+constexpr size_t kDenseMatrixHeaderSize = 16;
+
 inline uint32_t GetHashValue(uint16_t rid, uint16_t lid, uint32_t hash_mask) {
   return (3 * static_cast<uint32_t>(rid) + lid) & hash_mask;
   // Note: The above value is equivalent to
@@ -180,7 +210,33 @@ absl::StatusOr<Connector> Connector::CreateFromDataManager(
 #else   // __ANDROID__
   constexpr int kCacheSize = 1024;
 #endif  // __ANDROID__
-  return Create(data_manager.GetConnectorData(), kCacheSize);
+  absl::StatusOr<Connector> connector =
+      Create(data_manager.GetConnectorData(), kCacheSize);
+  if (!connector.ok() || !absl::GetFlag(FLAGS_use_dense_connection_matrix)) {
+    return connector;
+  }
+
+  // The dense matrix is an optimization, so the failures are not fatal.
+  const std::string filename =
+      absl::GetFlag(FLAGS_dense_connection_matrix_file);
+  if (!filename.empty()) {
+    const absl::Status status = connector->MapDenseMatrix(filename);
+    if (status.ok()) {
+      return connector;
+    }
+    LOG(INFO) << "Cannot map the dense connection matrix: " << status;
+  }
+  if (absl::Status status = connector->ExpandToDenseMatrix(); !status.ok()) {
+    LOG(WARNING) << "Cannot expand the connection matrix: " << status;
+    return connector;
+  }
+  if (!filename.empty()) {
+    if (absl::Status status = connector->WriteDenseMatrix(filename);
+        !status.ok()) {
+      LOG(WARNING) << "Cannot write the dense connection matrix: " << status;
+    }
+  }
+  return connector;
 }
 
 absl::StatusOr<Connector> Connector::Create(absl::string_view connection_data,
@@ -209,6 +265,8 @@ absl::Status Connector::Init(absl::string_view connection_data,
     return std::move(metadata).status();
   }
   resolution_ = metadata->resolution;
+  lsize_ = metadata->lsize;
+  connection_data_ = connection_data;
 
   // Set the read location to the metadata end.
   const char *ptr = connection_data.data() + Metadata::kByteSize;
@@ -305,6 +363,12 @@ absl::Status Connector::Init(absl::string_view connection_data,
 }
 
 int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
+  if (!dense_matrix_.empty()) {
+    const int16_t cost = dense_matrix_[static_cast<size_t>(rid) * lsize_ + lid];
+    if (cost != kDenseMatrixOverflowCost) {
+      return cost;
+    }
+  }
   const uint32_t index = EncodeKey(rid, lid);
   const uint32_t bucket = GetHashValue(rid, lid, cache_hash_mask_);
   // don't care the memory order. atomic access is only required.
@@ -325,6 +389,69 @@ void Connector::ClearCache() {
   }
 }
 
+absl::Status Connector::ExpandToDenseMatrix() {
+  const size_t rsize = rows_.size();
+  std::vector<int16_t> buffer(rsize * lsize_);
+  for (size_t rid = 0; rid < rsize; ++rid) {
+    for (size_t lid = 0; lid < lsize_; ++lid) {
+      const int cost = LookupCost(rid, lid);
+      buffer[rid * lsize_ + lid] =
+          (cost >= 0 && cost < kDenseMatrixOverflowCost)
+              ? cost
+              : kDenseMatrixOverflowCost;
+    }
+  }
+  dense_matrix_mmap_.reset();
+  dense_matrix_buffer_ = std::move(buffer);
+  dense_matrix_ = dense_matrix_buffer_;
+  return absl::OkStatus();
+}
+
+absl::Status Connector::MapDenseMatrix(zstring_view filename) {
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename);
+  if (!mmap.ok()) {
+    return std::move(mmap).status();
+  }
+  const size_t num_costs = rows_.size() * lsize_;
+  if (mmap->size() != kDenseMatrixHeaderSize + num_costs * sizeof(int16_t)) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("connector.cc: Unexpected size of ", filename.view(),
+                     ": ", mmap->size()));
+  }
+  const char *ptr = mmap->data();
+  const uint32_t magic = LoadUnalignedAdvance<uint32_t>(ptr);
+  const uint32_t lsize = LoadUnalignedAdvance<uint32_t>(ptr);
+  const uint64_t fingerprint = LoadUnalignedAdvance<uint64_t>(ptr);
+  if (magic != kDenseMatrixMagicNumber || lsize != lsize_ ||
+      fingerprint != Fingerprint(connection_data_)) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "connector.cc: ", filename.view(),
+        " is not built from the current connection data"));
+  }
+  dense_matrix_buffer_.clear();
+  dense_matrix_buffer_.shrink_to_fit();
+  // The mapped region is page aligned, so is the array after the header.
+  dense_matrix_ = absl::MakeConstSpan(
+      reinterpret_cast<const int16_t *>(ptr), num_costs);
+  dense_matrix_mmap_ = *std::move(mmap);
+  return absl::OkStatus();
+}
+
+absl::Status Connector::WriteDenseMatrix(zstring_view filename) const {
+  if (dense_matrix_.empty()) {
+    return absl::FailedPreconditionError(
+        "connector.cc: The dense matrix is not available");
+  }
+  std::string contents(kDenseMatrixHeaderSize, '\0');
+  char *ptr = contents.data();
+  ptr = StoreUnaligned<uint32_t>(kDenseMatrixMagicNumber, ptr);
+  ptr = StoreUnaligned<uint32_t>(lsize_, ptr);
+  StoreUnaligned<uint64_t>(Fingerprint(connection_data_), ptr);
+  contents.append(reinterpret_cast<const char *>(dense_matrix_.data()),
+                  dense_matrix_.size() * sizeof(int16_t));
+  return FileUtil::SetContents(filename, contents);
+}
+
 int Connector::LookupCost(uint16_t rid, uint16_t lid) const {
   std::optional<uint16_t> value = rows_[rid].GetValue(lid);
   if (!value.has_value()) {
@@ -33,13 +33,18 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/mmap.h"
+#include "base/strings/zstring_view.h"
 #include "data_manager/data_manager.h"
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
 
 namespace mozc {
 
@@ -58,6 +63,22 @@ class Connector final {
 
   void ClearCache();
 
+  // Expands the connection matrix into a dense array of int16_t costs, so that
+  // GetTransitionCost() becomes a single indexed load. The array takes
+  // 2 * rsize * lsize bytes (about 14 MB for the OSS data), so this is meant
+  // for the environments where the memory is cheap, e.g. servers.
+  absl::Status ExpandToDenseMatrix();
+
+  // Maps the dense matrix from the file written by WriteDenseMatrix() instead
+  // of expanding it. Fails if the file was created from different connection
+  // data.
+  absl::Status MapDenseMatrix(zstring_view filename);
+
+  // Writes the dense matrix to the file. The matrix must be expanded or mapped.
+  absl::Status WriteDenseMatrix(zstring_view filename) const;
+
+  bool HasDenseMatrix() const { return !dense_matrix_.empty(); }
+
  private:
   class Row;
 
@@ -68,6 +89,15 @@ class Connector final {
   std::vector<Row> rows_;
   const uint16_t *default_cost_ = nullptr;
   int resolution_ = 0;
+  uint16_t lsize_ = 0;
+  // The connection data, whose fingerprint validates the mapped dense matrix.
+  // It is computed only when the dense matrix is mapped or written.
+  absl::string_view connection_data_;
+  // Dense matrix of costs indexed by rid * lsize_ + lid. It points to either
+  // `dense_matrix_buffer_` or `dense_matrix_mmap_`.
+  absl::Span<const int16_t> dense_matrix_;
+  std::vector<int16_t> dense_matrix_buffer_;
+  std::optional<Mmap> dense_matrix_mmap_;
   uint32_t cache_hash_mask_ = 0;
   // Cache for transition cost.
   using cache_t = std::vector<std::atomic<uint64_t>>;
@@ -76,9 +106,7 @@ class Connector final {
 
 class Connector::Row final {
  public:
-  Row()
-      : chunk_bits_index_(sizeof(uint32_t)),
-        compact_bits_index_(sizeof(uint32_t)) {}
+  Row() = default;
 
   void Init(const uint8_t *chunk_bits, size_t chunk_bits_size,
             const uint8_t *compact_bits, size_t compact_bits_size,
@@ -87,8 +115,8 @@ class Connector::Row final {
   std::optional<uint16_t> GetValue(uint16_t index) const;
 
  private:
-  storage::louds::SimpleSuccinctBitVectorIndex chunk_bits_index_;
-  storage::louds::SimpleSuccinctBitVectorIndex compact_bits_index_;
+  storage::louds::RankSelectBitVectorIndex chunk_bits_index_;
+  storage::louds::RankSelectBitVectorIndex compact_bits_index_;
   const uint8_t *values_ = nullptr;
   bool use_1byte_value_ = false;
 };
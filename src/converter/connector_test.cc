@@ -38,6 +38,7 @@
 
 #include "absl/random/random.h"
 #include "absl/status/statusor.h"
+#include "base/file/temp_dir.h"
 #include "base/mmap.h"
 #include "base/vlog.h"
 #include "data_manager/connection_file_reader.h"
@@ -92,6 +93,55 @@ TEST(ConnectorTest, CompareWithRawData) {
   }
 }
 
+TEST(ConnectorTest, DenseMatrix) {
+  const std::string path = testing::GetSourceFileOrDie(
+      {MOZC_SRC_COMPONENTS("data_manager"), "testing", "connection.data"});
+  absl::StatusOr<Mmap> cmmap = Mmap::Map(path);
+  ASSERT_OK(cmmap) << cmmap.status();
+  absl::StatusOr<Connector> expected =
+      Connector::Create(cmmap->string_view(), 256);
+  ASSERT_OK(expected);
+  absl::StatusOr<Connector> dense =
+      Connector::Create(cmmap->string_view(), 256);
+  ASSERT_OK(dense);
+  EXPECT_FALSE(dense->HasDenseMatrix());
+  ASSERT_OK(dense->ExpandToDenseMatrix());
+  EXPECT_TRUE(dense->HasDenseMatrix());
+
+  const uint16_t size = reinterpret_cast<const uint16_t *>(cmmap->data())[2];
+  for (uint16_t rid = 0; rid < size; ++rid) {
+    for (uint16_t lid = 0; lid < size; ++lid) {
+      ASSERT_EQ(dense->GetTransitionCost(rid, lid),
+                expected->GetTransitionCost(rid, lid))
+          << rid << ", " << lid;
+    }
+  }
+
+  // Round trip via the file.
+  const TempFile file = testing::MakeTempFileOrDie();
+  ASSERT_OK(dense->WriteDenseMatrix(file.path()));
+  absl::StatusOr<Connector> mapped =
+      Connector::Create(cmmap->string_view(), 256);
+  ASSERT_OK(mapped);
+  ASSERT_OK(mapped->MapDenseMatrix(file.path()));
+  EXPECT_TRUE(mapped->HasDenseMatrix());
+  for (uint16_t rid = 0; rid < size; ++rid) {
+    for (uint16_t lid = 0; lid < size; ++lid) {
+      ASSERT_EQ(mapped->GetTransitionCost(rid, lid),
+                expected->GetTransitionCost(rid, lid))
+          << rid << ", " << lid;
+    }
+  }
+
+  // The file is rejected for different connection data.
+  std::string data(cmmap->begin(), cmmap->size());
+  data.back() ^= 1;
+  absl::StatusOr<Connector> modified = Connector::Create(data, 256);
+  ASSERT_OK(modified);
+  EXPECT_FALSE(modified->MapDenseMatrix(file.path()).ok());
+  EXPECT_FALSE(modified->HasDenseMatrix());
+}
+
 TEST(ConnectorTest, BrokenData) {
   const std::string path = testing::GetSourceFileOrDie(
       {MOZC_SRC_COMPONENTS("data_manager"), "testing", "connection.data"});
@@ -55,9 +55,10 @@
         'connector.cc',
       ],
       'dependencies': [
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_flags',
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_status',
         '<(mozc_oss_src_dir)/base/base.gyp:base',
-        '<(mozc_oss_src_dir)/storage/louds/louds.gyp:simple_succinct_bit_vector_index',
+        '<(mozc_oss_src_dir)/storage/louds/louds.gyp:rank_select_bit_vector_index',
       ],
     },
     {
@@ -50,6 +50,7 @@
 #include "absl/types/span.h"
 #include "base/container/trie.h"
 #include "base/japanese_util.h"
+#include "base/latency_stats.h"
 #include "base/strings/unicode.h"
 #include "base/util.h"
 #include "base/vlog.h"
@@ -920,12 +921,16 @@ namespace {
 class CachingConnector final {
  public:
   explicit CachingConnector(const Connector &connector)
-      : connector_{connector} {}
+      : connector_{connector},
+        use_dense_matrix_{connector.HasDenseMatrix()} {}
 
   CachingConnector(const CachingConnector &) = delete;
   CachingConnector &operator=(const CachingConnector &) = delete;
 
   void ResetCacheIfNecessary(uint16_t rnode_lid) {
+    if (use_dense_matrix_) {
+      return;
+    }
     if (cache_lid_ != rnode_lid) {
       absl::c_fill(cache_, -1);
       cache_lid_ = rnode_lid;
@@ -933,6 +938,10 @@ class CachingConnector final {
   }
 
   int GetTransitionCost(uint16_t lnode_rid, uint16_t rnode_lid) {
+    // The dense matrix is already a single load, so the cache doesn't help.
+    if (use_dense_matrix_) {
+      return connector_.GetTransitionCost(lnode_rid, rnode_lid);
+    }
     DCHECK_EQ(cache_lid_, rnode_lid);
     // Values for rid >= kCacheSize cannot be cached. However, frequent PoSs
     // have smaller IDs, so caching only for rid in [0, kCacheSize) works well.
@@ -950,6 +959,7 @@ class CachingConnector final {
   constexpr static int kCacheSize = 2048;
 
   const Connector &connector_;
+  const bool use_dense_matrix_;
   std::array<int, kCacheSize> cache_;
   uint16_t cache_lid_ = std::numeric_limits<uint16_t>::max();
 };
@@ -1008,11 +1018,109 @@ inline void ViterbiInternal(const Connector &connector, size_t pos,
     rnode->cost = best_cost + rnode->wcost;
   }
 }
+
+// The valid end nodes at a position packed into arrays (struct of arrays).
+// Viterbi looks up the left nodes for every right node at the position, so
+// packing them once saves chasing Node::enext for each right node, and the
+// minimum over the left nodes is computed by plain loops over contiguous
+// arrays, which the compiler can vectorize.
+class PackedEndNodes final {
+ public:
+  void Pack(const Lattice &lattice, size_t pos) {
+    rids_.clear();
+    costs_.clear();
+    nodes_.clear();
+    for (Node *lnode = lattice.end_nodes(pos); lnode != nullptr;
+         lnode = lnode->enext) {
+      if (lnode->prev == nullptr) {
+        // Invalid lnode.
+        continue;
+      }
+      rids_.push_back(lnode->rid);
+      costs_.push_back(lnode->cost);
+      nodes_.push_back(lnode);
+    }
+    totals_.resize(nodes_.size());
+  }
+
+  // Finds the left node which connects to a right node of `rnode_lid` with the
+  // minimum cost. Returns the node and the cost, or nullptr and kVeryBigCost
+  // if no node has a cost less than kVeryBigCost. Ties are broken by the order
+  // of the end nodes, as ViterbiInternal() does.
+  std::pair<Node *, int> FindBest(CachingConnector &conn, uint16_t rnode_lid) {
+    const size_t size = nodes_.size();
+    for (size_t i = 0; i < size; ++i) {
+      totals_[i] = conn.GetTransitionCost(rids_[i], rnode_lid);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      totals_[i] += costs_[i];
+    }
+    int best_cost = kVeryBigCost;
+    for (size_t i = 0; i < size; ++i) {
+      best_cost = std::min(best_cost, totals_[i]);
+    }
+    if (best_cost == kVeryBigCost) {
+      return {nullptr, kVeryBigCost};
+    }
+    const auto best_iter = absl::c_find(totals_, best_cost);
+    return {nodes_[best_iter - totals_.begin()], best_cost};
+  }
+
+ private:
+  std::vector<uint16_t> rids_;
+  std::vector<int> costs_;
+  std::vector<Node *> nodes_;
+  // Buffer for the total costs.
+  std::vector<int> totals_;
+};
+
+// Same as ViterbiInternal() but looks up the left nodes from the packed end
+// nodes.
+inline void PackedViterbiInternal(const Connector &connector, size_t pos,
+                                  size_t right_boundary, Lattice *lattice,
+                                  PackedEndNodes &packed) {
+  CachingConnector conn(connector);
+  packed.Pack(*lattice, pos);
+  for (Node *rnode = lattice->begin_nodes(pos); rnode != nullptr;
+       rnode = rnode->bnext) {
+    if (rnode->end_pos > right_boundary) {
+      // Invalid rnode.
+      rnode->prev = nullptr;
+      continue;
+    }
+
+    conn.ResetCacheIfNecessary(rnode->lid);
+
+    if (rnode->constrained_prev != nullptr) {
+      // Constrained node.
+      if (rnode->constrained_prev->prev == nullptr) {
+        rnode->prev = nullptr;
+      } else {
+        rnode->prev = rnode->constrained_prev;
+        rnode->cost = rnode->prev->cost + rnode->wcost +
+                      conn.GetTransitionCost(rnode->prev->rid, rnode->lid);
+      }
+      continue;
+    }
+
+    const auto [best_node, best_cost] = packed.FindBest(conn, rnode->lid);
+    rnode->prev = best_node;
+    rnode->cost = best_cost + rnode->wcost;
+  }
+}
 }  // namespace
 
-bool ImmutableConverter::Viterbi(const Segments &segments,
-                                 Lattice *lattice) const {
+bool ImmutableConverter::Viterbi(const Segments &segments, Lattice *lattice,
+                                 bool use_packed_end_nodes) const {
   absl::string_view key = lattice->key();
+  PackedEndNodes packed;
+  auto viterbi_internal = [&](size_t pos, size_t right_boundary) {
+    if (use_packed_end_nodes) {
+      PackedViterbiInternal(connector_, pos, right_boundary, lattice, packed);
+    } else {
+      ViterbiInternal(connector_, pos, right_boundary, lattice);
+    }
+  };
 
   // Process BOS.
   {
@@ -1048,7 +1156,7 @@ bool ImmutableConverter::Viterbi(const Segments &segments,
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
     for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(connector_, pos, right_boundary, lattice);
+      viterbi_internal(pos, right_boundary);
     }
     left_boundary = right_boundary;
   }
@@ -1058,7 +1166,7 @@ bool ImmutableConverter::Viterbi(const Segments &segments,
     // Run Viterbi for each position the segment.
     const size_t right_boundary = left_boundary + segment.key().size();
     for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(connector_, pos, right_boundary, lattice);
+      viterbi_internal(pos, right_boundary);
     }
     left_boundary = right_boundary;
   }
@@ -1170,7 +1278,7 @@ namespace {
 // most cases. So, in order to avoid too many allocations for internal
 // nodes of std::map, we use vector of key-value pairs.
 using CostAndNode = std::pair<int, Node *>;
-using BestMap = std::vector<std::pair<int, CostAndNode>>;
+using BestMap = Lattice::ViterbiColumn::BestMap;
 
 BestMap::iterator LowerBound(BestMap &best_map,
                              const std::pair<int, CostAndNode> &key) {
@@ -1182,6 +1290,20 @@ BestMap::iterator LowerBound(BestMap &best_map,
 
 }  // namespace
 
+// The best transitions are memoized per position in the lattice. While the
+// user types, the nodes ending at the unchanged prefix of the key keep their
+// costs, so those positions only compute the transitions for lids that have
+// not been seen there yet, e.g. the lids of the nodes newly looked up for the
+// extended key. Positions whose lbest differs from the memoized one are
+// relaxed from scratch.
+//
+// This is only partly incremental: every position from |calc_begin_pos| is
+// still visited to rebuild its lbest and to set the costs of the nodes
+// starting there. MakeLattice() inserts nodes at any position and
+// ResetNodeCost() and ApplyPrefixSuffixPenalty() rewrite the wcosts at the
+// start of the conversion key on every call, so there is no cheap way to tell
+// the first position whose nodes changed. Only the transition costs, which
+// dominate the time, are skipped.
 void ImmutableConverter::PredictionViterbiInternal(int calc_begin_pos,
                                                    int calc_end_pos,
                                                    Lattice *lattice) const {
@@ -1213,6 +1335,13 @@ void ImmutableConverter::PredictionViterbiInternal(int calc_begin_pos,
       continue;
     }
 
+    Lattice::ViterbiColumn *column = lattice->mutable_viterbi_column(pos);
+    if (column->lbest != lbest) {
+      column->lbest.swap(lbest);
+      column->rbest.clear();
+    }
+
+    // Collects the lids whose best transitions are not memoized yet.
     rbest.clear();
     Node *rnode_begin = lattice->begin_nodes(pos);
     for (Node *rnode = rnode_begin; rnode != nullptr; rnode = rnode->bnext) {
@@ -1220,27 +1349,43 @@ void ImmutableConverter::PredictionViterbiInternal(int calc_begin_pos,
         continue;
       }
       const BestMap::value_type key(rnode->lid, kInvalidValue);
+      const BestMap::const_iterator memo_iter = LowerBound(column->rbest, key);
+      if (memo_iter != column->rbest.end() && memo_iter->first == rnode->lid) {
+        continue;
+      }
       const BestMap::const_iterator iter = LowerBound(rbest, key);
       if (iter == rbest.end() || iter->first != rnode->lid) {
         rbest.insert(iter, key);
       }
     }
 
-    if (rbest.empty()) {
-      continue;
-    }
-
-    for (BestMap::iterator liter = lbest.begin(); liter != lbest.end();
-         ++liter) {
-      for (BestMap::iterator riter = rbest.begin(); riter != rbest.end();
-           ++riter) {
-        const int cost = liter->second.first + connector_.GetTransitionCost(
-                                                   liter->first, riter->first);
-        if (cost < riter->second.first) {
-          riter->second.first = cost;
-          riter->second.second = liter->second.second;
+    if (!rbest.empty()) {
+      for (BestMap::iterator liter = column->lbest.begin();
+           liter != column->lbest.end(); ++liter) {
+        for (BestMap::iterator riter = rbest.begin(); riter != rbest.end();
+             ++riter) {
+          const int cost =
+              liter->second.first +
+              connector_.GetTransitionCost(liter->first, riter->first);
+          if (cost < riter->second.first) {
+            riter->second.first = cost;
+            riter->second.second = liter->second.second;
+          }
         }
       }
+      const size_t memo_size = column->rbest.size();
+      column->rbest.insert(column->rbest.end(), rbest.begin(), rbest.end());
+      std::inplace_merge(
+          column->rbest.begin(), column->rbest.begin() + memo_size,
+          column->rbest.end(),
+          [](const std::pair<int, CostAndNode> &l,
+             const std::pair<int, CostAndNode> &r) {
+            return l.first < r.first;
+          });
+    }
+
+    if (column->rbest.empty()) {
+      continue;
     }
 
     for (Node *rnode = rnode_begin; rnode != nullptr; rnode = rnode->bnext) {
@@ -1248,8 +1393,8 @@ void ImmutableConverter::PredictionViterbiInternal(int calc_begin_pos,
         continue;
       }
       const BestMap::value_type key(rnode->lid, kInvalidValue);
-      const BestMap::const_iterator iter = LowerBound(rbest, key);
-      if (iter == rbest.end() || iter->first != rnode->lid ||
+      const BestMap::const_iterator iter = LowerBound(column->rbest, key);
+      if (iter == column->rbest.end() || iter->first != rnode->lid ||
           iter->second.second == nullptr) {
         continue;
       }
@@ -2132,30 +2277,43 @@ bool ImmutableConverter::ConvertForRequest(const ConversionRequest &request,
 
   Lattice *lattice = GetLattice(segments, is_prediction);
 
-  if (!MakeLattice(request, segments, lattice)) {
-    LOG(WARNING) << "could not make lattice";
-    return false;
+  {
+    ScopedLatencyTimer timer("converter/make_lattice");
+    if (!MakeLattice(request, segments, lattice)) {
+      LOG(WARNING) << "could not make lattice";
+      return false;
+    }
   }
+  LatencyStats::Increment("converter/lattice_nodes",
+                          lattice->node_allocator()->node_count());
 
   std::vector<uint16_t> group;
   MakeGroup(*segments, &group);
 
   if (is_prediction) {
+    ScopedLatencyTimer timer("converter/prediction_viterbi");
     if (!PredictionViterbi(*segments, lattice)) {
       LOG(WARNING) << "prediction_viterbi failed";
       return false;
     }
   } else {
-    if (!Viterbi(*segments, lattice)) {
+    ScopedLatencyTimer timer("converter/viterbi");
+    const bool use_packed_end_nodes =
+        request.request().decoder_experiment_params().use_packed_viterbi();
+    if (!Viterbi(*segments, lattice, use_packed_end_nodes)) {
       LOG(WARNING) << "viterbi failed";
       return false;
     }
   }
 
   MOZC_VLOG(2) << lattice->DebugString();
-  if (!MakeSegments(request, *lattice, group, segments)) {
-    LOG(WARNING) << "make segments failed";
-    return false;
+  {
+    // Dominated by the N-best enumeration of NBestGenerator.
+    ScopedLatencyTimer timer("converter/make_segments");
+    if (!MakeSegments(request, *lattice, group, segments)) {
+      LOG(WARNING) << "make segments failed";
+      return false;
+    }
   }
 
   return true;
@@ -70,6 +70,7 @@ class ImmutableConverter : public ImmutableConverterInterface {
   FRIEND_TEST(ImmutableConverterTest, DummyCandidatesInnerSegmentBoundary);
   FRIEND_TEST(ImmutableConverterTest, MakeLatticeKatakana);
   FRIEND_TEST(ImmutableConverterTest, NotConnectedTest);
+  FRIEND_TEST(ImmutableConverterTest, PackedViterbi);
   FRIEND_TEST(ImmutableConverterTest, PredictiveNodesOnlyForConversionKey);
   FRIEND_TEST(NBestGeneratorTest, InnerSegmentBoundary);
   FRIEND_TEST(NBestGeneratorTest, MultiSegmentConnectionTest);
@@ -127,7 +128,11 @@ class ImmutableConverter : public ImmutableConverterInterface {
   void ApplyPrefixSuffixPenalty(absl::string_view conversion_key,
                                 Lattice *lattice) const;
 
-  bool Viterbi(const Segments &segments, Lattice *lattice) const;
+  // If `use_packed_end_nodes` is true, the end nodes at each position are
+  // packed into arrays before the right nodes are visited. The result is the
+  // same as the default implementation.
+  bool Viterbi(const Segments &segments, Lattice *lattice,
+               bool use_packed_end_nodes = false) const;
 
   bool PredictionViterbi(const Segments &segments, Lattice *lattice) const;
   void PredictionViterbiInternal(int calc_begin_pos, int calc_end_pos,
@@ -38,6 +38,7 @@
 #include <vector>
 
 #include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "base/util.h"
 #include "converter/lattice.h"
@@ -434,6 +435,107 @@ TEST(ImmutableConverterTest, NotConnectedTest) {
   EXPECT_TRUE(tested);
 }
 
+TEST(ImmutableConverterTest, PackedViterbi) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverter *converter = data_and_converter->GetConverter();
+
+  constexpr absl::string_view kFirstKey = "しょうめい";
+  constexpr absl::string_view kSecondKey =
+      "わたしのなまえはなかのですきょうはいいてんきですね"
+      "あしたもはれるでしょう";
+  const std::string key = absl::StrCat(kFirstKey, kSecondKey);
+
+  // Long unsegmented input and the one with a fixed boundary.
+  for (const bool fixed_boundary : {false, true}) {
+    Segments segments;
+    Segment *segment = segments.add_segment();
+    if (fixed_boundary) {
+      segment->set_segment_type(Segment::FIXED_BOUNDARY);
+      segment->set_key(kFirstKey);
+      segment = segments.add_segment();
+      segment->set_key(kSecondKey);
+    } else {
+      segment->set_key(key);
+    }
+
+    const ConversionRequest request;
+    Lattice expected;
+    expected.SetKey(key);
+    converter->MakeLattice(request, &segments, &expected);
+    ASSERT_TRUE(converter->Viterbi(segments, &expected));
+
+    Lattice actual;
+    actual.SetKey(key);
+    converter->MakeLattice(request, &segments, &actual);
+    ASSERT_TRUE(converter->Viterbi(segments, &actual,
+                                   /*use_packed_end_nodes=*/true));
+
+    // The lattices are built in the same order, so the nodes correspond.
+    for (size_t pos = 0; pos <= key.size(); ++pos) {
+      const Node *expected_node = expected.begin_nodes(pos);
+      const Node *actual_node = actual.begin_nodes(pos);
+      for (; expected_node != nullptr && actual_node != nullptr;
+           expected_node = expected_node->bnext,
+           actual_node = actual_node->bnext) {
+        EXPECT_EQ(actual_node->cost, expected_node->cost) << pos;
+        ASSERT_EQ(actual_node->prev == nullptr, expected_node->prev == nullptr)
+            << pos;
+        if (expected_node->prev != nullptr) {
+          EXPECT_EQ(actual_node->prev->begin_pos,
+                    expected_node->prev->begin_pos);
+          EXPECT_EQ(actual_node->prev->value, expected_node->prev->value);
+          EXPECT_EQ(actual_node->prev->rid, expected_node->prev->rid);
+        }
+      }
+      EXPECT_EQ(actual_node, nullptr);
+      EXPECT_EQ(expected_node, nullptr);
+    }
+    EXPECT_EQ(actual.eos_nodes()->cost, expected.eos_nodes()->cost);
+  }
+}
+
+TEST(ImmutableConverterTest, IncrementalPredictionViterbi) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverter *converter = data_and_converter->GetConverter();
+  const ConversionRequest request =
+      ConversionRequestBuilder()
+          .SetOptions({.request_type = ConversionRequest::SUGGESTION,
+                       .max_conversion_candidates_size = 1})
+          .Build();
+
+  // Types the key character by character, then deletes some characters and
+  // types different ones. The memoized Viterbi state of the cached lattice
+  // must not change the results.
+  const std::vector<std::string> keys = {
+      "わ",          "わた",         "わたし",         "わたしの",
+      "わたしのな",  "わたしのなま", "わたしのなまえ", "わたしのなまえは",
+      "わたしのな",  "わたしのなか", "わたしのなかの", "わたしのなかのです",
+      "わたしのなかのでした"};
+  Segments incremental;
+  for (const std::string &key : keys) {
+    incremental.InitForConvert(key);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &incremental)) << key;
+
+    Segments fresh;
+    fresh.InitForConvert(key);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &fresh)) << key;
+
+    ASSERT_EQ(incremental.conversion_segments_size(),
+              fresh.conversion_segments_size())
+        << key;
+    const Segment &actual = incremental.conversion_segment(0);
+    const Segment &expected = fresh.conversion_segment(0);
+    ASSERT_EQ(actual.candidates_size(), expected.candidates_size()) << key;
+    for (size_t i = 0; i < expected.candidates_size(); ++i) {
+      EXPECT_EQ(actual.candidate(i).value, expected.candidate(i).value) << key;
+      EXPECT_EQ(actual.candidate(i).cost, expected.candidate(i).cost) << key;
+      EXPECT_EQ(actual.candidate(i).wcost, expected.candidate(i).wcost) << key;
+    }
+  }
+}
+
 TEST(ImmutableConverterTest, HistoryKeyLengthIsVeryLong) {
   // "あ..." (100 times)
   const std::string kA100 =
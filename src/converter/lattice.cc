@@ -157,6 +157,7 @@ void Lattice::SetKey(std::string key) {
   begin_nodes_.resize(size + 4, nullptr);
   end_nodes_.resize(size + 4, nullptr);
   cache_info_.resize(size + 4, 0);
+  viterbi_columns_.resize(size + 4);
 
   end_nodes_[0] = InitBOSNode(this, static_cast<uint16_t>(0));
   begin_nodes_[key_.size()] =
@@ -192,8 +193,11 @@ void Lattice::Clear() {
   key_.clear();
   begin_nodes_.clear();
   end_nodes_.clear();
-  node_allocator_->Free();
+  // The lattice is cleared for every conversion, so the memory of the nodes
+  // is kept for the next one.
+  node_allocator_->Clear();
   cache_info_.clear();
+  viterbi_columns_.clear();
   history_end_pos_ = 0;
 }
 
@@ -248,11 +252,16 @@ void Lattice::AddSuffix(const absl::string_view suffix_key) {
   std::fill(end_nodes_.begin() + old_size + 1, end_nodes_.end(),
             static_cast<Node *>(nullptr));
 
-  end_nodes_[0] = InitBOSNode(this, static_cast<uint16_t>(0));
+  // Keep the existing BOS node so that the memoized Viterbi state of the
+  // first position remains valid.
+  if (end_nodes_[0] == nullptr) {
+    end_nodes_[0] = InitBOSNode(this, static_cast<uint16_t>(0));
+  }
   begin_nodes_[new_size] = InitEOSNode(this, static_cast<uint16_t>(new_size));
 
   // update cache_info
   cache_info_.resize(new_size + 4, 0);
+  viterbi_columns_.resize(new_size + 4);
 
   // update key
   absl::StrAppend(&key_, suffix_key);
@@ -300,6 +309,11 @@ void Lattice::ShrinkKey(const size_t new_len) {
   }
   std::fill(cache_info_.begin() + new_len, cache_info_.end(), 0);
 
+  // drop the memoized viterbi state of the erased positions
+  for (size_t i = new_len + 1; i < viterbi_columns_.size(); ++i) {
+    viterbi_columns_[i] = ViterbiColumn();
+  }
+
   // update key
   key_.erase(new_len);
 }
@@ -33,6 +33,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/log/check.h"
@@ -116,6 +117,23 @@ class Lattice {
   // process for some heuristic methods.
   void ResetNodeCost();
 
+  // Best costs memoized by the prediction Viterbi for one position. Each
+  // entry is (id, (cost, node)) sorted by id. |lbest| holds the best node for
+  // each rid among the nodes ending at the position, and |rbest| holds the
+  // best transition from them for each lid of the nodes starting there.
+  // |rbest| depends only on |lbest|, so it stays valid across key updates as
+  // long as |lbest| is unchanged.
+  struct ViterbiColumn {
+    using BestMap = std::vector<std::pair<int, std::pair<int, Node *>>>;
+    BestMap lbest;
+    BestMap rbest;
+  };
+
+  ViterbiColumn *mutable_viterbi_column(size_t pos) {
+    DCHECK_LT(pos, viterbi_columns_.size());
+    return &viterbi_columns_[pos];
+  }
+
   // Dump the best path and the path that contains the designated string.
   std::string DebugString() const;
 
@@ -138,6 +156,11 @@ class Lattice {
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  // viterbi_columns_[pos] holds the memoized Viterbi state of |pos|. Entries
+  // beyond the key are dropped in ShrinkKey, so that a backspace falls back
+  // to the state saved for the shorter key.
+  std::vector<ViterbiColumn> viterbi_columns_;
 };
 
 }  // namespace mozc
@@ -31,6 +31,7 @@
 
 #include <cstddef>
 #include <string>
+#include <utility>
 
 #include "absl/container/btree_set.h"
 #include "converter/node.h"
@@ -221,4 +222,32 @@ TEST(LatticeTest, ShrinkKeyTest) {
     }
   }
 }
+
+TEST(LatticeTest, ViterbiColumnTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  const Node *bos_node = lattice.bos_nodes();
+  for (size_t pos = 0; pos <= 4; ++pos) {
+    Lattice::ViterbiColumn *column = lattice.mutable_viterbi_column(pos);
+    EXPECT_TRUE(column->lbest.empty());
+    EXPECT_TRUE(column->rbest.empty());
+    column->lbest.emplace_back(0, std::make_pair(0, lattice.NewNode()));
+    column->rbest.emplace_back(1, std::make_pair(10, lattice.NewNode()));
+  }
+
+  // The state of the remaining prefix is kept, and the BOS node is reused.
+  lattice.ShrinkKey(2);
+  lattice.AddSuffix("xt");
+  EXPECT_EQ(lattice.bos_nodes(), bos_node);
+  for (size_t pos = 0; pos <= 4; ++pos) {
+    const Lattice::ViterbiColumn *column = lattice.mutable_viterbi_column(pos);
+    EXPECT_EQ(column->lbest.size(), pos <= 2 ? 1 : 0) << pos;
+    EXPECT_EQ(column->rbest.size(), pos <= 2 ? 1 : 0) << pos;
+  }
+
+  lattice.SetKey("test");
+  for (size_t pos = 0; pos <= 4; ++pos) {
+    EXPECT_TRUE(lattice.mutable_viterbi_column(pos)->lbest.empty());
+  }
+}
 }  // namespace mozc
@@ -59,6 +59,13 @@ class NodeAllocator {
     node_count_ = 0;
   }
 
+  // Destroys all nodes allocated by NewNode(), but keeps the memory for the
+  // following allocations.
+  void Clear() {
+    node_freelist_.Clear();
+    node_count_ = 0;
+  }
+
   size_t max_nodes_size() const { return max_nodes_size_; }
 
   void set_max_nodes_size(size_t max_nodes_size) {
@@ -82,24 +82,53 @@ Segment &Segment::operator=(const Segment &x) {
 }
 
 void Segment::clear_candidates() {
-  pool_.clear();
   candidates_.clear();
+  candidate_pools_.clear();
+  // Reuses the pool unless it is shared with other segments.
+  if (pools_.size() == 1 && pools_[0].use_count() == 1 &&
+      pools_[0]->arena == candidate_arena_) {
+    pools_[0]->candidates.clear();
+  } else {
+    pools_.clear();
+  }
+}
+
+Segment::CandidatePtr Segment::NewCandidate() {
+  if (candidate_arena_ == nullptr) {
+    return CandidatePtr(new Candidate());
+  }
+  Candidate *candidate = candidate_arena_->Alloc();
+  // A reused candidate keeps the capacity of its strings.
+  candidate->Clear();
+  return CandidatePtr(candidate,
+                      CandidateDeleter{.arena = candidate_arena_.get()});
+}
+
+Candidate *Segment::AddToPool(CandidatePtr candidate) {
+  if (pools_.empty() || pools_.back().use_count() > 1 ||
+      pools_.back()->arena != candidate_arena_) {
+    pools_.push_back(std::make_shared<CandidatePool>());
+    pools_.back()->arena = candidate_arena_;
+  }
+  return pools_.back()->candidates.emplace_back(std::move(candidate)).get();
+}
+
+bool Segment::IsSharedCandidate(int i) const {
+  return candidate_pools_[i]->weak_from_this().use_count() > 1;
 }
 
 Candidate *Segment::push_back_candidate() {
-  auto candidate = std::make_unique<Candidate>();
-  Candidate *ptr = candidate.get();
-  pool_.push_back(std::move(candidate));
-  candidates_.push_back(ptr);
-  return ptr;
+  Candidate *candidate = AddToPool(NewCandidate());
+  candidates_.push_back(candidate);
+  candidate_pools_.push_back(pools_.back().get());
+  return candidate;
 }
 
 Candidate *Segment::push_front_candidate() {
-  auto candidate = std::make_unique<Candidate>();
-  Candidate *ptr = candidate.get();
-  pool_.push_back(std::move(candidate));
-  candidates_.push_front(ptr);
-  return ptr;
+  Candidate *candidate = AddToPool(NewCandidate());
+  candidates_.push_front(candidate);
+  candidate_pools_.push_front(pools_.back().get());
+  return candidate;
 }
 
 Candidate *Segment::insert_candidate(int i) {
@@ -113,20 +142,24 @@ Candidate *Segment::insert_candidate(int i) {
                 << candidates_.size();
     i = static_cast<int>(candidates_.size());
   }
-  Candidate *candidate =
-      pool_.emplace_back(std::make_unique<Candidate>()).get();
+  Candidate *candidate = AddToPool(NewCandidate());
   candidates_.insert(candidates_.begin() + i, candidate);
+  candidate_pools_.insert(candidate_pools_.begin() + i, pools_.back().get());
   return candidate;
 }
 
 void Segment::insert_candidate(int i, std::unique_ptr<Candidate> candidate) {
-  Candidate *cand_ptr = pool_.emplace_back(std::move(candidate)).get();
+  Candidate *cand_ptr = AddToPool(CandidatePtr(candidate.release()));
+  CandidatePool *pool = pools_.back().get();
   if (i <= 0) {
     candidates_.push_front(cand_ptr);
+    candidate_pools_.push_front(pool);
   } else if (i >= static_cast<int>(candidates_.size())) {
     candidates_.push_back(cand_ptr);
+    candidate_pools_.push_back(pool);
   } else {
     candidates_.insert(candidates_.begin() + i, cand_ptr);
+    candidate_pools_.insert(candidate_pools_.begin() + i, pool);
   }
 }
 
@@ -142,25 +175,30 @@ void Segment::insert_candidates(
   candidates_.resize(orig_size + candidates.size());
   std::copy_backward(candidates_.begin() + i, candidates_.begin() + orig_size,
                      candidates_.end());
-  for (const auto &candidate : candidates) {
-    candidates_[i++] = candidate.get();
+  candidate_pools_.resize(candidates_.size());
+  std::copy_backward(candidate_pools_.begin() + i,
+                     candidate_pools_.begin() + orig_size,
+                     candidate_pools_.end());
+  for (std::unique_ptr<Candidate> &candidate : candidates) {
+    candidates_[i] = AddToPool(CandidatePtr(candidate.release()));
+    candidate_pools_[i] = pools_.back().get();
+    ++i;
   }
-
-  pool_.insert(pool_.end(), std::make_move_iterator(candidates.begin()),
-               std::make_move_iterator(candidates.end()));
 }
 
 void Segment::pop_front_candidate() {
   if (!candidates_.empty()) {
-    // The unique_ptr in pool_ is deleted when the candidate is deleted.
+    // The unique_ptr in pools_ is deleted when the candidate is deleted.
     candidates_.pop_front();
+    candidate_pools_.pop_front();
   }
 }
 
 void Segment::pop_back_candidate() {
   if (!candidates_.empty()) {
-    // The unique_ptr in pool_ is deleted when the candidate is deleted.
+    // The unique_ptr in pools_ is deleted when the candidate is deleted.
     candidates_.pop_back();
+    candidate_pools_.pop_back();
   }
 }
 
@@ -170,6 +208,7 @@ void Segment::erase_candidate(int i) {
     return;
   }
   candidates_.erase(candidates_.begin() + i);
+  candidate_pools_.erase(candidate_pools_.begin() + i);
 }
 
 void Segment::erase_candidates(int i, size_t size) {
@@ -180,6 +219,8 @@ void Segment::erase_candidates(int i, size_t size) {
     return;
   }
   candidates_.erase(candidates_.begin() + i, candidates_.begin() + end);
+  candidate_pools_.erase(candidate_pools_.begin() + i,
+                         candidate_pools_.begin() + end);
 }
 
 const Candidate &Segment::meta_candidate(size_t i) const {
@@ -220,16 +261,22 @@ void Segment::move_candidate(int old_idx, int new_idx) {
   }
   if (old_idx > new_idx) {  // promotion
     Candidate *c = candidates_[old_idx];
+    CandidatePool *pool = candidate_pools_[old_idx];
     for (int i = old_idx; i >= new_idx + 1; --i) {
       candidates_[i] = candidates_[i - 1];
+      candidate_pools_[i] = candidate_pools_[i - 1];
     }
     candidates_[new_idx] = c;
+    candidate_pools_[new_idx] = pool;
   } else {  // demotion
     Candidate *c = candidates_[old_idx];
+    CandidatePool *pool = candidate_pools_[old_idx];
     for (int i = old_idx; i < new_idx; ++i) {
       candidates_[i] = candidates_[i + 1];
+      candidate_pools_[i] = candidate_pools_[i + 1];
     }
     candidates_[new_idx] = c;
+    candidate_pools_[new_idx] = pool;
   }
 }
 
@@ -242,15 +289,26 @@ void Segment::Clear() {
 }
 
 void Segment::DeepCopyCandidates(const std::deque<Candidate *> &candidates) {
-  DCHECK(pool_.empty());
-  pool_.reserve(candidates.size());
+  DCHECK(candidates_.empty());
   for (const Candidate *cand : candidates) {
-    auto new_cand = std::make_unique<Candidate>(*cand);
-    candidates_.push_back(new_cand.get());
-    pool_.push_back(std::move(new_cand));
+    CandidatePtr new_cand = NewCandidate();
+    *new_cand = *cand;
+    candidates_.push_back(AddToPool(std::move(new_cand)));
+    candidate_pools_.push_back(pools_.back().get());
   }
 }
 
+void Segment::CopyWithSharedCandidates(const Segment &x) {
+  removed_candidates_for_debug_ = x.removed_candidates_for_debug_;
+  segment_type_ = x.segment_type_;
+  key_ = x.key_;
+  key_len_ = x.key_len_;
+  meta_candidates_ = x.meta_candidates_;
+  candidates_ = x.candidates_;
+  candidate_pools_ = x.candidate_pools_;
+  pools_ = x.pools_;
+}
+
 std::string Segment::DebugString() const {
   std::stringstream os;
   os << "[segtype=" << segment_type() << " key=" << key() << std::endl;
@@ -271,6 +329,8 @@ std::string Segment::DebugString() const {
 Segments::Segments(const Segments &x)
     : max_history_segments_size_(x.max_history_segments_size_),
       resized_(x.resized_),
+      candidate_arena_(std::make_shared<ObjectPool<Candidate>>(
+          kCandidateArenaChunkSize)),
       pool_(32),
       revert_entries_(x.revert_entries_),
       cached_lattice_() {
@@ -298,23 +358,43 @@ Segments &Segments::operator=(const Segments &x) {
   return *this;
 }
 
-Segment *Segments::insert_segment(size_t i) {
+void Segments::CopyWithSharedCandidates(const Segments &x) {
+  if (this == &x) {
+    return;
+  }
+  Clear();
+
+  max_history_segments_size_ = x.max_history_segments_size_;
+  resized_ = x.resized_;
+  for (const Segment *segment : x.segments_) {
+    add_segment()->CopyWithSharedCandidates(*segment);
+  }
+  revert_entries_ = x.revert_entries_;
+  // Note: cached_lattice_ is not copied; see the comment for the copy
+  // constructor.
+}
+
+Segment *Segments::NewSegment() {
   Segment *segment = pool_.Alloc();
   segment->Clear();
+  segment->candidate_arena_ = candidate_arena_;
+  return segment;
+}
+
+Segment *Segments::insert_segment(size_t i) {
+  Segment *segment = NewSegment();
   segments_.insert(segments_.begin() + i, segment);
   return segment;
 }
 
 Segment *Segments::push_back_segment() {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
+  Segment *segment = NewSegment();
   segments_.push_back(segment);
   return segment;
 }
 
 Segment *Segments::push_front_segment() {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
+  Segment *segment = NewSegment();
   segments_.push_front(segment);
   return segment;
 }
@@ -523,7 +603,16 @@ bool Segments::Resize(size_t start_index, absl::Span<const uint8_t> new_sizes) {
 }
 
 void Segments::clear_segments() {
-  pool_.Free();
+  // Segments return their candidates to the arena when they are destroyed.
+  // The memory is kept for the following conversions.
+  pool_.Clear();
+  if (candidate_arena_.use_count() == 1) {
+    candidate_arena_->Clear();
+  } else {
+    // Other Segments still share candidates allocated from the arena.
+    candidate_arena_ =
+        std::make_shared<ObjectPool<Candidate>>(kCandidateArenaChunkSize);
+  }
   resized_ = false;
   segments_.clear();
 }
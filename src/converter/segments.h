@@ -68,7 +68,7 @@ class Segment final {
   // Using ::mozc::converter::Candidate is preferred.
   using Candidate = ::mozc::converter::Candidate;
 
-  Segment() : segment_type_(FREE), pool_(kCandidatesPoolSize) {}
+  Segment() : segment_type_(FREE) {}
 
   Segment(const Segment &x);
   Segment &operator=(const Segment &x);
@@ -97,6 +97,8 @@ class Segment final {
   const Candidate &candidate(int i) const;
 
   // setter
+  // Copies the candidate first if it is shared with other segments. See
+  // Segments::CopyWithSharedCandidates().
   Candidate *mutable_candidate(int i);
 
   // push and insert candidates
@@ -150,15 +152,53 @@ class Segment final {
     return os << segment.DebugString();
   }
 
+  // The candidates must not be modified through the pointers since they may
+  // be shared with other segments. Use mutable_candidate() instead.
   const std::deque<Candidate *> &candidates() const { return candidates_; }
 
   // For debug. Candidate words removed through conversion process.
   std::vector<Candidate> removed_candidates_for_debug_;
 
  private:
+  friend class Segments;
+
+  // Returns a candidate to the arena if it was allocated from the arena, or
+  // deletes it otherwise.
+  struct CandidateDeleter {
+    void operator()(Candidate *candidate) const {
+      if (arena == nullptr) {
+        delete candidate;
+      } else {
+        arena->Release(candidate);
+      }
+    }
+
+    ObjectPool<Candidate> *arena = nullptr;
+  };
+  using CandidatePtr = std::unique_ptr<Candidate, CandidateDeleter>;
+
+  // Owns candidates. Segments copied by Segments::CopyWithSharedCandidates()
+  // share their pools, whose candidates are immutable while shared.
+  struct CandidatePool : std::enable_shared_from_this<CandidatePool> {
+    // Keeps the arena alive until the candidates are returned to it.
+    std::shared_ptr<ObjectPool<Candidate>> arena;
+    std::vector<CandidatePtr> candidates;
+  };
+
+  // Returns an empty candidate, taken from `candidate_arena_` if available.
+  CandidatePtr NewCandidate();
+
+  // Adds `candidate` to the pool which is not shared and returns it.
+  Candidate *AddToPool(CandidatePtr candidate);
+
+  // Returns true if the i-th candidate is in a pool shared with other
+  // segments.
+  bool IsSharedCandidate(int i) const;
+
   void DeepCopyCandidates(const std::deque<Candidate *> &candidates);
 
-  static constexpr int kCandidatesPoolSize = 16;
+  // Copies `x` sharing the pools of the candidates with it.
+  void CopyWithSharedCandidates(const Segment &x);
 
   // LINT.IfChange
   SegmentType segment_type_;
@@ -173,8 +213,16 @@ class Segment final {
   size_t key_len_ = 0;
   std::deque<Candidate *> candidates_;
   std::vector<Candidate> meta_candidates_;
-  std::vector<std::unique_ptr<Candidate>> pool_;
+  // The pools owning `candidates_`. New candidates are added to the last pool
+  // unless it is shared.
+  std::vector<std::shared_ptr<CandidatePool>> pools_;
+  // The pool of each of `candidates_`, in the same order.
+  std::deque<CandidatePool *> candidate_pools_;
   // LINT.ThenChange(//converter/segments_matchers.h)
+
+  // The candidate arena of the owner Segments, or nullptr if this segment is
+  // not owned by Segments. Not copied by the copy operations.
+  std::shared_ptr<ObjectPool<Candidate>> candidate_arena_;
 };
 
 // Segments is basically an array of Segment.
@@ -353,12 +401,20 @@ class Segments final {
   Segments()
       : max_history_segments_size_(0),
         resized_(false),
+        candidate_arena_(std::make_shared<ObjectPool<converter::Candidate>>(
+            kCandidateArenaChunkSize)),
         pool_(32),
         cached_lattice_() {}
 
   Segments(const Segments &x);
   Segments &operator=(const Segments &x);
 
+  // Same as the copy assignment, except that the candidates are shared with
+  // `x` until either of them modifies them. Copying the segments to modify a
+  // few candidates, e.g. to commit them, costs only the pointers to the
+  // candidates. `x` and this object must be used on the same thread.
+  void CopyWithSharedCandidates(const Segments &x);
+
   // iterators
   iterator begin() { return iterator{segments_.begin()}; }
   iterator end() { return iterator{segments_.end()}; }
@@ -478,10 +534,22 @@ class Segments final {
   iterator history_segments_end();
   const_iterator history_segments_end() const;
 
+  // Allocates a segment from `pool_`, whose candidates are allocated from
+  // `candidate_arena_`.
+  Segment *NewSegment();
+
+  static constexpr int kCandidateArenaChunkSize = 64;
+
   // LINT.IfChange
   size_t max_history_segments_size_;
   bool resized_;
 
+  // Candidates of all the segments are allocated in chunks from this arena,
+  // and reused when they are removed from the segments. Clear() destroys all
+  // the candidates at once and keeps the chunks for the next conversion,
+  // unless the candidates are shared with other Segments. It must outlive
+  // `pool_`.
+  std::shared_ptr<ObjectPool<converter::Candidate>> candidate_arena_;
   ObjectPool<Segment> pool_;
   std::deque<Segment *> segments_;
   std::vector<RevertEntry> revert_entries_;
@@ -512,6 +580,12 @@ inline converter::Candidate *Segment::mutable_candidate(int i) {
     return &meta_candidates_[meta_index];
   }
   DCHECK_LT(i, candidates_.size());
+  if (IsSharedCandidate(i)) {
+    CandidatePtr candidate = NewCandidate();
+    *candidate = *candidates_[i];
+    candidates_[i] = AddToPool(std::move(candidate));
+    candidate_pools_[i] = pools_.back().get();
+  }
   return candidates_[i];
 }
 
@@ -84,9 +84,10 @@ MATCHER_P(EqualsCandidate, candidate, "") {
 }
 
 // Checks if a segment exactly matches the given segment except for the
-// following two fields:
+// following fields:
 //   * removed_candidates_for_debug_
-//   * pool_
+//   * pools_
+//   * candidate_pools_
 // Note: this is more useful than defining operator==() in testing as it can
 // display which field is different.
 //
@@ -208,7 +209,8 @@ MATCHER_P(ContainsCandidate, matcher, "") {
 }
 
 // Checks if a segments exactly matches the given segments except for the
-// following three fields:
+// following four fields:
+//   * candidate_arena_
 //   * pool_
 //   * revert_entries_
 //   * cached_lattice_
@@ -364,6 +364,118 @@ TEST(SegmentsTest, CopyTest) {
   }
 }
 
+TEST(SegmentsTest, CandidateArenaTest) {
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  Candidate *candidate = segment->add_candidate();
+  candidate->key = "key";
+  candidate->value = "value";
+  candidate->a11y_description = "description";
+  candidate->category = Candidate::SYMBOL;
+  candidate->cost_before_rescoring = 100;
+  candidate->PushBackInnerSegmentBoundary(3, 5, 3, 5);
+
+  // The candidate is reused after it's removed from the segments, and it's
+  // cleared as a new candidate.
+  segments.clear_conversion_segments();
+  segment = segments.add_segment();
+  Candidate *reused = segment->add_candidate();
+  EXPECT_EQ(reused, candidate);
+  EXPECT_TRUE(reused->key.empty());
+  EXPECT_TRUE(reused->value.empty());
+  EXPECT_TRUE(reused->a11y_description.empty());
+  EXPECT_EQ(reused->category, Candidate::DEFAULT_CATEGORY);
+  EXPECT_EQ(reused->cost_before_rescoring, 0);
+  EXPECT_TRUE(reused->inner_segment_boundary.empty());
+
+  // Candidates inserted from outside are owned by the segment as well.
+  segment->insert_candidate(0, std::make_unique<Candidate>());
+  EXPECT_EQ(segment->candidates_size(), 2);
+
+  // A copy of the segment doesn't depend on the arena.
+  reused->value = "value";
+  const Segment copy = *segment;
+  segments.Clear();
+  ASSERT_EQ(copy.candidates_size(), 2);
+  EXPECT_EQ(copy.candidate(1).value, "value");
+
+  // Clear() keeps the memory of the candidates for the next conversion.
+  EXPECT_EQ(segments.add_segment()->add_candidate(), candidate);
+}
+
+TEST(SegmentsTest, CopyWithSharedCandidates) {
+  auto src = std::make_unique<Segments>();
+  src->set_max_history_segments_size(2);
+  Segment *segment = src->add_segment();
+  segment->set_key("key");
+  for (const absl::string_view value : {"value_0", "value_1", "value_2"}) {
+    segment->add_candidate()->value = value;
+  }
+
+  Segments dest;
+  dest.CopyWithSharedCandidates(*src);
+  EXPECT_EQ(dest.max_history_segments_size(), 2);
+  ASSERT_EQ(dest.segments_size(), 1);
+  EXPECT_EQ(dest.segment(0).key(), "key");
+  ASSERT_EQ(dest.segment(0).candidates_size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(&dest.segment(0).candidate(i), &src->segment(0).candidate(i));
+  }
+
+  // Only the modified candidate is copied, and the source is not changed.
+  Segment *dest_segment = dest.mutable_segment(0);
+  dest_segment->move_candidate(2, 0);
+  dest_segment->mutable_candidate(0)->value = "committed";
+  EXPECT_EQ(dest.segment(0).candidate(0).value, "committed");
+  EXPECT_NE(&dest.segment(0).candidate(0), &src->segment(0).candidate(2));
+  EXPECT_EQ(&dest.segment(0).candidate(1), &src->segment(0).candidate(0));
+  EXPECT_EQ(&dest.segment(0).candidate(2), &src->segment(0).candidate(1));
+  EXPECT_EQ(src->segment(0).candidate(2).value, "value_2");
+
+  // The source copies the shared candidates on modification as well.
+  src->mutable_segment(0)->mutable_candidate(0)->value = "modified";
+  EXPECT_EQ(dest.segment(0).candidate(1).value, "value_0");
+
+  // The shared candidates outlive the source.
+  src->Clear();
+  src->add_segment()->add_candidate()->value = "new";
+  EXPECT_EQ(dest.segment(0).candidate(1).value, "value_0");
+  src.reset();
+  EXPECT_EQ(dest.segment(0).candidate(2).value, "value_1");
+  dest_segment->push_back_candidate()->value = "value_3";
+  EXPECT_EQ(dest.segment(0).candidate(3).value, "value_3");
+}
+
+TEST(SegmentsTest, CopyOnlySharedCandidates) {
+  Segments src;
+  Segment *src_segment = src.add_segment();
+  for (const absl::string_view value : {"value_0", "value_1"}) {
+    src_segment->add_candidate()->value = value;
+  }
+  Segments dest;
+  dest.CopyWithSharedCandidates(src);
+
+  // The candidates added after the copy are not shared even when they are
+  // moved around the shared ones.
+  Segment *segment = dest.mutable_segment(0);
+  Candidate *added = segment->push_front_candidate();
+  segment->insert_candidate(2)->value = "inserted";
+  segment->move_candidate(0, 3);
+  segment->erase_candidate(0);
+  ASSERT_EQ(segment->candidates_size(), 3);
+  EXPECT_EQ(segment->mutable_candidate(2), added);
+  EXPECT_EQ(segment->candidate(0).value, "inserted");
+  const Candidate *inserted = &segment->candidate(0);
+  EXPECT_EQ(segment->mutable_candidate(0), inserted);
+
+  // The shared one is copied once.
+  EXPECT_EQ(&segment->candidate(1), &src.segment(0).candidate(1));
+  Candidate *copied = segment->mutable_candidate(1);
+  EXPECT_NE(copied, &src.segment(0).candidate(1));
+  EXPECT_EQ(segment->mutable_candidate(1), copied);
+  EXPECT_EQ(copied->value, "value_1");
+}
+
 TEST(SegmentsTest, InitForConvert) {
   Segments segments;
   segments.InitForConvert("first");
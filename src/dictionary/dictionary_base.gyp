@@ -156,6 +156,7 @@
       'sources': [
         '<(gen_out_dir)/pos_map.inc',
         'user_dictionary.cc',
+        'user_dictionary_image.cc',
         'user_dictionary_importer.cc',
         'user_dictionary_session.cc',
         'user_dictionary_session_handler.cc',
@@ -169,6 +170,7 @@
         '<(mozc_oss_src_dir)/base/base.gyp:base',
         '<(mozc_oss_src_dir)/base/base.gyp:config_file_stream',
         '<(mozc_oss_src_dir)/base/base.gyp:number_util',
+        '<(mozc_oss_src_dir)/base/base.gyp:version',
         '<(mozc_oss_src_dir)/config/config.gyp:config_handler',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:config_proto',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:user_dictionary_storage_proto',
@@ -40,6 +40,7 @@
         'dictionary_impl_test.cc',
         'single_kanji_dictionary_test.cc',
         'suffix_dictionary_test.cc',
+        'user_dictionary_image_test.cc',
         'user_dictionary_importer_test.cc',
         'user_dictionary_session_handler_test.cc',
         'user_dictionary_session_test.cc',
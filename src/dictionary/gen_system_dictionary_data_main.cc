@@ -34,6 +34,7 @@
 //  --output="output.h"
 //  --make_header
 
+#include <cstdint>
 #include <ios>
 #include <memory>
 #include <ostream>
@@ -57,6 +58,9 @@
 ABSL_FLAG(std::string, input, "", "space separated input text files");
 ABSL_FLAG(std::string, user_pos_manager_data, "", "user pos manager data");
 ABSL_FLAG(std::string, output, "", "output binary file");
+ABSL_FLAG(int32_t, num_threads, 1,
+          "number of threads to build the dictionary. The output is the same "
+          "regardless of this value.");
 
 namespace mozc {
 namespace {
@@ -115,6 +119,7 @@ int main(int argc, char **argv) {
   loader.Load(system_dictionary_input, reading_correction_input);
 
   mozc::dictionary::SystemDictionaryBuilder builder;
+  builder.set_num_threads(absl::GetFlag(FLAGS_num_threads));
   builder.BuildFromTokens(loader.tokens());
 
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
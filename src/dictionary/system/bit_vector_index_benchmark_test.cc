@@ -0,0 +1,205 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmarks of the rank/select indices of the bit vectors in the system
+// dictionary of the OSS data set, comparing SimpleSuccinctBitVectorIndex and
+// RankSelectBitVectorIndex.
+//
+// The benchmarks run on the LOUDS bit vectors and the terminal bit vectors of
+// the key trie and the value trie, which are the ones queried by the lookup
+// of SystemDictionary.
+//
+// Usage:
+//   bazelisk run -c opt //dictionary/system:bit_vector_index_benchmark_test
+//
+// Add --copt=-mbmi2 to use PDEP for the select in a word.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/random/random.h"
+#include "absl/strings/string_view.h"
+#include "base/bits.h"
+#include "benchmark/benchmark.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "dictionary/file/codec_factory.h"
+#include "dictionary/file/dictionary_file.h"
+#include "dictionary/system/codec_interface.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
+#include "storage/louds/simple_succinct_bit_vector_index.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using ::mozc::storage::louds::RankSelectBitVectorIndex;
+using ::mozc::storage::louds::SimpleSuccinctBitVectorIndex;
+
+// The number of the queries generated for each benchmark.
+constexpr size_t kNumQueries = 4096;
+
+// Lower bound cache sizes used by SystemDictionary for the key trie.
+constexpr size_t kLb0CacheSize = 1024;
+constexpr size_t kLb1CacheSize = 1024;
+
+struct BitVector {
+  const uint8_t *data;
+  int length;
+};
+
+// Holds the bit vectors in the tries of the system dictionary.
+class BenchmarkEnvironment {
+ public:
+  static const BenchmarkEnvironment &Get() {
+    static const BenchmarkEnvironment *environment = new BenchmarkEnvironment();
+    return *environment;
+  }
+
+  // Returns the bit vector of the given type:
+  //   0: LOUDS of the key trie
+  //   1: Terminal bit vector of the key trie
+  //   2: LOUDS of the value trie
+  //   3: Terminal bit vector of the value trie
+  const BitVector &bit_vector(int type) const { return bit_vectors_[type]; }
+
+ private:
+  BenchmarkEnvironment()
+      : dictionary_file_(std::make_unique<DictionaryFile>(
+            DictionaryFileCodecFactory::GetCodec())) {
+    const absl::string_view data = data_manager_.GetSystemDictionaryData();
+    CHECK_OK(dictionary_file_->OpenFromImage(data.data(), data.size()));
+    const SystemDictionaryCodecInterface *codec =
+        SystemDictionaryCodecFactory::GetCodec();
+    AddTrie(codec->GetSectionNameForKey());
+    AddTrie(codec->GetSectionNameForValue());
+  }
+
+  // Adds the LOUDS and the terminal bit vectors of the trie. See
+  // LoudsTrie::Open() for the format of the image.
+  void AddTrie(absl::string_view section_name) {
+    int len = 0;
+    const uint8_t *image = reinterpret_cast<const uint8_t *>(
+        dictionary_file_->GetSection(section_name, &len));
+    CHECK(image != nullptr) << section_name;
+    const int louds_size = LoadUnalignedAdvance<uint32_t>(image);
+    const int terminal_size = LoadUnalignedAdvance<uint32_t>(image);
+    image += 2 * sizeof(uint32_t);
+    bit_vectors_.push_back({image, louds_size});
+    bit_vectors_.push_back({image + louds_size, terminal_size});
+  }
+
+  oss::OssDataManager data_manager_;
+  std::unique_ptr<DictionaryFile> dictionary_file_;
+  std::vector<BitVector> bit_vectors_;
+};
+
+std::vector<int> GenerateQueries(int min, int max) {
+  absl::BitGen gen;
+  std::vector<int> queries(kNumQueries);
+  for (int &query : queries) {
+    query = absl::Uniform(absl::IntervalClosed, gen, min, max);
+  }
+  return queries;
+}
+
+template <typename Index>
+void BM_Init(benchmark::State &state) {
+  const BitVector &bit_vector =
+      BenchmarkEnvironment::Get().bit_vector(state.range(0));
+  for (auto s : state) {
+    Index index;
+    index.Init(bit_vector.data, bit_vector.length, kLb0CacheSize,
+               kLb1CacheSize);
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetBytesProcessed(state.iterations() * bit_vector.length);
+}
+
+template <typename Index>
+void BM_Rank1(benchmark::State &state) {
+  const BitVector &bit_vector =
+      BenchmarkEnvironment::Get().bit_vector(state.range(0));
+  Index index;
+  index.Init(bit_vector.data, bit_vector.length, kLb0CacheSize, kLb1CacheSize);
+  const std::vector<int> queries = GenerateQueries(0, bit_vector.length * 8);
+  size_t i = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(index.Rank1(queries[i++ % kNumQueries]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Index>
+void BM_Select0(benchmark::State &state) {
+  const BitVector &bit_vector =
+      BenchmarkEnvironment::Get().bit_vector(state.range(0));
+  Index index;
+  index.Init(bit_vector.data, bit_vector.length, kLb0CacheSize, kLb1CacheSize);
+  const std::vector<int> queries = GenerateQueries(1, index.GetNum0Bits());
+  size_t i = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(index.Select0(queries[i++ % kNumQueries]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Index>
+void BM_Select1(benchmark::State &state) {
+  const BitVector &bit_vector =
+      BenchmarkEnvironment::Get().bit_vector(state.range(0));
+  Index index;
+  index.Init(bit_vector.data, bit_vector.length, kLb0CacheSize, kLb1CacheSize);
+  const std::vector<int> queries = GenerateQueries(1, index.GetNum1Bits());
+  size_t i = 0;
+  for (auto s : state) {
+    benchmark::DoNotOptimize(index.Select1(queries[i++ % kNumQueries]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The argument is the type of the bit vector. See
+// BenchmarkEnvironment::bit_vector().
+#define MOZC_BIT_VECTOR_INDEX_BENCHMARK(name)                               \
+  BENCHMARK_TEMPLATE(name, SimpleSuccinctBitVectorIndex)->DenseRange(0, 3); \
+  BENCHMARK_TEMPLATE(name, RankSelectBitVectorIndex)->DenseRange(0, 3)
+
+MOZC_BIT_VECTOR_INDEX_BENCHMARK(BM_Init);
+MOZC_BIT_VECTOR_INDEX_BENCHMARK(BM_Rank1);
+MOZC_BIT_VECTOR_INDEX_BENCHMARK(BM_Select0);
+MOZC_BIT_VECTOR_INDEX_BENCHMARK(BM_Select1);
+
+#undef MOZC_BIT_VECTOR_INDEX_BENCHMARK
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
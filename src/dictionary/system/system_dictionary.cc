@@ -100,12 +100,16 @@ constexpr size_t kKeyTrieLb1CacheSize = 1 * 1024;
 constexpr size_t kKeyTrieSelect0CacheSize = 4 * 1024;
 constexpr size_t kKeyTrieSelect1CacheSize = 4 * 1024;
 constexpr size_t kKeyTrieTermvecCacheSize = 1 * 1024;
+// Nodes near the root of the key trie have dozens of children, and every
+// lookup traverses them.
+constexpr size_t kKeyTrieLabelTableCacheSize = 4 * 1024;
 
 constexpr size_t kValueTrieLb0CacheSize = 1 * 1024;
 constexpr size_t kValueTrieLb1CacheSize = 1 * 1024;
 constexpr size_t kValueTrieSelect0CacheSize = 1 * 1024;
 constexpr size_t kValueTrieSelect1CacheSize = 16 * 1024;
 constexpr size_t kValueTrieTermvecCacheSize = 4 * 1024;
+constexpr size_t kValueTrieLabelTableCacheSize = 1 * 1024;
 
 // Expansion table format:
 // "<Character to expand>[<Expanded character 1><Expanded character 2>...]"
@@ -456,7 +460,7 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
       dictionary_file_->GetSection(codec_->GetSectionNameForKey(), &len));
   if (!key_trie_.Open(key_image, kKeyTrieLb0CacheSize, kKeyTrieLb1CacheSize,
                       kKeyTrieSelect0CacheSize, kKeyTrieSelect1CacheSize,
-                      kKeyTrieTermvecCacheSize)) {
+                      kKeyTrieTermvecCacheSize, kKeyTrieLabelTableCacheSize)) {
     LOG(ERROR) << "cannot open key trie";
     return false;
   }
@@ -468,7 +472,8 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
   if (!value_trie_.Open(value_image, kValueTrieLb0CacheSize,
                         kValueTrieLb1CacheSize, kValueTrieSelect0CacheSize,
                         kValueTrieSelect1CacheSize,
-                        kValueTrieTermvecCacheSize)) {
+                        kValueTrieTermvecCacheSize,
+                        kValueTrieLabelTableCacheSize)) {
     LOG(ERROR) << "can not open value trie";
     return false;
   }
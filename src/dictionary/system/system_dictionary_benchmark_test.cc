@@ -0,0 +1,297 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmarks of the lookup functions of SystemDictionary on the OSS data set.
+//
+// The lookup keys are sampled from the dictionary itself so that the key
+// distribution follows the one of the real data. Predictive lookup is
+// measured per key length because short keys (1 or 2 characters) are the
+// worst case; they hit the nodes near the root of the key trie that have the
+// largest subtrees.
+//
+// Usage:
+//   bazelisk run -c opt \
+//     //dictionary/system:system_dictionary_benchmark_test -- \
+//     --benchmark_filter=BM_LookupPredictive
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "base/util.h"
+#include "benchmark/benchmark.h"
+#include "config/config_handler.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/system_dictionary.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+// The maximum number of the keys and values in each corpus.
+constexpr size_t kMaxCorpusSize = 4096;
+
+// Counts the tokens returned by the dictionary.
+class CountingCallback : public DictionaryInterface::Callback {
+ public:
+  ResultType OnToken(absl::string_view key, absl::string_view actual_key,
+                     const Token &token) override {
+    ++num_tokens_;
+    return TRAVERSE_CONTINUE;
+  }
+
+  int64_t num_tokens() const { return num_tokens_; }
+
+ private:
+  int64_t num_tokens_ = 0;
+};
+
+// Collects the keys and values of the tokens.
+class CollectingCallback : public DictionaryInterface::Callback {
+ public:
+  CollectingCallback(absl::btree_set<std::string> *keys,
+                     absl::btree_set<std::string> *values)
+      : keys_(keys), values_(values) {}
+
+  ResultType OnToken(absl::string_view key, absl::string_view actual_key,
+                     const Token &token) override {
+    keys_->emplace(token.key);
+    values_->emplace(token.value);
+    return TRAVERSE_CONTINUE;
+  }
+
+ private:
+  absl::btree_set<std::string> *keys_;
+  absl::btree_set<std::string> *values_;
+};
+
+// Returns at most `size` elements of `set` picked at a constant stride, so
+// that the sample keeps the distribution of the whole set.
+std::vector<std::string> Sample(const absl::btree_set<std::string> &set,
+                                size_t size) {
+  const size_t stride = std::max<size_t>(1, set.size() / size);
+  std::vector<std::string> result;
+  result.reserve(size);
+  size_t i = 0;
+  for (const std::string &str : set) {
+    if (i++ % stride == 0 && result.size() < size) {
+      result.push_back(str);
+    }
+  }
+  return result;
+}
+
+// Holds the system dictionary of the OSS data set and the lookup corpora
+// sampled from it.
+class BenchmarkEnvironment {
+ public:
+  static const BenchmarkEnvironment &Get() {
+    static const BenchmarkEnvironment *environment = new BenchmarkEnvironment();
+    return *environment;
+  }
+
+  const SystemDictionary &dictionary() const { return *dictionary_; }
+
+  // Keys of the tokens, e.g. "かいしゃ".
+  const std::vector<std::string> &keys() const { return keys_; }
+
+  // Values of the tokens, e.g. "会社".
+  const std::vector<std::string> &values() const { return values_; }
+
+  // Concatenations of two keys, which simulate the suffixes of the input
+  // looked up at each position of the lattice.
+  const std::vector<std::string> &sentence_keys() const {
+    return sentence_keys_;
+  }
+
+  // Prefixes of the keys of the given length in characters.
+  std::vector<std::string> GetKeyPrefixes(size_t length) const {
+    absl::btree_set<std::string> prefixes;
+    for (const std::string &key : keys_) {
+      if (Util::CharsLen(key) >= length) {
+        prefixes.emplace(Util::Utf8SubString(key, 0, length));
+      }
+    }
+    return Sample(prefixes, kMaxCorpusSize);
+  }
+
+  const ConversionRequest &request() const { return request_; }
+  const ConversionRequest &key_expansion_request() const {
+    return key_expansion_request_;
+  }
+
+ private:
+  BenchmarkEnvironment()
+      : request_(CreateRequest(false)),
+        key_expansion_request_(CreateRequest(true)) {
+    const absl::string_view data = data_manager_.GetSystemDictionaryData();
+    dictionary_ = SystemDictionary::Builder(data.data(), data.size())
+                      .Build()
+                      .value();
+    BuildCorpora();
+  }
+
+  static ConversionRequest CreateRequest(bool use_key_expansion) {
+    commands::Request request;
+    request.set_kana_modifier_insensitive_conversion(use_key_expansion);
+    config::Config config = config::ConfigHandler::DefaultConfig();
+    config.set_use_kana_modifier_insensitive_conversion(use_key_expansion);
+    return ConversionRequestBuilder()
+        .SetRequest(request)
+        .SetConfig(config)
+        .Build();
+  }
+
+  // Samples the keys and values by predictive lookups for all the two
+  // hiragana character prefixes.
+  void BuildCorpora() {
+    absl::btree_set<std::string> keys, values;
+    CollectingCallback callback(&keys, &values);
+    std::vector<std::string> hiragana;
+    // From "ぁ" (U+3041) to "ん" (U+3093).
+    for (char32_t c = 0x3041; c <= 0x3093; ++c) {
+      hiragana.push_back(Util::CodepointToUtf8(c));
+    }
+    for (const std::string &first : hiragana) {
+      for (const std::string &second : hiragana) {
+        dictionary_->LookupPredictive(absl::StrCat(first, second), request_,
+                                      &callback);
+      }
+    }
+    CHECK(!keys.empty());
+    keys_ = Sample(keys, kMaxCorpusSize);
+    values_ = Sample(values, kMaxCorpusSize);
+
+    sentence_keys_.reserve(keys_.size());
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      sentence_keys_.push_back(
+          absl::StrCat(keys_[i], keys_[(i * 7 + 1) % keys_.size()]));
+    }
+  }
+
+  const ConversionRequest request_;
+  const ConversionRequest key_expansion_request_;
+  oss::OssDataManager data_manager_;
+  std::unique_ptr<SystemDictionary> dictionary_;
+  std::vector<std::string> keys_;
+  std::vector<std::string> values_;
+  std::vector<std::string> sentence_keys_;
+};
+
+// Type of the lookup methods of DictionaryInterface.
+using LookupMethod = void (SystemDictionary::*)(absl::string_view,
+                                                const ConversionRequest &,
+                                                DictionaryInterface::Callback *)
+    const;
+
+void RunLookup(benchmark::State &state, LookupMethod method,
+               const std::vector<std::string> &corpus,
+               const ConversionRequest &request) {
+  const SystemDictionary &dictionary = BenchmarkEnvironment::Get().dictionary();
+  CountingCallback callback;
+  size_t index = 0;
+  for (auto s : state) {
+    (dictionary.*method)(corpus[index++ % corpus.size()], request, &callback);
+  }
+  state.counters["tokens_per_lookup"] =
+      benchmark::Counter(static_cast<double>(callback.num_tokens()),
+                         benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LookupPrefix(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  RunLookup(state, &SystemDictionary::LookupPrefix, env.sentence_keys(),
+            env.request());
+}
+BENCHMARK(BM_LookupPrefix);
+
+void BM_LookupPrefixWithKeyExpansion(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  RunLookup(state, &SystemDictionary::LookupPrefix, env.sentence_keys(),
+            env.key_expansion_request());
+}
+BENCHMARK(BM_LookupPrefixWithKeyExpansion);
+
+// The argument is the length of the keys in characters.
+void BM_LookupPredictive(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  RunLookup(state, &SystemDictionary::LookupPredictive,
+            env.GetKeyPrefixes(state.range(0)), env.request());
+}
+BENCHMARK(BM_LookupPredictive)->DenseRange(1, 4);
+
+void BM_LookupPredictiveWithKeyExpansion(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  RunLookup(state, &SystemDictionary::LookupPredictive,
+            env.GetKeyPrefixes(state.range(0)), env.key_expansion_request());
+}
+BENCHMARK(BM_LookupPredictiveWithKeyExpansion)->DenseRange(1, 4);
+
+void BM_LookupExact(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  RunLookup(state, &SystemDictionary::LookupExact, env.keys(), env.request());
+}
+BENCHMARK(BM_LookupExact);
+
+void BM_LookupReverse(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  RunLookup(state, &SystemDictionary::LookupReverse, env.values(),
+            env.request());
+}
+BENCHMARK(BM_LookupReverse);
+
+// Reverse lookup after the cache for the input is populated, as done by the
+// reverse converter.
+void BM_LookupReverseWithCache(benchmark::State &state) {
+  const BenchmarkEnvironment &env = BenchmarkEnvironment::Get();
+  env.dictionary().PopulateReverseLookupCache(
+      absl::StrJoin(env.values(), ""));
+  RunLookup(state, &SystemDictionary::LookupReverse, env.values(),
+            env.request());
+  env.dictionary().ClearReverseLookupCache();
+}
+BENCHMARK(BM_LookupReverseWithCache);
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <ios>
@@ -54,6 +55,7 @@
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/japanese_util.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "dictionary/dictionary_token.h"
@@ -88,6 +90,31 @@ struct TokenGreaterThan {
   }
 };
 
+// Calls `func(i)` for each i in [0, size). The range is split into
+// `num_threads` consecutive chunks, each of which runs on its own thread.
+// `func` must be safe to call concurrently for different indices.
+template <typename Func>
+void ParallelFor(size_t size, int num_threads, const Func &func) {
+  const size_t num_chunks =
+      std::clamp<size_t>(num_threads, 1, std::max<size_t>(size, 1));
+  const size_t chunk_size = (size + num_chunks - 1) / num_chunks;
+  std::vector<Thread> threads;
+  for (size_t begin = chunk_size; begin < size; begin += chunk_size) {
+    const size_t end = std::min(size, begin + chunk_size);
+    threads.emplace_back([&func, begin, end] {
+      for (size_t i = begin; i < end; ++i) {
+        func(i);
+      }
+    });
+  }
+  for (size_t i = 0; i < std::min(size, chunk_size); ++i) {
+    func(i);
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+}
+
 void WriteSectionToFile(const DictionaryFileSection &section,
                         const std::string &filename) {
   if (absl::Status s = FileUtil::SetContents(
@@ -114,8 +141,15 @@ void SystemDictionaryBuilder::BuildFromTokensInternal(
   KeyInfoList key_info_list = ReadTokens(std::move(tokens));
 
   BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
-  BuildKeyTrie(key_info_list);
+  if (num_threads_ > 1) {
+    // The tries are independent of each other.
+    Thread value_trie_thread([&] { BuildValueTrie(key_info_list); });
+    BuildKeyTrie(key_info_list);
+    value_trie_thread.Join();
+  } else {
+    BuildValueTrie(key_info_list);
+    BuildKeyTrie(key_info_list);
+  }
 
   SetIdForValue(&key_info_list);
   SetIdForKey(&key_info_list);
@@ -333,20 +367,21 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
-    for (TokenInfo &token_info : key_info.tokens) {
+  ParallelFor(key_info_list->size(), num_threads_, [&](size_t i) {
+    for (TokenInfo &token_info : (*key_info_list)[i].tokens) {
       std::string value_str;
       codec_->EncodeValue(token_info.token->value, &value_str);
       token_info.id_in_value_trie = value_trie_builder_.GetId(value_str);
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ParallelFor(key_info_list->size(), num_threads_, [&](size_t i) {
+    KeyInfo &key_info = (*key_info_list)[i];
     std::stable_sort(key_info.tokens.begin(), key_info.tokens.end(),
                      TokenGreaterThan());
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
@@ -376,17 +411,18 @@ void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
 
   const int min_key_len =
       absl::GetFlag(FLAGS_min_key_length_to_use_small_cost_encoding);
-  for (KeyInfo &key_info : *key_info_list) {
+  ParallelFor(key_info_list->size(), num_threads_, [&](size_t i) {
+    KeyInfo &key_info = (*key_info_list)[i];
     if (Util::CharsLen(key_info.key) < min_key_len) {
       // Do not use small cost encoding for short keys.
-      continue;
+      return;
     }
     if (HasHomonymsInSamePos(key_info)) {
-      continue;
+      return;
     }
     if (HasHeterophones(key_info, heterophone_values)) {
       // We want to keep the cost order for LookupReverse().
-      continue;
+      return;
     }
 
     for (TokenInfo &token_info : key_info.tokens) {
@@ -396,11 +432,12 @@ void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
       }
       token_info.cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ParallelFor(key_info_list->size(), num_threads_, [&](size_t index) {
+    KeyInfo &key_info = (*key_info_list)[index];
     for (size_t i = 0; i < key_info.tokens.size(); ++i) {
       TokenInfo *token_info = &(key_info.tokens[i]);
       const uint32_t pos =
@@ -419,11 +456,12 @@ void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
         }
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ParallelFor(key_info_list->size(), num_threads_, [&](size_t index) {
+    KeyInfo &key_info = (*key_info_list)[index];
     for (size_t i = 1; i < key_info.tokens.size(); ++i) {
       const TokenInfo &prev_token_info = key_info.tokens[i - 1];
       TokenInfo *token_info = &(key_info.tokens[i]);
@@ -433,7 +471,7 @@ void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
         token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
@@ -446,11 +484,12 @@ void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ParallelFor(key_info_list->size(), num_threads_, [&](size_t i) {
+    KeyInfo &key_info = (*key_info_list)[i];
     std::string key_str;
     codec_->EncodeKey(key_info.key, &key_str);
     key_info.id_in_key_trie = key_trie_builder_.GetId(key_str);
-  }
+  });
 }
 
 void SystemDictionaryBuilder::BuildTokenArray(
@@ -465,9 +504,12 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
-    for (const KeyInfo *key_info : id_to_keyinfo_table) {
-      std::string tokens_str;
-      codec_->EncodeTokens(key_info->tokens, &tokens_str);
+    // Encodes the tokens in parallel, and then adds them in the order of ID.
+    std::vector<std::string> tokens_strs(id_to_keyinfo_table.size());
+    ParallelFor(id_to_keyinfo_table.size(), num_threads_, [&](size_t i) {
+      codec_->EncodeTokens(id_to_keyinfo_table[i]->tokens, &tokens_strs[i]);
+    });
+    for (const std::string &tokens_str : tokens_strs) {
       token_array_builder_.Add(tokens_str);
     }
   }
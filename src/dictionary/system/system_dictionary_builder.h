@@ -72,6 +72,10 @@ class SystemDictionaryBuilder final {
   SystemDictionaryBuilder(const SystemDictionaryBuilder &) = delete;
   SystemDictionaryBuilder &operator=(const SystemDictionaryBuilder &) = delete;
 
+  // Sets the number of threads used by BuildFromTokens(). The output doesn't
+  // depend on the number of threads.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
   void BuildFromTokens(absl::Span<Token *const> tokens) {
     BuildFromTokensInternal(std::vector<Token *>(tokens.begin(), tokens.end()));
   }
@@ -115,6 +119,7 @@ class SystemDictionaryBuilder final {
       SystemDictionaryCodecFactory::GetCodec();
   const DictionaryFileCodecInterface *file_codec_ =
       DictionaryFileCodecFactory::GetCodec();
+  int num_threads_ = 1;
 };
 
 }  // namespace dictionary
@@ -36,6 +36,7 @@
 #include <limits>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -970,6 +971,26 @@ TEST_F(SystemDictionaryTest, DoNotReturnNoModifierTargetWithLoudsTrie) {
   }
 }
 
+TEST_F(SystemDictionaryTest, ParallelBuildEmitsSameImage) {
+  absl::SetFlag(&FLAGS_min_key_length_to_use_small_cost_encoding,
+                original_flags_min_key_length_to_use_small_cost_encoding_);
+
+  std::ostringstream serial_image;
+  {
+    SystemDictionaryBuilder builder;
+    builder.BuildFromTokens(text_dict_.tokens());
+    builder.WriteToStream("", &serial_image);
+  }
+  for (const int num_threads : {2, 3, 8}) {
+    SystemDictionaryBuilder builder;
+    builder.set_num_threads(num_threads);
+    builder.BuildFromTokens(text_dict_.tokens());
+    std::ostringstream parallel_image;
+    builder.WriteToStream("", &parallel_image);
+    EXPECT_TRUE(parallel_image.str() == serial_image.str()) << num_threads;
+  }
+}
+
 TEST_F(SystemDictionaryTest, ShouldNotUseSmallCostEncodingForHeteronyms) {
   absl::SetFlag(&FLAGS_min_key_length_to_use_small_cost_encoding,
                 original_flags_min_key_length_to_use_small_cost_encoding_);
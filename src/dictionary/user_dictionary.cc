@@ -52,14 +52,18 @@
 #include "absl/strings/string_view.h"
 #include "base/file_util.h"
 #include "base/hash.h"
+#include "base/mmap.h"
 #include "base/strings/assign.h"
 #include "base/strings/japanese.h"
 #include "base/strings/unicode.h"
+#include "base/strings/zstring_view.h"
 #include "base/thread.h"
+#include "base/version.h"
 #include "base/vlog.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
+#include "dictionary/user_dictionary_image.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
@@ -71,26 +75,6 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
-struct OrderByKey {
-  bool operator()(const UserPos::Token &token, absl::string_view key) const {
-    return token.key < key;
-  }
-
-  bool operator()(absl::string_view key, const UserPos::Token &token) const {
-    return key < token.key;
-  }
-};
-
-struct OrderByKeyPrefix {
-  bool operator()(const UserPos::Token &token, absl::string_view prefix) const {
-    return absl::string_view(token.key).substr(0, prefix.size()) < prefix;
-  }
-
-  bool operator()(absl::string_view prefix, const UserPos::Token &token) const {
-    return prefix < absl::string_view(token.key).substr(0, prefix.size());
-  }
-};
-
 struct OrderByKeyThenById {
   bool operator()(const UserPos::Token &lhs, const UserPos::Token &rhs) const {
     const int comp = lhs.key.compare(rhs.key);
@@ -98,6 +82,20 @@ struct OrderByKeyThenById {
   }
 };
 
+// Returns the fingerprint of the POS data and the version, on which the
+// compiled image of the user dictionary depends.
+uint64_t GetUserPosFingerprint(const UserPos &user_pos) {
+  std::string data = Version::GetMozcVersion();
+  for (auto it = user_pos.begin(); it != user_pos.end(); ++it) {
+    absl::StrAppend(&data, "\t", it.pos_index(), ",", it.value_suffix_index(),
+                    ",", it.key_suffix_index(), ",", it.conjugation_id());
+  }
+  for (const std::string &pos : user_pos.GetPosList()) {
+    absl::StrAppend(&data, "\t", pos);
+  }
+  return Fingerprint(data);
+}
+
 class SuppressionDictionary {
  public:
   bool AddEntry(std::string key, std::string value) {
@@ -146,25 +144,24 @@ class SuppressionDictionary {
 
 class UserDictionary::TokensIndex {
  public:
-  TokensIndex(const UserPos &user_pos) : user_pos_(user_pos) {}
+  explicit TokensIndex(const UserPos &user_pos) : user_pos_(user_pos) {}
 
-  ~TokensIndex() = default;
+  TokensIndex(const TokensIndex &) = delete;
+  TokensIndex &operator=(const TokensIndex &) = delete;
 
-  bool empty() const { return user_pos_tokens_.empty(); }
-  size_t size() const { return user_pos_tokens_.size(); }
+  ~TokensIndex() = default;
 
-  std::vector<UserPos::Token>::const_iterator begin() const {
-    return user_pos_tokens_.begin();
-  }
-  std::vector<UserPos::Token>::const_iterator end() const {
-    return user_pos_tokens_.end();
-  }
+  const UserDictionaryImage &image() const { return image_; }
+  bool empty() const { return image_.empty(); }
+  size_t size() const { return image_.size(); }
 
-  void Load(const user_dictionary::UserDictionaryStorage &storage,
-            std::atomic<bool> *canceled_signal) {
+  // Compiles `storage` into an image on memory. Returns false when canceled.
+  bool Load(const user_dictionary::UserDictionaryStorage &storage,
+            uint64_t source_stamp, std::atomic<bool> *canceled_signal) {
     DCHECK(canceled_signal);
-    user_pos_tokens_.clear();
     absl::flat_hash_set<uint64_t> seen;
+    std::vector<UserPos::Token> user_pos_tokens;
+    std::vector<std::pair<std::string, std::string>> suppression_entries;
     std::vector<UserPos::Token> tokens;
 
     for (const UserDictionaryStorage::UserDictionary &dic :
@@ -182,7 +179,7 @@ class UserDictionary::TokensIndex {
         }
         if (canceled_signal->load()) {
           LOG(INFO) << "User dictionary loading is canceled";
-          return;
+          return false;
         }
 
         // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
@@ -205,7 +202,7 @@ class UserDictionary::TokensIndex {
 
         if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
           // "抑制単語"
-          suppression_dictionary_.AddEntry(std::move(reading), entry.value());
+          suppression_entries.emplace_back(std::move(reading), entry.value());
         } else if (entry.pos() == user_dictionary::UserDictionary::NO_POS) {
           // In theory NO_POS works without this implementation, as it is
           // covered in the UserPos::GetTokens function. However, that function
@@ -222,7 +219,7 @@ class UserDictionary::TokensIndex {
                                .comment = std::string(comment)};
           // NO_POS has '名詞サ変' id as in user_pos.def
           user_pos_.GetPosIds("名詞サ変", &token.id);
-          user_pos_tokens_.push_back(std::move(token));
+          user_pos_tokens.push_back(std::move(token));
         } else {
           tokens.clear();
           user_pos_.GetTokens(reading, entry.value(),
@@ -239,18 +236,52 @@ class UserDictionary::TokensIndex {
               token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
               token.add_attribute(UserPos::Token::SHORTCUT);
             }
-            user_pos_tokens_.push_back(std::move(token));
+            user_pos_tokens.push_back(std::move(token));
           }
         }
       }
     }
-    user_pos_tokens_.shrink_to_fit();
 
     // Sort first by key and then by POS ID.
-    std::sort(user_pos_tokens_.begin(), user_pos_tokens_.end(),
+    std::sort(user_pos_tokens.begin(), user_pos_tokens.end(),
               OrderByKeyThenById());
+    buffer_ = UserDictionaryImage::Build(user_pos_tokens, suppression_entries,
+                                         source_stamp);
+    const absl::Status s = OpenImage(buffer_);
+    DCHECK_OK(s);
 
-    MOZC_VLOG(1) << user_pos_tokens_.size() << " user dic entries loaded";
+    MOZC_VLOG(1) << image_.size() << " user dic entries loaded";
+    return s.ok();
+  }
+
+  // Maps the compiled image in `filename`. Fails unless the image is compiled
+  // from the source identified by `source_stamp`.
+  absl::Status LoadImageFile(zstring_view filename, uint64_t source_stamp) {
+    absl::StatusOr<Mmap> mmap = Mmap::Map(filename);
+    if (!mmap.ok()) {
+      return mmap.status();
+    }
+    mmap_ = *std::move(mmap);
+    if (absl::Status s = OpenImage(mmap_.string_view()); !s.ok()) {
+      return s;
+    }
+    if (image_.source_stamp() != source_stamp) {
+      return absl::FailedPreconditionError("The image is stale");
+    }
+    MOZC_VLOG(1) << image_.size() << " user dic entries mapped";
+    return absl::OkStatus();
+  }
+
+  // Writes the image compiled by Load() to `filename`. The file is replaced
+  // atomically as the other processes may be reading it.
+  absl::Status SaveImageFile(const std::string &filename) const {
+    DCHECK(!buffer_.empty());
+    const std::string tmp_filename = absl::StrCat(filename, ".tmp");
+    if (absl::Status s = FileUtil::SetContents(tmp_filename, buffer_);
+        !s.ok()) {
+      return s;
+    }
+    return FileUtil::AtomicRename(tmp_filename, filename);
   }
 
   bool IsSuppressedEntry(absl::string_view key, absl::string_view value) const {
@@ -262,9 +293,26 @@ class UserDictionary::TokensIndex {
   }
 
  private:
+  absl::Status OpenImage(absl::string_view data) {
+    absl::StatusOr<UserDictionaryImage> image = UserDictionaryImage::Open(data);
+    if (!image.ok()) {
+      return image.status();
+    }
+    image_ = *std::move(image);
+    for (size_t i = 0; i < image_.suppression_entries_size(); ++i) {
+      const auto [key, value] = image_.suppression_entry(i);
+      suppression_dictionary_.AddEntry(std::string(key), std::string(value));
+    }
+    return absl::OkStatus();
+  }
+
   const UserPos &user_pos_;
   SuppressionDictionary suppression_dictionary_;
-  std::vector<UserPos::Token> user_pos_tokens_;
+  // The storage of `image_`, which is either compiled on memory or mapped from
+  // the file.
+  std::string buffer_;
+  Mmap mmap_;
+  UserDictionaryImage image_;
 };
 
 class UserDictionary::UserDictionaryReloader {
@@ -316,7 +364,29 @@ class UserDictionary::UserDictionaryReloader {
 
  private:
   void ThreadMain() {
-    UserDictionaryStorage storage(dic_->GetFileName());
+    const std::string filename = dic_->GetFileName();
+    const std::string image_filename =
+        UserDictionaryUtil::GetUserDictionaryImageFileName(filename);
+    // Identifies the source and the POS data the image is compiled from. The
+    // content is hashed since the modification time in seconds doesn't change
+    // when the source is edited within the second the image is written.
+    absl::StatusOr<std::string> source = FileUtil::GetContents(filename);
+    if (!source.ok()) {
+      LOG(ERROR) << "Failed to read the user dictionary: " << source.status();
+      return;
+    }
+    const uint64_t source_stamp = Fingerprint(absl::StrCat(
+        Fingerprint(*source), "\t", dic_->user_pos_fingerprint_));
+
+    // Maps the compiled image if it is up to date, which costs O(1) and skips
+    // parsing the source.
+    if (auto tokens = std::make_shared<TokensIndex>(*dic_->user_pos_);
+        tokens->LoadImageFile(image_filename, source_stamp).ok()) {
+      dic_->SetTokens(std::move(tokens));
+      return;
+    }
+
+    UserDictionaryStorage storage(filename);
 
     // Load from file
     if (absl::Status s = storage.Load(); !s.ok()) {
@@ -324,7 +394,15 @@ class UserDictionary::UserDictionaryReloader {
       return;
     }
 
-    dic_->Load(storage.GetProto());
+    std::shared_ptr<const TokensIndex> tokens =
+        dic_->LoadTokens(storage.GetProto(), source_stamp);
+    if (tokens == nullptr) {
+      return;
+    }
+    // Failure is not fatal, e.g., the old image is still mapped on Windows.
+    if (absl::Status s = tokens->SaveImageFile(image_filename); !s.ok()) {
+      LOG(WARNING) << "Cannot save the user dictionary image: " << s;
+    }
   }
 
   std::optional<BackgroundFuture<void>> reload_;
@@ -343,6 +421,7 @@ UserDictionary::UserDictionary(std::unique_ptr<const UserPos> user_pos,
     : reloader_(std::make_unique<UserDictionaryReloader>(this)),
       user_pos_(std::move(user_pos)),
       pos_matcher_(pos_matcher),
+      user_pos_fingerprint_(GetUserPosFingerprint(*user_pos_)),
       tokens_(std::make_shared<TokensIndex>(*user_pos_)),
       filename_(std::move(filename)) {
   DCHECK(user_pos_);
@@ -390,12 +469,11 @@ void UserDictionary::LookupPredictive(
   }
 
   // Find the starting point of iteration over dictionary contents.
+  const UserDictionaryImage &image = tokens->image();
   Token token;
-  for (auto [begin, end] = std::equal_range(tokens->begin(), tokens->end(), key,
-                                            OrderByKeyPrefix());
-       begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
-    switch (callback->OnKey(user_pos_token.key)) {
+  for (auto [i, end] = image.PrefixRange(key); i < end; ++i) {
+    const UserDictionaryImage::Token user_token = image.token(i);
+    switch (callback->OnKey(user_token.key)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_NEXT_KEY:
@@ -405,13 +483,13 @@ void UserDictionary::LookupPredictive(
         break;
     }
     // b/333613472: Make sure not to set the additional penalties.
-    if (callback->OnActualKey(user_pos_token.key, user_pos_token.key,
+    if (callback->OnActualKey(user_token.key, user_token.key,
                               /* num_expanded= */ 0) ==
         Callback::TRAVERSE_DONE) {
       return;
     }
-    PopulateTokenFromUserPosToken(user_pos_token, PREDICTIVE, &token);
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
+    PopulateToken(user_token, PREDICTIVE, &token);
+    if (callback->OnToken(user_token.key, user_token.key, token) ==
         Callback::TRAVERSE_DONE) {
       return;
     }
@@ -437,49 +515,43 @@ void UserDictionary::LookupPrefix(absl::string_view key,
     return;
   }
 
-  // Find the starting point for iteration over dictionary contents.
-  const absl::string_view first_char = Utf8AsChars(key).front();
+  const UserDictionaryImage &image = tokens->image();
   Token token;
-  for (auto it = std::lower_bound(tokens->begin(), tokens->end(), first_char,
-                                  OrderByKey());
-       it != tokens->end(); ++it) {
-    const UserPos::Token &user_pos_token = *it;
-    if (user_pos_token.key > key) {
-      break;
-    }
-    if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
-      continue;
-    }
-    if (!key.starts_with(user_pos_token.key)) {
-      continue;
-    }
-    switch (callback->OnKey(user_pos_token.key)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
+  image.VisitPrefixes(key, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const UserDictionaryImage::Token user_token = image.token(i);
+      if (user_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
         continue;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
-    }
-    if (callback->OnActualKey(user_pos_token.key, user_pos_token.key,
-                              /* num_expanded= */ 0) ==
-        Callback::TRAVERSE_DONE) {
-      return;
-    }
-    PopulateTokenFromUserPosToken(user_pos_token, PREFIX, &token);
-    switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
+      }
+      switch (callback->OnKey(user_token.key)) {
+        case Callback::TRAVERSE_DONE:
+          return false;
+        case Callback::TRAVERSE_NEXT_KEY:
+          continue;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
+      if (callback->OnActualKey(user_token.key, user_token.key,
+                                /* num_expanded= */ 0) ==
+          Callback::TRAVERSE_DONE) {
+        return false;
+      }
+      PopulateToken(user_token, PREFIX, &token);
+      switch (callback->OnToken(user_token.key, user_token.key, token)) {
+        case Callback::TRAVERSE_DONE:
+          return false;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
     }
-  }
+    return true;
+  });
 }
 
 void UserDictionary::LookupExact(absl::string_view key,
@@ -490,8 +562,8 @@ void UserDictionary::LookupExact(absl::string_view key,
   if (key.empty() || tokens->empty() || conversion_request.incognito_mode()) {
     return;
   }
-  auto [begin, end] =
-      std::equal_range(tokens->begin(), tokens->end(), key, OrderByKey());
+  const UserDictionaryImage &image = tokens->image();
+  auto [begin, end] = image.EqualRange(key);
   if (begin == end) {
     return;
   }
@@ -504,12 +576,12 @@ void UserDictionary::LookupExact(absl::string_view key,
   }
 
   Token token;
-  for (; begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
-    if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
+  for (size_t i = begin; i < end; ++i) {
+    const UserDictionaryImage::Token user_token = image.token(i);
+    if (user_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
       continue;
     }
-    PopulateTokenFromUserPosToken(user_pos_token, EXACT, &token);
+    PopulateToken(user_token, EXACT, &token);
     if (callback->OnToken(key, key, token) != Callback::TRAVERSE_CONTINUE) {
       return;
     }
@@ -535,10 +607,9 @@ bool UserDictionary::LookupComment(absl::string_view key,
   }
 
   // Set the comment that was found first.
-  for (auto [begin, end] =
-           std::equal_range(tokens->begin(), tokens->end(), key, OrderByKey());
-       begin != end; ++begin) {
-    const UserPos::Token &token = *begin;
+  const UserDictionaryImage &image = tokens->image();
+  for (auto [i, end] = image.EqualRange(key); i < end; ++i) {
+    const UserDictionaryImage::Token token = image.token(i);
     if (token.value == value && !token.comment.empty()) {
       comment->assign(token.comment);
       return true;
@@ -567,6 +638,12 @@ void UserDictionary::WaitForReloader() { reloader_->Wait(); }
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
+  return LoadTokens(storage, /*source_stamp=*/0) != nullptr;
+}
+
+std::shared_ptr<const UserDictionary::TokensIndex> UserDictionary::LoadTokens(
+    const user_dictionary::UserDictionaryStorage &storage,
+    uint64_t source_stamp) {
   const size_t size = GetTokens()->size();
 
   // If UserDictionary is pretty big, we first remove the
@@ -583,10 +660,12 @@ bool UserDictionary::Load(
   }
 
   auto tokens = std::make_shared<TokensIndex>(*user_pos_);
-  tokens->Load(storage, &canceled_signal_);
+  if (!tokens->Load(storage, source_stamp, &canceled_signal_)) {
+    return nullptr;
+  }
 
   SetTokens(tokens);
-  return true;
+  return tokens;
 }
 
 std::vector<std::string> UserDictionary::GetPosList() const {
@@ -598,25 +677,38 @@ std::string UserDictionary::GetFileName() const { return filename_; }
 void UserDictionary::PopulateTokenFromUserPosToken(
     const UserPos::Token &user_pos_token, RequestType request_type,
     Token *token) const {
-  token->key = user_pos_token.key;
-  token->value = user_pos_token.value;
-  token->lid = token->rid = user_pos_token.id;
+  const UserDictionaryImage::Token user_token = {
+      .key = user_pos_token.key,
+      .value = user_pos_token.value,
+      .comment = user_pos_token.comment,
+      .id = user_pos_token.id,
+      .attributes = user_pos_token.attributes,
+  };
+  PopulateToken(user_token, request_type, token);
+}
+
+void UserDictionary::PopulateToken(const UserDictionaryImage::Token &user_token,
+                                   RequestType request_type,
+                                   Token *token) const {
+  strings::Assign(token->key, user_token.key);
+  strings::Assign(token->value, user_token.value);
+  token->lid = token->rid = user_token.id;
   token->attributes = Token::USER_DICTIONARY;
 
   // * Overwrites POS ids.
   // Actual pos id of suggestion-only candidates are 名詞-サ変.
   // TODO(taku): We would like to change the POS to 名詞-サ変 in user-pos.def,
   // because SUGGEST_ONLY is not POS.
-  if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY) ||
-      user_pos_token.has_attribute(UserPos::Token::SHORTCUT)) {
+  if (user_token.has_attribute(UserPos::Token::SUGGESTION_ONLY) ||
+      user_token.has_attribute(UserPos::Token::SHORTCUT)) {
     token->lid = token->rid = pos_matcher_.GetUnknownId();
   }
 
   // * Overwrites costs.
   // Locale is not Japanese.
-  if (user_pos_token.has_attribute(UserPos::Token::NON_JA_LOCALE)) {
+  if (user_token.has_attribute(UserPos::Token::NON_JA_LOCALE)) {
     token->cost = 10000;
-  } else if (user_pos_token.has_attribute(UserPos::Token::ISOLATED_WORD)) {
+  } else if (user_token.has_attribute(UserPos::Token::ISOLATED_WORD)) {
     // Set smaller cost for "短縮よみ" in order to make
     // the rank of the word higher than others.
     token->cost = 200;
@@ -629,7 +721,7 @@ void UserDictionary::PopulateTokenFromUserPosToken(
   // on the length of the key. Shorter keys have more penalty so that
   // they are not shown in the context.
   // TODO(taku): Better to apply this cost for all user defined words?
-  if (user_pos_token.has_attribute(UserPos::Token::SHORTCUT) &&
+  if (user_token.has_attribute(UserPos::Token::SHORTCUT) &&
       (request_type == PREFIX || request_type == EXACT)) {
     const int key_length = strings::AtLeastCharsLen(token->key, 4);
     token->cost += (4 - key_length) * 2000;
@@ -31,6 +31,7 @@
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -40,6 +41,7 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
+#include "dictionary/user_dictionary_image.h"
 #include "dictionary/user_pos.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "request/conversion_request.h"
@@ -130,10 +132,22 @@ class UserDictionary : public UserDictionaryInterface {
 
   std::string GetFileName() const;
 
+  // Builds the tokens from `storage` and sets them. Returns nullptr when the
+  // loading is canceled.
+  std::shared_ptr<const TokensIndex> LoadTokens(
+      const user_dictionary::UserDictionaryStorage &storage,
+      uint64_t source_stamp);
+
+  void PopulateToken(const UserDictionaryImage::Token &user_token,
+                     RequestType request_type, Token *token) const;
+
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPos> user_pos_;
   const PosMatcher pos_matcher_;
 
+  // Identifies the POS data, which the compiled images depend on.
+  const uint64_t user_pos_fingerprint_;
+
   // Uses shared pointer to asynchronously update `tokens_`.
   // `tokens_` are set in different thread.
   std::shared_ptr<TokensIndex> tokens_;
@@ -0,0 +1,354 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/user_dictionary_image.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dictionary/user_pos.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'Z', 'U', 'S', 'R', 'D', 'I', 'C'};
+
+template <typename T>
+void AppendRaw(const T &value, std::string &out) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+absl::Span<const T> GetSpan(const char *data, size_t size) {
+  return absl::MakeConstSpan(std::launder(reinterpret_cast<const T *>(data)),
+                             size);
+}
+
+// Collects the strings into one pool, sharing the identical strings.
+class StringPoolBuilder {
+ public:
+  // Returns the offset of `str` in the pool. `str` must outlive this builder.
+  uint32_t Add(absl::string_view str) {
+    const auto [it, inserted] = offsets_.emplace(str, pool_.size());
+    if (inserted) {
+      pool_.append(str);
+    }
+    return it->second;
+  }
+
+  const std::string &pool() const { return pool_; }
+
+ private:
+  std::string pool_;
+  absl::flat_hash_map<absl::string_view, uint32_t> offsets_;
+};
+
+}  // namespace
+
+struct UserDictionaryImage::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_tokens;
+  uint32_t num_trie_nodes;
+  uint32_t num_suppression_entries;
+  uint32_t string_pool_size;
+  uint32_t reserved;
+  uint64_t source_stamp;
+};
+
+std::string UserDictionaryImage::Build(
+    absl::Span<const UserPos::Token> tokens,
+    absl::Span<const std::pair<std::string, std::string>> suppression_entries,
+    uint64_t source_stamp) {
+  static_assert(sizeof(Header) == 40);
+  static_assert(sizeof(TokenRecord) == 28);
+  static_assert(sizeof(TrieNode) == 16);
+  static_assert(sizeof(SuppressionRecord) == 16);
+
+  StringPoolBuilder pool;
+  std::vector<TokenRecord> token_records;
+  token_records.reserve(tokens.size());
+  for (const UserPos::Token &token : tokens) {
+    token_records.push_back({
+        .key_offset = pool.Add(token.key),
+        .key_size = static_cast<uint32_t>(token.key.size()),
+        .value_offset = pool.Add(token.value),
+        .value_size = static_cast<uint32_t>(token.value.size()),
+        .comment_offset = pool.Add(token.comment),
+        .comment_size = static_cast<uint32_t>(token.comment.size()),
+        .id = token.id,
+        .attributes = token.attributes,
+    });
+  }
+
+  std::vector<SuppressionRecord> suppression_records;
+  suppression_records.reserve(suppression_entries.size());
+  for (const auto &[key, value] : suppression_entries) {
+    suppression_records.push_back({
+        .key_offset = pool.Add(key),
+        .key_size = static_cast<uint32_t>(key.size()),
+        .value_offset = pool.Add(value),
+        .value_size = static_cast<uint32_t>(value.size()),
+    });
+  }
+
+  // Builds the trie. Since the tokens are sorted, the tokens under a node form
+  // a range, in which the tokens whose key ends at the node come first.
+  std::vector<TrieNode> trie_nodes;
+  if (!tokens.empty()) {
+    struct Range {
+      uint32_t begin;
+      uint32_t end;
+      uint32_t depth;
+    };
+    std::vector<Range> ranges;
+    trie_nodes.push_back({});
+    ranges.push_back({0, static_cast<uint32_t>(tokens.size()), 0});
+    for (size_t i = 0; i < trie_nodes.size(); ++i) {
+      const auto [begin, end, depth] = ranges[i];
+      uint32_t pos = begin;
+      while (pos < end && tokens[pos].key.size() == depth) {
+        ++pos;
+      }
+      trie_nodes[i].children_begin = trie_nodes.size();
+      trie_nodes[i].tokens_begin = begin;
+      trie_nodes[i].tokens_end = pos;
+      while (pos < end) {
+        const char label = tokens[pos].key[depth];
+        uint32_t next = pos + 1;
+        while (next < end && tokens[next].key[depth] == label) {
+          ++next;
+        }
+        trie_nodes.push_back({.label = static_cast<uint8_t>(label)});
+        ranges.push_back({pos, next, depth + 1});
+        pos = next;
+      }
+    }
+  }
+
+  Header header = {
+      .version = kFormatVersion,
+      .num_tokens = static_cast<uint32_t>(token_records.size()),
+      .num_trie_nodes = static_cast<uint32_t>(trie_nodes.size()),
+      .num_suppression_entries =
+          static_cast<uint32_t>(suppression_records.size()),
+      .string_pool_size = static_cast<uint32_t>(pool.pool().size()),
+      .source_stamp = source_stamp,
+  };
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+
+  std::string image;
+  image.reserve(sizeof(Header) + token_records.size() * sizeof(TokenRecord) +
+                trie_nodes.size() * sizeof(TrieNode) +
+                suppression_records.size() * sizeof(SuppressionRecord) +
+                pool.pool().size());
+  AppendRaw(header, image);
+  for (const TokenRecord &record : token_records) {
+    AppendRaw(record, image);
+  }
+  for (const TrieNode &node : trie_nodes) {
+    AppendRaw(node, image);
+  }
+  for (const SuppressionRecord &record : suppression_records) {
+    AppendRaw(record, image);
+  }
+  image.append(pool.pool());
+  return image;
+}
+
+absl::StatusOr<UserDictionaryImage> UserDictionaryImage::Open(
+    absl::string_view data) {
+  if (data.size() < sizeof(Header)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Image is too small: %d bytes", data.size()));
+  }
+  if (reinterpret_cast<uintptr_t>(data.data()) % alignof(TokenRecord) != 0) {
+    return absl::InvalidArgumentError("Image is not aligned");
+  }
+  Header header;
+  std::memcpy(&header, data.data(), sizeof(Header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    return absl::InvalidArgumentError("Broken magic");
+  }
+  if (header.version != kFormatVersion) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Format version mismatch: %d != %d", header.version, kFormatVersion));
+  }
+
+  // Computes the section sizes in 64 bits so that they never overflow.
+  const uint64_t tokens_size =
+      uint64_t{header.num_tokens} * sizeof(TokenRecord);
+  const uint64_t trie_nodes_size =
+      uint64_t{header.num_trie_nodes} * sizeof(TrieNode);
+  const uint64_t suppression_size =
+      uint64_t{header.num_suppression_entries} * sizeof(SuppressionRecord);
+  const uint64_t expected_size = sizeof(Header) + tokens_size +
+                                 trie_nodes_size + suppression_size +
+                                 header.string_pool_size;
+  if (expected_size != data.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Image size mismatch: expected %d, actual %d",
+                        expected_size, data.size()));
+  }
+  if (header.num_tokens > 0 && header.num_trie_nodes == 0) {
+    return absl::InvalidArgumentError("Trie is missing");
+  }
+
+  UserDictionaryImage image;
+  image.source_stamp_ = header.source_stamp;
+  const char *ptr = data.data() + sizeof(Header);
+  image.tokens_ = GetSpan<TokenRecord>(ptr, header.num_tokens);
+  ptr += tokens_size;
+  image.trie_nodes_ = GetSpan<TrieNode>(ptr, header.num_trie_nodes);
+  ptr += trie_nodes_size;
+  image.suppression_entries_ =
+      GetSpan<SuppressionRecord>(ptr, header.num_suppression_entries);
+  ptr += suppression_size;
+  image.string_pool_ = absl::string_view(ptr, header.string_pool_size);
+  return image;
+}
+
+UserDictionaryImage::Token UserDictionaryImage::token(size_t i) const {
+  const TokenRecord &record = tokens_[i];
+  return Token{
+      .key = GetString(record.key_offset, record.key_size),
+      .value = GetString(record.value_offset, record.value_size),
+      .comment = GetString(record.comment_offset, record.comment_size),
+      .id = record.id,
+      .attributes = record.attributes,
+  };
+}
+
+absl::string_view UserDictionaryImage::key(size_t i) const {
+  return GetString(tokens_[i].key_offset, tokens_[i].key_size);
+}
+
+std::pair<size_t, size_t> UserDictionaryImage::EqualRange(
+    absl::string_view key) const {
+  size_t begin = 0, end = size();
+  // Finds the first token whose key is not less than `key`.
+  for (size_t count = end; count > 0;) {
+    const size_t half = count / 2;
+    if (this->key(begin + half) < key) {
+      begin += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  end = begin;
+  while (end < size() && this->key(end) == key) {
+    ++end;
+  }
+  return {begin, end};
+}
+
+std::pair<size_t, size_t> UserDictionaryImage::PrefixRange(
+    absl::string_view prefix) const {
+  const auto head = [&](size_t i) { return key(i).substr(0, prefix.size()); };
+  size_t begin = 0;
+  for (size_t count = size(); count > 0;) {
+    const size_t half = count / 2;
+    if (head(begin + half) < prefix) {
+      begin += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  size_t end = begin;
+  for (size_t count = size() - begin; count > 0;) {
+    const size_t half = count / 2;
+    if (head(end + half) == prefix) {
+      end += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  return {begin, end};
+}
+
+std::pair<absl::string_view, absl::string_view>
+UserDictionaryImage::suppression_entry(size_t i) const {
+  const SuppressionRecord &record = suppression_entries_[i];
+  return {GetString(record.key_offset, record.key_size),
+          GetString(record.value_offset, record.value_size)};
+}
+
+absl::string_view UserDictionaryImage::GetString(uint32_t offset,
+                                                 uint32_t size) const {
+  if (offset > string_pool_.size()) {
+    return absl::string_view();
+  }
+  // substr() clips `size` at the end of the pool.
+  return string_pool_.substr(offset, size);
+}
+
+std::pair<size_t, size_t> UserDictionaryImage::TokensAt(size_t node) const {
+  const TrieNode &trie_node = trie_nodes_[node];
+  const size_t end = std::min<size_t>(trie_node.tokens_end, size());
+  return {std::min<size_t>(trie_node.tokens_begin, end), end};
+}
+
+size_t UserDictionaryImage::FindChild(size_t node, uint8_t label) const {
+  const size_t num_nodes = trie_nodes_.size();
+  const size_t children_end = std::min<size_t>(
+      node + 1 < num_nodes ? trie_nodes_[node + 1].children_begin : num_nodes,
+      num_nodes);
+  const size_t children_begin =
+      std::min<size_t>(trie_nodes_[node].children_begin, children_end);
+  const auto begin = trie_nodes_.begin() + children_begin;
+  const auto end = trie_nodes_.begin() + children_end;
+  const auto it =
+      std::lower_bound(begin, end, label, [](const TrieNode &n, uint8_t label) {
+        return n.label < label;
+      });
+  if (it == end || it->label != label) {
+    return kNoNode;
+  }
+  return it - trie_nodes_.begin();
+}
+
+}  // namespace dictionary
+}  // namespace mozc
@@ -0,0 +1,200 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_DICTIONARY_USER_DICTIONARY_IMAGE_H_
+#define MOZC_DICTIONARY_USER_DICTIONARY_IMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dictionary/user_pos.h"
+
+namespace mozc {
+namespace dictionary {
+
+// UserDictionaryImage is a compiled form of the user dictionary, which is read
+// in place. When the image is memory-mapped from a file, opening it costs O(1)
+// regardless of the number of the entries, and the pages are shared among the
+// processes mapping the same file.
+//
+// * Prerequisite
+// Little endian is assumed.
+//
+// * Binary format
+//
+// +---------------------------------------+
+// | Header (40 bytes)                     |
+// +---------------------------------------+
+// | Token records (28 bytes each)         |
+// +---------------------------------------+
+// | Trie nodes (16 bytes each)            |
+// +---------------------------------------+
+// | Suppression records (16 bytes each)   |
+// +---------------------------------------+
+// | String pool                           |
+// +---------------------------------------+
+//
+// The token records are sorted by key and then by POS id. Every string is
+// stored as a pair of offset and size in the string pool. The trie is built
+// over the bytes of the keys and its nodes are stored in the breadth-first
+// order, so that the prefix lookup costs O(key length).
+class UserDictionaryImage {
+ public:
+  static constexpr uint32_t kFormatVersion = 1;
+
+  // A token read from the image. The strings point into the image.
+  struct Token {
+    absl::string_view key;
+    absl::string_view value;
+    absl::string_view comment;
+    uint16_t id = 0;
+    uint16_t attributes = 0;
+
+    bool has_attribute(UserPos::Token::Attribute attr) const {
+      return attributes & attr;
+    }
+  };
+
+  // Builds the image of `tokens`, which must be sorted by key and then by POS
+  // id, and `suppression_entries` of (key, value) pairs. `source_stamp`
+  // identifies the source from which the image is compiled.
+  static std::string Build(
+      absl::Span<const UserPos::Token> tokens,
+      absl::Span<const std::pair<std::string, std::string>>
+          suppression_entries,
+      uint64_t source_stamp);
+
+  // Returns the image reading `data` in place. `data` must outlive the
+  // returned image and be aligned to 4 bytes. Only the header is validated
+  // here; the accessors never read outside of `data` even if the records are
+  // broken.
+  static absl::StatusOr<UserDictionaryImage> Open(absl::string_view data);
+
+  // Constructs an empty image.
+  UserDictionaryImage() = default;
+
+  uint64_t source_stamp() const { return source_stamp_; }
+
+  bool empty() const { return tokens_.empty(); }
+  size_t size() const { return tokens_.size(); }
+
+  Token token(size_t i) const;
+  absl::string_view key(size_t i) const;
+
+  // Returns the range [begin, end) of the tokens whose key is `key`.
+  std::pair<size_t, size_t> EqualRange(absl::string_view key) const;
+
+  // Returns the range [begin, end) of the tokens whose key starts with
+  // `prefix`.
+  std::pair<size_t, size_t> PrefixRange(absl::string_view prefix) const;
+
+  // Calls `visitor(begin, end)` for each range of the tokens whose key is a
+  // prefix of `key`, from the shortest key. Stops when `visitor` returns
+  // false. Costs O(key length + number of matches), independent of the
+  // dictionary size.
+  template <typename Visitor>
+  void VisitPrefixes(absl::string_view key, Visitor visitor) const {
+    if (trie_nodes_.empty()) {
+      return;
+    }
+    size_t node = 0;
+    for (const char c : key) {
+      node = FindChild(node, static_cast<uint8_t>(c));
+      if (node == kNoNode) {
+        return;
+      }
+      const auto [begin, end] = TokensAt(node);
+      if (begin != end && !visitor(begin, end)) {
+        return;
+      }
+    }
+  }
+
+  size_t suppression_entries_size() const {
+    return suppression_entries_.size();
+  }
+  // Returns the i-th suppression entry as a pair of key and value.
+  std::pair<absl::string_view, absl::string_view> suppression_entry(
+      size_t i) const;
+
+ private:
+  struct TokenRecord {
+    uint32_t key_offset;
+    uint32_t key_size;
+    uint32_t value_offset;
+    uint32_t value_size;
+    uint32_t comment_offset;
+    uint32_t comment_size;
+    uint16_t id;
+    uint16_t attributes;
+  };
+
+  // The children of the i-th node are trie_nodes_[children_begin] to
+  // trie_nodes_[i + 1].children_begin - 1, sorted by label.
+  struct TrieNode {
+    uint32_t children_begin;
+    // The tokens whose key ends at this node.
+    uint32_t tokens_begin;
+    uint32_t tokens_end;
+    uint8_t label;
+    uint8_t reserved[3];
+  };
+
+  struct SuppressionRecord {
+    uint32_t key_offset;
+    uint32_t key_size;
+    uint32_t value_offset;
+    uint32_t value_size;
+  };
+
+  struct Header;
+
+  static constexpr size_t kNoNode = 0;  // The root is never a child.
+
+  absl::string_view GetString(uint32_t offset, uint32_t size) const;
+  std::pair<size_t, size_t> TokensAt(size_t node) const;
+  size_t FindChild(size_t node, uint8_t label) const;
+
+  uint64_t source_stamp_ = 0;
+  absl::Span<const TokenRecord> tokens_;
+  absl::Span<const TrieNode> trie_nodes_;
+  absl::Span<const SuppressionRecord> suppression_entries_;
+  absl::string_view string_pool_;
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_USER_DICTIONARY_IMAGE_H_
@@ -0,0 +1,158 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/user_dictionary_image.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "dictionary/user_pos.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+std::vector<UserPos::Token> MakeTokens() {
+  std::vector<UserPos::Token> tokens = {
+      {.key = "あ", .value = "亜", .id = 1},
+      {.key = "あい", .value = "愛", .id = 1, .comment = "love"},
+      {.key = "あい", .value = "藍", .id = 2},
+      {.key = "あいう", .value = "アイウ", .id = 3,
+       .attributes = UserPos::Token::SUGGESTION_ONLY},
+      {.key = "か", .value = "化", .id = 1},
+  };
+  std::sort(tokens.begin(), tokens.end(),
+            [](const UserPos::Token &lhs, const UserPos::Token &rhs) {
+              return std::make_pair(lhs.key, lhs.id) <
+                     std::make_pair(rhs.key, rhs.id);
+            });
+  return tokens;
+}
+
+std::vector<std::string> GetValues(const UserDictionaryImage &image,
+                                   std::pair<size_t, size_t> range) {
+  std::vector<std::string> values;
+  for (size_t i = range.first; i < range.second; ++i) {
+    values.emplace_back(image.token(i).value);
+  }
+  return values;
+}
+
+TEST(UserDictionaryImageTest, BuildAndOpen) {
+  const std::vector<std::pair<std::string, std::string>> suppression_entries =
+      {{"さ", "差"}, {"", "死"}};
+  const std::string data =
+      UserDictionaryImage::Build(MakeTokens(), suppression_entries, 1234);
+  absl::StatusOr<UserDictionaryImage> image = UserDictionaryImage::Open(data);
+  ASSERT_TRUE(image.ok()) << image.status();
+
+  EXPECT_EQ(image->source_stamp(), 1234);
+  ASSERT_EQ(image->size(), 5);
+  const UserDictionaryImage::Token token = image->token(1);
+  EXPECT_EQ(token.key, "あい");
+  EXPECT_EQ(token.value, "愛");
+  EXPECT_EQ(token.comment, "love");
+  EXPECT_EQ(token.id, 1);
+  EXPECT_TRUE(image->token(3).has_attribute(UserPos::Token::SUGGESTION_ONLY));
+
+  ASSERT_EQ(image->suppression_entries_size(), 2);
+  EXPECT_THAT(image->suppression_entry(0), Pair("さ", "差"));
+  EXPECT_THAT(image->suppression_entry(1), Pair("", "死"));
+}
+
+TEST(UserDictionaryImageTest, Lookup) {
+  const std::string data = UserDictionaryImage::Build(MakeTokens(), {}, 0);
+  absl::StatusOr<UserDictionaryImage> image = UserDictionaryImage::Open(data);
+  ASSERT_TRUE(image.ok()) << image.status();
+
+  EXPECT_THAT(GetValues(*image, image->EqualRange("あい")),
+              ElementsAre("愛", "藍"));
+  EXPECT_THAT(GetValues(*image, image->EqualRange("い")), IsEmpty());
+  EXPECT_THAT(GetValues(*image, image->PrefixRange("あい")),
+              ElementsAre("愛", "藍", "アイウ"));
+  EXPECT_THAT(GetValues(*image, image->PrefixRange("か")), ElementsAre("化"));
+  EXPECT_THAT(GetValues(*image, image->PrefixRange("さ")), IsEmpty());
+
+  std::vector<std::string> values;
+  image->VisitPrefixes("あいうえ", [&](size_t begin, size_t end) {
+    for (const std::string &value : GetValues(*image, {begin, end})) {
+      values.push_back(value);
+    }
+    return true;
+  });
+  EXPECT_THAT(values, ElementsAre("亜", "愛", "藍", "アイウ"));
+
+  values.clear();
+  image->VisitPrefixes("あいうえ", [&](size_t begin, size_t end) {
+    values.push_back(std::string(image->token(begin).value));
+    return false;
+  });
+  EXPECT_THAT(values, ElementsAre("亜"));
+}
+
+TEST(UserDictionaryImageTest, Empty) {
+  const std::string data = UserDictionaryImage::Build({}, {}, 0);
+  absl::StatusOr<UserDictionaryImage> image = UserDictionaryImage::Open(data);
+  ASSERT_TRUE(image.ok()) << image.status();
+  EXPECT_TRUE(image->empty());
+  EXPECT_THAT(image->EqualRange("あ"), Pair(0, 0));
+  EXPECT_THAT(image->PrefixRange("あ"), Pair(0, 0));
+  image->VisitPrefixes("あ", [](size_t begin, size_t end) {
+    ADD_FAILURE() << "Never called";
+    return true;
+  });
+}
+
+TEST(UserDictionaryImageTest, RejectsBrokenData) {
+  const std::string data = UserDictionaryImage::Build(MakeTokens(), {}, 0);
+  EXPECT_FALSE(UserDictionaryImage::Open("").ok());
+  EXPECT_FALSE(
+      UserDictionaryImage::Open(absl::string_view(data).substr(0, 40)).ok());
+  EXPECT_FALSE(UserDictionaryImage::Open(data + "x").ok());
+
+  std::string broken_magic = data;
+  broken_magic[0] = 'X';
+  EXPECT_FALSE(UserDictionaryImage::Open(broken_magic).ok());
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
@@ -173,6 +173,15 @@ absl::Status UserDictionaryStorage::Save() const {
     return absl::PermissionDeniedError(msg);
   }
 
+  // The compiled image is stale now. It is rebuilt by UserDictionary on the
+  // next load. Failure is not fatal as the image is also validated by the
+  // modification time of the source.
+  if (absl::Status s = FileUtil::UnlinkIfExists(
+          UserDictionaryUtil::GetUserDictionaryImageFileName(filename_));
+      !s.ok()) {
+    LOG(WARNING) << "Cannot remove the user dictionary image: " << s;
+  }
+
   if (too_big_file_bytes) {
     return absl::ResourceExhaustedError(absl::StrFormat(
         "Save was successful with error (TOO_BIG_FILE_BYTES): %s",
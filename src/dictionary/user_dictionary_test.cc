@@ -40,6 +40,7 @@
 #include <vector>
 
 #include "absl/log/check.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
@@ -55,6 +56,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/user_dictionary_storage.h"
+#include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
 #include "protocol/config.pb.h"
 #include "protocol/user_dictionary_storage.pb.h"
@@ -73,6 +75,7 @@ using ::testing::AnyNumber;
 using ::testing::AnyOf;
 using ::testing::Each;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::Eq;
 using ::testing::Field;
 using ::testing::IsEmpty;
@@ -546,6 +549,42 @@ TEST_F(UserDictionaryTest, TestLookupPrefix) {
   EXPECT_THAT(LookupPrefix("starting", *dic), IsEmpty());
 }
 
+TEST_F(UserDictionaryTest, TestLookupPrefixWithSharedFirstCharacter) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  // Many entries share the first character "か".
+  constexpr absl::string_view kChars[] = {"か", "き", "く", "ん", "じ"};
+  std::string contents;
+  for (const absl::string_view c1 : kChars) {
+    for (const absl::string_view c2 : kChars) {
+      for (const absl::string_view c3 : kChars) {
+        const std::string key = absl::StrCat("か", c1, c2, c3);
+        absl::StrAppend(&contents, key, "\t", key, "\tnoun\n");
+      }
+    }
+  }
+  absl::StrAppend(&contents, "か\tか\tnoun\n", "かん\tかん\tnoun\n");
+  {
+    UserDictionaryStorage storage("");
+    LoadFromString(contents, &storage);
+    dic->Load(storage.GetProto());
+  }
+
+  // Only the prefixes of the key are returned, from the shortest one.
+  const Entry kExpected[] = {
+      {"か", "か", 100, 100},
+      {"かん", "かん", 100, 100},
+      {"かんじく", "かんじく", 100, 100},
+  };
+  EXPECT_THAT(LookupPrefix("かんじくう", *dic), ElementsAreArray(kExpected));
+  EXPECT_THAT(LookupPrefix("かんじ", *dic),
+              ElementsAre(kExpected[0], kExpected[1]));
+  EXPECT_THAT(LookupPrefix("かあ", *dic), ElementsAre(kExpected[0]));
+  EXPECT_THAT(LookupPrefix("きかん", *dic), IsEmpty());
+}
+
 TEST_F(UserDictionaryTest, TestLookupExact) {
   std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
   // Wait for async reload called from the constructor.
@@ -810,6 +849,66 @@ TEST_F(UserDictionaryTest, AsyncLoadTest) {
   }
 }
 
+TEST_F(UserDictionaryTest, CompiledImageTest) {
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string filename =
+      FileUtil::JoinPath(temp_dir.path(), "compiled_image_test.db");
+  const std::string image_filename =
+      UserDictionaryUtil::GetUserDictionaryImageFileName(filename);
+
+  UserDictionaryStorage storage(filename);
+  EXPECT_TRUE(storage.Lock());
+  EXPECT_OK(storage.CreateDictionary("test"));
+  {
+    UserDictionaryStorage::UserDictionary *dic =
+        storage.GetProto().mutable_dictionaries(0);
+    UserDictionaryStorage::UserDictionaryEntry *entry = dic->add_entries();
+    entry->set_key("key");
+    entry->set_value("value");
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    entry = dic->add_entries();
+    entry->set_key("suppress_key");
+    entry->set_value("suppress_value");
+    entry->set_pos(user_dictionary::UserDictionary::SUPPRESSION_WORD);
+  }
+  EXPECT_OK(storage.Save());
+
+  // The image is compiled on the first load, and is mapped on the second.
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithFilename(filename));
+    dic->WaitForReloader();
+    EXPECT_OK(FileUtil::FileExists(image_filename));
+
+    CollectTokenCallback callback;
+    dic->LookupExact("key", ConvReq(config_), &callback);
+    ASSERT_EQ(callback.tokens().size(), 1);
+    EXPECT_EQ(callback.tokens()[0].value, "value");
+    EXPECT_TRUE(dic->IsSuppressedEntry("suppress_key", "suppress_value"));
+  }
+
+  // An image compiled from the old source is not used even if the source is
+  // modified within the same second.
+  absl::StatusOr<std::string> old_image = FileUtil::GetContents(image_filename);
+  ASSERT_OK(old_image);
+  storage.GetProto().mutable_dictionaries(0)->mutable_entries(0)->set_value(
+      "new_value");
+  EXPECT_OK(storage.Save());
+  EXPECT_OK(FileUtil::SetContents(image_filename, *old_image));
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithFilename(filename));
+    dic->WaitForReloader();
+    CollectTokenCallback callback;
+    dic->LookupExact("key", ConvReq(config_), &callback);
+    ASSERT_EQ(callback.tokens().size(), 1);
+    EXPECT_EQ(callback.tokens()[0].value, "new_value");
+  }
+
+  // Saving the source invalidates the image.
+  EXPECT_OK(storage.Save());
+  EXPECT_FALSE(FileUtil::FileExists(image_filename).ok());
+  EXPECT_TRUE(storage.UnLock());
+}
+
 TEST_F(UserDictionaryTest, TestSuppressionDictionary) {
   std::unique_ptr<UserDictionary> user_dic(CreateDictionaryWithMockPos());
   user_dic->WaitForReloader();
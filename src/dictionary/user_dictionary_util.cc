@@ -39,6 +39,7 @@
 
 #include "absl/log/log.h"
 #include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "base/config_file_stream.h"
@@ -216,6 +217,12 @@ std::string UserDictionaryUtil::GetUserDictionaryFileName() {
   return ConfigFileStream::GetFileName(kUserDictionaryFile);
 }
 
+// static
+std::string UserDictionaryUtil::GetUserDictionaryImageFileName(
+    absl::string_view filename) {
+  return absl::StrCat(filename, ".image");
+}
+
 // static
 bool UserDictionaryUtil::SanitizeEntry(
     user_dictionary::UserDictionary::Entry *entry) {
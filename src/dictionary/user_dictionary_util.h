@@ -131,6 +131,10 @@ class UserDictionaryUtil {
   // Returns the file name of UserDictionary.
   static std::string GetUserDictionaryFileName();
 
+  // Returns the file name of the compiled image of the user dictionary stored
+  // in `filename`.
+  static std::string GetUserDictionaryImageFileName(absl::string_view filename);
+
   // Returns the string representation of PosType, or empty string if the given
   // pos is invalid.
   // For historical reason, the pos was represented in Japanese characters.
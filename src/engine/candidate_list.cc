@@ -43,6 +43,21 @@
 namespace mozc {
 namespace engine {
 
+Candidate::Candidate(const Candidate &x)
+    : id_(x.id_),
+      attributes_(x.attributes_),
+      subcandidate_list_(x.subcandidate_list_ == nullptr
+                             ? nullptr
+                             : std::make_unique<CandidateList>(
+                                   *x.subcandidate_list_)) {}
+
+Candidate &Candidate::operator=(const Candidate &x) {
+  if (this != &x) {
+    *this = Candidate(x);
+  }
+  return *this;
+}
+
 void Candidate::Clear() {
   id_ = 0;
   attributes_ = NO_ATTRIBUTES;
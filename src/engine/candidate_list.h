@@ -70,6 +70,14 @@ using Attributes = uint32_t;
 
 class Candidate final {
  public:
+  Candidate() = default;
+
+  // Copies the subcandidate list as well.
+  Candidate(const Candidate &x);
+  Candidate &operator=(const Candidate &x);
+  Candidate(Candidate &&) = default;
+  Candidate &operator=(Candidate &&) = default;
+
   void Clear();
 
   bool HasSubcandidateList() const { return subcandidate_list_ != nullptr; }
@@ -110,14 +118,10 @@ class CandidateList final {
         rotate_(rotate),
         focused_(false) {}
 
-  // Minimum copy operator.
-  // TODO(all): Support full copy operation of CandidateList as EngineConverter
-  // is currently copyable. Since the CandidateList contractor is
-  // initialized with `rotate`, `rotate_` is copied in the copy operator.
-  CandidateList &operator=(const CandidateList &candidate_list) {
-    rotate_ = candidate_list.rotate_;
-    return *this;
-  }
+  // Copyable so that EngineConverter::Clone() copies the candidates as they
+  // are instead of building them from the segments again.
+  CandidateList(const CandidateList &) = default;
+  CandidateList &operator=(const CandidateList &) = default;
 
   void Clear();
 
@@ -467,5 +467,22 @@ TEST_F(CandidateListTest, NextAvailableId) {
   EXPECT_EQ(sub_sub_list_2_1_->next_available_id(), 214);
 }
 
+TEST_F(CandidateListTest, Copy) {
+  EXPECT_TRUE(main_list_->MoveToId(22));
+  CandidateList copy = *main_list_;
+  EXPECT_TRUE(copy.rotate());
+  EXPECT_EQ(copy.size(), main_list_->size());
+  EXPECT_EQ(copy.focused_id(), 22);
+  EXPECT_EQ(copy.next_available_id(), 213);
+
+  // The subcandidate lists are copied as well.
+  ASSERT_TRUE(copy.candidate(7).HasSubcandidateList());
+  EXPECT_NE(&copy.candidate(7).subcandidate_list(),
+            &main_list_->candidate(7).subcandidate_list());
+  EXPECT_TRUE(copy.MoveToId(1));
+  EXPECT_EQ(copy.focused_id(), 1);
+  EXPECT_EQ(main_list_->focused_id(), 22);
+}
+
 }  // namespace engine
 }  // namespace mozc
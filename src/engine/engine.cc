@@ -30,6 +30,7 @@
 #include "engine/engine.h"
 
 #include <memory>
+#include <optional>
 #include <utility>
 
 #include "absl/base/optimization.h"
@@ -39,6 +40,8 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
 #include "base/vlog.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
@@ -49,6 +52,7 @@
 #include "engine/data_loader.h"
 #include "engine/minimal_converter.h"
 #include "engine/modules.h"
+#include "engine/synchronized_converter.h"
 #include "engine/supplemental_model_interface.h"
 #include "prediction/dictionary_predictor.h"
 #include "prediction/predictor.h"
@@ -86,7 +90,8 @@ absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateEngine(
 absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateEngine(
     std::unique_ptr<engine::Modules> modules, bool is_mobile) {
   auto engine = std::make_unique<Engine>();
-  absl::Status engine_status = engine->Init(std::move(modules), is_mobile);
+  absl::Status engine_status =
+      engine->ReloadModules(std::move(modules), is_mobile);
   if (!engine_status.ok()) {
     return engine_status;
   }
@@ -99,14 +104,24 @@ std::unique_ptr<Engine> Engine::CreateEngine() {
 
 Engine::Engine() : minimal_converter_(CreateMinimalConverter()) {}
 
+Engine::~Engine() {
+  // The loader thread may still deliver a snapshot to `pending_`.
+  loader_.Wait();
+}
+
 absl::Status Engine::ReloadModules(std::unique_ptr<engine::Modules> modules,
                                    bool is_mobile) {
-  ReloadAndWait();
-  return Init(std::move(modules), is_mobile);
+  absl::StatusOr<std::shared_ptr<const Snapshot>> snapshot =
+      CreateSnapshot(std::move(modules), is_mobile);
+  if (!snapshot.ok()) {
+    return snapshot.status();
+  }
+  Publish(*std::move(snapshot));
+  return absl::OkStatus();
 }
 
-absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
-                          bool is_mobile) {
+absl::StatusOr<std::shared_ptr<const Engine::Snapshot>> Engine::CreateSnapshot(
+    std::unique_ptr<engine::Modules> modules, bool is_mobile) {
   auto immutable_converter_factory = [](const engine::Modules &modules) {
     return std::make_unique<ImmutableConverter>(modules);
   };
@@ -144,69 +159,133 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
     return absl::ResourceExhaustedError("engine.cc: converter_ is null");
   }
 
-  converter_ = std::move(converter);
+  auto synchronized_converter =
+      std::make_shared<SynchronizedConverter>(converter);
+  return std::make_shared<const Snapshot>(
+      Snapshot{std::move(converter), std::move(synchronized_converter)});
+}
 
-  return absl::OkStatus();
+void Engine::Publish(std::shared_ptr<const Snapshot> snapshot) {
+  std::shared_ptr<const Snapshot> retired = snapshot_.load();
+  snapshot_.store(snapshot);
+  if (!retired) {
+    return;
+  }
+
+  // The retired converter saves its learning data on destruction, and then
+  // the new one reloads it. The reclaimers are chained to keep the order of
+  // the generations.
+  std::optional<BackgroundFuture<void>> previous = std::move(reclaimer_);
+  reclaimer_.emplace([previous = std::move(previous),
+                      retired = std::move(retired),
+                      current = std::move(snapshot)]() mutable {
+    if (previous.has_value()) {
+      previous->Wait();
+    }
+    retired.reset();
+    current->synchronized_converter->RunExclusively([&current] {
+      current->converter->Sync();
+      current->converter->Reload();
+    });
+  });
 }
 
-bool Engine::Reload() { return converter_ && converter_->Reload(); }
+bool Engine::Reload() {
+  const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+  return snapshot && snapshot->synchronized_converter->RunExclusively(
+                         [&snapshot] { return snapshot->converter->Reload(); });
+}
 
-bool Engine::Sync() { return converter_ && converter_->Sync(); }
+bool Engine::Sync() {
+  const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+  return snapshot && snapshot->synchronized_converter->RunExclusively(
+                         [&snapshot] { return snapshot->converter->Sync(); });
+}
 
-bool Engine::Wait() { return converter_ && converter_->Wait(); }
+bool Engine::Wait() {
+  if (reclaimer_.has_value()) {
+    reclaimer_->Wait();
+  }
+  const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+  return snapshot && snapshot->converter->Wait();
+}
 
 bool Engine::ReloadAndWait() { return Reload() && Wait(); }
 
 bool Engine::ClearUserHistory() {
-  if (converter_) {
-    converter_->rewriter().Clear();
+  if (const std::shared_ptr<const Snapshot> snapshot = snapshot_.load()) {
+    snapshot->synchronized_converter->RunExclusively(
+        [&snapshot] { snapshot->converter->rewriter().Clear(); });
   }
   return true;
 }
 
 bool Engine::ClearUserPrediction() {
-  return converter_ && converter_->predictor().ClearAllHistory();
+  const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+  return snapshot && snapshot->synchronized_converter->RunExclusively([&] {
+           return snapshot->converter->predictor().ClearAllHistory();
+         });
 }
 
 bool Engine::ClearUnusedUserPrediction() {
-  return converter_ && converter_->predictor().ClearUnusedHistory();
+  const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+  return snapshot && snapshot->synchronized_converter->RunExclusively([&] {
+           return snapshot->converter->predictor().ClearUnusedHistory();
+         });
 }
 
 bool Engine::MaybeReloadEngine(EngineReloadResponse *response) {
-  if (!converter_ || always_wait_for_testing_) {
+  if (!snapshot_.load() || always_wait_for_testing_) {
     loader_.Wait();
   }
 
-  if (loader_.IsRunning() || !loader_response_) {
+  if (loader_.IsRunning()) {
     return false;
   }
 
-  const bool is_mobile = loader_response_->response.request().engine_type() ==
-                         EngineReloadRequest::MOBILE;
-  *response = std::move(loader_response_->response);
-
-  const absl::Status reload_status =
-      ReloadModules(std::move(loader_response_->modules), is_mobile);
-  if (reload_status.ok()) {
-    response->set_status(EngineReloadResponse::RELOADED);
+  std::unique_ptr<PendingSnapshot> pending;
+  {
+    absl::MutexLock lock(&pending_mutex_);
+    pending = std::move(pending_);
+  }
+  if (!pending) {
+    return false;
   }
-  loader_response_.reset();
 
-  return reload_status.ok();
+  *response = std::move(pending->response);
+  response->set_status(EngineReloadResponse::RELOADED);
+  Publish(std::move(pending->snapshot));
+  return true;
 }
 
 bool Engine::SendEngineReloadRequest(const EngineReloadRequest &request) {
+  // The converter is built in the loader thread as well, so that
+  // MaybeReloadEngine() only needs to publish it.
   return loader_.StartNewDataBuildTask(
-      request, [this](std::unique_ptr<DataLoader::Response> response) {
-        loader_response_ = std::move(response);
+      request,
+      [this](std::unique_ptr<DataLoader::Response> response) -> absl::Status {
+        const bool is_mobile = response->response.request().engine_type() ==
+                               EngineReloadRequest::MOBILE;
+        absl::StatusOr<std::shared_ptr<const Snapshot>> snapshot =
+            CreateSnapshot(std::move(response->modules), is_mobile);
+        if (!snapshot.ok()) {
+          return snapshot.status();
+        }
+        auto pending = std::make_unique<PendingSnapshot>(PendingSnapshot{
+            std::move(response->response), *std::move(snapshot)});
+        {
+          absl::MutexLock lock(&pending_mutex_);
+          pending_.swap(pending);
+        }
+        // The snapshot replaced here, if any, is released out of the lock.
         return absl::OkStatus();
       });
 }
 
 bool Engine::SendSupplementalModelReloadRequest(
     const EngineReloadRequest &request) {
-  if (converter_) {
-    converter_->modules().GetSupplementalModel().LoadAsync(request);
+  if (const std::shared_ptr<const Snapshot> snapshot = snapshot_.load()) {
+    snapshot->converter->modules().GetSupplementalModel().LoadAsync(request);
   }
   return true;
 }
@@ -56,12 +56,14 @@
       'sources': [
         '<(gen_out_dir)/../dictionary/pos_matcher_impl.inc',
         'engine.cc',
+        'synchronized_converter.cc',
       ],
       'dependencies': [
         'engine_converter',
         'minimal_converter',
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_status',
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_strings',
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_synchronization',
         '<(mozc_oss_src_dir)/base/base.gyp:base',
         '<(mozc_oss_src_dir)/converter/converter.gyp:converter',
         '<(mozc_oss_src_dir)/dictionary/dictionary_base.gyp:pos_matcher',
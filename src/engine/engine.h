@@ -31,13 +31,17 @@
 #define MOZC_ENGINE_ENGINE_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
 #include "data_manager/data_manager.h"
@@ -47,6 +51,7 @@
 #include "engine/engine_interface.h"
 #include "engine/minimal_converter.h"
 #include "engine/modules.h"
+#include "engine/synchronized_converter.h"
 #include "engine/supplemental_model_interface.h"
 #include "prediction/predictor_interface.h"
 #include "protocol/commands.pb.h"
@@ -60,8 +65,8 @@ class Engine : public EngineInterface {
  public:
   // There are two types of engine: desktop and mobile.  The differences are the
   // underlying prediction engine (DesktopPredictor or MobilePredictor) and
-  // learning preference (to learn content word or not).  See Init() for the
-  // details of implementation.
+  // learning preference (to learn content word or not).  See CreateSnapshot()
+  // for the details of implementation.
 
   // Creates an instance with desktop configuration from a data manager.  The
   // ownership of data manager is passed to the engine instance.
@@ -87,8 +92,16 @@ class Engine : public EngineInterface {
   Engine(const Engine &) = delete;
   Engine &operator=(const Engine &) = delete;
 
+  ~Engine() override;
+
+  // Returns the converter shared by the sessions. It is safe to call from
+  // multiple threads. The returned converter stays valid after the engine is
+  // reloaded, so the callers holding it keep using the old snapshot.
   std::shared_ptr<const ConverterInterface> GetConverter() const {
-    return converter_ ? converter_ : minimal_converter_;
+    if (std::shared_ptr<const Snapshot> snapshot = snapshot_.load()) {
+      return snapshot->synchronized_converter;
+    }
+    return minimal_converter_;
   }
 
   std::unique_ptr<engine::EngineConverterInterface> CreateEngineConverter()
@@ -107,13 +120,17 @@ class Engine : public EngineInterface {
   bool ClearUserPrediction() override;
   bool ClearUnusedUserPrediction() override;
 
+  // Builds a converter from `modules` and publishes it synchronously.
   absl::Status ReloadModules(std::unique_ptr<engine::Modules> modules,
                              bool is_mobile);
 
   absl::string_view GetDataVersion() const override {
     static absl::string_view kDefaultDataVersion = "0.0.0";
-    return converter_ ? converter_->modules().GetDataManager().GetDataVersion()
-                      : kDefaultDataVersion;
+    const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+    if (!snapshot) {
+      return kDefaultDataVersion;
+    }
+    return snapshot->converter->modules().GetDataManager().GetDataVersion();
   }
 
   // Returns a list of part-of-speech (e.g. "名詞", "動詞一段") to be used for
@@ -121,19 +138,22 @@ class Engine : public EngineInterface {
   // Since the POS set may differ per LM, this function returns
   // available POS items. In practice, the POS items are rarely changed.
   std::vector<std::string> GetPosList() const override {
-    if (converter_) {
-      return converter_->modules().GetUserDictionary().GetPosList();
+    if (const std::shared_ptr<const Snapshot> snapshot = snapshot_.load()) {
+      return snapshot->converter->modules().GetUserDictionary().GetPosList();
     }
     return {};
   }
 
   // For testing only.
   engine::Modules &GetModulesForTesting() const {
-    DCHECK(converter_);
-    return converter_->modules();
+    const std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+    DCHECK(snapshot);
+    return snapshot->converter->modules();
   }
 
-  // Maybe reload a new data manager. Returns true if reloaded.
+  // Maybe reload a new data manager. Returns true if reloaded. The converter
+  // for the new data is built by the loader thread, so this method only
+  // publishes it. The retired converter is torn down in the background.
   bool MaybeReloadEngine(EngineReloadResponse *response) override;
   bool SendEngineReloadRequest(const EngineReloadRequest &request) override;
   bool SendSupplementalModelReloadRequest(
@@ -150,16 +170,39 @@ class Engine : public EngineInterface {
   // For the constructor.
   friend std::unique_ptr<Engine> std::make_unique<Engine>();
 
-  // Initializes the engine object by the given modules and is_mobile flag.
-  // The is_mobile flag is used to select DefaultPredictor and MobilePredictor.
-  absl::Status Init(std::unique_ptr<engine::Modules> modules, bool is_mobile);
+  // A converter and its wrapper for the sessions. They are published together
+  // so that the readers never see a mix of two generations.
+  struct Snapshot {
+    std::shared_ptr<Converter> converter;
+    std::shared_ptr<SynchronizedConverter> synchronized_converter;
+  };
+
+  // A snapshot built by the loader thread, waiting to be published.
+  struct PendingSnapshot {
+    EngineReloadResponse response;
+    std::shared_ptr<const Snapshot> snapshot;
+  };
+
+  // Builds a snapshot by the given modules and is_mobile flag. The is_mobile
+  // flag is used to select DefaultPredictor and MobilePredictor.
+  static absl::StatusOr<std::shared_ptr<const Snapshot>> CreateSnapshot(
+      std::unique_ptr<engine::Modules> modules, bool is_mobile);
+
+  // Replaces the current snapshot with `snapshot`. The previous snapshot is
+  // handed to `reclaimer_` so that its destruction, which saves the learning
+  // data and unmaps the data, doesn't block the caller.
+  void Publish(std::shared_ptr<const Snapshot> snapshot);
 
   DataLoader loader_;
 
   std::unique_ptr<engine::SupplementalModelInterface> supplemental_model_;
-  std::shared_ptr<Converter> converter_;
+  AtomicSharedPtr<const Snapshot> snapshot_;
   std::shared_ptr<ConverterInterface> minimal_converter_;
-  std::unique_ptr<DataLoader::Response> loader_response_;
+  absl::Mutex pending_mutex_;
+  std::unique_ptr<PendingSnapshot> pending_ ABSL_GUARDED_BY(pending_mutex_);
+  // Tears down the retired snapshots. Accessed only by the thread publishing
+  // the snapshots.
+  std::optional<BackgroundFuture<void>> reclaimer_;
   // Do not initialized with Init() because the cost of initialization is
   // negligible.
   user_dictionary::UserDictionarySessionHandler
@@ -0,0 +1,337 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// End-to-end benchmarks of the conversion engine.
+//
+// The benchmarks drive EngineConverter on top of the OSS data set with the
+// workloads seen on the keystroke path:
+//  * single-segment conversion,
+//  * multi-segment conversion,
+//  * suggestion per keystroke,
+//  * prediction, and
+//  * commit with learning.
+// Besides the mean time reported by the benchmark library, each benchmark
+// reports the latency percentiles of one operation (p50, p90 and p99 in
+// microseconds) and the number of heap allocations per operation, so that
+// the keystroke cost can be tracked across releases.
+//
+// Usage:
+//   bazelisk run -c opt //engine:engine_benchmark_test -- \
+//     --benchmark_repetitions=3
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "base/file/temp_dir.h"
+#include "base/system_util.h"
+#include "benchmark/benchmark.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "config/config_handler.h"
+#include "engine/engine.h"
+#include "engine/engine_converter.h"
+#include "engine/oss_engine_factory.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "testing/mozctest.h"
+
+namespace {
+
+// The number of heap allocations made by the process. Updated by the
+// replaced global operator new below.
+std::atomic<int64_t> g_num_allocations = 0;
+
+}  // namespace
+
+// Counts the heap allocations. The replacement is local to this benchmark
+// binary. The default operator delete releases the memory with free().
+void *operator new(size_t size) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size); ptr != nullptr) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace mozc {
+namespace engine {
+namespace {
+
+// Romaji inputs that are converted into a single segment.
+constexpr absl::string_view kSingleSegmentInputs[] = {
+    "henkan",  "nihongo", "kyou",      "tenki",   "arigatou",
+    "kaisha",  "densha",  "shashin",   "gakkou",  "tomodachi",
+    "benkyou", "shigoto", "yasumi",    "kazoku",  "ryokou",
+    "kensaku", "jikan",   "konpyu-ta", "tegami",  "denwa",
+};
+
+// Romaji inputs of sentences that are converted into multiple segments.
+constexpr absl::string_view kMultiSegmentInputs[] = {
+    "watashinonamaehanakanodesu",
+    "kyouhaiitenkidesune",
+    "ashitanokaigiha10jikarakaisaisaremasu",
+    "kinouhatomodachitoeigawominiikimashita",
+    "konoshouhinnohasouhaitsugorininarimasuka",
+    "shinkansendetoukyoukaraoosakamadeikimasu",
+    "nihongonyuuryokunotesutowoshiteimasu",
+    "raishuunoyoteiwooshietekudasai",
+    "ekimaenokissatendemachiawasemashou",
+    "saikinhasamukunattekimashitane",
+};
+
+// Collects the per-operation statistics of a benchmark.
+class OperationStats {
+ public:
+  OperationStats() = default;
+
+  void Start() {
+    num_allocations_at_start_ =
+        g_num_allocations.load(std::memory_order_relaxed);
+    start_time_ = absl::Now();
+  }
+
+  void Stop() {
+    const absl::Duration elapsed = absl::Now() - start_time_;
+    num_allocations_ += g_num_allocations.load(std::memory_order_relaxed) -
+                        num_allocations_at_start_;
+    latencies_us_.push_back(absl::ToDoubleMicroseconds(elapsed));
+  }
+
+  // Adds the statistics to the counters of `state`.
+  void Report(benchmark::State &state) {
+    if (latencies_us_.empty()) {
+      return;
+    }
+    std::sort(latencies_us_.begin(), latencies_us_.end());
+    state.counters["p50_us"] = Percentile(50);
+    state.counters["p90_us"] = Percentile(90);
+    state.counters["p99_us"] = Percentile(99);
+    state.counters["max_us"] = latencies_us_.back();
+    state.counters["allocs_per_op"] =
+        static_cast<double>(num_allocations_) / latencies_us_.size();
+    state.counters["ops"] = benchmark::Counter(
+        static_cast<double>(latencies_us_.size()), benchmark::Counter::kIsRate);
+  }
+
+ private:
+  double Percentile(int percent) const {
+    const size_t index = (latencies_us_.size() - 1) * percent / 100;
+    return latencies_us_[index];
+  }
+
+  absl::Time start_time_;
+  int64_t num_allocations_at_start_ = 0;
+  int64_t num_allocations_ = 0;
+  std::vector<double> latencies_us_;
+};
+
+// Holds the engine and the user profile shared by all the benchmarks. The
+// engine is created once because loading the OSS data set dominates the
+// running time otherwise.
+class BenchmarkEnvironment {
+ public:
+  static BenchmarkEnvironment &Get() {
+    static BenchmarkEnvironment *environment = new BenchmarkEnvironment();
+    return *environment;
+  }
+
+  const Engine &engine() const { return *engine_; }
+  Engine *mutable_engine() { return engine_.get(); }
+  std::shared_ptr<const composer::Table> table() const { return table_; }
+  std::shared_ptr<const commands::Request> request() const { return request_; }
+  std::shared_ptr<const config::Config> config() const { return config_; }
+
+ private:
+  BenchmarkEnvironment()
+      : temp_dir_(testing::MakeTempDirectoryOrDie()),
+        request_(std::make_shared<commands::Request>()),
+        config_(std::make_shared<config::Config>(
+            config::ConfigHandler::DefaultConfig())) {
+    SystemUtil::SetUserProfileDirectory(temp_dir_.path());
+    config::ConfigHandler::SetConfig(*config_);
+    engine_ = OssEngineFactory::Create().value();
+    auto table = std::make_shared<composer::Table>();
+    CHECK(table->LoadFromFile("system://romanji-hiragana.tsv"));
+    table_ = std::move(table);
+  }
+
+  TempDirectory temp_dir_;
+  std::unique_ptr<Engine> engine_;
+  std::shared_ptr<const composer::Table> table_;
+  std::shared_ptr<const commands::Request> request_;
+  std::shared_ptr<const config::Config> config_;
+};
+
+// A pair of composer and converter as owned by a session.
+class SessionState {
+ public:
+  SessionState()
+      : composer_(BenchmarkEnvironment::Get().table(),
+                  BenchmarkEnvironment::Get().request(),
+                  BenchmarkEnvironment::Get().config()),
+        converter_(BenchmarkEnvironment::Get().engine().GetConverter(),
+                   BenchmarkEnvironment::Get().request(),
+                   BenchmarkEnvironment::Get().config()) {}
+
+  void Reset() {
+    composer_.Reset();
+    converter_.Reset();
+  }
+
+  void SetInput(absl::string_view input) {
+    Reset();
+    composer_.InsertCharacterPreedit(input);
+  }
+
+  composer::Composer &composer() { return composer_; }
+  EngineConverter &converter() { return converter_; }
+  const commands::Context &context() const { return context_; }
+
+ private:
+  composer::Composer composer_;
+  EngineConverter converter_;
+  commands::Context context_;
+};
+
+template <size_t N>
+void RunConversion(benchmark::State &state,
+                   const absl::string_view (&inputs)[N]) {
+  SessionState session;
+  OperationStats stats;
+  size_t index = 0;
+  for (auto s : state) {
+    state.PauseTiming();
+    session.SetInput(inputs[index++ % N]);
+    state.ResumeTiming();
+
+    stats.Start();
+    benchmark::DoNotOptimize(session.converter().Convert(session.composer()));
+    stats.Stop();
+  }
+  stats.Report(state);
+}
+
+void BM_ConvertSingleSegment(benchmark::State &state) {
+  RunConversion(state, kSingleSegmentInputs);
+}
+BENCHMARK(BM_ConvertSingleSegment);
+
+void BM_ConvertMultiSegment(benchmark::State &state) {
+  RunConversion(state, kMultiSegmentInputs);
+}
+BENCHMARK(BM_ConvertMultiSegment);
+
+// Types a sentence one character at a time and sends a suggestion request
+// after every keystroke, as the session does for the desktop client. One
+// operation is one keystroke.
+void BM_SuggestPerKeystroke(benchmark::State &state) {
+  SessionState session;
+  OperationStats stats;
+  size_t index = 0;
+  for (auto s : state) {
+    const absl::string_view input =
+        kMultiSegmentInputs[index++ % std::size(kMultiSegmentInputs)];
+    state.PauseTiming();
+    session.Reset();
+    state.ResumeTiming();
+
+    for (const char c : input) {
+      stats.Start();
+      session.composer().InsertCharacter(std::string(1, c));
+      benchmark::DoNotOptimize(
+          session.converter().Suggest(session.composer(), session.context()));
+      stats.Stop();
+    }
+  }
+  stats.Report(state);
+}
+BENCHMARK(BM_SuggestPerKeystroke);
+
+// Sends a prediction request (e.g. Tab key) for the prefix of a word.
+void BM_Predict(benchmark::State &state) {
+  SessionState session;
+  OperationStats stats;
+  size_t index = 0;
+  for (auto s : state) {
+    const absl::string_view input =
+        kSingleSegmentInputs[index++ % std::size(kSingleSegmentInputs)];
+    state.PauseTiming();
+    session.SetInput(input.substr(0, std::max<size_t>(2, input.size() / 2)));
+    state.ResumeTiming();
+
+    stats.Start();
+    benchmark::DoNotOptimize(session.converter().Predict(session.composer()));
+    stats.Stop();
+  }
+  stats.Report(state);
+}
+BENCHMARK(BM_Predict);
+
+// Converts a sentence and commits it. The commit updates the user history of
+// the predictor and the rewriters, so the cost of learning is included.
+void BM_CommitWithLearning(benchmark::State &state) {
+  SessionState session;
+  OperationStats stats;
+  size_t index = 0;
+  for (auto s : state) {
+    state.PauseTiming();
+    session.SetInput(
+        kMultiSegmentInputs[index++ % std::size(kMultiSegmentInputs)]);
+    CHECK(session.converter().Convert(session.composer()));
+    state.ResumeTiming();
+
+    stats.Start();
+    session.converter().Commit(session.composer(), session.context());
+    stats.Stop();
+  }
+  stats.Report(state);
+  BenchmarkEnvironment::Get().mutable_engine()->ClearUserHistory();
+  BenchmarkEnvironment::Get().mutable_engine()->ClearUserPrediction();
+}
+BENCHMARK(BM_CommitWithLearning);
+
+}  // namespace
+}  // namespace engine
+}  // namespace mozc
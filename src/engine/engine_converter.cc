@@ -32,6 +32,7 @@
 #include "engine/engine_converter.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -40,10 +41,12 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/no_destructor.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "base/latency_stats.h"
 #include "base/text_normalizer.h"
 #include "base/util.h"
 #include "base/vlog.h"
@@ -96,6 +99,19 @@ int32_t CalculateCursorOffset(absl::string_view committed_text) {
   // If committed_text is a bracket pair, set the cursor in the middle.
   return Util::IsBracketPairText(committed_text) ? -1 : 0;
 }
+
+// The empty instances shared by all the converters, which never modify them.
+const std::shared_ptr<const Segments> &GetEmptySegments() {
+  static const absl::NoDestructor<std::shared_ptr<const Segments>> kSegments(
+      std::make_shared<const Segments>());
+  return *kSegments;
+}
+
+const std::shared_ptr<const Segment> &GetEmptySegment() {
+  static const absl::NoDestructor<std::shared_ptr<const Segment>> kSegment(
+      std::make_shared<const Segment>());
+  return *kSegment;
+}
 }  // namespace
 
 EngineConverter::EngineConverter(
@@ -109,16 +125,18 @@ EngineConverter::EngineConverter(
     std::shared_ptr<const Config> config)
     : EngineConverterInterface(),
       converter_(std::move(converter)),
-      segments_(),
-      incognito_segments_(),
+      segments_(std::make_shared<Segments>()),
+      incognito_segments_(GetEmptySegments()),
       segment_index_(0),
+      previous_suggestions_(GetEmptySegment()),
       result_(),
       candidate_list_(true),
       request_(std::move(request)),
       state_(COMPOSITION),
       request_type_(ConversionRequest::CONVERSION),
       client_revision_(0),
-      candidate_list_visible_(false) {
+      candidate_list_visible_(false),
+      candidate_list_revision_(0) {
   DCHECK(request_);
   DCHECK(converter_);
   DCHECK(config);
@@ -163,7 +181,7 @@ bool EngineConverter::ConvertWithPreferences(
           .SetOptions(std::move(options))
           .Build();
 
-  if (!converter_->StartConversion(conversion_request, &segments_)) {
+  if (!converter_->StartConversion(conversion_request, mutable_segments())) {
     LOG(WARNING) << "StartConversion() failed";
     ResetState();
     return false;
@@ -271,10 +289,10 @@ bool EngineConverter::ConvertToTransliteration(
     // preedit as a single segment.  We should modify
     // converter/converter.cc to enable to accept mozc::Segment::FIXED
     // from the session layer.
-    if (segment_index_ + 1 != segments_.conversion_segments_size()) {
+    if (segment_index_ + 1 != segments().conversion_segments_size()) {
       size_t offset = 0;
       for (const Segment &segment :
-           segments_.conversion_segments().drop(segment_index_ + 1)) {
+           segments().conversion_segments().drop(segment_index_ + 1)) {
         offset += segment.key_len();
       }
       ResizeSegmentWidth(composer, offset);
@@ -350,9 +368,9 @@ bool EngineConverter::SwitchKanaType(const composer::Composer &composer) {
     // preedit as a single segment.  We should modify
     // converter/converter.cc to enable to accept mozc::Segment::FIXED
     // from the session layer.
-    if (segments_.conversion_segments_size() != 1) {
+    if (segments().conversion_segments_size() != 1) {
       std::string composition;
-      GetPreedit(0, segments_.conversion_segments_size(), &composition);
+      GetPreedit(0, segments().conversion_segments_size(), &composition);
       DCHECK(request_);
       DCHECK(config_);
       const ConversionRequest conversion_request =
@@ -362,10 +380,10 @@ bool EngineConverter::SwitchKanaType(const composer::Composer &composer) {
               .SetConfigView(*config_)
               .Build();
 
-      if (!converter_->ResizeSegment(&segments_, conversion_request, 0,
+      if (!converter_->ResizeSegment(mutable_segments(), conversion_request, 0,
                                      Util::CharsLen(composition))) {
         LOG(WARNING) << "ResizeSegment failed for segments.";
-        DLOG(WARNING) << segments_.DebugString();
+        DLOG(WARNING) << segments().DebugString();
       }
       UpdateCandidateList();
     }
@@ -417,7 +435,7 @@ bool EngineConverter::SuggestWithPreferences(
   // Initialize the conversion request and segments for suggestion.
   ConversionRequest::Options options;
   options.enable_user_history_for_conversion = preferences.use_history;
-  segments_.clear_conversion_segments();
+  mutable_segments()->clear_conversion_segments();
 
   const size_t cursor = composer.GetCursor();
 
@@ -461,13 +479,14 @@ bool EngineConverter::SuggestWithPreferences(
           .Build();
 
   // Start actual suggestion/prediction.
-  bool result = converter_->StartPrediction(conversion_request, &segments_);
+  bool result =
+      converter_->StartPrediction(conversion_request, mutable_segments());
   if (!result) {
     MOZC_VLOG(1)
         << "Start(Partial?)(Suggestion|Prediction)ForRequest() returns no "
            "suggestions.";
     // Clear segments and keep the context
-    converter_->CancelConversion(&segments_);
+    converter_->CancelConversion(mutable_segments());
     return false;
   }
 
@@ -487,9 +506,10 @@ bool EngineConverter::SuggestWithPreferences(
             .SetConfigView(*config_)
             .SetOptions(std::move(incognito_options))
             .Build();
-    incognito_segments_.Clear();
+    auto incognito_segments = std::make_shared<Segments>();
     result = converter_->StartPrediction(incognito_conversion_request,
-                                         &incognito_segments_);
+                                         incognito_segments.get());
+    incognito_segments_ = std::move(incognito_segments);
     if (!result) {
       MOZC_VLOG(1)
           << "Start(Partial?)SuggestionForRequest() for incognito request "
@@ -497,11 +517,12 @@ bool EngineConverter::SuggestWithPreferences(
       // TODO(noriyukit): Check if fall through here is ok.
     }
   }
-  DCHECK_EQ(segments_.conversion_segments_size(), 1);
+  DCHECK_EQ(segments().conversion_segments_size(), 1);
 
   // Copy current suggestions so that we can merge
   // prediction/suggestions later
-  previous_suggestions_ = segments_.conversion_segment(0);
+  previous_suggestions_ =
+      std::make_shared<const Segment>(segments().conversion_segment(0));
 
   // Overwrite the request type to SUGGESTION.
   // Without this logic, a candidate gets focused that is unexpected behavior.
@@ -549,17 +570,17 @@ bool EngineConverter::PredictWithPreferences(
           .Build();
 
   const bool predict_first =
-      !CheckState(PREDICTION) && IsEmptySegment(previous_suggestions_);
+      !CheckState(PREDICTION) && IsEmptySegment(*previous_suggestions_);
 
   const bool predict_expand =
-      (CheckState(PREDICTION) && !IsEmptySegment(previous_suggestions_) &&
+      (CheckState(PREDICTION) && !IsEmptySegment(*previous_suggestions_) &&
        candidate_list_.size() > 0 && candidate_list_.focused() &&
        candidate_list_.focused_index() == candidate_list_.last_index());
 
-  segments_.clear_conversion_segments();
+  mutable_segments()->clear_conversion_segments();
 
   if (predict_expand || predict_first) {
-    if (!converter_->StartPrediction(conversion_request, &segments_)) {
+    if (!converter_->StartPrediction(conversion_request, mutable_segments())) {
       LOG(WARNING) << "StartPrediction() failed";
       // TODO(komatsu): Perform refactoring after checking the stability test.
       //
@@ -573,7 +594,7 @@ bool EngineConverter::PredictWithPreferences(
   }
 
   // Merge suggestions and prediction
-  segments_.PrependCandidates(previous_suggestions_);
+  mutable_segments()->PrependCandidates(*previous_suggestions_);
 
   segment_index_ = 0;
   state_ = PREDICTION;
@@ -589,7 +610,7 @@ void EngineConverter::MaybeExpandPrediction(
   DCHECK(CheckState(PREDICTION | CONVERSION));
 
   // Expand the current suggestions and fill with Prediction results.
-  if (!CheckState(PREDICTION) || IsEmptySegment(previous_suggestions_) ||
+  if (!CheckState(PREDICTION) || IsEmptySegment(*previous_suggestions_) ||
       !candidate_list_.focused() ||
       candidate_list_.focused_index() != candidate_list_.last_index()) {
     return;
@@ -613,7 +634,7 @@ void EngineConverter::Cancel() {
   ResetResult();
 
   // Clear segments and keep the context
-  converter_->CancelConversion(&segments_);
+  converter_->CancelConversion(mutable_segments());
   ResetState();
 }
 
@@ -622,7 +643,7 @@ void EngineConverter::Reset() {
 
   // Even if composition mode, call ResetConversion
   // in order to clear history segments.
-  converter_->ResetConversion(&segments_);
+  converter_->ResetConversion(mutable_segments());
 
   if (CheckState(COMPOSITION)) {
     return;
@@ -638,14 +659,14 @@ void EngineConverter::Commit(const composer::Composer &composer,
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
-  if (!UpdateResult(0, segments_.conversion_segments_size(), nullptr)) {
+  if (!UpdateResult(0, segments().conversion_segments_size(), nullptr)) {
     Cancel();
     ResetState();
     return;
   }
 
-  for (size_t i = 0; i < segments_.conversion_segments_size(); ++i) {
-    if (!converter_->CommitSegmentValue(&segments_, i,
+  for (size_t i = 0; i < segments().conversion_segments_size(); ++i) {
+    if (!converter_->CommitSegmentValue(mutable_segments(), i,
                                         GetCandidateIndexForConverter(i))) {
       LOG(WARNING) << "Failed to commit segment " << i;
     }
@@ -659,7 +680,7 @@ void EngineConverter::Commit(const composer::Composer &composer,
                                                    .SetContextView(context)
                                                    .SetConfigView(*config_)
                                                    .Build();
-  converter_->FinishConversion(conversion_request, &segments_);
+  converter_->FinishConversion(conversion_request, mutable_segments());
   ResetState();
 }
 
@@ -671,7 +692,7 @@ bool EngineConverter::CommitSuggestionInternal(
   ResetResult();
   const std::string preedit = composer.GetStringForPreedit();
 
-  if (!UpdateResult(0, segments_.conversion_segments_size(),
+  if (!UpdateResult(0, segments().conversion_segments_size(),
                     consumed_key_size)) {
     // Do not need to call Cancel like Commit because the current
     // state is SUGGESTION.
@@ -687,7 +708,7 @@ bool EngineConverter::CommitSuggestionInternal(
       *consumed_key_size < composer.GetLength()) {
     // A candidate was chosen from partial suggestion.
     if (!converter_->CommitPartialSuggestionSegmentValue(
-            &segments_, 0, GetCandidateIndexForConverter(0),
+            mutable_segments(), 0, GetCandidateIndexForConverter(0),
             Util::Utf8SubString(preedit, 0, *consumed_key_size),
             Util::Utf8SubString(preedit, *consumed_key_size,
                                 preedit_length - *consumed_key_size))) {
@@ -698,10 +719,10 @@ bool EngineConverter::CommitSuggestionInternal(
     InitializeSelectedCandidateIndices();
     // One or more segments must exist because new segment is inserted
     // just after the committed segment.
-    DCHECK_GT(segments_.conversion_segments_size(), 0);
+    DCHECK_GT(segments().conversion_segments_size(), 0);
   } else {
     // Not partial suggestion so let's reset the state.
-    if (!converter_->CommitSegmentValue(&segments_, 0,
+    if (!converter_->CommitSegmentValue(mutable_segments(), 0,
                                         GetCandidateIndexForConverter(0))) {
       LOG(WARNING) << "CommitSegmentValue failed";
       return false;
@@ -714,8 +735,8 @@ bool EngineConverter::CommitSuggestionInternal(
                                                      .SetContextView(context)
                                                      .SetConfigView(*config_)
                                                      .Build();
-    converter_->FinishConversion(conversion_request, &segments_);
-    DCHECK_EQ(0, segments_.conversion_segments_size());
+    converter_->FinishConversion(conversion_request, mutable_segments());
+    DCHECK_EQ(0, segments().conversion_segments_size());
     ResetState();
   }
   return true;
@@ -767,13 +788,13 @@ void EngineConverter::CommitSegmentsInternal(const composer::Composer &composer,
                                              size_t segments_to_commit,
                                              size_t *consumed_key_size) {
   DCHECK(CheckState(PREDICTION | CONVERSION));
-  DCHECK(segments_.conversion_segments_size() >= segments_to_commit);
+  DCHECK(segments().conversion_segments_size() >= segments_to_commit);
   ResetResult();
   candidate_list_visible_ = false;
   *consumed_key_size = 0;
 
   // If commit all segments, just call Commit.
-  if (segments_.conversion_segments_size() <= segments_to_commit) {
+  if (segments().conversion_segments_size() <= segments_to_commit) {
     Commit(composer, context);
     return;
   }
@@ -790,7 +811,7 @@ void EngineConverter::CommitSegmentsInternal(const composer::Composer &composer,
   std::vector<size_t> candidate_ids;
   for (size_t i = 0; i < segments_to_commit; ++i) {
     // Get the i-th (0 origin) conversion segment and the selected candidate.
-    const Segment &segment = segments_.conversion_segment(i);
+    const Segment &segment = segments().conversion_segment(i);
 
     // Accumulate the size of i-th segment's key.
     // The caller will remove corresponding characters from the composer.
@@ -799,7 +820,7 @@ void EngineConverter::CommitSegmentsInternal(const composer::Composer &composer,
     // Collect candidate's id for each segment.
     candidate_ids.push_back(GetCandidateIndexForConverter(i));
   }
-  if (!converter_->CommitSegments(&segments_, candidate_ids)) {
+  if (!converter_->CommitSegments(mutable_segments(), candidate_ids)) {
     LOG(WARNING) << "CommitSegments failed";
   }
 
@@ -830,7 +851,7 @@ void EngineConverter::CommitPreedit(const composer::Composer &composer,
   // Cursor offset needs to be calculated based on normalized text.
   output::FillCursorOffsetResult(CalculateCursorOffset(normalized_preedit),
                                  &result_);
-  segments_.InitForCommit(key, normalized_preedit);
+  mutable_segments()->InitForCommit(key, normalized_preedit);
   CommitSegmentsSize(EngineConverterInterface::COMPOSITION, context);
   DCHECK(request_);
   DCHECK(config_);
@@ -847,7 +868,7 @@ void EngineConverter::CommitPreedit(const composer::Composer &composer,
           .SetConfigView(*config_)
           .SetOptions(std::move(options))
           .Build();
-  converter_->FinishConversion(conversion_request, &segments_);
+  converter_->FinishConversion(conversion_request, mutable_segments());
   ResetState();
 }
 
@@ -866,7 +887,9 @@ void EngineConverter::CommitHead(size_t count,
   output::FillCursorOffsetResult(CalculateCursorOffset(composition), &result_);
 }
 
-void EngineConverter::Revert() { converter_->RevertConversion(&segments_); }
+void EngineConverter::Revert() {
+  converter_->RevertConversion(mutable_segments());
+}
 
 bool EngineConverter::DeleteCandidateFromHistory(std::optional<int> id) {
   if (id == std::nullopt) {
@@ -876,17 +899,17 @@ bool EngineConverter::DeleteCandidateFromHistory(std::optional<int> id) {
     const Candidate &cand = candidate_list_.focused_candidate();
     id = cand.id();
   } else {
-    if (segment_index_ >= segments_.conversion_segments_size()) {
+    if (segment_index_ >= segments().conversion_segments_size()) {
       return false;
     }
-    const Segment &segment = segments_.conversion_segment(segment_index_);
+    const Segment &segment = segments().conversion_segment(segment_index_);
     if (!segment.is_valid_index(*id)) {
       return false;
     }
   }
   DCHECK(id.has_value());
   return converter_->DeleteCandidateFromHistory(
-      segments_, segments_.history_segments_size() + segment_index_, *id);
+      segments(), segments().history_segments_size() + segment_index_, *id);
 }
 
 void EngineConverter::SegmentFocusInternal(size_t index) {
@@ -907,7 +930,7 @@ void EngineConverter::SegmentFocusInternal(size_t index) {
 }
 
 void EngineConverter::SegmentFocusRight() {
-  if (segment_index_ + 1 >= segments_.conversion_segments_size()) {
+  if (segment_index_ + 1 >= segments().conversion_segments_size()) {
     // If |segment_index_| is at the tail of the segments,
     // focus on the head.
     SegmentFocusLeftEdge();
@@ -917,7 +940,7 @@ void EngineConverter::SegmentFocusRight() {
 }
 
 void EngineConverter::SegmentFocusLast() {
-  const size_t r_edge = segments_.conversion_segments_size() - 1;
+  const size_t r_edge = segments().conversion_segments_size() - 1;
   SegmentFocusInternal(r_edge);
 }
 
@@ -949,15 +972,15 @@ void EngineConverter::ResizeSegmentWidth(const composer::Composer &composer,
                                                    .SetRequestView(*request_)
                                                    .SetConfigView(*config_)
                                                    .Build();
-  if (!converter_->ResizeSegment(&segments_, conversion_request, segment_index_,
-                                 delta)) {
+  if (!converter_->ResizeSegment(mutable_segments(), conversion_request,
+                                 segment_index_, delta)) {
     return;
   }
 
   UpdateCandidateList();
   // Clears selected index of a focused segment and trailing segments.
   // TODO(hsumita): Keep the indices if the segment type is FIXED_VALUE.
-  selected_candidate_indices_.resize(segments_.conversion_segments_size());
+  selected_candidate_indices_.resize(segments().conversion_segments_size());
   std::fill(selected_candidate_indices_.begin() + segment_index_ + 1,
             selected_candidate_indices_.end(), 0);
   UpdateSelectedCandidateIndex();
@@ -1126,6 +1149,7 @@ void EngineConverter::FillOutput(const composer::Composer &composer,
     LOG(ERROR) << "output is nullptr.";
     return;
   }
+  ScopedLatencyTimer timer("engine/fill_output");
   if (result_.has_value()) {
     FillResult(output->mutable_result());
   }
@@ -1169,7 +1193,7 @@ void EngineConverter::FillOutput(const composer::Composer &composer,
   // For debug. Removed candidate words through the conversion process.
   if (CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
     output::FillRemovedCandidates(
-        segments_.conversion_segment(segment_index_),
+        segments().conversion_segment(segment_index_),
         output->mutable_removed_candidate_words_for_debug());
   }
 }
@@ -1177,16 +1201,21 @@ void EngineConverter::FillOutput(const composer::Composer &composer,
 EngineConverter *EngineConverter::Clone() const {
   EngineConverter *engine_converter =
       new EngineConverter(converter_, request_, config_);
+  // The candidate list is copied as is, and the segments are shared until
+  // either of the converters modifies them.
   *engine_converter = *this;
+  return engine_converter;
+}
 
-  if (engine_converter->CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
-    // UpdateCandidateList() is not simple setter and it uses some members.
-    engine_converter->UpdateCandidateList();
-    engine_converter->candidate_list_.MoveToId(candidate_list_.focused_id());
-    engine_converter->SetCandidateListVisible(candidate_list_visible_);
+Segments *EngineConverter::mutable_segments() {
+  if (segments_.use_count() > 1) {
+    // Shares the candidates as well so that only the candidates to be
+    // modified are copied, e.g. by committing them.
+    auto segments = std::make_shared<Segments>();
+    segments->CopyWithSharedCandidates(*segments_);
+    segments_ = std::move(segments);
   }
-
-  return engine_converter;
+  return segments_.get();
 }
 
 void EngineConverter::ResetResult() { result_.Clear(); }
@@ -1194,17 +1223,18 @@ void EngineConverter::ResetResult() { result_.Clear(); }
 void EngineConverter::ResetState() {
   state_ = COMPOSITION;
   segment_index_ = 0;
-  previous_suggestions_.clear();
+  previous_suggestions_ = GetEmptySegment();
   candidate_list_visible_ = false;
   candidate_list_.Clear();
+  UpdateCandidateListRevision();
   selected_candidate_indices_.clear();
-  incognito_segments_.Clear();
+  incognito_segments_ = GetEmptySegments();
 }
 
 void EngineConverter::SegmentFocus() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
   if (!converter_->FocusSegmentValue(
-          &segments_, segment_index_,
+          mutable_segments(), segment_index_,
           GetCandidateIndexForConverter(segment_index_))) {
     LOG(ERROR) << "FocusSegmentValue failed";
   }
@@ -1213,7 +1243,7 @@ void EngineConverter::SegmentFocus() {
 void EngineConverter::SegmentFix() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
   if (!converter_->CommitSegmentValue(
-          &segments_, segment_index_,
+          mutable_segments(), segment_index_,
           GetCandidateIndexForConverter(segment_index_))) {
     LOG(WARNING) << "CommitSegmentValue failed";
   }
@@ -1222,14 +1252,14 @@ void EngineConverter::SegmentFix() {
 void EngineConverter::GetPreedit(const size_t index, const size_t size,
                                  std::string *preedit) const {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  DCHECK(index + size <= segments_.conversion_segments_size());
+  DCHECK(index + size <= segments().conversion_segments_size());
   DCHECK(preedit);
 
   preedit->clear();
   for (size_t i = index; i < size; ++i) {
     if (CheckState(CONVERSION)) {
       // In conversion mode, all the key of candidates is same.
-      preedit->append(segments_.conversion_segment(i).key());
+      preedit->append(segments().conversion_segment(i).key());
     } else {
       DCHECK(CheckState(SUGGESTION | PREDICTION));
       // In suggestion or prediction modes, each key may have
@@ -1244,7 +1274,7 @@ void EngineConverter::GetPreedit(const size_t index, const size_t size,
 void EngineConverter::GetConversion(const size_t index, const size_t size,
                                     std::string *conversion) const {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  DCHECK(index + size <= segments_.conversion_segments_size());
+  DCHECK(index + size <= segments().conversion_segments_size());
   DCHECK(conversion);
 
   conversion->clear();
@@ -1256,7 +1286,7 @@ void EngineConverter::GetConversion(const size_t index, const size_t size,
 void EngineConverter::UpdateResultTokens(const size_t index,
                                          const size_t size) {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  DCHECK(index + size <= segments_.conversion_segments_size());
+  DCHECK(index + size <= segments().conversion_segments_size());
 
   auto add_tokens = [this](absl::string_view content_key,
                            absl::string_view content_value,
@@ -1275,7 +1305,7 @@ void EngineConverter::UpdateResultTokens(const size_t index,
   for (size_t i = index; i < size; ++i) {
     const int cand_idx = GetCandidateIndexForConverter(i);
     const Segment::Candidate &candidate =
-        segments_.conversion_segment(i).candidate(cand_idx);
+        segments().conversion_segment(i).candidate(cand_idx);
     const int first_token_idx = result_.tokens_size();
 
     if (Segment::Candidate::InnerSegmentIterator it(&candidate); !it.Done()) {
@@ -1300,11 +1330,11 @@ void EngineConverter::UpdateResultTokens(const size_t index,
 size_t EngineConverter::GetConsumedPreeditSize(const size_t index,
                                                const size_t size) const {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  DCHECK(index + size <= segments_.conversion_segments_size());
+  DCHECK(index + size <= segments().conversion_segments_size());
 
   if (CheckState(SUGGESTION | PREDICTION)) {
     DCHECK_EQ(1, size);
-    const Segment &segment = segments_.conversion_segment(0);
+    const Segment &segment = segments().conversion_segment(0);
     const int id = GetCandidateIndexForConverter(0);
     const Segment::Candidate &candidate = segment.candidate(id);
     return (candidate.attributes & Segment::Candidate::PARTIALLY_KEY_CONSUMED)
@@ -1317,10 +1347,10 @@ size_t EngineConverter::GetConsumedPreeditSize(const size_t index,
   for (size_t i = index; i < size; ++i) {
     const int id = GetCandidateIndexForConverter(i);
     const Segment::Candidate &candidate =
-        segments_.conversion_segment(i).candidate(id);
+        segments().conversion_segment(i).candidate(id);
     DCHECK(
         !(candidate.attributes & Segment::Candidate::PARTIALLY_KEY_CONSUMED));
-    result += segments_.conversion_segment(i).key_len();
+    result += segments().conversion_segment(i).key_len();
   }
   return result;
 }
@@ -1332,7 +1362,7 @@ bool EngineConverter::MaybePerformCommandCandidate(const size_t index,
   for (size_t i = index; i < size; ++i) {
     const int id = GetCandidateIndexForConverter(i);
     const Segment::Candidate &candidate =
-        segments_.conversion_segment(i).candidate(id);
+        segments().conversion_segment(i).candidate(id);
     if (candidate.attributes & Segment::Candidate::COMMAND_CANDIDATE) {
       switch (candidate.command) {
         case Segment::Candidate::DEFAULT_COMMAND:
@@ -1396,9 +1426,10 @@ void EngineConverter::AppendCandidateList() {
   // some lists), the most appropriate location to be added new meta candidates
   // cannot be decided).
   const bool add_meta_candidates = (candidate_list_.size() == 0);
+  UpdateCandidateListRevision();
 
-  DCHECK_LT(segment_index_, segments_.conversion_segments_size());
-  const Segment &segment = segments_.conversion_segment(segment_index_);
+  DCHECK_LT(segment_index_, segments().conversion_segments_size());
+  const Segment &segment = segments().conversion_segment(segment_index_);
 
   auto get_candidate_dedup_key =
       [](const Segment::Candidate &c) -> const std::string & {
@@ -1467,6 +1498,14 @@ void EngineConverter::UpdateCandidateList() {
   AppendCandidateList();
 }
 
+void EngineConverter::UpdateCandidateListRevision() {
+  // Shared by all the converters so that a cloned converter never reuses the
+  // revision of different candidates.
+  static std::atomic<uint64_t> next_revision = 1;
+  candidate_list_revision_ =
+      next_revision.fetch_add(1, std::memory_order_relaxed);
+}
+
 int EngineConverter::GetCandidateIndexForConverter(
     const size_t segment_index) const {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
@@ -1483,7 +1522,7 @@ std::string EngineConverter::GetSelectedCandidateValue(
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
   const int id = GetCandidateIndexForConverter(segment_index);
   const Segment::Candidate &candidate =
-      segments_.conversion_segment(segment_index).candidate(id);
+      segments().conversion_segment(segment_index).candidate(id);
   if (candidate.attributes & Segment::Candidate::COMMAND_CANDIDATE) {
     // Return an empty string, however this path should not be reached.
     return "";
@@ -1495,12 +1534,12 @@ const Segment::Candidate &EngineConverter::GetSelectedCandidate(
     const size_t segment_index) const {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
   const int id = GetCandidateIndexForConverter(segment_index);
-  return segments_.conversion_segment(segment_index).candidate(id);
+  return segments().conversion_segment(segment_index).candidate(id);
 }
 
 void EngineConverter::FillConversion(commands::Preedit *preedit) const {
   DCHECK(CheckState(PREDICTION | CONVERSION));
-  output::FillConversion(segments_, segment_index_,
+  output::FillConversion(segments(), segment_index_,
                          candidate_list_.focused_id(), preedit);
 }
 
@@ -1525,15 +1564,16 @@ void EngineConverter::FillCandidateWindow(
   // Temporarily added to see if this condition is really satisfied in the
   // real world or not.
 #ifdef CHANNEL_DEV
-  CHECK_LT(0, segments_.conversion_segments_size());
+  CHECK_LT(0, segments().conversion_segments_size());
 #endif  // CHANNEL_DEV
-  if (segment_index_ >= segments_.conversion_segments_size()) {
+  if (segment_index_ >= segments().conversion_segments_size()) {
     LOG(WARNING) << "Invalid segment_index_: " << segment_index_
-                 << ", segments_size: " << segments_.conversion_segments_size();
+                 << ", segments_size: "
+                 << segments().conversion_segments_size();
     return;
   }
 
-  const Segment &segment = segments_.conversion_segment(segment_index_);
+  const Segment &segment = segments().conversion_segment(segment_index_);
   output::FillCandidateWindow(segment, candidate_list_, position,
                               candidate_window);
 
@@ -1620,19 +1660,20 @@ void EngineConverter::FillAllCandidateWords(
       break;
   }
 
-  if (segment_index_ >= segments_.conversion_segments_size()) {
+  if (segment_index_ >= segments().conversion_segments_size()) {
     LOG(WARNING) << "Invalid segment_index_: " << segment_index_
-                 << ", segments_size: " << segments_.conversion_segments_size();
+                 << ", segments_size: "
+                 << segments().conversion_segments_size();
     return;
   }
-  const Segment &segment = segments_.conversion_segment(segment_index_);
+  const Segment &segment = segments().conversion_segment(segment_index_);
   output::FillAllCandidateWords(segment, candidate_list_, category, candidates);
 }
 
 void EngineConverter::FillIncognitoCandidateWords(
     commands::CandidateList *candidates) const {
   const Segment &segment =
-      incognito_segments_.conversion_segment(segment_index_);
+      incognito_segments_->conversion_segment(segment_index_);
   for (size_t i = 0; i < segment.candidates_size(); ++i) {
     commands::CandidateWord *candidate_word_proto =
         candidates->add_candidates();
@@ -1650,6 +1691,7 @@ void EngineConverter::SetRequest(
   DCHECK(request);
   request_ = std::move(request);
   candidate_list_.set_page_size(request_->candidate_page_size());
+  UpdateCandidateListRevision();
 }
 
 void EngineConverter::SetConfig(std::shared_ptr<const config::Config> config) {
@@ -1658,6 +1700,7 @@ void EngineConverter::SetConfig(std::shared_ptr<const config::Config> config) {
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   selection_shortcut_ = config_->selection_shortcut();
   use_cascading_window_ = config_->use_cascading_window();
+  UpdateCandidateListRevision();
 }
 
 void EngineConverter::OnStartComposition(const commands::Context &context) {
@@ -1669,7 +1712,7 @@ void EngineConverter::OnStartComposition(const commands::Context &context) {
   if (!context.has_preceding_text()) {
     // In this case, reset history segments when the revision is mismatched.
     if (revision_changed) {
-      converter_->ResetConversion(&segments_);
+      converter_->ResetConversion(mutable_segments());
     }
     return;
   }
@@ -1678,14 +1721,14 @@ void EngineConverter::OnStartComposition(const commands::Context &context) {
   // If preceding text is empty, it is OK to reset the history segments by
   // calling ResetConversion.
   if (preceding_text.empty()) {
-    converter_->ResetConversion(&segments_);
+    converter_->ResetConversion(mutable_segments());
     return;
   }
 
   // Hereafter, we keep the existing history segments as long as it is
   // consistent with the preceding text even when revision_changed is true.
   std::string history_text;
-  for (const Segment &segment : segments_) {
+  for (const Segment &segment : segments()) {
     if (segment.segment_type() != Segment::HISTORY) {
       break;
     }
@@ -1715,10 +1758,10 @@ void EngineConverter::OnStartComposition(const commands::Context &context) {
 
   // Here we reconstruct history segments from |preceding_text| regardless
   // of revision mismatch. If it fails the history segments is cleared anyway.
-  if (!converter_->ReconstructHistory(&segments_, preceding_text)) {
+  if (!converter_->ReconstructHistory(mutable_segments(), preceding_text)) {
     LOG(WARNING) << "ReconstructHistory failed.";
     DLOG(WARNING) << "preceding_text: " << preceding_text
-                  << ", segments: " << segments_.DebugString();
+                  << ", segments: " << segments().DebugString();
   }
 }
 
@@ -1738,7 +1781,7 @@ void EngineConverter::UpdateSelectedCandidateIndex() {
 
 void EngineConverter::InitializeSelectedCandidateIndices() {
   selected_candidate_indices_.clear();
-  selected_candidate_indices_.resize(segments_.conversion_segments_size());
+  selected_candidate_indices_.resize(segments().conversion_segments_size());
 }
 
 void EngineConverter::UpdateCandidateStats(absl::string_view base_name,
@@ -1771,7 +1814,7 @@ void EngineConverter::CommitSegmentsSize(
       commit_segment_size = 1;
       break;
     case CONVERSION:
-      commit_segment_size = segments_.conversion_segments_size();
+      commit_segment_size = segments().conversion_segments_size();
       break;
     default:
       LOG(DFATAL) << "Unexpected state: " << commit_state;
@@ -1791,6 +1834,7 @@ void EngineConverter::SetRequestType(
     ConversionRequest::Options &options) {
   request_type_ = request_type;
   options.request_type = request_type;
+  UpdateCandidateListRevision();
 }
 
 }  // namespace engine
@@ -35,6 +35,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -249,10 +250,16 @@ class EngineConverter : public EngineConverterInterface {
   void set_selection_shortcut(
       config::Config::SelectionShortcut selection_shortcut) override {
     selection_shortcut_ = selection_shortcut;
+    UpdateCandidateListRevision();
   }
 
   void set_use_cascading_window(bool use_cascading_window) override {
     use_cascading_window_ = use_cascading_window;
+    UpdateCandidateListRevision();
+  }
+
+  uint64_t candidate_list_revision() const override {
+    return candidate_list_revision_;
   }
 
   // Meaning that all the composition characters are consumed.
@@ -314,6 +321,11 @@ class EngineConverter : public EngineConverterInterface {
   // candidates.
   void UpdateCandidateList();
 
+  // Assigns a new revision to the candidates. Called whenever the output of
+  // FillCandidateWindow() or FillAllCandidateWords() may change for other
+  // reasons than the focus.
+  void UpdateCandidateListRevision();
+
   // Returns the candidate index to be used by the converter.
   int GetCandidateIndexForConverter(size_t segment_index) const;
 
@@ -346,6 +358,12 @@ class EngineConverter : public EngineConverterInterface {
 
   bool IsEmptySegment(const Segment &segment) const;
 
+  // Returns the segments, which are shared with the clones of this converter
+  // until either of them modifies them. mutable_segments() copies them if
+  // they are shared.
+  const Segments &segments() const { return *segments_; }
+  Segments *mutable_segments();
+
   // Handles selected_indices for usage stats.
   void InitializeSelectedCandidateIndices();
   void UpdateSelectedCandidateIndex();
@@ -361,17 +379,19 @@ class EngineConverter : public EngineConverterInterface {
   std::shared_ptr<const ConverterInterface> converter_;
 
   // Conversion stats used by converter_.
-  Segments segments_;
+  std::shared_ptr<Segments> segments_;
 
   // Segments for Text Conversion API to fill incognito_candidate_words
   // Note:
   // Text Conversion API is available in Android Gboard.
   // It provides the converted candidates from the composition texts.
-  Segments incognito_segments_;
+  // Immutable once filled so that the clones can share it.
+  std::shared_ptr<const Segments> incognito_segments_;
   size_t segment_index_;
 
   // Previous suggestions to be merged with the current predictions.
-  Segment previous_suggestions_;
+  // Immutable once filled so that the clones can share it.
+  std::shared_ptr<const Segment> previous_suggestions_;
 
   // A part of Output protobuf to be returned to the client side.
   commands::Result result_;
@@ -407,6 +427,9 @@ class EngineConverter : public EngineConverterInterface {
 
   bool candidate_list_visible_;
 
+  // See candidate_list_revision().
+  uint64_t candidate_list_revision_;
+
   // Mutable values of |config_|.  These values may be changed temporarily per
   // session.
   bool use_cascading_window_;
@@ -33,6 +33,7 @@
 #define MOZC_ENGINE_SESSION_CONVERTER_INTERFACE_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -237,6 +238,12 @@ class EngineConverterInterface {
       config::Config::SelectionShortcut selection_shortcut) = 0;
 
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
+
+  // Returns the revision of the candidates filled by FillOutput(). The
+  // revision changes whenever the candidates may change, except for the
+  // focus and the page. It is unique among all the converters, so equal
+  // revisions mean the same candidates.
+  virtual uint64_t candidate_list_revision() const = 0;
 };
 
 }  // namespace engine
@@ -122,16 +122,16 @@ class EngineConverterTest : public testing::TestWithTempUserProfile {
 
   static void GetSegments(const EngineConverter &converter, Segments *dest) {
     CHECK(dest);
-    *dest = converter.segments_;
+    *dest = converter.segments();
   }
 
   static const Segments &GetSegments(const EngineConverter &converter) {
-    return converter.segments_;
+    return converter.segments();
   }
 
   static void SetSegments(const Segments &src, EngineConverter *converter) {
     CHECK(converter);
-    converter->segments_ = src;
+    *converter->mutable_segments() = src;
   }
 
   static const commands::Result &GetResult(const EngineConverter &converter) {
@@ -471,6 +471,36 @@ TEST_F(EngineConverterTest, Convert) {
   EXPECT_FALSE(IsCandidateListVisible(converter));
 }
 
+TEST_F(EngineConverterTest, CandidateListRevision) {
+  auto mock_converter = std::make_shared<MockConverter>();
+  EngineConverter converter(mock_converter, request_, config_);
+  {
+    Segments segments;
+    SetAiueo(&segments);
+    composer_->InsertCharacterPreedit("あいうえお");
+    FillT13Ns(&segments, composer_.get());
+    EXPECT_CALL(*mock_converter, StartConversion(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  }
+
+  const uint64_t initial_revision = converter.candidate_list_revision();
+  EXPECT_TRUE(converter.Convert(*composer_));
+  const uint64_t revision = converter.candidate_list_revision();
+  EXPECT_NE(revision, initial_revision);
+
+  // Moving the focus keeps the candidates.
+  converter.CandidateNext(*composer_);
+  EXPECT_EQ(converter.candidate_list_revision(), revision);
+
+  // The clone copies the candidates as they are.
+  std::unique_ptr<EngineConverter> cloned(converter.Clone());
+  EXPECT_EQ(cloned->candidate_list_revision(), revision);
+  EXPECT_EQ(converter.candidate_list_revision(), revision);
+
+  converter.Cancel();
+  EXPECT_NE(converter.candidate_list_revision(), revision);
+}
+
 TEST_F(EngineConverterTest, ConvertWithSpellingCorrection) {
   auto mock_converter = std::make_shared<MockConverter>();
   EngineConverter converter(mock_converter, request_, config_);
@@ -2715,6 +2745,14 @@ TEST_F(EngineConverterTest, Clone) {
     dest.reset(src.Clone());
     ASSERT_TRUE(dest.get() != nullptr);
     ExpectSameEngineConverter(src, *dest);
+
+    // The clone shares the segments until either of them modifies them.
+    EXPECT_EQ(&GetSegments(*dest), &GetSegments(src));
+    dest->Cancel();
+    EXPECT_NE(&GetSegments(*dest), &GetSegments(src));
+    EXPECT_FALSE(dest->IsActive());
+    EXPECT_TRUE(src.IsActive());
+    EXPECT_EQ(GetSegments(src).conversion_segments_size(), 2);
   }
 }
 
@@ -35,6 +35,7 @@
 
 #include "absl/log/check.h"
 #include "absl/strings/string_view.h"
+#include "converter/converter_interface.h"
 #include "data_manager/data_manager.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "engine/modules.h"
@@ -154,6 +155,25 @@ TEST_F(EngineTest, DataUpdateSuccessfulScenarioTest) {
   EXPECT_EQ(engine_->GetDataVersion(), oss_version_);
 }
 
+// Tests that the converter taken before a reload outlives the reload.
+TEST_F(EngineTest, ReloadKeepsOldConverterAlive) {
+  EngineReloadResponse response;
+  EXPECT_TRUE(engine_->SendEngineReloadRequest(mock_request_));
+  EXPECT_TRUE(engine_->MaybeReloadEngine(&response));
+  std::shared_ptr<const ConverterInterface> old_converter =
+      engine_->GetConverter();
+
+  EXPECT_TRUE(engine_->SendEngineReloadRequest(oss_request_));
+  EXPECT_TRUE(engine_->MaybeReloadEngine(&response));
+  EXPECT_TRUE(engine_->Wait());
+  EXPECT_EQ(engine_->GetDataVersion(), oss_version_);
+
+  // The new requests pick up the new converter, and the old one is released
+  // by the last holder.
+  EXPECT_NE(engine_->GetConverter(), old_converter);
+  EXPECT_EQ(old_converter.use_count(), 1);
+}
+
 // Tests the interaction with DataLoader in the situation where
 // requested data is broken.
 TEST_F(EngineTest, ReloadInvalidDataTest) {
@@ -93,6 +93,20 @@
         'engine.gyp:engine_converter',
       ],
     },
+    {
+      'target_name': 'synchronized_converter_test',
+      'type': 'executable',
+      'sources': [
+        'synchronized_converter_test.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        'engine.gyp:engine',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'engine_converter_stress_test',
       'type': 'executable',
@@ -120,6 +134,7 @@
         'engine_converter_test',
         'engine_internal_test',
         'data_loader_test',
+        'synchronized_converter_test',
       ],
     },
   ],
@@ -0,0 +1,152 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/synchronized_converter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/log/check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+
+SynchronizedConverter::SynchronizedConverter(
+    std::shared_ptr<const ConverterInterface> converter)
+    : converter_(std::move(converter)) {
+  DCHECK(converter_);
+}
+
+bool SynchronizedConverter::StartConversion(const ConversionRequest &request,
+                                            Segments *segments) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->StartConversion(request, segments);
+}
+
+bool SynchronizedConverter::StartReverseConversion(
+    Segments *segments, const absl::string_view key) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->StartReverseConversion(segments, key);
+}
+
+bool SynchronizedConverter::StartPrediction(const ConversionRequest &request,
+                                            Segments *segments) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->StartPrediction(request, segments);
+}
+
+void SynchronizedConverter::FinishConversion(const ConversionRequest &request,
+                                             Segments *segments) const {
+  absl::WriterMutexLock lock(&mutex_);
+  converter_->FinishConversion(request, segments);
+}
+
+void SynchronizedConverter::CancelConversion(Segments *segments) const {
+  converter_->CancelConversion(segments);
+}
+
+void SynchronizedConverter::ResetConversion(Segments *segments) const {
+  converter_->ResetConversion(segments);
+}
+
+void SynchronizedConverter::RevertConversion(Segments *segments) const {
+  absl::WriterMutexLock lock(&mutex_);
+  converter_->RevertConversion(segments);
+}
+
+bool SynchronizedConverter::DeleteCandidateFromHistory(
+    const Segments &segments, size_t segment_index,
+    int candidate_index) const {
+  absl::WriterMutexLock lock(&mutex_);
+  return converter_->DeleteCandidateFromHistory(segments, segment_index,
+                                                candidate_index);
+}
+
+bool SynchronizedConverter::ReconstructHistory(
+    Segments *segments, const absl::string_view preceding_text) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->ReconstructHistory(segments, preceding_text);
+}
+
+bool SynchronizedConverter::CommitSegmentValue(Segments *segments,
+                                               size_t segment_index,
+                                               int candidate_index) const {
+  return converter_->CommitSegmentValue(segments, segment_index,
+                                        candidate_index);
+}
+
+bool SynchronizedConverter::CommitPartialSuggestionSegmentValue(
+    Segments *segments, size_t segment_index, int candidate_index,
+    const absl::string_view current_segment_key,
+    const absl::string_view new_segment_key) const {
+  return converter_->CommitPartialSuggestionSegmentValue(
+      segments, segment_index, candidate_index, current_segment_key,
+      new_segment_key);
+}
+
+bool SynchronizedConverter::FocusSegmentValue(Segments *segments,
+                                              size_t segment_index,
+                                              int candidate_index) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->FocusSegmentValue(segments, segment_index,
+                                       candidate_index);
+}
+
+bool SynchronizedConverter::CommitSegments(
+    Segments *segments, absl::Span<const size_t> candidate_index) const {
+  return converter_->CommitSegments(segments, candidate_index);
+}
+
+bool SynchronizedConverter::ResizeSegment(Segments *segments,
+                                          const ConversionRequest &request,
+                                          size_t segment_index,
+                                          int offset_length) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->ResizeSegment(segments, request, segment_index,
+                                   offset_length);
+}
+
+bool SynchronizedConverter::ResizeSegments(
+    Segments *segments, const ConversionRequest &request,
+    size_t start_segment_index,
+    absl::Span<const uint8_t> new_size_array) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return converter_->ResizeSegments(segments, request, start_segment_index,
+                                    new_size_array);
+}
+
+}  // namespace mozc
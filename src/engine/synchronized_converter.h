@@ -0,0 +1,128 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_ENGINE_SYNCHRONIZED_CONVERTER_H_
+#define MOZC_ENGINE_SYNCHRONIZED_CONVERTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+
+// A converter shared by the sessions that run on different threads.
+//
+// The per-session state of conversion, i.e., the lattice with its node
+// allocator and the candidates, lives in Segments. What is shared among the
+// sessions is the read-only data in engine::Modules and the learned data in
+// the rewriters and the predictors. Conversion and prediction only read the
+// learned data, so they run concurrently. FinishConversion(),
+// RevertConversion() and DeleteCandidateFromHistory() update it, so they wait
+// for the running conversions and exclude the others. The methods that touch
+// only `segments` are not locked.
+//
+// The predictors call the underlying converter directly, so the lock is never
+// acquired recursively.
+class SynchronizedConverter final : public ConverterInterface {
+ public:
+  explicit SynchronizedConverter(
+      std::shared_ptr<const ConverterInterface> converter);
+
+  [[nodiscard]]
+  bool StartConversion(const ConversionRequest &request,
+                       Segments *segments) const override;
+  [[nodiscard]]
+  bool StartReverseConversion(Segments *segments,
+                              absl::string_view key) const override;
+  [[nodiscard]]
+  bool StartPrediction(const ConversionRequest &request,
+                       Segments *segments) const override;
+
+  void FinishConversion(const ConversionRequest &request,
+                        Segments *segments) const override;
+  void CancelConversion(Segments *segments) const override;
+  void ResetConversion(Segments *segments) const override;
+  void RevertConversion(Segments *segments) const override;
+
+  [[nodiscard]]
+  bool DeleteCandidateFromHistory(const Segments &segments,
+                                  size_t segment_index,
+                                  int candidate_index) const override;
+
+  [[nodiscard]]
+  bool ReconstructHistory(Segments *segments,
+                          absl::string_view preceding_text) const override;
+
+  [[nodiscard]]
+  bool CommitSegmentValue(Segments *segments, size_t segment_index,
+                          int candidate_index) const override;
+  [[nodiscard]]
+  bool CommitPartialSuggestionSegmentValue(
+      Segments *segments, size_t segment_index, int candidate_index,
+      absl::string_view current_segment_key,
+      absl::string_view new_segment_key) const override;
+  [[nodiscard]]
+  bool FocusSegmentValue(Segments *segments, size_t segment_index,
+                         int candidate_index) const override;
+  [[nodiscard]]
+  bool CommitSegments(Segments *segments,
+                      absl::Span<const size_t> candidate_index) const override;
+  [[nodiscard]] bool ResizeSegment(Segments *segments,
+                                   const ConversionRequest &request,
+                                   size_t segment_index,
+                                   int offset_length) const override;
+  [[nodiscard]] bool ResizeSegments(
+      Segments *segments, const ConversionRequest &request,
+      size_t start_segment_index,
+      absl::Span<const uint8_t> new_size_array) const override;
+
+  // Runs `func` exclusively with the conversions. Use this to update the
+  // learned data outside of the converter, e.g., to clear or reload it.
+  template <typename Func>
+  decltype(auto) RunExclusively(Func &&func) const {
+    absl::WriterMutexLock lock(&mutex_);
+    return func();
+  }
+
+ private:
+  const std::shared_ptr<const ConverterInterface> converter_;
+  mutable absl::Mutex mutex_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_SYNCHRONIZED_CONVERTER_H_
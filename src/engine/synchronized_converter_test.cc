@@ -0,0 +1,132 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/synchronized_converter.h"
+
+#include <memory>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "base/thread.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::_;
+using ::testing::Return;
+
+TEST(SynchronizedConverterTest, Forward) {
+  auto mock = std::make_shared<MockConverter>();
+  const SynchronizedConverter converter(mock);
+
+  const ConversionRequest request;
+  Segments segments;
+  EXPECT_CALL(*mock, StartConversion(_, &segments)).WillOnce(Return(true));
+  EXPECT_CALL(*mock, FinishConversion(_, &segments));
+  EXPECT_CALL(*mock, CommitSegmentValue(&segments, 1, 2))
+      .WillOnce(Return(false));
+
+  EXPECT_TRUE(converter.StartConversion(request, &segments));
+  EXPECT_FALSE(converter.CommitSegmentValue(&segments, 1, 2));
+  converter.FinishConversion(request, &segments);
+}
+
+TEST(SynchronizedConverterTest, ConversionsRunConcurrently) {
+  auto mock = std::make_shared<MockConverter>();
+  const SynchronizedConverter converter(mock);
+
+  // Both of the predictions wait for each other, which deadlocks if they are
+  // serialized.
+  absl::BlockingCounter both_started(2);
+  EXPECT_CALL(*mock, StartPrediction(_, _))
+      .Times(2)
+      .WillRepeatedly([&both_started] {
+        both_started.DecrementCount();
+        both_started.Wait();
+        return true;
+      });
+
+  Thread thread([&converter] {
+    const ConversionRequest request;
+    Segments segments;
+    EXPECT_TRUE(converter.StartPrediction(request, &segments));
+  });
+  const ConversionRequest request;
+  Segments segments;
+  EXPECT_TRUE(converter.StartPrediction(request, &segments));
+  thread.Join();
+}
+
+TEST(SynchronizedConverterTest, LearningExcludesConversions) {
+  auto mock = std::make_shared<MockConverter>();
+  const SynchronizedConverter converter(mock);
+
+  absl::Notification prediction_started;
+  absl::Notification finish_prediction;
+  absl::Notification finished;
+  EXPECT_CALL(*mock, StartPrediction(_, _))
+      .WillOnce([&prediction_started, &finish_prediction] {
+        prediction_started.Notify();
+        finish_prediction.WaitForNotification();
+        return true;
+      });
+  EXPECT_CALL(*mock, FinishConversion(_, _)).WillOnce([&finished] {
+    finished.Notify();
+  });
+
+  Thread prediction([&converter] {
+    const ConversionRequest request;
+    Segments segments;
+    EXPECT_TRUE(converter.StartPrediction(request, &segments));
+  });
+  prediction_started.WaitForNotification();
+
+  Thread learning([&converter] {
+    const ConversionRequest request;
+    Segments segments;
+    converter.FinishConversion(request, &segments);
+  });
+  // FinishConversion() waits for the running prediction.
+  EXPECT_FALSE(finished.WaitForNotificationWithTimeout(absl::Milliseconds(50)));
+  finish_prediction.Notify();
+  finished.WaitForNotification();
+
+  prediction.Join();
+  learning.Join();
+}
+
+}  // namespace
+}  // namespace mozc
@@ -88,6 +88,35 @@ class IPCClientInterface {
 
   // return last error
   virtual IPCErrorType GetLastIPCError() const = 0;
+
+  // Switches the connection to the persistent mode, in which the connection
+  // stays open after Call() so that it can be reused for the following calls.
+  // Returns false if the platform or the server doesn't support it. The magic
+  // bytes are sent only to a server advertising the persistent mode in its
+  // IPC key file, so the connection stays usable for the legacy protocol if
+  // the server doesn't. Otherwise the connection may be closed (i.e.
+  // Connected() returns false) after the failure.
+  virtual bool EnablePersistentConnection(absl::Duration timeout) {
+    return false;
+  }
+
+  // Returns true if the connection is in the persistent mode.
+  virtual bool IsPersistentConnection() const { return false; }
+
+  // Pipelined IPC, available only in the persistent mode.
+  // SendRequest() sends a request without waiting for the response, and
+  // ReceiveResponse() receives the response of the oldest request in flight.
+  // The server processes requests of a connection in order, so the responses
+  // are received in the order of the requests. Keep the number of requests in
+  // flight small; the server doesn't read the next request until its response
+  // for the previous one is written to the socket.
+  virtual bool SendRequest(const std::string &request,
+                           absl::Duration timeout) {
+    return false;
+  }
+  virtual bool ReceiveResponse(std::string *response, absl::Duration timeout) {
+    return false;
+  }
 };
 
 #ifdef __APPLE__
@@ -146,12 +175,22 @@ class IPCClient : public IPCClientInterface {
   // When Server doesn't send response within timeout, 'Call' returns false.
   // When timeout (in msec) is set -1, 'Call' waits forever.
   // Note that on Linux and Windows, Call() closes the socket_. This means you
-  // cannot call the Call() function more than once.
+  // cannot call the Call() function more than once, unless the connection is
+  // in the persistent mode (Linux only).
   bool Call(const std::string &request, std::string *response,
             absl::Duration timeout) override;
 
   IPCErrorType GetLastIPCError() const override { return last_ipc_error_; }
 
+#if !defined(_WIN32) && !defined(__APPLE__)
+  // Persistent mode. See IPCClientInterface for details.
+  bool EnablePersistentConnection(absl::Duration timeout) override;
+  bool IsPersistentConnection() const override { return persistent_; }
+  bool SendRequest(const std::string &request,
+                   absl::Duration timeout) override;
+  bool ReceiveResponse(std::string *response, absl::Duration timeout) override;
+#endif  // !_WIN32 && !__APPLE__
+
   // terminate the server process named |name|
   // Do not use it unless version mismatch happens
   static bool TerminateServer(absl::string_view name);
@@ -174,6 +213,7 @@ class IPCClient : public IPCClientInterface {
   MachPortManagerInterface *mach_port_manager_;
 #else   // _WIN32
   int socket_;
+  bool persistent_;
 #endif  // _WIN32
   bool connected_;
   IPCPathManager *ipc_path_manager_;
@@ -207,6 +247,11 @@ class IPCClientFactory : public IPCClientFactoryInterface {
 };
 
 // Synchronous, Single-thread IPC Server
+// On Linux, the server also keeps connections in the persistent mode (see
+// IPCClient::EnablePersistentConnection) open, and serves their requests in
+// the same loop. Requests of each connection are processed in order.
+// On Linux, Process() can also run on a pool of worker threads (see
+// set_num_workers()).
 // Usage:
 // class MyEchoServer: public IPCServer {
 //  public:
@@ -239,6 +284,19 @@ class IPCServer {
   // If 'Process' return false, server finishes select loop
   virtual bool Process(absl::string_view request, std::string *response) = 0;
 
+  // Returns the key to order the requests processed by the worker threads.
+  // Requests with the same key are processed one at a time in the arrival
+  // order, while requests with different keys may be processed concurrently.
+  // By default, all the requests have the same key.
+  virtual uint64_t GetOrderingKey(absl::string_view request) const {
+    return 0;
+  }
+
+  // Sets the number of worker threads calling Process(). If it is 0 (default),
+  // Process() is called on the thread running Loop(). Otherwise Process() must
+  // be thread-safe. Must be called before Loop(). Only effective on Linux.
+  void set_num_workers(int32_t num_workers) { num_workers_ = num_workers; }
+
   // Start select loop. It goes into infinite loop.
   void Loop();
 
@@ -279,9 +337,14 @@ class IPCServer {
 #else   // _WIN32
   int socket_;
   std::string server_address_;
+  // The maximum number of connections in the persistent mode.
+  int32_t max_persistent_connections_;
+  // eventfd to wake up Loop() from Terminate() or the worker threads.
+  int wakeup_fd_;
 #endif  // _WIN32
 
   absl::Duration timeout_;
+  int32_t num_workers_ = 0;
 };
 
 }  // namespace mozc
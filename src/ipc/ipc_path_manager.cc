@@ -206,6 +206,10 @@ bool IPCPathManager::SavePathName() {
   // set the server version
   ipc_path_info_.set_protocol_version(IPC_PROTOCOL_VERSION);
   ipc_path_info_.set_product_version(Version::GetMozcVersion());
+#ifdef __linux__
+  // IPCServer in unix_ipc.cc serves connections in the persistent mode.
+  ipc_path_info_.set_persistent_connection(true);
+#endif  // __linux__
 
 #ifdef _WIN32
   ipc_path_info_.set_process_id(static_cast<uint32_t>(::GetCurrentProcessId()));
@@ -299,6 +303,10 @@ uint32_t IPCPathManager::GetServerProtocolVersion() const {
   return ipc_path_info_.protocol_version();
 }
 
+bool IPCPathManager::IsPersistentConnectionSupported() const {
+  return ipc_path_info_.persistent_connection();
+}
+
 const std::string &IPCPathManager::GetServerProductVersion() const {
   return ipc_path_info_.product_version();
 }
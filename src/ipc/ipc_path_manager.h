@@ -94,6 +94,9 @@ class IPCPathManager {
   // return process id of the server
   uint32_t GetServerProcessId() const;
 
+  // Returns true if the server advertises the persistent mode of connections.
+  bool IsPersistentConnectionSupported() const;
+
   // Checks the server pid is the valid server specified with server_path.
   // server pid can be obtained by OS dependent method.
   // This API is only available on Windows Vista or Linux.
@@ -34,7 +34,11 @@
 #include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "base/thread.h"
@@ -163,5 +167,198 @@ TEST_F(IPCTest, IPCTest) {
   con.Wait();
 }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+// IPCPathManager is a singleton per name, so each test uses its own name.
+constexpr char kPersistentServerAddress[] = "test_persistent_echo_server";
+constexpr char kLimitedServerAddress[] = "test_limited_echo_server";
+constexpr char kWorkerServerAddress[] = "test_worker_echo_server";
+
+TEST_F(IPCTest, PersistentConnectionTest) {
+  EchoServer server(kPersistentServerAddress, 10, absl::Milliseconds(1000));
+  server.LoopAndReturn();
+  absl::SleepFor(absl::Milliseconds(100));
+
+  IPCClient client(kPersistentServerAddress, "");
+  ASSERT_TRUE(client.Connected());
+  EXPECT_FALSE(client.IsPersistentConnection());
+  ASSERT_TRUE(client.EnablePersistentConnection(absl::Milliseconds(1000)));
+  EXPECT_TRUE(client.IsPersistentConnection());
+
+  // The same connection serves multiple calls.
+  for (int i = 0; i < kNumRequests; ++i) {
+    const std::string input = GenerateInputData(i);
+    std::string output;
+    ASSERT_TRUE(client.Call(input, &output, absl::Milliseconds(1000)))
+        << "size=" << input.size();
+    EXPECT_EQ(output, input);
+  }
+
+  // A client of the legacy protocol is served while the persistent
+  // connection is open.
+  {
+    IPCClient legacy_client(kPersistentServerAddress, "");
+    ASSERT_TRUE(legacy_client.Connected());
+    std::string output;
+    ASSERT_TRUE(
+        legacy_client.Call("legacy", &output, absl::Milliseconds(1000)));
+    EXPECT_EQ(output, "legacy");
+  }
+
+  // Legacy requests sharing a prefix with the magic bytes are kept intact.
+  for (const std::string &input :
+       {std::string("\0MOZ", 4), std::string("\0MOZCIPX-legacy", 15)}) {
+    IPCClient legacy_client(kPersistentServerAddress, "");
+    ASSERT_TRUE(legacy_client.Connected());
+    std::string output;
+    ASSERT_TRUE(legacy_client.Call(input, &output, absl::Milliseconds(1000)));
+    EXPECT_EQ(output, input);
+  }
+
+  // Pipelined requests are responded in order.
+  constexpr int kNumPipelinedRequests = 4;
+  for (int i = 0; i < kNumPipelinedRequests; ++i) {
+    ASSERT_TRUE(
+        client.SendRequest(GenerateInputData(i), absl::Milliseconds(1000)));
+  }
+  for (int i = 0; i < kNumPipelinedRequests; ++i) {
+    std::string output;
+    ASSERT_TRUE(client.ReceiveResponse(&output, absl::Milliseconds(1000)));
+    EXPECT_EQ(output, GenerateInputData(i));
+  }
+
+  std::string output;
+  client.Call("kill", &output, absl::Milliseconds(1000));
+  server.Wait();
+
+  // The server closes the connection on exit.
+  EXPECT_FALSE(client.Call("foo", &output, absl::Milliseconds(1000)));
+  EXPECT_EQ(client.GetLastIPCError(), IPC_NO_CONNECTION);
+  EXPECT_FALSE(client.Connected());
+}
+
+TEST_F(IPCTest, PersistentConnectionLimitTest) {
+  // The server accepts only one persistent connection.
+  EchoServer server(kLimitedServerAddress, 1, absl::Milliseconds(1000));
+  server.LoopAndReturn();
+  absl::SleepFor(absl::Milliseconds(100));
+
+  IPCClient client1(kLimitedServerAddress, "");
+  ASSERT_TRUE(client1.EnablePersistentConnection(absl::Milliseconds(1000)));
+
+  IPCClient client2(kLimitedServerAddress, "");
+  ASSERT_TRUE(client2.Connected());
+  EXPECT_FALSE(client2.EnablePersistentConnection(absl::Milliseconds(1000)));
+  EXPECT_FALSE(client2.Connected());
+
+  std::string output;
+  EXPECT_TRUE(client1.Call("foo", &output, absl::Milliseconds(1000)));
+  EXPECT_EQ(output, "foo");
+
+  client1.Call("kill", &output, absl::Milliseconds(1000));
+  server.Wait();
+}
+
+// Echo server whose ordering key is the first byte of the request. It checks
+// that requests with the same key are not processed concurrently.
+class OrderedEchoServer : public IPCServer {
+ public:
+  OrderedEchoServer(const std::string &path, int32_t num_connections,
+                    absl::Duration timeout)
+      : IPCServer(path, num_connections, timeout) {}
+
+  bool Process(absl::string_view input, std::string *output) override {
+    if (input == "kill") {
+      output->clear();
+      return false;
+    }
+    const uint64_t key = GetOrderingKey(input);
+    {
+      absl::MutexLock lock(&mutex_);
+      EXPECT_TRUE(active_keys_.insert(key).second) << input;
+    }
+    if (input == "block") {
+      // Blocks until another request is processed on another worker.
+      EXPECT_TRUE(
+          released_.WaitForNotificationWithTimeout(absl::Seconds(10)));
+    } else if (input == "release") {
+      released_.Notify();
+    }
+    {
+      absl::MutexLock lock(&mutex_);
+      active_keys_.erase(key);
+    }
+    output->assign(input.data(), input.size());
+    return true;
+  }
+
+  uint64_t GetOrderingKey(absl::string_view request) const override {
+    return request.empty() ? 0 : request.front();
+  }
+
+ private:
+  absl::Notification released_;
+  absl::Mutex mutex_;
+  absl::flat_hash_set<uint64_t> active_keys_ ABSL_GUARDED_BY(mutex_);
+};
+
+TEST_F(IPCTest, WorkerPoolTest) {
+  OrderedEchoServer server(kWorkerServerAddress, 10, absl::Milliseconds(1000));
+  server.set_num_workers(4);
+  server.LoopAndReturn();
+  absl::SleepFor(absl::Milliseconds(100));
+
+  // A blocked request doesn't block requests with other keys.
+  Thread blocked([] {
+    IPCClient client(kWorkerServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    std::string output;
+    EXPECT_TRUE(client.Call("block", &output, absl::Seconds(10)));
+    EXPECT_EQ(output, "block");
+  });
+  absl::SleepFor(absl::Milliseconds(100));
+  {
+    IPCClient client(kWorkerServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    std::string output;
+    EXPECT_TRUE(client.Call("release", &output, absl::Milliseconds(1000)));
+    EXPECT_EQ(output, "release");
+  }
+  blocked.Join();
+
+  // Connections share the keys, and each connection pipelines requests.
+  std::vector<Thread> clients;
+  for (int i = 0; i < kNumThreads; ++i) {
+    clients.push_back(Thread([i] {
+      IPCClient client(kWorkerServerAddress, "");
+      ASSERT_TRUE(client.EnablePersistentConnection(absl::Milliseconds(1000)));
+      // Small requests so that the pipelined requests and responses fit in
+      // the socket buffers.
+      const absl::string_view prefix = (i % 2 == 0) ? "x" : "y";
+      constexpr int kNumPipelinedRequests = 4;
+      for (int j = 0; j < kNumRequests; j += kNumPipelinedRequests) {
+        for (int k = j; k < j + kNumPipelinedRequests; ++k) {
+          ASSERT_TRUE(client.SendRequest(absl::StrCat(prefix, k),
+                                         absl::Milliseconds(1000)));
+        }
+        for (int k = j; k < j + kNumPipelinedRequests; ++k) {
+          std::string output;
+          ASSERT_TRUE(
+              client.ReceiveResponse(&output, absl::Milliseconds(1000)));
+          EXPECT_EQ(output, absl::StrCat(prefix, k));
+        }
+      }
+    }));
+  }
+  for (Thread &client : clients) {
+    client.Join();
+  }
+
+  IPCClient kill(kWorkerServerAddress, "");
+  std::string output;
+  kill.Call("kill", &output, absl::Milliseconds(1000));
+  server.Wait();
+}
+#endif  // __linux__ && !__ANDROID__
+
 }  // namespace
 }  // namespace mozc
@@ -31,6 +31,8 @@
 #if defined(__linux__)
 
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -38,19 +40,30 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "base/file_util.h"
+#include "base/thread.h"
 #include "base/vlog.h"
 #include "ipc/ipc.h"
 #include "ipc/ipc_path_manager.h"
@@ -64,6 +77,22 @@ namespace {
 
 constexpr int kInvalidSocket = -1;
 
+// Magic bytes sent by a client to switch the connection to the persistent
+// mode, and echoed back by the server to accept it. The first byte is zero so
+// that it never collides with a request of the legacy protocol, which is a
+// serialized protobuf message and cannot start with a zero tag.
+constexpr absl::string_view kPersistentConnectionMagic("\0MOZCIPC", 8);
+
+// In the persistent mode, each message is sent as a frame that consists of
+// the payload size (4 bytes, big endian) followed by the payload.
+constexpr size_t kFrameHeaderSize = 4;
+
+// Frames larger than this are treated as broken.
+constexpr uint32_t kMaxFrameSize = 64 * 1024 * 1024;
+
+// The maximum number of events returned by one epoll_wait().
+constexpr int kMaxEpollEvents = 16;
+
 absl::Status mkdir_p(const std::string &dirname) {
   const std::string parent_dir = FileUtil::Dirname(dirname);
   struct stat st;
@@ -153,6 +182,10 @@ IPCErrorType SendMessage(int socket, const std::string &msg,
       // An error occurs.
       LOG(ERROR) << "an error occurred during sending \"" << msg.substr(offset)
                  << "\": " << strerror(errno);
+      if (offset == 0 && (errno == EPIPE || errno == ECONNRESET)) {
+        // The peer has already closed the connection.
+        return IPC_NO_CONNECTION;
+      }
       return IPC_WRITE_ERROR;
     }
     offset += l;
@@ -192,6 +225,329 @@ IPCErrorType RecvMessage(int socket, std::string *msg, absl::Duration timeout) {
   return IPC_NO_ERROR;
 }
 
+// Receives exactly `size` bytes. Returns IPC_NO_CONNECTION if the peer has
+// closed the connection before sending any byte.
+IPCErrorType RecvBytes(int socket, char *buf, size_t size,
+                       absl::Duration timeout) {
+  size_t offset = 0;
+  while (offset < size) {
+    if (IsReadTimeout(socket, timeout)) {
+      LOG(WARNING) << "Read timeout " << timeout;
+      return IPC_TIMEOUT_ERROR;
+    }
+    const ssize_t l = ::recv(socket, buf + offset, size - offset, 0);
+    if (l < 0) {
+      LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
+      return IPC_READ_ERROR;
+    }
+    if (l == 0) {
+      if (offset == 0) {
+        MOZC_VLOG(1) << "connection closed by peer";
+        return IPC_NO_CONNECTION;
+      }
+      LOG(ERROR) << "connection closed after " << offset << " bytes";
+      return IPC_READ_ERROR;
+    }
+    offset += l;
+  }
+  return IPC_NO_ERROR;
+}
+
+IPCErrorType SendFrame(int socket, absl::string_view payload,
+                       absl::Duration timeout) {
+  if (payload.size() > kMaxFrameSize) {
+    LOG(ERROR) << "too large message: " << payload.size();
+    return IPC_WRITE_ERROR;
+  }
+  std::string frame(kFrameHeaderSize, '\0');
+  const uint32_t size = payload.size();
+  for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+    frame[i] = static_cast<char>((size >> (8 * (kFrameHeaderSize - 1 - i))) &
+                                 0xff);
+  }
+  frame.append(payload);
+  return SendMessage(socket, frame, timeout);
+}
+
+IPCErrorType RecvFrame(int socket, std::string *payload,
+                       absl::Duration timeout) {
+  char header[kFrameHeaderSize];
+  if (const IPCErrorType error =
+          RecvBytes(socket, header, kFrameHeaderSize, timeout);
+      error != IPC_NO_ERROR) {
+    payload->clear();
+    return error;
+  }
+  uint32_t size = 0;
+  for (const char c : header) {
+    size = (size << 8) | static_cast<uint8_t>(c);
+  }
+  if (size > kMaxFrameSize) {
+    LOG(ERROR) << "broken frame: size=" << size;
+    payload->clear();
+    return IPC_READ_ERROR;
+  }
+  payload->resize(size);
+  if (const IPCErrorType error =
+          RecvBytes(socket, payload->data(), size, timeout);
+      error != IPC_NO_ERROR) {
+    payload->clear();
+    // EOF in the middle of the frame is not a clean shutdown.
+    return error == IPC_NO_CONNECTION ? IPC_READ_ERROR : error;
+  }
+  MOZC_VLOG(1) << size << " bytes received";
+  return IPC_NO_ERROR;
+}
+
+// Returns true if the client requests the persistent mode. Otherwise the
+// bytes consumed from the socket are stored in `prefix` so that they can be
+// prepended to the request of the legacy protocol. Since a request of the
+// legacy protocol is a serialized proto, which never starts with '\0', the
+// legacy request usually costs a single recv() here.
+bool RecvPersistentConnectionMagic(int socket, absl::Duration timeout,
+                                   std::string *prefix) {
+  char buf[kPersistentConnectionMagic.size()];
+  size_t offset = 0;
+  prefix->clear();
+  while (offset < sizeof(buf)) {
+    // Waits for the rest of the magic bytes instead of spinning on recv().
+    if (IsReadTimeout(socket, timeout)) {
+      break;
+    }
+    const ssize_t l = ::recv(socket, buf + offset, sizeof(buf) - offset,
+                             /* flags */ 0);
+    if (l <= 0) {
+      // EOF or an error. The error, if any, is reported by the following
+      // RecvMessage().
+      break;
+    }
+    offset += l;
+    if (absl::string_view(buf, offset) !=
+        kPersistentConnectionMagic.substr(0, offset)) {
+      break;
+    }
+  }
+  if (absl::string_view(buf, offset) == kPersistentConnectionMagic) {
+    return true;
+  }
+  prefix->assign(buf, offset);
+  return false;
+}
+
+// A request read from a connection, waiting to be processed.
+struct PendingRequest {
+  int socket;
+  // True if the connection is in the persistent mode.
+  bool persistent;
+  std::string request;
+};
+
+// Connections in the persistent mode. A connection is watched by epoll with
+// EPOLLONESHOT, so that it is not reported again until the response to the
+// current request is sent. This keeps the responses in the request order.
+class PersistentConnections {
+ public:
+  PersistentConnections(int epoll_fd, size_t max_size)
+      : epoll_fd_(epoll_fd), max_size_(max_size) {}
+
+  // Starts watching `socket`. Returns false if there are too many connections.
+  bool Add(int socket) {
+    absl::MutexLock lock(&mutex_);
+    if (sockets_.size() >= max_size_) {
+      return false;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = socket;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) < 0) {
+      LOG(ERROR) << "epoll_ctl() failed: " << strerror(errno);
+      return false;
+    }
+    sockets_.insert(socket);
+    return true;
+  }
+
+  // Watches `socket` again for the next request.
+  void Rearm(int socket) {
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = socket;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket, &event) < 0) {
+      LOG(ERROR) << "epoll_ctl() failed: " << strerror(errno);
+      Close(socket);
+    }
+  }
+
+  void Close(int socket) {
+    absl::MutexLock lock(&mutex_);
+    // The socket is closed while the lock is held, so that Add() doesn't see
+    // the same descriptor reused for a new connection before it's erased.
+    sockets_.erase(socket);
+    ::close(socket);
+  }
+
+  void CloseAll() {
+    absl::MutexLock lock(&mutex_);
+    for (const int socket : sockets_) {
+      ::close(socket);
+    }
+    sockets_.clear();
+  }
+
+ private:
+  const int epoll_fd_;
+  const size_t max_size_;
+  absl::Mutex mutex_;
+  absl::flat_hash_set<int> sockets_ ABSL_GUARDED_BY(mutex_);
+};
+
+void CloseConnection(const PendingRequest &pending,
+                     PersistentConnections &persistent_connections) {
+  if (pending.persistent) {
+    persistent_connections.Close(pending.socket);
+  } else {
+    ::close(pending.socket);
+  }
+}
+
+// Processes the request and sends the response. Returns false if the server
+// should be terminated.
+bool ServeRequest(IPCServer *server, const PendingRequest &pending,
+                  absl::Duration timeout,
+                  PersistentConnections &persistent_connections) {
+  std::string response;
+  if (!server->Process(pending.request, &response)) {
+    LOG(WARNING) << "Process() failed";
+    CloseConnection(pending, persistent_connections);
+    return false;
+  }
+
+  if (response.empty()) {
+    // The client cannot distinguish an empty response from an error, so close
+    // the connection without the response.
+    LOG(WARNING) << "response is empty";
+    CloseConnection(pending, persistent_connections);
+    return true;
+  }
+
+  if (!pending.persistent) {
+    // In the legacy protocol, the response is delimited by closing the
+    // connection.
+    if (SendMessage(pending.socket, response, timeout) != IPC_NO_ERROR) {
+      LOG(WARNING) << "SendMessage() failed";
+    }
+    ::close(pending.socket);
+    return true;
+  }
+
+  if (SendFrame(pending.socket, response, timeout) != IPC_NO_ERROR) {
+    LOG(WARNING) << "SendFrame() failed";
+    persistent_connections.Close(pending.socket);
+    return true;
+  }
+  persistent_connections.Rearm(pending.socket);
+  return true;
+}
+
+// Processes requests on a pool of worker threads. Requests with the same
+// ordering key are processed one at a time in the arrival order, while
+// requests with different keys are processed concurrently.
+class RequestDispatcher {
+ public:
+  using Handler = std::function<void(const PendingRequest &)>;
+
+  // `handler` processes a request. `canceller` is called for the requests left
+  // unprocessed when the dispatcher is destroyed.
+  RequestDispatcher(int num_workers, Handler handler, Handler canceller)
+      : handler_(std::move(handler)), canceller_(std::move(canceller)) {
+    workers_.reserve(num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      workers_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  RequestDispatcher(const RequestDispatcher &) = delete;
+  RequestDispatcher &operator=(const RequestDispatcher &) = delete;
+
+  ~RequestDispatcher() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+    }
+    for (Thread &worker : workers_) {
+      worker.Join();
+    }
+    for (const auto &[key, queue] : queues_) {
+      for (const PendingRequest &pending : queue) {
+        canceller_(pending);
+      }
+    }
+  }
+
+  void Dispatch(uint64_t key, PendingRequest pending) {
+    absl::MutexLock lock(&mutex_);
+    auto [it, inserted] = queues_.try_emplace(key);
+    it->second.push_back(std::move(pending));
+    if (inserted) {
+      // No other request with the same key is queued or being processed.
+      ready_keys_.push_back(key);
+    }
+  }
+
+ private:
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return stopped_ || !ready_keys_.empty();
+  }
+
+  void WorkerLoop() {
+    mutex_.Lock();
+    while (true) {
+      mutex_.Await(absl::Condition(this, &RequestDispatcher::HasWork));
+      if (stopped_) {
+        break;
+      }
+      const uint64_t key = ready_keys_.front();
+      ready_keys_.pop_front();
+      // The queue stays in `queues_` while the request is processed, so that
+      // the following requests with the same key wait for it.
+      std::deque<PendingRequest> &queue = queues_[key];
+      const PendingRequest pending = std::move(queue.front());
+      queue.pop_front();
+
+      mutex_.Unlock();
+      handler_(pending);
+      mutex_.Lock();
+
+      // `queue` may be invalidated by the insertions to `queues_`.
+      if (auto it = queues_.find(key); it->second.empty()) {
+        queues_.erase(it);
+      } else {
+        ready_keys_.push_back(key);
+      }
+    }
+    mutex_.Unlock();
+  }
+
+  const Handler handler_;
+  const Handler canceller_;
+  std::vector<Thread> workers_;
+  absl::Mutex mutex_;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  // Requests per ordering key. A key is present while its request is queued
+  // or being processed.
+  absl::flat_hash_map<uint64_t, std::deque<PendingRequest>> queues_
+      ABSL_GUARDED_BY(mutex_);
+  // Keys whose first request can be processed.
+  std::deque<uint64_t> ready_keys_ ABSL_GUARDED_BY(mutex_);
+};
+
+void Wakeup(int wakeup_fd) {
+  const uint64_t value = 1;
+  if (::write(wakeup_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+    LOG(WARNING) << "write() to eventfd failed: " << strerror(errno);
+  }
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -216,6 +572,7 @@ bool IsAbstractSocket(const std::string &address) {
 // Client
 IPCClient::IPCClient(const absl::string_view name)
     : socket_(kInvalidSocket),
+      persistent_(false),
       connected_(false),
       ipc_path_manager_(nullptr),
       last_ipc_error_(IPC_NO_ERROR) {
@@ -225,6 +582,7 @@ IPCClient::IPCClient(const absl::string_view name)
 IPCClient::IPCClient(const absl::string_view name,
                      const absl::string_view server_path)
     : socket_(kInvalidSocket),
+      persistent_(false),
       connected_(false),
       ipc_path_manager_(nullptr),
       last_ipc_error_(IPC_NO_ERROR) {
@@ -310,6 +668,9 @@ bool IPCClient::Call(const std::string &request, std::string *response,
     LOG(ERROR) << "Call failed: not connected";
     return false;
   }
+  if (persistent_) {
+    return SendRequest(request, timeout) && ReceiveResponse(response, timeout);
+  }
   last_ipc_error_ = SendMessage(socket_, request, timeout);
   if (last_ipc_error_ != IPC_NO_ERROR) {
     LOG(ERROR) << "SendMessage failed";
@@ -335,10 +696,85 @@ bool IPCClient::Call(const std::string &request, std::string *response,
 
 bool IPCClient::Connected() const { return connected_; }
 
+bool IPCClient::EnablePersistentConnection(absl::Duration timeout) {
+  if (!connected_) {
+    return false;
+  }
+  if (persistent_) {
+    return true;
+  }
+  // A server which doesn't advertise the persistent mode would take the magic
+  // bytes as a part of a request, so they are sent only when advertised. The
+  // connection stays usable for the legacy protocol in that case.
+  if (ipc_path_manager_ == nullptr ||
+      !ipc_path_manager_->IsPersistentConnectionSupported()) {
+    MOZC_VLOG(1) << "the server doesn't support persistent connections";
+    return false;
+  }
+  last_ipc_error_ = SendMessage(
+      socket_, std::string(kPersistentConnectionMagic), timeout);
+  if (last_ipc_error_ == IPC_NO_ERROR) {
+    std::string ack(kPersistentConnectionMagic.size(), '\0');
+    last_ipc_error_ = RecvBytes(socket_, ack.data(), ack.size(), timeout);
+    if (last_ipc_error_ == IPC_NO_ERROR && ack == kPersistentConnectionMagic) {
+      persistent_ = true;
+      MOZC_VLOG(1) << "persistent connection established";
+      return true;
+    }
+  }
+  // The server doesn't support the persistent mode, or refused it. The
+  // connection is no longer usable for the legacy protocol either.
+  LOG(WARNING) << "persistent connection is not available: "
+               << last_ipc_error_;
+  connected_ = false;
+  return false;
+}
+
+bool IPCClient::SendRequest(const std::string &request,
+                            absl::Duration timeout) {
+  if (!connected_ || !persistent_) {
+    LOG(ERROR) << "SendRequest failed: not in the persistent mode";
+    return false;
+  }
+  last_ipc_error_ = SendFrame(socket_, request, timeout);
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    LOG(ERROR) << "SendFrame failed";
+    connected_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool IPCClient::ReceiveResponse(std::string *response,
+                                absl::Duration timeout) {
+  if (!connected_ || !persistent_) {
+    LOG(ERROR) << "ReceiveResponse failed: not in the persistent mode";
+    return false;
+  }
+  last_ipc_error_ = RecvFrame(socket_, response, timeout);
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    LOG(ERROR) << "RecvFrame failed";
+    // The stream may be out of sync with the requests.
+    connected_ = false;
+    return false;
+  }
+  MOZC_VLOG(1) << "Call succeeded";
+  return true;
+}
+
 // Server
 IPCServer::IPCServer(const std::string &name, int32_t num_connections,
                      absl::Duration timeout)
-    : connected_(false), socket_(kInvalidSocket), timeout_(timeout) {
+    : connected_(false),
+      socket_(kInvalidSocket),
+      max_persistent_connections_(num_connections),
+      wakeup_fd_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      timeout_(timeout) {
+  if (wakeup_fd_ < 0) {
+    LOG(ERROR) << "eventfd() failed: " << strerror(errno);
+    return;
+  }
+
   IPCPathManager *manager = IPCPathManager::GetIPCPathManager(name);
   if (!manager->CreateNewPathName() && !manager->LoadPathName()) {
     LOG(ERROR) << "Cannot prepare IPC path name";
@@ -413,52 +849,143 @@ IPCServer::~IPCServer() {
   }
   connected_ = false;
   socket_ = kInvalidSocket;
+  if (wakeup_fd_ >= 0) {
+    ::close(wakeup_fd_);
+  }
   MOZC_VLOG(1) << "IPCServer destructed";
 }
 
 bool IPCServer::Connected() const { return connected_; }
 
 void IPCServer::Loop() {
-  // The most portable and straightforward single-thread server
-  bool error = false;
+  // epoll waits for new connections, requests on the persistent connections,
+  // and the wakeup event. Requests are read on this thread, and processed
+  // either on this thread or on the worker threads.
+  const int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    LOG(FATAL) << "epoll_create1() failed: " << strerror(errno);
+    return;
+  }
+  for (const int fd : {socket_, wakeup_fd_}) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      LOG(FATAL) << "epoll_ctl() failed: " << strerror(errno);
+      return;
+    }
+  }
+
+  std::atomic<bool> error = false;
+  PersistentConnections persistent_connections(epoll_fd,
+                                               max_persistent_connections_);
+  const RequestDispatcher::Handler serve =
+      [&](const PendingRequest &pending) {
+        if (!ServeRequest(this, pending, timeout_, persistent_connections)) {
+          error = true;
+          Wakeup(wakeup_fd_);
+        }
+      };
+  std::optional<RequestDispatcher> dispatcher;
+  if (num_workers_ > 0) {
+    dispatcher.emplace(num_workers_, serve,
+                       [&](const PendingRequest &pending) {
+                         CloseConnection(pending, persistent_connections);
+                       });
+  }
+  auto dispatch = [&](PendingRequest pending) {
+    if (dispatcher.has_value()) {
+      const uint64_t key = GetOrderingKey(pending.request);
+      dispatcher->Dispatch(key, std::move(pending));
+    } else {
+      serve(pending);
+    }
+  };
+
   pid_t pid = 0;
-  std::string request;
-  std::string response;
+  epoll_event events[kMaxEpollEvents];
   while (!error && !terminate_.HasBeenNotified()) {
+    const int num_events = ::epoll_wait(epoll_fd, events, kMaxEpollEvents, -1);
+    if (num_events < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "epoll_wait() failed: " << strerror(errno);
+      return;
+    }
+
+    // Reads one request per ready persistent connection so that a busy client
+    // doesn't starve the others. Pipelined requests remain in the socket
+    // buffer until the connection is watched again.
+    bool has_new_connection = false;
+    for (int i = 0; i < num_events && !error; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == socket_) {
+        has_new_connection = true;
+        continue;
+      }
+      if (fd == wakeup_fd_) {
+        uint64_t value = 0;
+        ::read(wakeup_fd_, &value, sizeof(value));
+        continue;
+      }
+      PendingRequest pending = {fd, true, ""};
+      if (const IPCErrorType recv_error =
+              RecvFrame(fd, &pending.request, timeout_);
+          recv_error != IPC_NO_ERROR) {
+        LOG_IF(WARNING, recv_error != IPC_NO_CONNECTION)
+            << "RecvFrame() failed";
+        persistent_connections.Close(fd);
+        continue;
+      }
+      dispatch(std::move(pending));
+    }
+
+    if (error || !has_new_connection) {
+      continue;
+    }
     const int new_sock = ::accept(socket_, nullptr, nullptr);
     if (new_sock < 0) {
       LOG(FATAL) << "accept() failed: " << strerror(errno);
       return;
     }
     if (!IsPeerValid(new_sock, &pid)) {
-      continue;
-    }
-
-    if (RecvMessage(new_sock, &request, timeout_) != IPC_NO_ERROR) {
-      LOG(WARNING) << "RecvMessage() failed";
       ::close(new_sock);
       continue;
     }
 
-    if (!Process(request, &response)) {
-      LOG(WARNING) << "Process() failed";
-      ::close(new_sock);
-      error = true;
+    std::string prefix;
+    if (RecvPersistentConnectionMagic(new_sock, timeout_, &prefix)) {
+      SetCloseOnExecFlag(new_sock);
+      if (!persistent_connections.Add(new_sock)) {
+        // Closing the connection without the reply makes the client fall back
+        // to the legacy protocol.
+        LOG(WARNING) << "persistent connection is refused";
+        ::close(new_sock);
+        continue;
+      }
+      if (SendMessage(new_sock, std::string(kPersistentConnectionMagic),
+                      timeout_) != IPC_NO_ERROR) {
+        LOG(WARNING) << "SendMessage() failed";
+        persistent_connections.Close(new_sock);
+      }
       continue;
     }
 
-    if (response.empty()) {
-      LOG(WARNING) << "response is empty";
+    PendingRequest pending = {new_sock, false, ""};
+    if (RecvMessage(new_sock, &pending.request, timeout_) != IPC_NO_ERROR) {
+      LOG(WARNING) << "RecvMessage() failed";
       ::close(new_sock);
       continue;
     }
-
-    if (SendMessage(new_sock, response, timeout_) != IPC_NO_ERROR) {
-      LOG(WARNING) << "SendMessage() failed";
-    }
-    ::close(new_sock);
+    pending.request.insert(0, prefix);
+    dispatch(std::move(pending));
   }
 
+  // Waits for the requests being processed.
+  dispatcher.reset();
+  persistent_connections.CloseAll();
+  ::close(epoll_fd);
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
@@ -472,6 +999,7 @@ void IPCServer::Loop() {
 void IPCServer::Terminate() {
   if (server_thread_ != nullptr) {
     terminate_.Notify();
+    Wakeup(wakeup_fd_);
     server_thread_->Join();
   }
 }
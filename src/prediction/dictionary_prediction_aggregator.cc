@@ -48,8 +48,10 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "base/japanese_util.h"
+#include "base/latency_stats.h"
 #include "base/number_util.h"
 #include "base/strings/unicode.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "composer/query.h"
@@ -131,6 +133,12 @@ bool IsLanguageAwareInputEnabled(const ConversionRequest &request) {
   return lang_aware == Request::LANGUAGE_AWARE_SUGGESTION;
 }
 
+bool IsParallelAggregationEnabled(const ConversionRequest &request) {
+  return request.request()
+      .decoder_experiment_params()
+      .parallel_prediction_aggregation();
+}
+
 bool IsZeroQuerySuffixPredictionDisabled(const ConversionRequest &request) {
   return request.request()
       .decoder_experiment_params()
@@ -505,6 +513,7 @@ std::vector<Result> DictionaryPredictionAggregator::AggregateResults(
 std::vector<Result>
 DictionaryPredictionAggregator::AggregateTypingCorrectedResults(
     const ConversionRequest &request) const {
+  ScopedLatencyTimer timer("prediction/typing_correction");
   std::vector<Result> results;
   AggregateTypingCorrectedPrediction(request, (UNIGRAM | BIGRAM | REALTIME),
                                      &results);
@@ -589,37 +598,71 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
       return NO_PREDICTION;
     }
   }
+
+  // In partial suggestion or prediction, only realtime candidates are used.
+  const bool is_partial =
+      request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
+      request.request_type() == ConversionRequest::PARTIAL_PREDICTION;
+
   PredictionTypes selected_types = NO_PREDICTION;
+  // The realtime conversion by the immutable converter only reads the
+  // dictionaries, so it can run in background while the other aggregators
+  // look up the dictionaries. Its results are inserted at `realtime_pos` to
+  // keep the same order as the serial execution regardless of timing. The top
+  // conversion result from the actual converter runs rewriters, so it stays
+  // on this thread.
+  std::optional<BackgroundFuture<std::vector<Result>>> realtime_results;
+  size_t realtime_pos = 0;
   if (ShouldAggregateRealTimeConversionResults(request)) {
-    AggregateRealtimeConversion(
-        request, realtime_max_size,
-        /* insert_realtime_top_from_actual_converter= */
-        request.use_actual_converter_for_realtime_conversion(), results);
+    if (!is_partial && realtime_max_size > 0 &&
+        IsParallelAggregationEnabled(request)) {
+      if (request.use_actual_converter_for_realtime_conversion() &&
+          !PushBackTopConversionResult(request, results)) {
+        LOG(WARNING) << "Realtime conversion with converter failed";
+      }
+      realtime_pos = results->size();
+      realtime_results.emplace([this, &request, realtime_max_size]() {
+        ScopedLatencyTimer timer("prediction/realtime");
+        std::vector<Result> realtime;
+        AggregateRealtimeConversion(
+            request, realtime_max_size,
+            /* insert_realtime_top_from_actual_converter= */ false, &realtime);
+        return realtime;
+      });
+    } else {
+      ScopedLatencyTimer timer("prediction/realtime");
+      AggregateRealtimeConversion(
+          request, realtime_max_size,
+          /* insert_realtime_top_from_actual_converter= */
+          request.use_actual_converter_for_realtime_conversion(), results);
+    }
     selected_types |= REALTIME;
   }
 
-  // In partial suggestion or prediction, only realtime candidates are used.
-  if (request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
-      request.request_type() == ConversionRequest::PARTIAL_PREDICTION) {
+  if (is_partial) {
     return selected_types;
   }
 
   // Add unigram candidates.
   const size_t min_unigram_key_len = unigram_config.min_key_len;
   if (key_len >= min_unigram_key_len) {
+    ScopedLatencyTimer timer("prediction/unigram");
     const auto &unigram_fn = unigram_config.unigram_fn;
     PredictionType type = (this->*unigram_fn)(request, results);
     selected_types |= type;
   }
 
-  if (IsMixedConversionEnabled(request.request()) && key_len > 0 &&
-      AggregateNumberCandidates(request, results)) {
-    selected_types |= NUMBER;
+  if (IsMixedConversionEnabled(request.request()) && key_len > 0) {
+    ScopedLatencyTimer timer("prediction/number");
+    if (AggregateNumberCandidates(request, results)) {
+      selected_types |= NUMBER;
+    }
   }
 
   // Add bigram candidates.
   constexpr int kMinHistoryKeyLen = 3;
   if (HasHistoryKeyLongerThanOrEqualTo(request, kMinHistoryKeyLen)) {
+    ScopedLatencyTimer timer("prediction/bigram");
     AggregateBigramPrediction(request, Segment::Candidate::SOURCE_INFO_NONE,
                               results);
     selected_types |= BIGRAM;
@@ -628,11 +671,13 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
   // Add english candidates.
   if (IsLanguageAwareInputEnabled(request) && IsQwertyMobileTable(request) &&
       key_len >= min_unigram_key_len) {
+    ScopedLatencyTimer timer("prediction/english");
     AggregateEnglishPredictionUsingRawInput(request, results);
     selected_types |= ENGLISH;
   }
 
   if (request_util::IsAutoPartialSuggestionEnabled(request)) {
+    ScopedLatencyTimer timer("prediction/prefix");
     AggregatePrefixCandidates(request, results);
     selected_types |= PREFIX;
   }
@@ -641,6 +686,7 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     // We do not want to add single kanji results for non mixed conversion
     // (i.e., Desktop, or Hardware Keyboard in Mobile), since they contain
     // partial results.
+    ScopedLatencyTimer timer("prediction/single_kanji");
     const std::vector<Result> single_kanji_results =
         modules_.GetSingleKanjiPredictionAggregator().AggregateResults(request);
     if (!single_kanji_results.empty()) {
@@ -650,7 +696,15 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     }
   }
 
+  if (realtime_results.has_value()) {
+    std::vector<Result> realtime = std::move(*realtime_results).Get();
+    results->insert(results->begin() + realtime_pos,
+                    std::make_move_iterator(realtime.begin()),
+                    std::make_move_iterator(realtime.end()));
+  }
+
   MaybePopulateTypingCorrectionPenalty(request, results);
+  LatencyStats::Increment("prediction/results", results->size());
 
   return selected_types;
 }
@@ -670,15 +724,20 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePredictionForZeroQuery(
                                        kMinHistoryKeyLenForZeroQuery) &&
       !IsBigramNwpFilteringMode(
           request, commands::DecoderExperimentParams::FILTER_ALL)) {
+    ScopedLatencyTimer timer("prediction/zero_query_bigram");
     AggregateBigramPrediction(
         request, Segment::Candidate::DICTIONARY_PREDICTOR_ZERO_QUERY_BIGRAM,
         results);
     selected_types |= BIGRAM;
   }
   if (!request.converter_history_key().empty()) {
-    if (modules_.GetSupplementalModel().Predict(request, *results)) {
-      selected_types |= SUPPLEMENTAL_MODEL;
+    {
+      ScopedLatencyTimer timer("prediction/supplemental_model");
+      if (modules_.GetSupplementalModel().Predict(request, *results)) {
+        selected_types |= SUPPLEMENTAL_MODEL;
+      }
     }
+    ScopedLatencyTimer timer("prediction/zero_query_suffix");
     AggregateZeroQuerySuffixPrediction(request, results);
     selected_types |= SUFFIX;
   }
@@ -2017,6 +2017,38 @@ TEST_F(DictionaryPredictionAggregatorTest, UseActualConverterRequest) {
   }
 }
 
+TEST_F(DictionaryPredictionAggregatorTest, ParallelAggregation) {
+  std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
+      CreateAggregatorWithMockData();
+  const DictionaryPredictionAggregatorTestPeer &aggregator =
+      data_and_aggregator->aggregator();
+
+  Segments segments;
+  SetUpInputForSuggestion("ぐーぐるあ", composer_.get(), &segments);
+
+  auto aggregate = [&]() {
+    const ConversionRequest convreq =
+        CreatePredictionConversionRequest(segments);
+    std::vector<Result> results;
+    EXPECT_EQ(aggregator.AggregatePredictionForRequest(convreq, &results),
+              UNIGRAM | REALTIME);
+    return results;
+  };
+
+  const std::vector<Result> serial_results = aggregate();
+  request_->mutable_decoder_experiment_params()
+      ->set_parallel_prediction_aggregation(true);
+  const std::vector<Result> parallel_results = aggregate();
+
+  // The results are merged in the same order as the serial execution.
+  ASSERT_EQ(parallel_results.size(), serial_results.size());
+  for (size_t i = 0; i < serial_results.size(); ++i) {
+    EXPECT_EQ(parallel_results[i].key, serial_results[i].key);
+    EXPECT_EQ(parallel_results[i].value, serial_results[i].value);
+    EXPECT_EQ(parallel_results[i].types, serial_results[i].types);
+  }
+}
+
 TEST_F(DictionaryPredictionAggregatorTest, GetCandidateCutoffThreshold) {
   std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
       CreateAggregatorWithMockData();
@@ -44,6 +44,7 @@
         'predictor.cc',
         'result.cc',
         'single_kanji_prediction_aggregator.cc',
+        'user_history_index.cc',
         'user_history_predictor.cc',
       ],
       'dependencies': [
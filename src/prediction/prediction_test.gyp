@@ -40,6 +40,7 @@
         'dictionary_predictor_test.cc',
         'dictionary_prediction_aggregator_test.cc',
         'number_decoder_test.cc',
+        'user_history_index_test.cc',
         'user_history_predictor_test.cc',
         'predictor_test.cc',
         'single_kanji_prediction_aggregator_test.cc',
@@ -0,0 +1,130 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/user_history_index.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/string_view.h"
+#include "base/japanese_util.h"
+
+namespace mozc::prediction {
+
+void UserHistoryIndex::Add(uint32_t fp, absl::string_view key) {
+  const auto [iter, inserted] = recency_.insert_or_assign(fp, next_recency_++);
+  if (!inserted || key.empty()) {
+    // The fingerprint is derived from the key, so the indexed key is the same.
+    return;
+  }
+  keys_.emplace(std::string(key), fp);
+  std::string roman = japanese_util::HiraganaToRomanji(key);
+  if (roman.size() > 1) {
+    roman_tails_.emplace(roman.substr(1), fp);
+  }
+  romans_.emplace(std::move(roman), fp);
+}
+
+void UserHistoryIndex::Clear() {
+  next_recency_ = 0;
+  recency_.clear();
+  keys_.clear();
+  romans_.clear();
+  roman_tails_.clear();
+}
+
+// static
+void UserHistoryIndex::LookupRange(const KeySet &keys,
+                                   absl::string_view prefix,
+                                   std::vector<uint32_t> *fps) {
+  for (auto iter = keys.lower_bound({std::string(prefix), 0});
+       iter != keys.end() && iter->first.starts_with(prefix); ++iter) {
+    fps->push_back(iter->second);
+  }
+}
+
+void UserHistoryIndex::LookupPrefixesOf(absl::string_view key,
+                                        std::vector<uint32_t> *fps) const {
+  std::pair<std::string, uint32_t> lower;
+  for (size_t len = 1; len <= key.size(); ++len) {
+    lower.first.assign(key.substr(0, len));
+    for (auto iter = keys_.lower_bound(lower);
+         iter != keys_.end() && iter->first == lower.first; ++iter) {
+      fps->push_back(iter->second);
+    }
+  }
+}
+
+void UserHistoryIndex::LookupPredictive(absl::string_view prefix,
+                                        std::vector<uint32_t> *fps) const {
+  LookupRange(keys_, prefix, fps);
+}
+
+void UserHistoryIndex::LookupRomanFuzzyCandidates(
+    absl::string_view roman_prefix, std::vector<uint32_t> *fps) const {
+  if (roman_prefix.empty()) {
+    return;
+  }
+  // No edit or an edit after the first character.
+  LookupRange(romans_, roman_prefix.substr(0, 1), fps);
+  // '-' substituted for the first character.
+  LookupRange(romans_, "-", fps);
+  // The first two characters swapped.
+  if (roman_prefix.size() > 1) {
+    LookupRange(romans_, roman_prefix.substr(1, 1), fps);
+  }
+  // A character deleted before the first character.
+  LookupRange(roman_tails_, roman_prefix.substr(0, 1), fps);
+}
+
+void UserHistoryIndex::SortByRecency(std::vector<uint32_t> *fps) const {
+  std::vector<std::pair<uint64_t, uint32_t>> sorted;
+  sorted.reserve(fps->size());
+  for (const uint32_t fp : *fps) {
+    const auto iter = recency_.find(fp);
+    if (iter != recency_.end()) {
+      sorted.emplace_back(iter->second, fp);
+    }
+  }
+  absl::c_sort(sorted, [](const auto &l, const auto &r) {
+    return l.first > r.first;
+  });
+  fps->clear();
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (i == 0 || sorted[i].first != sorted[i - 1].first) {
+      fps->push_back(sorted[i].second);
+    }
+  }
+}
+
+}  // namespace mozc::prediction
@@ -0,0 +1,108 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_PREDICTION_USER_HISTORY_INDEX_H_
+#define MOZC_PREDICTION_USER_HISTORY_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc::prediction {
+
+// Secondary index of the user history entries by their readings.
+//
+// UserHistoryPredictor keeps the entries in an LRU cache keyed by
+// fingerprints, which can only be scanned linearly. This class indexes the
+// fingerprints by the reading and its romanized form, and remembers the order
+// in which they were inserted to the cache, so that the predictor only visits
+// the entries which may match the input, still in the LRU order.
+//
+// The index is not notified when the LRU cache evicts or erases entries. The
+// caller must look up the returned fingerprints in the cache and skip missing
+// ones, and should call Clear() and re-add the live entries when size()
+// grows too large compared to the cache.
+class UserHistoryIndex {
+ public:
+  UserHistoryIndex() = default;
+  UserHistoryIndex(const UserHistoryIndex &) = delete;
+  UserHistoryIndex &operator=(const UserHistoryIndex &) = delete;
+
+  // Registers the entry |fp| whose reading is |key| as the most recently
+  // used one. Adding the same entry again only updates its recency.
+  void Add(uint32_t fp, absl::string_view key);
+
+  void Clear();
+
+  // Returns the number of fingerprints ever added since the last Clear().
+  size_t size() const { return recency_.size(); }
+
+  // Appends the entries whose reading is a non-empty prefix of |key|.
+  void LookupPrefixesOf(absl::string_view key,
+                        std::vector<uint32_t> *fps) const;
+
+  // Appends the entries whose reading starts with |prefix|.
+  void LookupPredictive(absl::string_view prefix,
+                        std::vector<uint32_t> *fps) const;
+
+  // Appends the entries whose romanized reading may match |roman_prefix| by
+  // UserHistoryPredictor::RomanFuzzyPrefixMatch(). It allows one edit, so the
+  // candidates are the ones that match the first character of |roman_prefix|
+  // after at most one deletion, swap, or '-' substitution there.
+  void LookupRomanFuzzyCandidates(absl::string_view roman_prefix,
+                                  std::vector<uint32_t> *fps) const;
+
+  // Sorts |fps| from the most recently added and removes duplicates.
+  void SortByRecency(std::vector<uint32_t> *fps) const;
+
+ private:
+  using KeySet = absl::btree_set<std::pair<std::string, uint32_t>>;
+
+  static void LookupRange(const KeySet &keys, absl::string_view prefix,
+                          std::vector<uint32_t> *fps);
+
+  uint64_t next_recency_ = 0;
+  absl::flat_hash_map<uint32_t, uint64_t> recency_;
+  // (reading, fp)
+  KeySet keys_;
+  // (romanized reading, fp)
+  KeySet romans_;
+  // (romanized reading without the first character, fp)
+  KeySet roman_tails_;
+};
+
+}  // namespace mozc::prediction
+
+#endif  // MOZC_PREDICTION_USER_HISTORY_INDEX_H_
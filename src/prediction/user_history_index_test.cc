@@ -0,0 +1,115 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/user_history_index.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc::prediction {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+TEST(UserHistoryIndexTest, LookupByKey) {
+  UserHistoryIndex index;
+  index.Add(1, "わたし");
+  index.Add(2, "わたしの");
+  index.Add(3, "わ");
+  index.Add(4, "なまえ");
+  index.Add(5, "");
+
+  std::vector<uint32_t> fps;
+  index.LookupPrefixesOf("わたしは", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(1, 3));
+
+  fps.clear();
+  index.LookupPredictive("わた", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(1, 2));
+
+  fps.clear();
+  index.LookupPredictive("あ", &fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+TEST(UserHistoryIndexTest, LookupRomanFuzzyCandidates) {
+  UserHistoryIndex index;
+  index.Add(1, "かいしゃ");  // kaisha
+  index.Add(2, "あかい");    // akai
+  index.Add(3, "いか");      // ika
+  index.Add(4, "ーい");      // -i
+  index.Add(5, "しか");      // sika
+
+  // The candidates may contain entries that do not match, but never miss
+  // the matching ones.
+  std::vector<uint32_t> fps;
+  // "kaisha" and "ka" of "ika" by prefix, "akai" by deletion, and "-i" by
+  // substitution.
+  index.LookupRomanFuzzyCandidates("kai", &fps);
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(4, 3, 2, 1));
+
+  fps.clear();
+  // "ika" by prefix, "kaisha" by the swap of "ik", "sika" by deletion, and
+  // "-i" by substitution.
+  index.LookupRomanFuzzyCandidates("ika", &fps);
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(5, 4, 3, 1));
+
+  fps.clear();
+  index.LookupRomanFuzzyCandidates("", &fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+TEST(UserHistoryIndexTest, SortByRecency) {
+  UserHistoryIndex index;
+  index.Add(1, "a");
+  index.Add(2, "b");
+  index.Add(3, "c");
+  index.Add(1, "a");
+  EXPECT_EQ(index.size(), 3);
+
+  std::vector<uint32_t> fps = {2, 1, 3, 2, 4};
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(1, 3, 2));
+
+  index.Clear();
+  EXPECT_EQ(index.size(), 0);
+  fps = {1, 2, 3};
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+}  // namespace
+}  // namespace mozc::prediction
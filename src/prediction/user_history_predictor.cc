@@ -43,15 +43,18 @@
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/status/status.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "base/bits.h"
@@ -59,8 +62,10 @@
 #include "base/config_file_stream.h"
 #include "base/container/freelist.h"
 #include "base/container/trie.h"
+#include "base/file_util.h"
 #include "base/hash.h"
 #include "base/japanese_util.h"
+#include "base/random.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "composer/composer.h"
@@ -80,6 +85,7 @@ namespace mozc::prediction {
 namespace {
 
 using ::mozc::composer::TypeCorrectedQuery;
+using ::mozc::user_history_predictor::UserHistoryJournal;
 
 // Finds suggestion candidates from the most recent 3000 history in LRU.
 // We don't check all history, since suggestion is called every key event
@@ -120,6 +126,25 @@ constexpr absl::string_view kEmojiDescription = "絵文字";
 
 constexpr absl::Duration k62Days = absl::Hours(62 * 24);
 
+// Suffix of the journal file appended to the history file name.
+constexpr absl::string_view kJournalSuffix = ".journal";
+
+// The journal is compacted into a new snapshot when it has more records than
+// max(kMinJournalSizeToCompact, the number of entries / 2).
+constexpr size_t kMinJournalSizeToCompact = 256;
+
+// Returns the last access time before which entries are expired.
+uint64_t GetExpirationTime() {
+  const absl::Time now = Clock::GetAbslTime();
+  return absl::ToUnixSeconds(std::max(now - k62Days, absl::UnixEpoch()));
+}
+
+bool IsExpiredEntry(const UserHistoryPredictor::Entry &entry,
+                    uint64_t expiration_time) {
+  return entry.entry_type() == UserHistoryPredictor::Entry::DEFAULT_ENTRY &&
+         entry.last_access_time() < expiration_time;
+}
+
 // TODO(peria, hidehiko): Unify this checker and IsEmojiCandidate in
 //     EmojiRewriter.  If you make similar functions before the merging in
 //     case, put a similar note to avoid twisted dependency.
@@ -232,6 +257,11 @@ bool UserHistoryPredictor::IsPrivacySensitive(const Segments *segments) const {
   return kNonSensitive;
 }
 
+UserHistoryStorage::UserHistoryStorage(const absl::string_view filename)
+    : journal_filename_(absl::StrCat(filename, kJournalSuffix)),
+      storage_(filename),
+      journal_storage_(journal_filename_) {}
+
 bool UserHistoryStorage::Load() {
   std::string input;
   if (!storage_.Load(&input)) {
@@ -249,7 +279,72 @@ bool UserHistoryStorage::Load() {
       << num_deleted << " old entries were not loaded "
       << proto_.entries_size();
 
-  MOZC_VLOG(1) << "Loaded user history, size=" << proto_.entries_size();
+  if (!LoadJournal()) {
+    LOG(WARNING) << "User history journal is broken. "
+                 << journal_.records_size() << " records were loaded";
+    has_broken_journal_ = true;
+  }
+
+  MOZC_VLOG(1) << "Loaded user history, size=" << proto_.entries_size()
+               << ", journal size=" << journal_.records_size();
+  return true;
+}
+
+bool UserHistoryStorage::LoadJournal() {
+  journal_.Clear();
+  journal_.set_generation(proto_.generation());
+  if (proto_.generation() == 0) {
+    // Written by the older version, which has no journal.
+    return true;
+  }
+
+  std::vector<std::string> chunks;
+  const bool loaded = journal_storage_.LoadRecords(&chunks);
+  if (!loaded && chunks.empty() &&
+      !FileUtil::FileExists(journal_filename_).ok()) {
+    return true;
+  }
+
+  const uint64_t expiration_time = GetExpirationTime();
+  UserHistoryJournal chunk;
+  for (const std::string &input : chunks) {
+    if (!chunk.ParseFromString(input)) {
+      LOG(ERROR) << "ParseFromString failed. journal looks broken";
+      return false;
+    }
+    // Chunks of the previous snapshot remain when the journal could not be
+    // removed on Save().
+    if (chunk.generation() != proto_.generation()) {
+      continue;
+    }
+    for (UserHistoryJournal::Record &record : *chunk.mutable_records()) {
+      // Like the entries of the snapshot, the entries not accessed for 62
+      // days are deleted rather than restored.
+      if (record.type() != UserHistoryJournal::Record::DELETE &&
+          IsExpiredEntry(record.entry(), expiration_time)) {
+        record.set_type(UserHistoryJournal::Record::DELETE);
+        record.clear_entry();
+      }
+      *journal_.add_records() = std::move(record);
+    }
+  }
+  return loaded;
+}
+
+bool UserHistoryStorage::AppendJournal(
+    const UserHistoryJournal &journal) const {
+  DCHECK_NE(journal.generation(), 0);
+  std::string output;
+  if (!journal.AppendToString(&output)) {
+    LOG(ERROR) << "AppendToString failed";
+    return false;
+  }
+
+  if (!journal_storage_.Append(output)) {
+    LOG(ERROR) << "Can't append user history journal.";
+    return false;
+  }
+
   return true;
 }
 
@@ -263,6 +358,15 @@ bool UserHistoryStorage::Save() {
   LOG_IF(INFO, num_deleted > 0)
       << num_deleted << " old entries were removed before save";
 
+  // A new generation invalidates the journal of the previous snapshot even if
+  // it cannot be removed below.
+  uint64_t generation = 0;
+  Random random;
+  while (generation == 0 || generation == proto_.generation()) {
+    generation = random();
+  }
+  proto_.set_generation(generation);
+
   std::string output;
   if (!proto_.AppendToString(&output)) {
     LOG(ERROR) << "AppendToString failed";
@@ -274,6 +378,13 @@ bool UserHistoryStorage::Save() {
     return false;
   }
 
+  journal_.Clear();
+  journal_.set_generation(generation);
+  has_broken_journal_ = false;
+  if (absl::Status s = FileUtil::UnlinkIfExists(journal_filename_); !s.ok()) {
+    LOG(WARNING) << "Can't remove user history journal: " << s;
+  }
+
   return true;
 }
 
@@ -283,9 +394,7 @@ int UserHistoryStorage::DeleteEntriesBefore(uint64_t timestamp) {
   int i = 0;
   int new_size = proto_.entries_size();
   while (i < new_size) {
-    if (proto_.entries(i).entry_type() !=
-            UserHistoryPredictor::Entry::DEFAULT_ENTRY ||
-        proto_.entries(i).last_access_time() >= timestamp) {
+    if (!IsExpiredEntry(proto_.entries(i), timestamp)) {
       ++i;
       continue;
     }
@@ -305,9 +414,7 @@ int UserHistoryStorage::DeleteEntriesBefore(uint64_t timestamp) {
 }
 
 int UserHistoryStorage::DeleteEntriesUntouchedFor62Days() {
-  const absl::Time now = Clock::GetAbslTime();
-  const absl::Time timestamp = std::max(now - k62Days, absl::UnixEpoch());
-  return DeleteEntriesBefore(absl::ToUnixSeconds(timestamp));
+  return DeleteEntriesBefore(GetExpirationTime());
 }
 
 bool UserHistoryPredictor::EntryPriorityQueue::Push(Entry *entry) {
@@ -366,6 +473,7 @@ std::string UserHistoryPredictor::GetUserHistoryFileName() {
 uint16_t UserHistoryPredictor::revert_id() { return kRevertId; }
 
 void UserHistoryPredictor::WaitForSyncer() {
+  absl::MutexLock lock(&sync_mutex_);
   if (sync_.has_value()) {
     sync_->Wait();
     sync_.reset();
@@ -378,6 +486,11 @@ bool UserHistoryPredictor::Wait() {
 }
 
 bool UserHistoryPredictor::CheckSyncerAndDelete() const {
+  absl::MutexLock lock(&sync_mutex_);
+  return CheckSyncerAndDeleteLocked();
+}
+
+bool UserHistoryPredictor::CheckSyncerAndDeleteLocked() const {
   if (sync_.has_value()) {
     if (!sync_->Ready()) {
       return false;
@@ -399,7 +512,8 @@ bool UserHistoryPredictor::Reload() {
 }
 
 bool UserHistoryPredictor::AsyncLoad() {
-  if (!CheckSyncerAndDelete()) {  // now loading/saving
+  absl::MutexLock lock(&sync_mutex_);
+  if (!CheckSyncerAndDeleteLocked()) {  // now loading/saving
     return true;
   }
 
@@ -416,7 +530,8 @@ bool UserHistoryPredictor::AsyncSave() {
     return true;
   }
 
-  if (!CheckSyncerAndDelete()) {  // now loading/saving
+  absl::MutexLock lock(&sync_mutex_);
+  if (!CheckSyncerAndDeleteLocked()) {  // now loading/saving
     return true;
   }
 
@@ -441,6 +556,7 @@ bool UserHistoryPredictor::Load() {
 
 bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
   dic_->Clear();
+  index_.Clear();
   for (const Entry &entry : history.GetProto().entries()) {
     // Workaround for b/116826494: Some garbled characters are suggested
     // from user history. This filters such entries.
@@ -448,11 +564,42 @@ bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
       LOG(ERROR) << "Invalid UTF8 found in user history: " << entry;
       continue;
     }
-    dic_->Insert(EntryFingerprint(entry), entry);
+    const uint32_t fp = EntryFingerprint(entry);
+    dic_->Insert(fp, entry);
+    AddToIndex(fp, entry);
   }
 
+  const UserHistoryJournal &journal = history.GetJournal();
+  for (const UserHistoryJournal::Record &record : journal.records()) {
+    switch (record.type()) {
+      case UserHistoryJournal::Record::INSERT:
+        if (Util::IsValidUtf8(record.entry().value())) {
+          dic_->Insert(record.fp(), record.entry());
+          AddToIndex(record.fp(), record.entry());
+        }
+        break;
+      case UserHistoryJournal::Record::UPDATE:
+        // The entry may have been expired or evicted.
+        if (Entry *entry = dic_->MutableLookupWithoutInsert(record.fp());
+            entry != nullptr) {
+          *entry = record.entry();
+        }
+        break;
+      case UserHistoryJournal::Record::DELETE:
+        dic_->Erase(record.fp());
+        break;
+    }
+  }
+
+  journal_changes_.clear();
+  journal_deletions_.clear();
+  journal_generation_ = journal.generation();
+  journal_size_ = journal.records_size();
+  needs_snapshot_ = journal_generation_ == 0 || history.has_broken_journal();
+
   MOZC_VLOG(1) << "Loaded user history, size="
-               << history.GetProto().entries_size();
+               << history.GetProto().entries_size()
+               << ", journal size=" << journal_size_;
 
   return true;
 }
@@ -472,6 +619,11 @@ bool UserHistoryPredictor::Save() {
 
   const std::string filename = GetUserHistoryFileName();
 
+  if (!needs_snapshot_ && SaveJournal(filename)) {
+    updated_ = false;
+    return true;
+  }
+
   UserHistoryStorage history(filename);
   for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
     *history.GetProto().add_entries() = elm->value;
@@ -488,6 +640,57 @@ bool UserHistoryPredictor::Save() {
   return true;
 }
 
+bool UserHistoryPredictor::SaveJournal(absl::string_view filename) {
+  UserHistoryJournal journal;
+  journal.set_generation(journal_generation_);
+
+  // Erased or evicted entries. The ones inserted again are journaled as
+  // inserted below.
+  for (const uint32_t fp : journal_deletions_) {
+    if (!dic_->HasKey(fp)) {
+      UserHistoryJournal::Record *record = journal.add_records();
+      record->set_type(UserHistoryJournal::Record::DELETE);
+      record->set_fp(fp);
+    }
+  }
+
+  // Entries are replayed from the least recently used one so that the
+  // inserted ones come to the head in the same order.
+  for (const DicElement *elm = dic_->Tail(); elm != nullptr; elm = elm->prev) {
+    const auto it = journal_changes_.find(elm->key);
+    if (it == journal_changes_.end()) {
+      continue;
+    }
+    UserHistoryJournal::Record *record = journal.add_records();
+    record->set_type(it->second ? UserHistoryJournal::Record::INSERT
+                                : UserHistoryJournal::Record::UPDATE);
+    record->set_fp(elm->key);
+    *record->mutable_entry() = elm->value;
+  }
+
+  if (journal.records_size() == 0) {
+    return true;
+  }
+
+  const size_t max_journal_size =
+      std::max(kMinJournalSizeToCompact, dic_->Size() / 2);
+  if (journal_size_ + journal.records_size() > max_journal_size) {
+    MOZC_VLOG(1) << "Compacting user history journal";
+    return false;
+  }
+
+  const UserHistoryStorage history(filename);
+  if (!history.AppendJournal(journal)) {
+    LOG(ERROR) << "UserHistoryStorage::AppendJournal() failed";
+    return false;
+  }
+
+  journal_size_ += journal.records_size();
+  journal_changes_.clear();
+  journal_deletions_.clear();
+  return true;
+}
+
 bool UserHistoryPredictor::ClearAllHistory() {
   // Waits until syncer finishes
   WaitForSyncer();
@@ -496,6 +699,8 @@ bool UserHistoryPredictor::ClearAllHistory() {
   // Renews DicCache as LruCache tries to reuse the internal value by
   // using FreeList
   dic_ = std::make_unique<DicCache>(UserHistoryPredictor::cache_size());
+  index_.Clear();
+  needs_snapshot_ = true;
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -527,7 +732,7 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
 
   for (const uint32_t key : keys) {
     MOZC_VLOG(2) << "Removing: " << key;
-    if (!dic_->Erase(key)) {
+    if (!EraseFromDic(key)) {
       LOG(ERROR) << "cannot erase " << key;
     }
   }
@@ -674,6 +879,8 @@ bool UserHistoryPredictor::ClearHistoryEntry(const absl::string_view key,
     }
   }
   if (deleted) {
+    // The chains may have been cut anywhere in |dic_|.
+    needs_snapshot_ = true;
     updated_ = true;
   }
   return deleted;
@@ -1388,16 +1595,21 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
 
   const absl::Time now = Clock::GetAbslTime();
   int trial = 0;
-  for (const DicElement &elm : *dic_) {
+  for (const uint32_t fp :
+       LookupIndex(request_type, request, input_key, base_key,
+                   expanded != nullptr, roman_input_key, corrected,
+                   prev_entry)) {
     // already found enough results.
     if (results->size() >= max_results_size) {
       break;
     }
 
-    if (!IsValidEntryIgnoringRemovedField(elm.value)) {
+    // The entry may have been evicted from or erased in the cache.
+    const Entry *entry = dic_->LookupWithoutInsert(fp);
+    if (entry == nullptr || !IsValidEntryIgnoringRemovedField(*entry)) {
       continue;
     }
-    if (absl::FromUnixSeconds(elm.value.last_access_time()) + k62Days < now) {
+    if (absl::FromUnixSeconds(entry->last_access_time()) + k62Days < now) {
       updated_ = true;  // We found an entry to be deleted at next save.
       continue;
     }
@@ -1409,29 +1621,113 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
 
     // Lookup key from elm_value and prev_entry.
     // If a new entry is found, the entry is pushed to the results.
-    if (LookupEntry(request_type, input_key, base_key, expanded.get(),
-                    &(elm.value), prev_entry, results) ||
-        RomanFuzzyLookupEntry(roman_input_key, &(elm.value), results) ||
-        ZeroQueryLookupEntry(request_type, input_key, &(elm.value), prev_entry,
+    if (LookupEntry(request_type, input_key, base_key, expanded.get(), entry,
+                    prev_entry, results) ||
+        RomanFuzzyLookupEntry(roman_input_key, entry, results) ||
+        ZeroQueryLookupEntry(request_type, input_key, entry, prev_entry,
                              results)) {
       continue;
     }
 
     // Lookup typing corrected keys when the original `input_key` doesn't match.
-    // Since dic_ is sorted in LRU, typing corrected queries are ranked lower
-    // than the original key.
+    // Since the candidates are sorted in LRU, typing corrected queries are
+    // ranked lower than the original key.
     for (const auto &c : corrected) {
       // Only apply when score > 0. When score < 0, we trigger literal-on-top
       // in dictionary predictor.
       if (c.score > 0.0 &&
-          LookupEntry(request_type, c.correction, c.correction, nullptr,
-                      &(elm.value), prev_entry, results)) {
+          LookupEntry(request_type, c.correction, c.correction, nullptr, entry,
+                      prev_entry, results)) {
         break;
       }
     }
   }
 }
 
+std::vector<uint32_t> UserHistoryPredictor::LookupIndex(
+    RequestType request_type, const ConversionRequest &request,
+    absl::string_view input_key, absl::string_view base_key,
+    bool has_expanded, absl::string_view roman_input_key,
+    const std::vector<TypeCorrectedQuery> &corrected,
+    const Entry *prev_entry) const {
+  std::vector<uint32_t> fps;
+
+  // LookupEntry() matches the entries whose key is a prefix of |base_key| or
+  // starts with it. The expanded keys are only checked after |base_key|.
+  if (!base_key.empty()) {
+    index_.LookupPrefixesOf(base_key, &fps);
+    index_.LookupPredictive(base_key, &fps);
+  } else if (has_expanded) {
+    const auto [query_base, expanded_set] =
+        request.composer().GetQueriesForPrediction();
+    for (absl::string_view expanded_key : expanded_set) {
+      index_.LookupPredictive(expanded_key, &fps);
+    }
+  } else if (prev_entry != nullptr) {
+    // Zero query suggestion from the bigrams of |prev_entry|.
+    for (const NextEntry &next_entry : prev_entry->next_entries()) {
+      fps.push_back(next_entry.entry_fp());
+    }
+  }
+
+  // RomanFuzzyLookupEntry()
+  index_.LookupRomanFuzzyCandidates(roman_input_key, &fps);
+
+  // ZeroQueryLookupEntry()
+  if (prev_entry != nullptr && aggressive_bigram_enabled_ &&
+      request_type == ZERO_QUERY_SUGGESTION && input_key.empty()) {
+    index_.LookupPredictive(prev_entry->key(), &fps);
+  }
+
+  // LookupEntry() with the typing corrected keys.
+  for (const TypeCorrectedQuery &c : corrected) {
+    if (c.score > 0.0 && !c.correction.empty()) {
+      index_.LookupPrefixesOf(c.correction, &fps);
+      index_.LookupPredictive(c.correction, &fps);
+    }
+  }
+
+  index_.SortByRecency(&fps);
+  return fps;
+}
+
+void UserHistoryPredictor::AddToIndex(uint32_t fp, const Entry &entry) {
+  if (index_.size() >= 2 * UserHistoryPredictor::cache_size()) {
+    RebuildIndex();
+  }
+  index_.Add(fp, entry.key());
+  journal_changes_[fp] = true;
+}
+
+void UserHistoryPredictor::MarkUpdated(uint32_t fp) {
+  // Keeps the entry promoted if it is not yet journaled.
+  journal_changes_.try_emplace(fp, false);
+}
+
+UserHistoryPredictor::DicElement *UserHistoryPredictor::InsertToDic(
+    uint32_t fp) {
+  if (dic_->Size() >= UserHistoryPredictor::cache_size() &&
+      !dic_->HasKey(fp) && dic_->Tail() != nullptr) {
+    journal_deletions_.insert(dic_->Tail()->key);
+  }
+  return dic_->Insert(fp);
+}
+
+bool UserHistoryPredictor::EraseFromDic(uint32_t fp) {
+  if (!dic_->Erase(fp)) {
+    return false;
+  }
+  journal_deletions_.insert(fp);
+  return true;
+}
+
+void UserHistoryPredictor::RebuildIndex() {
+  index_.Clear();
+  for (const DicElement *elm = dic_->Tail(); elm != nullptr; elm = elm->prev) {
+    index_.Add(elm->key, elm->value.key());
+  }
+}
+
 // static
 void UserHistoryPredictor::GetInputKeyFromSegments(
     const ConversionRequest &request, const Segments &segments,
@@ -1730,7 +2026,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   const uint32_t dic_key = Fingerprint("", "", type);
 
   CHECK(dic_.get());
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key);
   if (e == nullptr) {
     MOZC_VLOG(2) << "insert failed";
     return;
@@ -1741,6 +2037,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   entry->Clear();
   entry->set_entry_type(type);
   entry->set_last_access_time(last_access_time);
+  AddToIndex(dic_key, *entry);
 }
 
 bool UserHistoryPredictor::ShouldInsert(
@@ -1797,7 +2094,7 @@ void UserHistoryPredictor::Insert(std::string key, std::string value,
     // add a treatment for UPDATE_ENTRY mode
   }
 
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key);
   if (e == nullptr) {
     MOZC_VLOG(2) << "insert failed";
     return;
@@ -1832,6 +2129,7 @@ void UserHistoryPredictor::Insert(std::string key, std::string value,
 
   MOZC_VLOG(2) << entry->key() << " " << entry->value()
                << " has been inserted: " << *entry;
+  AddToIndex(dic_key, *entry);
 
   // New entry is inserted to the cache
   updated_ = true;
@@ -1858,6 +2156,7 @@ void UserHistoryPredictor::MaybeRemoveUnselectedHistory(
     // Note(b/339742825): For now shown freq is only used here and it's OK to
     // increment the value here.
     entry->set_shown_freq(entry->shown_freq() + 1);
+    MarkUpdated(Fingerprint(candidate.key, candidate.value));
 
     const float selected_ratio =
         1.0 * std::max(entry->suggestion_freq(), entry->conversion_freq()) /
@@ -2066,9 +2365,10 @@ void UserHistoryPredictor::InsertHistory(RequestType request_type,
          Util::CharsLen(conversion_segment.value) > 1)) {
       return;
     }
-    Entry *history_entry = dic_->MutableLookupWithoutInsert(
-        LearningSegmentFingerprint(history_segment));
+    const uint32_t history_fp = LearningSegmentFingerprint(history_segment);
+    Entry *history_entry = dic_->MutableLookupWithoutInsert(history_fp);
     if (history_entry) {
+      MarkUpdated(history_fp);
       NextEntry next_entry;
       if (!is_suggestion_selected) {
         for (const auto next_fp :
@@ -2146,7 +2446,7 @@ void UserHistoryPredictor::Revert(Segments *segments) {
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
       const uint32_t key = LoadUnaligned<uint32_t>(revert_entry.key.data());
       MOZC_VLOG(2) << "Erasing the key: " << key;
-      dic_->Erase(key);
+      EraseFromDic(key);
     }
   }
 }
@@ -40,8 +40,11 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "base/container/freelist.h"
 #include "base/container/trie.h"
 #include "base/thread.h"
@@ -51,6 +54,7 @@
 #include "dictionary/pos_matcher.h"
 #include "engine/modules.h"
 #include "prediction/predictor_interface.h"
+#include "prediction/user_history_index.h"
 #include "prediction/user_history_predictor.pb.h"
 #include "request/conversion_request.h"
 #include "storage/encrypted_string_storage.h"
@@ -62,15 +66,20 @@ namespace mozc::prediction {
 // Added serialization method for UserHistory.
 class UserHistoryStorage {
  public:
-  explicit UserHistoryStorage(const absl::string_view filename)
-      : storage_(filename) {}
+  explicit UserHistoryStorage(const absl::string_view filename);
 
-  // Loads from encrypted file.
+  // Loads the snapshot and its journal from encrypted files.
   bool Load();
 
-  // Saves history into encrypted file.
+  // Saves history into encrypted file as a new snapshot, and discards the
+  // journal of the previous one.
   bool Save();
 
+  // Appends |journal| to the journal file. The generation of |journal| must be
+  // the one of the snapshot on the disk, otherwise it is ignored on Load().
+  bool AppendJournal(
+      const mozc::user_history_predictor::UserHistoryJournal &journal) const;
+
   // Deletes entries before the given timestamp.  Returns the number of deleted
   // entries.
   int DeleteEntriesBefore(uint64_t timestamp);
@@ -84,9 +93,24 @@ class UserHistoryStorage {
     return proto_;
   }
 
+  // Returns the journal records loaded for the snapshot.
+  const mozc::user_history_predictor::UserHistoryJournal &GetJournal() const {
+    return journal_;
+  }
+
+  // Returns true if the journal file has a broken record. Records appended
+  // after it are never loaded, so the next save should be a snapshot.
+  bool has_broken_journal() const { return has_broken_journal_; }
+
  private:
+  bool LoadJournal();
+
+  std::string journal_filename_;
   storage::EncryptedStringStorage storage_;
+  storage::EncryptedStringStorage journal_storage_;
   mozc::user_history_predictor::UserHistory proto_;
+  mozc::user_history_predictor::UserHistoryJournal journal_;
+  bool has_broken_journal_ = false;
 };
 
 // UserHistoryPredictor is NOT thread safe.
@@ -263,9 +287,15 @@ class UserHistoryPredictor : public PredictorInterface {
   // Loads user history data to an on-memory LRU.
   bool Load(const UserHistoryStorage &history);
 
-  // Saves user history data in LRU to local file
+  // Saves user history data in LRU to local file. Appends the changes since
+  // the last load or save to the journal when possible, and writes a new
+  // snapshot otherwise.
   bool Save();
 
+  // Appends the changes since the last load or save to the journal. Returns
+  // false if a snapshot should be written instead.
+  bool SaveJournal(absl::string_view filename);
+
   // non-blocking version of Load
   // This makes a new thread and call Load()
   bool AsyncSave();
@@ -351,6 +381,37 @@ class UserHistoryPredictor : public PredictorInterface {
   using DicElement = DicCache::Element;
 
   bool CheckSyncerAndDelete() const;
+  bool CheckSyncerAndDeleteLocked() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(sync_mutex_);
+
+  // Registers the entry |fp| in |dic_| to |index_| as the most recently used
+  // one and marks it to be journaled. Rebuilds |index_| when it has too many
+  // evicted or erased entries.
+  void AddToIndex(uint32_t fp, const Entry &entry);
+
+  // Marks the entry |fp| in |dic_| to be journaled after it was modified in
+  // place without changing its position in the LRU.
+  void MarkUpdated(uint32_t fp);
+
+  // Inserts |fp| to |dic_| like DicCache::Insert(), and marks the entry
+  // evicted by the insertion to be journaled.
+  DicElement *InsertToDic(uint32_t fp);
+
+  // Erases |fp| from |dic_| and marks it to be journaled. Returns false if it
+  // is not in |dic_|.
+  bool EraseFromDic(uint32_t fp);
+
+  // Rebuilds |index_| from the entries in |dic_|.
+  void RebuildIndex();
+
+  // Returns the fingerprints of the entries which may match the input in
+  // GetResultsFromHistoryDictionary(), from the most recently used.
+  std::vector<uint32_t> LookupIndex(
+      RequestType request_type, const ConversionRequest &request,
+      absl::string_view input_key, absl::string_view base_key,
+      bool has_expanded, absl::string_view roman_input_key,
+      const std::vector<::mozc::composer::TypeCorrectedQuery> &corrected,
+      const Entry *prev_entry) const;
 
   // If |entry| is the target of prediction,
   // create a new result and insert it to |results|.
@@ -512,7 +573,21 @@ class UserHistoryPredictor : public PredictorInterface {
   bool content_word_learning_enabled_;
   mutable std::atomic<bool> updated_;
   std::unique_ptr<DicCache> dic_;
-  mutable std::optional<BackgroundFuture<void>> sync_;
+  UserHistoryIndex index_;
+
+  // Journal state. |journal_changes_| maps the fingerprints of the entries
+  // modified after the last load or save to true if they were moved to the
+  // head of |dic_|. |journal_deletions_| is the set of the entries erased or
+  // evicted after the last load or save.
+  absl::flat_hash_map<uint32_t, bool> journal_changes_;
+  absl::flat_hash_set<uint32_t> journal_deletions_;
+  uint64_t journal_generation_ = 0;
+  size_t journal_size_ = 0;
+  bool needs_snapshot_ = true;
+  // Guards `sync_`, which is checked by the concurrent lookups.
+  mutable absl::Mutex sync_mutex_;
+  mutable std::optional<BackgroundFuture<void>> sync_
+      ABSL_GUARDED_BY(sync_mutex_);
   const engine::Modules &modules_;
 
   mutable std::atomic<bool> aggressive_bigram_enabled_ = false;
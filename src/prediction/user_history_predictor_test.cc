@@ -43,6 +43,7 @@
 
 #include "absl/log/check.h"
 #include "absl/random/random.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
@@ -191,11 +192,12 @@ class UserHistoryPredictorTest : public testing::TestWithTempUserProfile {
   static UserHistoryPredictor::Entry *InsertEntry(
       UserHistoryPredictor *predictor, const absl::string_view key,
       const absl::string_view value) {
-    UserHistoryPredictor::Entry *e =
-        &predictor->dic_->Insert(predictor->Fingerprint(key, value))->value;
+    const uint32_t fp = predictor->Fingerprint(key, value);
+    UserHistoryPredictor::Entry *e = &predictor->dic_->Insert(fp)->value;
     e->set_key(std::string(key));
     e->set_value(std::string(value));
     e->set_removed(false);
+    predictor->AddToIndex(fp, *e);
     return e;
   }
 
@@ -211,6 +213,16 @@ class UserHistoryPredictorTest : public testing::TestWithTempUserProfile {
     return predictor.dic_->Size();
   }
 
+  // Returns the serialized entries in the LRU order.
+  static std::vector<std::string> GetSerializedEntries(
+      const UserHistoryPredictor &predictor) {
+    std::vector<std::string> entries;
+    for (const auto &elm : *predictor.dic_) {
+      entries.push_back(elm.value.SerializeAsString());
+    }
+    return entries;
+  }
+
   static bool LoadStorage(UserHistoryPredictor *predictor,
                           const UserHistoryStorage &history) {
     return predictor->Load(history);
@@ -2588,6 +2600,157 @@ TEST_F(UserHistoryPredictorTest, UserHistoryStorageContainingInvalidEntries) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, JournalIsReplayedOnLoad) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  const std::string filename = UserHistoryPredictor::GetUserHistoryFileName();
+  const std::string journal_filename = absl::StrCat(filename, ".journal");
+
+  // The first save after clearing the history writes a snapshot.
+  Segments segments;
+  const ConversionRequest convreq1 = SetUpInputForConversion(
+      "わたしのなまえはなかのです", &composer_, &segments);
+  AddCandidate("私の名前は中野です", &segments);
+  predictor->Finish(convreq1, &segments);
+  ASSERT_TRUE(predictor->Sync());
+  WaitForSyncer(predictor);
+  EXPECT_FALSE(FileUtil::FileExists(journal_filename).ok());
+
+  // The following changes are appended to the journal.
+  segments.Clear();
+  const ConversionRequest convreq2 = SetUpInputForConversion(
+      "わたしのなまえはたかはしです", &composer_, &segments);
+  AddCandidate("私の名前は高橋です", &segments);
+  predictor->Finish(convreq2, &segments);
+  ASSERT_TRUE(predictor->Sync());
+  WaitForSyncer(predictor);
+  EXPECT_OK(FileUtil::FileExists(journal_filename));
+
+  const std::vector<std::string> expected = GetSerializedEntries(*predictor);
+  {
+    UserHistoryStorage storage(filename);
+    ASSERT_TRUE(storage.Load());
+    EXPECT_GT(storage.GetJournal().records_size(), 0);
+    EXPECT_FALSE(storage.has_broken_journal());
+    EXPECT_TRUE(LoadStorage(predictor, storage));
+  }
+  EXPECT_EQ(GetSerializedEntries(*predictor), expected);
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は中野です"));
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は高橋です"));
+
+  // Clearing the history writes a new snapshot and discards the journal.
+  predictor->ClearAllHistory();
+  WaitForSyncer(predictor);
+  EXPECT_FALSE(FileUtil::FileExists(journal_filename).ok());
+}
+
+TEST_F(UserHistoryPredictorTest, TornJournalRecordForcesSnapshot) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  const std::string filename = UserHistoryPredictor::GetUserHistoryFileName();
+  const std::string journal_filename = absl::StrCat(filename, ".journal");
+
+  Segments segments;
+  const ConversionRequest convreq1 = SetUpInputForConversion(
+      "わたしのなまえはなかのです", &composer_, &segments);
+  AddCandidate("私の名前は中野です", &segments);
+  predictor->Finish(convreq1, &segments);
+  ASSERT_TRUE(predictor->Sync());
+  WaitForSyncer(predictor);
+
+  segments.Clear();
+  const ConversionRequest convreq2 = SetUpInputForConversion(
+      "わたしのなまえはたかはしです", &composer_, &segments);
+  AddCandidate("私の名前は高橋です", &segments);
+  predictor->Finish(convreq2, &segments);
+  ASSERT_TRUE(predictor->Sync());
+  WaitForSyncer(predictor);
+  ASSERT_OK(FileUtil::FileExists(journal_filename));
+
+  // A record torn at a crash, followed by a valid record appended later.
+  absl::StatusOr<std::string> contents =
+      FileUtil::GetContents(journal_filename);
+  ASSERT_OK(contents);
+  contents->append(std::string("\x00\x00\x01\x00torn", 8));
+  ASSERT_OK(FileUtil::SetContents(journal_filename, *contents));
+  {
+    UserHistoryStorage storage(filename);
+    ASSERT_TRUE(storage.Load());
+    user_history_predictor::UserHistoryJournal journal;
+    journal.set_generation(storage.GetProto().generation());
+    UserHistoryPredictor::Entry *entry =
+        journal.add_records()->mutable_entry();
+    entry->set_key("key");
+    entry->set_value("value");
+    ASSERT_TRUE(storage.AppendJournal(journal));
+  }
+
+  // The records before the torn one are loaded, and the corruption is
+  // reported.
+  {
+    UserHistoryStorage storage(filename);
+    ASSERT_TRUE(storage.Load());
+    EXPECT_TRUE(storage.has_broken_journal());
+    EXPECT_GT(storage.GetJournal().records_size(), 0);
+    EXPECT_TRUE(LoadStorage(predictor, storage));
+  }
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は中野です"));
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は高橋です"));
+
+  // The next save writes a snapshot instead of appending after the torn
+  // record, so the following changes are not lost.
+  segments.Clear();
+  const ConversionRequest convreq3 = SetUpInputForConversion(
+      "わたしのなまえはすずきです", &composer_, &segments);
+  AddCandidate("私の名前は鈴木です", &segments);
+  predictor->Finish(convreq3, &segments);
+  ASSERT_TRUE(predictor->Sync());
+  WaitForSyncer(predictor);
+  EXPECT_FALSE(FileUtil::FileExists(journal_filename).ok());
+  {
+    UserHistoryStorage storage(filename);
+    ASSERT_TRUE(storage.Load());
+    EXPECT_FALSE(storage.has_broken_journal());
+    EXPECT_TRUE(LoadStorage(predictor, storage));
+  }
+  EXPECT_TRUE(IsSuggested(predictor, "わたしの", "私の名前は鈴木です"));
+}
+
+TEST_F(UserHistoryPredictorTest, JournalDoesNotRestoreOldEntries) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1));
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string filename = FileUtil::JoinPath(temp_dir.path(), "history");
+
+  auto add_entry = [&clock](absl::string_view value,
+                            UserHistoryPredictor::Entry *entry) {
+    entry->set_key("key");
+    entry->set_value(value);
+    entry->set_last_access_time(absl::ToUnixSeconds(clock->GetAbslTime()));
+  };
+
+  user_history_predictor::UserHistoryJournal journal;
+  {
+    UserHistoryStorage storage(filename);
+    add_entry("old_value", journal.add_records()->mutable_entry());
+    clock->Advance(absl::Hours(24 * 63));
+    add_entry("new_value", storage.GetProto().add_entries());
+    ASSERT_TRUE(storage.Save());
+    add_entry("new_value2", journal.add_records()->mutable_entry());
+    journal.set_generation(storage.GetProto().generation());
+    ASSERT_TRUE(storage.AppendJournal(journal));
+  }
+
+  UserHistoryStorage storage(filename);
+  ASSERT_TRUE(storage.Load());
+  ASSERT_EQ(storage.GetJournal().records_size(), 2);
+  EXPECT_EQ(storage.GetJournal().records(0).type(),
+            user_history_predictor::UserHistoryJournal::Record::DELETE);
+  EXPECT_EQ(storage.GetJournal().records(1).type(),
+            user_history_predictor::UserHistoryJournal::Record::INSERT);
+
+  UserHistoryPredictor *predictor = GetUserHistoryPredictor();
+  EXPECT_TRUE(LoadStorage(predictor, storage));
+  EXPECT_EQ(EntrySize(*predictor), 2);
+}
+
 TEST_F(UserHistoryPredictorTest, RomanFuzzyPrefixMatch) {
   // same
   EXPECT_FALSE(UserHistoryPredictor::RomanFuzzyPrefixMatch("abc", "abc"));
@@ -49,6 +49,9 @@ class EnglishVariantsRewriter : public RewriterInterface {
   ~EnglishVariantsRewriter() override = default;
 
   int capability(const ConversionRequest &request) const override;
+  int required_segments_properties() const override {
+    return RewriterInterface::HAS_ENGLISH_CANDIDATE;
+  }
 
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
@@ -34,10 +34,12 @@
 #include <iterator>
 #include <string>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/civil_time.h"
 #include "absl/time/time.h"
 #include "base/clock.h"
@@ -74,7 +76,10 @@ class FortuneData {
     ChangeFortune();
   }
 
-  void ChangeFortune() {
+  // Draws a new fortune once a day and returns the current one. Called by the
+  // concurrent conversions.
+  FortuneType ChangeFortune() {
+    absl::MutexLock lock(&mutex_);
     const int *levels = kNormalLevels;
 
     const absl::Time at = Clock::GetAbslTime();
@@ -83,7 +88,7 @@ class FortuneData {
 
     // Modify once per one day
     if (today == last_updated_day_) {
-      return;
+      return fortune_type_;
     }
     last_updated_day_ = today;
 
@@ -106,14 +111,14 @@ class FortuneData {
       }
     }
     DCHECK(IsValidFortuneType(fortune_type_));
+    return fortune_type_;
   }
 
-  FortuneType fortune_type() const { return fortune_type_; }
-
  private:
-  FortuneType fortune_type_;
-  absl::CivilDay last_updated_day_;
-  absl::BitGen gen_;
+  absl::Mutex mutex_;
+  FortuneType fortune_type_ ABSL_GUARDED_BY(mutex_);
+  absl::CivilDay last_updated_day_ ABSL_GUARDED_BY(mutex_);
+  absl::BitGen gen_ ABSL_GUARDED_BY(mutex_);
 };
 
 // Insert Fortune message into the |segment|
@@ -195,11 +200,10 @@ bool FortuneRewriter::Rewrite(const ConversionRequest &request,
   if (key != "おみくじ") {
     return false;
   }
-  FortuneData *fortune_data = Singleton<FortuneData>::get();
-  fortune_data->ChangeFortune();
+  const FortuneType fortune_type =
+      Singleton<FortuneData>::get()->ChangeFortune();
   // Insert a fortune candidate into the last of all candidates.
-  return InsertCandidate(fortune_data->fortune_type(),
-                         segment.candidates_size(),
+  return InsertCandidate(fortune_type, segment.candidates_size(),
                          segments->mutable_conversion_segment(0));
 }
 }  // namespace mozc
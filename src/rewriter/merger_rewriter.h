@@ -33,15 +33,20 @@
 #include <cstddef>
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/latency_stats.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/rewriter_util.h"
 
 namespace mozc {
 
@@ -53,8 +58,15 @@ class MergerRewriter : public RewriterInterface {
   MergerRewriter(const MergerRewriter &) = delete;
   MergerRewriter &operator=(const MergerRewriter &) = delete;
 
-  void AddRewriter(std::unique_ptr<RewriterInterface> rewriter) {
+  // `name` identifies the rewriter in LatencyStats. Unnamed rewriters are
+  // identified by their position.
+  void AddRewriter(std::unique_ptr<RewriterInterface> rewriter,
+                   absl::string_view name = "") {
     DCHECK(rewriter);
+    stage_names_.push_back(
+        name.empty() ? absl::StrCat("rewriter/#", rewriters_.size())
+                     : absl::StrCat("rewriter/", name));
+    required_properties_.push_back(rewriter->required_segments_properties());
     rewriters_.push_back(std::move(rewriter));
   }
 
@@ -97,9 +109,26 @@ class MergerRewriter : public RewriterInterface {
     }();
 
     bool is_updated = false;
-    for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
-      if (rewriter->capability(request) & capability_type) {
-        is_updated |= rewriter->Rewrite(request, segments);
+    // The properties of `segments`, computed on demand and invalidated
+    // whenever a rewriter updates the segments.
+    std::optional<int> properties;
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      const RewriterInterface &rewriter = *rewriters_[i];
+      if (!(rewriter.capability(request) & capability_type)) {
+        continue;
+      }
+      if (const int required = required_properties_[i]; required != 0) {
+        if (!properties.has_value()) {
+          properties = RewriterUtil::GetSegmentsProperties(*segments);
+        }
+        if ((*properties & required) != required) {
+          continue;
+        }
+      }
+      ScopedLatencyTimer timer(stage_names_[i]);
+      if (rewriter.Rewrite(request, segments)) {
+        is_updated = true;
+        properties.reset();
       }
     }
 
@@ -181,6 +210,10 @@ class MergerRewriter : public RewriterInterface {
 
  private:
   std::vector<std::unique_ptr<RewriterInterface>> rewriters_;
+  // LatencyStats stage names and required_segments_properties(), parallel to
+  // `rewriters_`.
+  std::vector<std::string> stage_names_;
+  std::vector<int> required_properties_;
 };
 
 }  // namespace mozc
@@ -108,6 +108,42 @@ class TestRewriter : public RewriterInterface {
   int capability_;
 };
 
+// Requires `properties` and adds a candidate of `value_to_add` if not empty.
+class PropertyRewriter : public RewriterInterface {
+ public:
+  PropertyRewriter(std::string *buffer, const absl::string_view name,
+                   int properties, const absl::string_view value_to_add)
+      : buffer_(buffer),
+        name_(name),
+        properties_(properties),
+        value_to_add_(value_to_add) {}
+
+  int capability(const ConversionRequest &request) const override {
+    return RewriterInterface::ALL;
+  }
+
+  int required_segments_properties() const override { return properties_; }
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    buffer_->append(name_ + ".Rewrite();");
+    if (value_to_add_.empty()) {
+      return false;
+    }
+    Segment::Candidate *candidate =
+        segments->mutable_conversion_segment(0)->add_candidate();
+    candidate->value = value_to_add_;
+    candidate->content_value = value_to_add_;
+    return true;
+  }
+
+ private:
+  std::string *buffer_;
+  const std::string name_;
+  const int properties_;
+  const std::string value_to_add_;
+};
+
 class MergerRewriterTest : public testing::TestWithTempUserProfile {};
 
 ConversionRequest ConvReq(ConversionRequest::RequestType request_type) {
@@ -264,6 +300,47 @@ TEST_F(MergerRewriterTest, RewriteCheckTest) {
   call_result.clear();
 }
 
+TEST_F(MergerRewriterTest, RequiredSegmentsProperties) {
+  std::string call_result;
+  MergerRewriter merger;
+  merger.AddRewriter(std::make_unique<PropertyRewriter>(
+      &call_result, "number", RewriterInterface::HAS_NUMBER_CANDIDATE, ""));
+  merger.AddRewriter(
+      std::make_unique<PropertyRewriter>(&call_result, "add", 0, "mozc"));
+  merger.AddRewriter(std::make_unique<PropertyRewriter>(
+      &call_result, "english", RewriterInterface::HAS_ENGLISH_CANDIDATE, ""));
+  merger.AddRewriter(std::make_unique<PropertyRewriter>(
+      &call_result, "both",
+      RewriterInterface::HAS_NUMBER_CANDIDATE |
+          RewriterInterface::HAS_ENGLISH_CANDIDATE,
+      ""));
+
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("もず");
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->value = "もず";
+  candidate->content_value = "もず";
+
+  // The properties are recomputed after "add" adds an English candidate.
+  const ConversionRequest request = ConvReq(ConversionRequest::CONVERSION);
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_EQ(call_result,
+            "add.Rewrite();"
+            "english.Rewrite();");
+  call_result.clear();
+
+  candidate = segment->add_candidate();
+  candidate->value = "百舌鳥";
+  candidate->content_value = "百舌鳥";
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_EQ(call_result,
+            "number.Rewrite();"
+            "add.Rewrite();"
+            "english.Rewrite();"
+            "both.Rewrite();");
+}
+
 TEST_F(MergerRewriterTest, Focus) {
   std::string call_result;
   MergerRewriter merger;
@@ -52,6 +52,9 @@ class NumberRewriter : public RewriterInterface {
   ~NumberRewriter() override;
 
   int capability(const ConversionRequest &request) const override;
+  int required_segments_properties() const override {
+    return RewriterInterface::HAS_NUMBER_CANDIDATE;
+  }
 
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
@@ -134,56 +134,70 @@ Rewriter::Rewriter(const engine::Modules &modules) {
   const dictionary::PosGroup &pos_group = modules.GetPosGroup();
 
 #ifdef MOZC_USER_DICTIONARY_REWRITER
-  AddRewriter(std::make_unique<UserDictionaryRewriter>());
+  AddRewriter(std::make_unique<UserDictionaryRewriter>(), "UserDictionary");
 #endif  // MOZC_USER_DICTIONARY_REWRITER
 
-  AddRewriter(std::make_unique<FocusCandidateRewriter>(data_manager));
-  AddRewriter(std::make_unique<LanguageAwareRewriter>(pos_matcher, dictionary));
-  AddRewriter(std::make_unique<TransliterationRewriter>(pos_matcher));
-  AddRewriter(std::make_unique<EnglishVariantsRewriter>(pos_matcher));
-  AddRewriter(std::make_unique<NumberRewriter>(data_manager));
-  AddRewriter(CollocationRewriter::Create(data_manager));
-  AddRewriter(std::make_unique<SingleKanjiRewriter>(data_manager));
-  AddRewriter(std::make_unique<IvsVariantsRewriter>());
-  AddRewriter(std::make_unique<EmojiRewriter>(data_manager));
-  AddRewriter(EmoticonRewriter::CreateFromDataManager(data_manager));
-  AddRewriter(std::make_unique<CalculatorRewriter>());
-  AddRewriter(std::make_unique<SymbolRewriter>(data_manager));
-  AddRewriter(std::make_unique<UnicodeRewriter>());
-  AddRewriter(std::make_unique<VariantsRewriter>(pos_matcher));
-  AddRewriter(std::make_unique<ZipcodeRewriter>(pos_matcher));
-  AddRewriter(std::make_unique<DiceRewriter>());
-  AddRewriter(std::make_unique<SmallLetterRewriter>());
+  AddRewriter(std::make_unique<FocusCandidateRewriter>(data_manager),
+              "FocusCandidate");
+  AddRewriter(std::make_unique<LanguageAwareRewriter>(pos_matcher, dictionary),
+              "LanguageAware");
+  AddRewriter(std::make_unique<TransliterationRewriter>(pos_matcher),
+              "Transliteration");
+  AddRewriter(std::make_unique<EnglishVariantsRewriter>(pos_matcher),
+              "EnglishVariants");
+  AddRewriter(std::make_unique<NumberRewriter>(data_manager), "Number");
+  AddRewriter(CollocationRewriter::Create(data_manager), "Collocation");
+  AddRewriter(std::make_unique<SingleKanjiRewriter>(data_manager),
+              "SingleKanji");
+  AddRewriter(std::make_unique<IvsVariantsRewriter>(), "IvsVariants");
+  AddRewriter(std::make_unique<EmojiRewriter>(data_manager), "Emoji");
+  AddRewriter(EmoticonRewriter::CreateFromDataManager(data_manager),
+              "Emoticon");
+  AddRewriter(std::make_unique<CalculatorRewriter>(), "Calculator");
+  AddRewriter(std::make_unique<SymbolRewriter>(data_manager), "Symbol");
+  AddRewriter(std::make_unique<UnicodeRewriter>(), "Unicode");
+  AddRewriter(std::make_unique<VariantsRewriter>(pos_matcher), "Variants");
+  AddRewriter(std::make_unique<ZipcodeRewriter>(pos_matcher), "Zipcode");
+  AddRewriter(std::make_unique<DiceRewriter>(), "Dice");
+  AddRewriter(std::make_unique<SmallLetterRewriter>(), "SmallLetter");
 
   if (absl::GetFlag(FLAGS_use_history_rewriter)) {
-    AddRewriter(std::make_unique<UserBoundaryHistoryRewriter>());
+    AddRewriter(std::make_unique<UserBoundaryHistoryRewriter>(),
+                "UserBoundaryHistory");
     AddRewriter(
-        std::make_unique<UserSegmentHistoryRewriter>(pos_matcher, pos_group));
+        std::make_unique<UserSegmentHistoryRewriter>(pos_matcher, pos_group),
+        "UserSegmentHistory");
   }
 
 #ifdef MOZC_DATE_REWRITER
-  AddRewriter(std::make_unique<DateRewriter>(dictionary));
+  AddRewriter(std::make_unique<DateRewriter>(dictionary), "Date");
 #endif  // MOZC_DATE_REWRITER
 
 #ifdef MOZC_FORTUNE_REWRITER
-  AddRewriter(std::make_unique<FortuneRewriter>());
+  AddRewriter(std::make_unique<FortuneRewriter>(), "Fortune");
 #endif  // MOZC_FORTUNE_REWRITER
 
 #ifdef MOZC_COMMAND_REWRITER
-  AddRewriter(std::make_unique<CommandRewriter>());
+  AddRewriter(std::make_unique<CommandRewriter>(), "Command");
 #endif  // MOZC_COMMAND_REWRITER
 
 #ifdef MOZC_USAGE_REWRITER
-  AddRewriter(std::make_unique<UsageRewriter>(data_manager, dictionary));
+  AddRewriter(std::make_unique<UsageRewriter>(data_manager, dictionary),
+              "Usage");
 #endif  // MOZC_USAGE_REWRITER
 
-  AddRewriter(std::make_unique<VersionRewriter>(data_manager.GetDataVersion()));
-  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager));
-  AddRewriter(std::make_unique<T13nPromotionRewriter>());
-  AddRewriter(std::make_unique<EnvironmentalFilterRewriter>(data_manager));
-  AddRewriter(std::make_unique<RemoveRedundantCandidateRewriter>());
-  AddRewriter(std::make_unique<OrderRewriter>());
-  AddRewriter(std::make_unique<A11yDescriptionRewriter>(data_manager));
+  AddRewriter(std::make_unique<VersionRewriter>(data_manager.GetDataVersion()),
+              "Version");
+  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager),
+              "Correction");
+  AddRewriter(std::make_unique<T13nPromotionRewriter>(), "T13nPromotion");
+  AddRewriter(std::make_unique<EnvironmentalFilterRewriter>(data_manager),
+              "EnvironmentalFilter");
+  AddRewriter(std::make_unique<RemoveRedundantCandidateRewriter>(),
+              "RemoveRedundantCandidate");
+  AddRewriter(std::make_unique<OrderRewriter>(), "Order");
+  AddRewriter(std::make_unique<A11yDescriptionRewriter>(data_manager),
+              "A11yDescription");
 }
 
 }  // namespace mozc
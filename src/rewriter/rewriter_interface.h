@@ -59,6 +59,23 @@ class RewriterInterface {
     return CONVERSION;
   }
 
+  // Cheap properties of the conversion segments that MergerRewriter computes
+  // at most once per Segments, see RewriterUtil::GetSegmentsProperties().
+  enum SegmentsProperty {
+    // Some candidate has a content value starting with a number character,
+    // i.e. an Arabic digit or a Kanji numeral.
+    HAS_NUMBER_CANDIDATE = 1,
+    // Some candidate has a content value that is an English word.
+    // See Util::IsEnglishTransliteration().
+    HAS_ENGLISH_CANDIDATE = 2,
+  };
+
+  // Returns the SegmentsProperty bits that segments must all have for
+  // Rewrite() to modify them. MergerRewriter skips this rewriter for the
+  // segments lacking any of them, so the rewriter doesn't need to scan the
+  // candidates only to find nothing to do.
+  virtual int required_segments_properties() const { return 0; }
+
   struct ResizeSegmentsRequest {
     // Position of the segment to be resized.
     size_t segment_index = 0;
@@ -75,6 +92,7 @@ class RewriterInterface {
     return std::nullopt;
   }
 
+  // Returns true if `segments` are modified.
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
@@ -31,10 +31,33 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <string>
 
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "base/number_util.h"
+#include "base/util.h"
 #include "converter/segments.h"
+#include "rewriter/rewriter_interface.h"
 
 namespace mozc {
+namespace {
+
+// Returns true if `value` starts with a character that
+// NumberUtil::NormalizeNumbers() reads as a number.
+bool StartsWithNumber(absl::string_view value) {
+  char32_t c;
+  absl::string_view rest;
+  if (!Util::SplitFirstChar32(value, &c, &rest)) {
+    return false;
+  }
+  const absl::string_view first = value.substr(0, value.size() - rest.size());
+  uint64_t n;
+  return absl::SimpleAtoi(NumberUtil::KanjiNumberToArabicNumber(first), &n);
+}
+
+}  // namespace
 
 // Candidates from user history: "h"
 // Other existing candidates : "o"
@@ -66,4 +89,26 @@ size_t RewriterUtil::CalculateInsertPosition(const Segment &segment,
                   segment.candidates_size());
 }
 
+int RewriterUtil::GetSegmentsProperties(const Segments &segments) {
+  constexpr int kAll = RewriterInterface::HAS_NUMBER_CANDIDATE |
+                       RewriterInterface::HAS_ENGLISH_CANDIDATE;
+  int properties = 0;
+  for (const Segment &segment : segments.conversion_segments()) {
+    for (size_t i = 0; i < segment.candidates_size(); ++i) {
+      const absl::string_view content_value =
+          segment.candidate(i).content_value;
+      if (StartsWithNumber(content_value)) {
+        properties |= RewriterInterface::HAS_NUMBER_CANDIDATE;
+      }
+      if (Util::IsEnglishTransliteration(content_value)) {
+        properties |= RewriterInterface::HAS_ENGLISH_CANDIDATE;
+      }
+      if (properties == kAll) {
+        return properties;
+      }
+    }
+  }
+  return properties;
+}
+
 }  // namespace mozc
@@ -45,6 +45,10 @@ class RewriterUtil {
   // predictors.
   static size_t CalculateInsertPosition(const Segment &segment, size_t offset);
 
+  // Returns the RewriterInterface::SegmentsProperty bits of the conversion
+  // segments.
+  static int GetSegmentsProperties(const Segments &segments);
+
  private:
   RewriterUtil() = delete;
   virtual ~RewriterUtil() = delete;
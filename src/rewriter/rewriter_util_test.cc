@@ -34,6 +34,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "converter/segments.h"
+#include "rewriter/rewriter_interface.h"
 #include "testing/gunit.h"
 
 namespace mozc {
@@ -77,5 +78,35 @@ TEST(RewriterUtilTest, CalculateInsertPositionTest_NoUserHistory) {
   EXPECT_EQ(RewriterUtil::CalculateInsertPosition(segment, 6), 5);
 }
 
+TEST(RewriterUtilTest, GetSegmentsProperties) {
+  constexpr int kNumber = RewriterInterface::HAS_NUMBER_CANDIDATE;
+  constexpr int kEnglish = RewriterInterface::HAS_ENGLISH_CANDIDATE;
+
+  auto get_properties = [](absl::string_view content_value) {
+    Segments segments;
+    Segment *segment = segments.add_segment();
+    AddCandidate("key", "value", segment);
+    segment->mutable_candidate(0)->content_value = "こんにちは";
+    AddCandidate("key", "value", segment);
+    segment->mutable_candidate(1)->content_value = std::string(content_value);
+    return RewriterUtil::GetSegmentsProperties(segments);
+  };
+  EXPECT_EQ(get_properties("あいう"), 0);
+  EXPECT_EQ(get_properties("10"), kNumber);
+  EXPECT_EQ(get_properties("１０円"), kNumber);
+  EXPECT_EQ(get_properties("三脚"), kNumber);
+  EXPECT_EQ(get_properties("壱万円"), kNumber);
+  EXPECT_EQ(get_properties("円1"), 0);
+  EXPECT_EQ(get_properties("Mozc"), kEnglish);
+  EXPECT_EQ(get_properties("Mozc 2"), 0);
+
+  Segments segments;
+  AddCandidate("key", "value", segments.add_segment());
+  segments.mutable_segment(0)->mutable_candidate(0)->content_value = "1";
+  AddCandidate("key", "value", segments.add_segment());
+  segments.mutable_segment(1)->mutable_candidate(0)->content_value = "mozc";
+  EXPECT_EQ(RewriterUtil::GetSegmentsProperties(segments), kNumber | kEnglish);
+}
+
 }  // namespace
 }  // namespace mozc
@@ -0,0 +1,204 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/candidate_delta.h"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "protocol/candidate_window.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+
+void CandidateDeltaEncoder::Encode(const commands::Input &input,
+                                   const uint64_t candidate_list_revision,
+                                   commands::Output *output) {
+  if (!output->has_candidate_window() && !output->has_all_candidate_words()) {
+    return;
+  }
+
+  // The client may not have the candidates sent after its revision.
+  if (!input.has_candidate_delta_revision() ||
+      input.candidate_delta_revision() != revision_) {
+    candidate_window_key_.reset();
+    all_candidate_words_revision_.reset();
+  }
+
+  commands::Output::CandidateDelta delta;
+  bool sent_in_full = false;
+
+  if (output->has_candidate_window()) {
+    commands::CandidateWindow *window = output->mutable_candidate_window();
+    std::optional<CandidateWindowKey> key;
+    // The sub candidate window depends on the focused candidate, so the
+    // window with it is always sent in full.
+    if (window->candidate_size() > 0 && !window->has_sub_candidate_window()) {
+      key = CandidateWindowKey{candidate_list_revision,
+                               window->candidate(0).index()};
+    }
+    if (key.has_value() && key == candidate_window_key_) {
+      commands::CandidateWindow stripped;
+      if (window->has_focused_index()) {
+        stripped.set_focused_index(window->focused_index());
+      }
+      stripped.set_size(window->size());
+      stripped.set_position(window->position());
+      // The footer depends on the focused candidate, e.g. whether it can be
+      // deleted from the history.
+      if (window->has_footer()) {
+        *stripped.mutable_footer() = std::move(*window->mutable_footer());
+      }
+      if (window->usages().has_focused_index()) {
+        delta.set_usages_focused_index(window->usages().focused_index());
+      }
+      *window = std::move(stripped);
+      delta.set_candidate_window_omitted(true);
+    } else {
+      candidate_window_key_ = key;
+      sent_in_full = true;
+    }
+  }
+
+  if (output->has_all_candidate_words()) {
+    commands::CandidateList *words = output->mutable_all_candidate_words();
+    if (candidate_list_revision == all_candidate_words_revision_) {
+      commands::CandidateList stripped;
+      if (words->has_focused_index()) {
+        stripped.set_focused_index(words->focused_index());
+      }
+      *words = std::move(stripped);
+      delta.set_all_candidate_words_omitted(true);
+    } else {
+      all_candidate_words_revision_ = candidate_list_revision;
+      sent_in_full = true;
+    }
+  }
+
+  if (sent_in_full) {
+    ++revision_;
+  }
+  delta.set_revision(revision_);
+  *output->mutable_candidate_delta() = std::move(delta);
+}
+
+void CandidateDeltaDecoder::FillInput(commands::Input *input) const {
+  if (revision_.has_value()) {
+    input->set_candidate_delta_revision(*revision_);
+  }
+}
+
+bool CandidateDeltaDecoder::Decode(commands::Output *output) {
+  if (!output->has_candidate_delta()) {
+    return true;
+  }
+  const commands::Output::CandidateDelta delta = output->candidate_delta();
+  output->clear_candidate_delta();
+
+  // The revision is incremented once per Output which has any candidates in
+  // full, so the omitted candidates are known only if the revisions agree.
+  const bool sent_in_full =
+      (output->has_candidate_window() && !delta.candidate_window_omitted()) ||
+      (output->has_all_candidate_words() &&
+       !delta.all_candidate_words_omitted());
+  const bool in_sync =
+      revision_.has_value() &&
+      delta.revision() == *revision_ + (sent_in_full ? 1 : 0);
+
+  bool result = true;
+  if (delta.candidate_window_omitted()) {
+    if (in_sync && candidate_window_.has_value()) {
+      commands::CandidateWindow window = *candidate_window_;
+      const commands::CandidateWindow &stripped = output->candidate_window();
+      if (stripped.has_focused_index()) {
+        window.set_focused_index(stripped.focused_index());
+      } else {
+        window.clear_focused_index();
+      }
+      window.set_size(stripped.size());
+      window.set_position(stripped.position());
+      if (stripped.has_footer()) {
+        *window.mutable_footer() = stripped.footer();
+      } else {
+        window.clear_footer();
+      }
+      if (delta.has_usages_focused_index()) {
+        window.mutable_usages()->set_focused_index(
+            delta.usages_focused_index());
+      } else if (window.has_usages()) {
+        window.mutable_usages()->clear_focused_index();
+      }
+      *output->mutable_candidate_window() = std::move(window);
+    } else {
+      output->clear_candidate_window();
+      result = false;
+    }
+  } else if (output->has_candidate_window()) {
+    candidate_window_ = output->candidate_window();
+  }
+
+  if (delta.all_candidate_words_omitted()) {
+    if (in_sync && all_candidate_words_.has_value()) {
+      commands::CandidateList words = *all_candidate_words_;
+      if (output->all_candidate_words().has_focused_index()) {
+        words.set_focused_index(output->all_candidate_words().focused_index());
+      } else {
+        words.clear_focused_index();
+      }
+      *output->mutable_all_candidate_words() = std::move(words);
+    } else {
+      output->clear_all_candidate_words();
+      result = false;
+    }
+  } else if (output->has_all_candidate_words()) {
+    all_candidate_words_ = output->all_candidate_words();
+  }
+
+  if (!result) {
+    // Asks the server to send the candidates in full next time.
+    LOG(ERROR) << "Unknown candidates at revision " << delta.revision();
+    Reset();
+    return false;
+  }
+  revision_ = delta.revision();
+  return true;
+}
+
+void CandidateDeltaDecoder::Reset() {
+  revision_.reset();
+  candidate_window_.reset();
+  all_candidate_words_.reset();
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,118 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_SESSION_CANDIDATE_DELTA_H_
+#define MOZC_SESSION_CANDIDATE_DELTA_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "protocol/candidate_window.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+
+// Omits the candidates in commands::Output which the client already has.
+//
+// While the user moves the focus within a page, only the focused index of
+// the candidate window changes, yet the whole window and all the candidate
+// words are sent on every key. The encoder tells the unchanged candidates by
+// EngineConverterInterface::candidate_list_revision() and the page of the
+// window, without looking into the candidates, and replaces them with their
+// focus, position and footer. CandidateDeltaDecoder restores them on the client side.
+// This saves serializing, sending and parsing the candidates, but the server
+// still fills them in commands::Output before they are stripped.
+//
+// Candidates are omitted only when the client acknowledges the latest
+// revision with Input::candidate_delta_revision, so a lost response or a
+// restarted session results in the candidates sent in full again.
+//
+// The delta is limited to the IPC between the client library and the server.
+// The decoder restores the complete candidates, so the renderer still
+// receives them in full through RendererClient.
+class CandidateDeltaEncoder {
+ public:
+  CandidateDeltaEncoder() = default;
+
+  CandidateDeltaEncoder(const CandidateDeltaEncoder &) = delete;
+  CandidateDeltaEncoder &operator=(const CandidateDeltaEncoder &) = delete;
+
+  // Strips `candidate_window` and `all_candidate_words` of `output` if they
+  // are the same as the last ones except for focus, and sets
+  // `candidate_delta`. `candidate_list_revision` is the revision of the
+  // converter which filled `output`. Does nothing if `output` has no
+  // candidates.
+  void Encode(const commands::Input &input, uint64_t candidate_list_revision,
+              commands::Output *output);
+
+ private:
+  // Identifies the candidates in the candidate window.
+  struct CandidateWindowKey {
+    uint64_t candidate_list_revision;
+    // The index of the first candidate in the page.
+    uint32_t page_start;
+
+    bool operator==(const CandidateWindowKey &) const = default;
+  };
+
+  uint64_t revision_ = 0;
+  std::optional<CandidateWindowKey> candidate_window_key_;
+  std::optional<uint64_t> all_candidate_words_revision_;
+};
+
+// Restores the candidates omitted by CandidateDeltaEncoder.
+class CandidateDeltaDecoder {
+ public:
+  CandidateDeltaDecoder() = default;
+
+  CandidateDeltaDecoder(const CandidateDeltaDecoder &) = delete;
+  CandidateDeltaDecoder &operator=(const CandidateDeltaDecoder &) = delete;
+
+  // Sets the revision of the candidates the decoder holds to `input`.
+  void FillInput(commands::Input *input) const;
+
+  // Fills the omitted candidates of `output` and clears `candidate_delta`.
+  // Returns false if the omitted candidates are unknown to the decoder, in
+  // which case they are removed from `output`.
+  bool Decode(commands::Output *output);
+
+ private:
+  void Reset();
+
+  std::optional<uint64_t> revision_;
+  std::optional<commands::CandidateWindow> candidate_window_;
+  std::optional<commands::CandidateList> all_candidate_words_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_CANDIDATE_DELTA_H_
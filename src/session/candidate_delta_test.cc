@@ -0,0 +1,230 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/candidate_delta.h"
+
+#include <cstdint>
+
+#include "protocol/candidate_window.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/gunit.h"
+#include "testing/testing_util.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+using ::mozc::commands::Input;
+using ::mozc::commands::Output;
+
+constexpr uint64_t kRevision = 10;
+
+// Makes an output with `num_candidates` candidates, whose window is the page
+// starting with `page_start`.
+Output MakeOutput(int focused_index, int num_candidates, int page_start = 0) {
+  Output output;
+  commands::CandidateWindow *window = output.mutable_candidate_window();
+  window->set_focused_index(focused_index);
+  window->set_size(num_candidates);
+  window->set_position(0);
+  window->mutable_usages()->set_focused_index(focused_index);
+  commands::CandidateList *words = output.mutable_all_candidate_words();
+  words->set_focused_index(focused_index);
+  for (int i = 0; i < num_candidates; ++i) {
+    commands::CandidateWindow::Candidate *candidate = window->add_candidate();
+    candidate->set_index(page_start + i);
+    candidate->set_value("candidate");
+    candidate->set_id(i);
+    commands::Information *usage = window->mutable_usages()->add_information();
+    usage->set_id(i);
+    usage->set_description("usage");
+    commands::CandidateWord *word = words->add_candidates();
+    word->set_id(i);
+    word->set_index(i);
+    word->set_value("candidate");
+  }
+  return output;
+}
+
+class CandidateDeltaTest : public ::testing::Test {
+ protected:
+  // Sends `output` through the encoder and the decoder.
+  Output RoundTrip(const Output &output,
+                   uint64_t candidate_list_revision = kRevision) {
+    Input input;
+    decoder_.FillInput(&input);
+    Output sent = output;
+    encoder_.Encode(input, candidate_list_revision, &sent);
+    last_sent_ = sent;
+    EXPECT_TRUE(decoder_.Decode(&sent));
+    return sent;
+  }
+
+  CandidateDeltaEncoder encoder_;
+  CandidateDeltaDecoder decoder_;
+  Output last_sent_;
+};
+
+TEST_F(CandidateDeltaTest, OmitsCandidatesWhenOnlyFocusChanges) {
+  const Output first = MakeOutput(0, 5);
+  EXPECT_PROTO_EQ(first, RoundTrip(first));
+  EXPECT_EQ(last_sent_.candidate_window().candidate_size(), 5);
+  EXPECT_FALSE(last_sent_.candidate_delta().candidate_window_omitted());
+
+  const Output second = MakeOutput(3, 5);
+  EXPECT_PROTO_EQ(second, RoundTrip(second));
+  EXPECT_TRUE(last_sent_.candidate_delta().candidate_window_omitted());
+  EXPECT_TRUE(last_sent_.candidate_delta().all_candidate_words_omitted());
+  EXPECT_EQ(last_sent_.candidate_window().candidate_size(), 0);
+  EXPECT_EQ(last_sent_.all_candidate_words().candidates_size(), 0);
+  EXPECT_EQ(last_sent_.candidate_window().focused_index(), 3);
+  EXPECT_EQ(last_sent_.candidate_delta().usages_focused_index(), 3);
+
+  Output suggestion = MakeOutput(0, 5);
+  commands::CandidateWindow *window = suggestion.mutable_candidate_window();
+  window->clear_focused_index();
+  window->mutable_usages()->clear_focused_index();
+  EXPECT_PROTO_EQ(suggestion, RoundTrip(suggestion));
+  EXPECT_TRUE(last_sent_.candidate_delta().candidate_window_omitted());
+}
+
+TEST_F(CandidateDeltaTest, SendsChangedCandidatesInFull) {
+  RoundTrip(MakeOutput(0, 5));
+  const uint64_t revision = last_sent_.candidate_delta().revision();
+
+  // The converter has rebuilt the candidates.
+  const Output output = MakeOutput(0, 6);
+  EXPECT_PROTO_EQ(output, RoundTrip(output, kRevision + 1));
+  EXPECT_FALSE(last_sent_.candidate_delta().candidate_window_omitted());
+  EXPECT_FALSE(last_sent_.candidate_delta().all_candidate_words_omitted());
+  EXPECT_EQ(last_sent_.candidate_delta().revision(), revision + 1);
+
+  // Only the page of the candidate window is changed.
+  const Output next = MakeOutput(1, 6, 6);
+  EXPECT_PROTO_EQ(next, RoundTrip(next, kRevision + 1));
+  EXPECT_FALSE(last_sent_.candidate_delta().candidate_window_omitted());
+  EXPECT_TRUE(last_sent_.candidate_delta().all_candidate_words_omitted());
+}
+
+TEST_F(CandidateDeltaTest, UpdatesFooterWithFocus) {
+  // Like output::FillFooter(), the footer tells how to delete the focused
+  // candidate only if it is deletable.
+  auto make_output = [](int focused_index) {
+    Output output = MakeOutput(focused_index, 5);
+    commands::CandidateWindow *window = output.mutable_candidate_window();
+    window->mutable_candidate(1)->mutable_annotation()->set_deletable(true);
+    commands::Footer *footer = window->mutable_footer();
+    footer->set_index_visible(true);
+    footer->set_logo_visible(true);
+    if (focused_index == 1) {
+      footer->set_label("Ctrl+Delで履歴から削除");
+    } else {
+      footer->set_sub_label("build number");
+    }
+    return output;
+  };
+
+  RoundTrip(make_output(0));
+  for (const int focused_index : {1, 2, 1}) {
+    const Output output = make_output(focused_index);
+    EXPECT_PROTO_EQ(output, RoundTrip(output));
+    EXPECT_TRUE(last_sent_.candidate_delta().candidate_window_omitted());
+  }
+
+  // The footer is cleared if the output has none.
+  Output output = make_output(3);
+  output.mutable_candidate_window()->clear_footer();
+  EXPECT_PROTO_EQ(output, RoundTrip(output));
+  EXPECT_TRUE(last_sent_.candidate_delta().candidate_window_omitted());
+}
+
+TEST_F(CandidateDeltaTest, SendsSubCandidateWindowInFull) {
+  Output output = MakeOutput(0, 5);
+  output.mutable_candidate_window()
+      ->mutable_sub_candidate_window()
+      ->add_candidate()
+      ->set_value("sub");
+  RoundTrip(output);
+  EXPECT_PROTO_EQ(output, RoundTrip(output));
+  EXPECT_FALSE(last_sent_.candidate_delta().candidate_window_omitted());
+  EXPECT_TRUE(last_sent_.candidate_delta().all_candidate_words_omitted());
+}
+
+TEST_F(CandidateDeltaTest, DoesNothingWithoutCandidates) {
+  Output output;
+  output.set_consumed(true);
+  encoder_.Encode(Input(), kRevision, &output);
+  EXPECT_FALSE(output.has_candidate_delta());
+  EXPECT_TRUE(decoder_.Decode(&output));
+}
+
+TEST_F(CandidateDeltaTest, SendsInFullUnlessRevisionIsAcknowledged) {
+  RoundTrip(MakeOutput(0, 5));
+
+  // The client doesn't know the revision, e.g. the response was lost.
+  Output output = MakeOutput(1, 5);
+  encoder_.Encode(Input(), kRevision, &output);
+  EXPECT_FALSE(output.candidate_delta().candidate_window_omitted());
+  EXPECT_FALSE(output.candidate_delta().all_candidate_words_omitted());
+
+  // The decoder skipped the revision above but receives the candidates in
+  // full again.
+  const Output next = MakeOutput(2, 5);
+  EXPECT_PROTO_EQ(next, RoundTrip(next));
+  EXPECT_FALSE(last_sent_.candidate_delta().candidate_window_omitted());
+
+  EXPECT_PROTO_EQ(MakeOutput(3, 5), RoundTrip(MakeOutput(3, 5)));
+  EXPECT_TRUE(last_sent_.candidate_delta().candidate_window_omitted());
+}
+
+TEST_F(CandidateDeltaTest, DecoderRejectsUnknownCandidates) {
+  CandidateDeltaEncoder encoder;
+  Input input;
+  Output output = MakeOutput(0, 5);
+  encoder.Encode(input, kRevision, &output);
+  input.set_candidate_delta_revision(output.candidate_delta().revision());
+  output = MakeOutput(1, 5);
+  encoder.Encode(input, kRevision, &output);
+  ASSERT_TRUE(output.candidate_delta().candidate_window_omitted());
+
+  EXPECT_FALSE(decoder_.Decode(&output));
+  EXPECT_FALSE(output.has_candidate_window());
+  EXPECT_FALSE(output.has_all_candidate_words());
+  EXPECT_FALSE(output.has_candidate_delta());
+
+  // The decoder asks for the candidates in full.
+  Input next;
+  decoder_.FillInput(&next);
+  EXPECT_FALSE(next.has_candidate_delta_revision());
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
@@ -64,8 +64,10 @@ ImeContext::CopyableData::CopyableData()
       request(composer::GetSharedDefaultRequest()),
       config(config::ConfigHandler::GetSharedDefaultConfig()),
       key_map_manager(GetSharedDefaultKeyMapManager()),
-      composer(composer::Table::GetSharedDefaultTable(), request, config),
-      state(NONE) {
+      composer(std::make_shared<composer::Composer>(
+          composer::Table::GetSharedDefaultTable(), request, config)),
+      state(NONE),
+      output(std::make_shared<commands::Output>()) {
   DCHECK(request);
   DCHECK(config);
   DCHECK(key_map_manager);
@@ -76,19 +78,23 @@ ImeContext::ImeContext(
     std::unique_ptr<engine::EngineConverterInterface> converter)
     : converter_(std::move(converter)) {}
 
-ImeContext::ImeContext(const ImeContext &src) : data_(src.data_) {
-  if (src.converter_) {
-    converter_ = absl::WrapUnique(src.converter().Clone());
+ImeContext::ImeContext(const ImeContext &src)
+    : data_(src.data_), converter_(src.converter_) {}
+
+engine::EngineConverterInterface *ImeContext::mutable_converter() {
+  if (converter_.use_count() > 1) {
+    converter_ = absl::WrapUnique(converter_->Clone());
   }
+  return converter_.get();
 }
 
 void ImeContext::SetRequest(std::shared_ptr<const commands::Request> request) {
   DCHECK(request);
   data_.request = std::move(request);
   if (converter_) {
-    converter_->SetRequest(data_.request);
+    mutable_converter()->SetRequest(data_.request);
   }
-  data_.composer.SetRequest(data_.request);
+  mutable_composer()->SetRequest(data_.request);
 }
 
 const commands::Request &ImeContext::GetRequest() const {
@@ -100,10 +106,10 @@ void ImeContext::SetConfig(std::shared_ptr<const config::Config> config) {
   data_.config = std::move(config);
 
   if (converter_) {
-    converter_->SetConfig(data_.config);
+    mutable_converter()->SetConfig(data_.config);
   }
 
-  data_.composer.SetConfig(data_.config);
+  mutable_composer()->SetConfig(data_.config);
   data_.key_event_transformer.ReloadConfig(*data_.config);
 }
 
@@ -53,6 +53,9 @@ class ImeContext final {
   ImeContext() = default;
   explicit ImeContext(
       std::unique_ptr<engine::EngineConverterInterface> converter);
+  // The copy shares the composer, the converter and the output with `src`
+  // until either of them modifies them, so taking a snapshot for undo costs
+  // O(1).
   explicit ImeContext(const ImeContext &src);
 
   ImeContext &operator=(const ImeContext &) = delete;
@@ -67,15 +70,13 @@ class ImeContext final {
     data_.last_command_time = last_command_time;
   }
 
-  const composer::Composer &composer() const { return data_.composer; }
-  composer::Composer *mutable_composer() { return &data_.composer; }
+  const composer::Composer &composer() const { return *data_.composer; }
+  composer::Composer *mutable_composer() { return Detach(data_.composer); }
 
   const engine::EngineConverterInterface &converter() const {
     return *converter_;
   }
-  engine::EngineConverterInterface *mutable_converter() {
-    return converter_.get();
-  }
+  engine::EngineConverterInterface *mutable_converter();
 
   const KeyEventTransformer &key_event_transformer() const {
     return data_.key_event_transformer;
@@ -123,10 +124,24 @@ class ImeContext final {
   }
   commands::Context *mutable_client_context() { return &data_.client_context; }
 
-  const commands::Output &output() const { return data_.output; }
-  commands::Output *mutable_output() { return &data_.output; }
+  const commands::Output &output() const { return *data_.output; }
+  commands::Output *mutable_output() { return Detach(data_.output); }
+  // Replaces the output without copying the shared one.
+  void set_output(const commands::Output &output) {
+    data_.output = std::make_shared<commands::Output>(output);
+  }
 
  private:
+  // Returns the object owned by `ptr` after copying it if it is shared with
+  // other contexts.
+  template <typename T>
+  static T *Detach(std::shared_ptr<T> &ptr) {
+    if (ptr.use_count() > 1) {
+      ptr = std::make_shared<T>(*ptr);
+    }
+    return ptr.get();
+  }
+
   // Separate copyable data and non-copyable data to
   // easily overload copy operator.
   struct CopyableData {
@@ -143,7 +158,7 @@ class ImeContext final {
     std::shared_ptr<const config::Config> config;
     std::shared_ptr<const keymap::KeyMapManager> key_map_manager;
 
-    composer::Composer composer;
+    std::shared_ptr<composer::Composer> composer;
     KeyEventTransformer key_event_transformer;
 
     State state;
@@ -153,13 +168,16 @@ class ImeContext final {
 
     // Storing the last output consisting of the last result and the
     // last performed command.
-    commands::Output output;
+    std::shared_ptr<commands::Output> output;
   };
 
   CopyableData data_;
 
-  // converter_ should explicitly be copied via Clone() method.
-  std::unique_ptr<engine::EngineConverterInterface> converter_;
+  // converter_ is shared with the copies of this context, e.g. the undo
+  // context, and mutable_converter() copies it via Clone() method when it is
+  // shared. The clone also shares the segments and their candidates, and
+  // copies only what it modifies.
+  std::shared_ptr<engine::EngineConverterInterface> converter_;
 };
 
 }  // namespace session
@@ -191,5 +191,29 @@ TEST(ImeContextTest, CopyContext) {
   }
 }
 
+TEST(ImeContextTest, CopySharesDataUntilModified) {
+  auto converter = std::make_shared<MockConverter>();
+  ImeContext source(std::make_unique<EngineConverter>(converter));
+  source.mutable_composer()->InsertCharacter("a");
+  source.mutable_output()->set_id(1);
+
+  ImeContext destination(source);
+  EXPECT_EQ(&destination.composer(), &source.composer());
+  EXPECT_EQ(&destination.converter(), &source.converter());
+  EXPECT_EQ(&destination.output(), &source.output());
+
+  source.mutable_composer()->InsertCharacter("b");
+  source.mutable_output()->set_id(2);
+  source.mutable_converter()->set_use_cascading_window(true);
+  EXPECT_NE(&destination.composer(), &source.composer());
+  EXPECT_NE(&destination.converter(), &source.converter());
+  EXPECT_NE(&destination.output(), &source.output());
+
+  EXPECT_EQ(source.composer().GetLength(), 2);
+  EXPECT_EQ(destination.composer().GetLength(), 1);
+  EXPECT_EQ(source.output().id(), 2);
+  EXPECT_EQ(destination.output().id(), 1);
+}
+
 }  // namespace session
 }  // namespace mozc
@@ -1376,7 +1376,7 @@ bool Session::CommitCandidate(commands::Command *command) {
         // Don't clear the undo context, which we've just updated.
         MoveCursorToEndInternal(command, false);
         // Copy the previous output for Undo.
-        *context_->mutable_output() = command->output();
+        context_->set_output(command->output());
         return true;
       }
     }
@@ -1396,7 +1396,7 @@ bool Session::CommitCandidate(commands::Command *command) {
   }
   Output(command);
   // Copy the previous output for Undo.
-  *context_->mutable_output() = command->output();
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1434,6 +1434,14 @@ bool Session::MaybeSelectCandidate(commands::Command *command) {
   return context_->mutable_converter()->CandidateMoveToShortcut(shortcut);
 }
 
+void Session::EncodeCandidateDelta(commands::Command *command) {
+  if (context_->client_capability().candidate_delta()) {
+    candidate_delta_encoder_.Encode(
+        command->input(), context_->converter().candidate_list_revision(),
+        command->mutable_output());
+  }
+}
+
 void Session::set_client_capability(commands::Capability capability) {
   *context_->mutable_client_capability() = std::move(capability);
 }
@@ -1775,7 +1783,7 @@ bool Session::CommitInternal(commands::Command *command,
 
   Output(command);
   // Copy the previous output for Undo.
-  *context_->mutable_output() = command->output();
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1834,7 +1842,7 @@ bool Session::CommitFirstSuggestion(commands::Command *command) {
 
   Output(command);
   // Copy the previous output for Undo.
-  *context_->mutable_output() = command->output();
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1869,7 +1877,7 @@ bool Session::CommitSegment(commands::Command *command) {
   }
   Output(command);
   // Copy the previous output for Undo.
-  *context_->mutable_output() = command->output();
+  context_->set_output(command->output());
   return true;
 }
 
@@ -54,6 +54,7 @@
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:config_proto',
         '<(mozc_oss_src_dir)/request/request.gyp:conversion_request',
         '<(mozc_oss_src_dir)/transliteration/transliteration.gyp:transliteration',
+        'session_base.gyp:candidate_delta',
         'session_base.gyp:keymap',
         'session_internal',
       ],
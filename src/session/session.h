@@ -44,6 +44,7 @@
 #include "engine/engine_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/candidate_delta.h"
 #include "session/ime_context.h"
 #include "session/keymap.h"
 #include "testing/friend_test.h"
@@ -66,6 +67,10 @@ class Session {
   // Perform the SEND_COMMAND command defined commands.proto.
   bool SendCommand(mozc::commands::Command *command);
 
+  // Omits the candidates in command.output which the client already has if
+  // the client has Capability::candidate_delta.
+  void EncodeCandidateDelta(mozc::commands::Command *command);
+
   // Turn on IME. Do nothing (but the keyevent is consumed) when IME is already
   // turned on.
   bool IMEOn(mozc::commands::Command *command);
@@ -280,6 +285,8 @@ class Session {
   // Undo stack. *begin is the oldest, and *back is the newest.
   std::deque<std::unique_ptr<ImeContext>> undo_contexts_;
 
+  CandidateDeltaEncoder candidate_delta_encoder_;
+
   std::unique_ptr<ImeContext> CreateContext(
       const EngineInterface &engine) const;
 
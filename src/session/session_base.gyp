@@ -52,6 +52,17 @@
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:config_proto',
       ],
     },
+    {
+      'target_name': 'candidate_delta',
+      'type': 'static_library',
+      'sources': [
+        'candidate_delta.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_log',
+        '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
+      ],
+    },
     {
       'target_name': 'key_info_util',
       'type': 'static_library',
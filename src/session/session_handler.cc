@@ -43,8 +43,11 @@
 #include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "base/clock.h"
+#include "base/latency_stats.h"
 #include "base/stopwatch.h"
 #include "base/version.h"
 #include "base/vlog.h"
@@ -97,6 +100,10 @@ ABSL_FLAG(int32_t, last_create_session_timeout, 300,
 
 ABSL_FLAG(bool, restricted, false, "Launch server with restricted setting");
 
+ABSL_FLAG(bool, latency_stats, false,
+          "Collect per-stage latency statistics, which are returned by the "
+          "GET_LATENCY_STATS command.");
+
 namespace mozc {
 namespace {
 
@@ -150,6 +157,10 @@ SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine)
     absl::SetFlag(&FLAGS_last_command_timeout, 60);
   }
 
+  if (absl::GetFlag(FLAGS_latency_stats)) {
+    LatencyStats::SetEnabled(true);
+  }
+
   // Allow [2..128] sessions.
   max_session_size_ = std::clamp(absl::GetFlag(FLAGS_max_session_size), 2, 128);
   session_map_ = std::make_unique<SessionMap>(max_session_size_);
@@ -298,6 +309,34 @@ bool SessionHandler::SetRequest(commands::Command *command) {
 }
 
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  switch (command->input().type()) {
+    case commands::Input::SEND_KEY:
+    case commands::Input::TEST_SEND_KEY:
+    case commands::Input::SEND_COMMAND:
+      break;
+    default: {
+      absl::WriterMutexLock lock(&mutex_);
+      return EvalCommandLocked(command);
+    }
+  }
+
+  // Commands to an existing session are evaluated concurrently with the
+  // commands to the other sessions.
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (!EvalCommandLocked(command)) {
+      return false;
+    }
+  }
+  // The session may update the config, which affects all the sessions.
+  if (command->output().has_config()) {
+    absl::WriterMutexLock lock(&mutex_);
+    MaybeUpdateConfig(command);
+  }
+  return is_available_;
+}
+
+bool SessionHandler::EvalCommandLocked(commands::Command *command) {
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
     return false;
@@ -371,6 +410,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::GET_SERVER_VERSION:
       eval_succeeded = GetServerVersion(command);
       break;
+    case commands::Input::GET_LATENCY_STATS:
+      eval_succeeded = GetLatencyStats(command);
+      break;
     default:
       eval_succeeded = false;
   }
@@ -388,6 +430,12 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   }
 
   stopwatch.Stop();
+  if (LatencyStats::IsEnabled()) {
+    LatencyStats::Record(
+        absl::StrCat("session/", commands::Input::CommandType_Name(
+                                     command->input().type())),
+        stopwatch.GetElapsed());
+  }
 
   return is_available_;
 }
@@ -408,39 +456,45 @@ void SessionHandler::MaybeUpdateConfig(commands::Command *command) {
 
 bool SessionHandler::SendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = FindSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendKey(command);
-  MaybeUpdateConfig(command);
+  session->SendKey(command);
+  session->EncodeCandidateDelta(command);
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = FindSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->TestSendKey(command);
+  session->TestSendKey(command);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = FindSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendCommand(command);
-  MaybeUpdateConfig(command);
+  session->SendCommand(command);
+  session->EncodeCandidateDelta(command);
   return true;
 }
 
+session::Session *SessionHandler::FindSession(SessionID id) {
+  absl::MutexLock lock(&session_map_mutex_);
+  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
+  return session == nullptr ? nullptr : session->get();
+}
+
 void SessionHandler::MaybeReloadEngine(commands::Command *command) {
   if (session_map_->Size() > 0) {
     // Some sessions still use the current engine_.
@@ -467,6 +521,25 @@ bool SessionHandler::GetServerVersion(mozc::commands::Command *command) const {
   return true;
 }
 
+bool SessionHandler::GetLatencyStats(commands::Command *command) const {
+  commands::LatencyStats *stats =
+      command->mutable_output()->mutable_latency_stats();
+  const LatencyStats::Snapshot snapshot = LatencyStats::TakeSnapshot();
+  for (const LatencyStats::Stage &stage : snapshot.stages) {
+    commands::LatencyStats::Stage *entry = stats->add_stages();
+    entry->set_name(stage.name);
+    entry->set_count(stage.count);
+    entry->set_total_microseconds(absl::ToInt64Microseconds(stage.total));
+    entry->set_max_microseconds(absl::ToInt64Microseconds(stage.max));
+  }
+  for (const LatencyStats::Counter &counter : snapshot.counters) {
+    commands::LatencyStats::Counter *entry = stats->add_counters();
+    entry->set_name(counter.name);
+    entry->set_value(counter.value);
+  }
+  return true;
+}
+
 bool SessionHandler::CreateSession(commands::Command *command) {
   // prevent DOS attack
   // don't allow CreateSession in very short period.
@@ -32,12 +32,15 @@
 #ifndef MOZC_SESSION_SESSION_HANDLER_H_
 #define MOZC_SESSION_SESSION_HANDLER_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "composer/table.h"
 #include "engine/engine_interface.h"
@@ -65,6 +68,9 @@ class SessionHandler {
   // Returns true if SessionHandle is available.
   bool IsAvailable() const;
 
+  // Evaluates the command. This method is thread-safe. Commands to different
+  // sessions can be evaluated concurrently, while the caller must keep the
+  // order of commands to the same session.
   bool EvalCommand(commands::Command *command);
 
   // Starts watch dog timer to cleanup sessions.
@@ -86,6 +92,14 @@ class SessionHandler {
       mozc::storage::LruCache<SessionID, std::unique_ptr<session::Session>>;
   using SessionElement = SessionMap::Element;
 
+  // Evaluates the command with mutex_ held.
+  bool EvalCommandLocked(commands::Command *command);
+
+  // Returns the session for `id`, or nullptr if not available. Callable with
+  // mutex_ held in the shared mode.
+  session::Session *FindSession(SessionID id)
+      ABSL_LOCKS_EXCLUDED(session_map_mutex_);
+
   // Updates the config, if the |command| contains the config.
   void MaybeUpdateConfig(commands::Command *command);
 
@@ -120,6 +134,7 @@ class SessionHandler {
   bool NoOperation(commands::Command *command);
   bool ReloadSupplementalModel(commands::Command *command);
   bool GetServerVersion(commands::Command *command) const;
+  bool GetLatencyStats(commands::Command *command) const;
 
   // Replaces engine_ with a new instance if it is ready.
   void MaybeReloadEngine(commands::Command *command);
@@ -127,11 +142,19 @@ class SessionHandler {
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
+  // Commands to an existing session (SEND_KEY, TEST_SEND_KEY and SEND_COMMAND)
+  // hold mutex_ in the shared mode, and the other commands hold it
+  // exclusively.
+  absl::Mutex mutex_;
+  // Guards the LRU order of session_map_, which is updated by the lookups with
+  // mutex_ held in the shared mode.
+  absl::Mutex session_map_mutex_;
+
   std::unique_ptr<SessionMap> session_map_;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::optional<SessionWatchDog> session_watch_dog_;
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
-  bool is_available_ = false;
+  std::atomic<bool> is_available_ = false;
   uint32_t max_session_size_ = 0;
   absl::Time last_session_empty_time_ = absl::InfinitePast();
   absl::Time last_cleanup_time_ = absl::InfinitePast();
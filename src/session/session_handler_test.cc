@@ -48,6 +48,8 @@
 #include "absl/time/time.h"
 #include "base/clock.h"
 #include "base/clock_mock.h"
+#include "base/latency_stats.h"
+#include "base/thread.h"
 #include "composer/query.h"
 #include "config/config_handler.h"
 #include "data_manager/data_manager.h"
@@ -70,6 +72,7 @@ ABSL_DECLARE_FLAG(int32_t, max_session_size);
 ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
 ABSL_DECLARE_FLAG(int32_t, last_create_session_timeout);
+ABSL_DECLARE_FLAG(bool, latency_stats);
 
 namespace mozc {
 namespace {
@@ -552,6 +555,53 @@ TEST_F(SessionHandlerTest, UpdateComposition) {
   }
 }
 
+TEST_F(SessionHandlerTest, ConcurrentSessionsTest) {
+  SessionHandler handler(CreateMockDataEngine());
+
+  constexpr int kNumSessions = 4;
+  std::vector<uint64_t> session_ids(kNumSessions);
+  for (uint64_t &id : session_ids) {
+    ASSERT_TRUE(CreateSession(handler, &id));
+  }
+
+  // Commands to different sessions are evaluated concurrently with the
+  // commands not bound to a session.
+  std::vector<Thread> threads;
+  for (const uint64_t id : session_ids) {
+    threads.push_back(Thread([&handler, id] {
+      for (int i = 0; i < 20; ++i) {
+        for (const char key : {'k', 'a', 'n', 'j', 'i'}) {
+          commands::Command command;
+          command.mutable_input()->set_id(id);
+          command.mutable_input()->set_type(commands::Input::SEND_KEY);
+          command.mutable_input()->mutable_key()->set_key_code(key);
+          EXPECT_TRUE(handler.EvalCommand(&command));
+          EXPECT_EQ(command.output().id(), id);
+        }
+        EXPECT_TRUE(IsGoodSession(handler, id));
+        commands::Command command;
+        command.mutable_input()->set_id(id);
+        command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+        command.mutable_input()->mutable_command()->set_type(
+            commands::SessionCommand::SUBMIT);
+        EXPECT_TRUE(handler.EvalCommand(&command));
+      }
+    }));
+  }
+  for (int i = 0; i < 20; ++i) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::GET_CONFIG);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+
+  for (const uint64_t id : session_ids) {
+    EXPECT_TRUE(DeleteSession(handler, id));
+  }
+}
+
 TEST_F(SessionHandlerTest, KeyMapTest) {
   config::Config config = config::ConfigHandler::GetCopiedConfig();
   const keymap::KeyMapManager *msime_keymap;
@@ -768,6 +818,32 @@ TEST_F(SessionHandlerTest, GetServerVersionTest) {
   EXPECT_EQ(command.output().server_version().data_version(), "24.20240101.01");
 }
 
+TEST_F(SessionHandlerTest, GetLatencyStatsTest) {
+  absl::SetFlag(&FLAGS_latency_stats, true);
+  LatencyStats::Clear();
+  SessionHandler handler(std::make_unique<MockEngine>());
+  absl::SetFlag(&FLAGS_latency_stats, false);
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::NO_OPERATION);
+  ASSERT_TRUE(handler.EvalCommand(&command));
+  LatencyStats::Increment("test/counter", 3);
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::GET_LATENCY_STATS);
+  ASSERT_TRUE(handler.EvalCommand(&command));
+  LatencyStats::SetEnabled(false);
+  LatencyStats::Clear();
+
+  const commands::LatencyStats &stats = command.output().latency_stats();
+  ASSERT_EQ(stats.stages_size(), 1);
+  EXPECT_EQ(stats.stages(0).name(), "session/NO_OPERATION");
+  EXPECT_EQ(stats.stages(0).count(), 1);
+  ASSERT_EQ(stats.counters_size(), 1);
+  EXPECT_EQ(stats.counters(0).name(), "test/counter");
+  EXPECT_EQ(stats.counters(0).value(), 3);
+}
+
 TEST_F(SessionHandlerTest, ReloadFromMinimalEngine) {
   std::unique_ptr<Engine> engine = Engine::CreateEngine();
 
@@ -33,12 +33,15 @@
 
 #include "session/session_server.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
+#include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "base/protobuf/coded_stream.h"
 #include "base/vlog.h"
 #include "engine/engine_factory.h"
 #include "ipc/ipc.h"
@@ -46,6 +49,11 @@
 #include "protocol/commands.pb.h"
 #include "session/session_handler.h"
 
+ABSL_FLAG(int32_t, ipc_worker_threads, 0,
+          "The number of threads to process the requests. If 0, the requests "
+          "are processed one by one on the IPC thread. Only effective on "
+          "Linux.");
+
 namespace {
 
 #ifdef _WIN32
@@ -61,6 +69,37 @@ constexpr absl::Duration kTimeOut = absl::Milliseconds(5000);
 constexpr char kSessionName[] = "session";
 constexpr char kEventName[] = "session";
 
+// Wire types of the protocol buffer encoding.
+constexpr uint32_t kWireTypeVarint = 0;
+constexpr uint32_t kWireTypeFixed64 = 1;
+constexpr uint32_t kWireTypeLengthDelimited = 2;
+constexpr uint32_t kWireTypeFixed32 = 5;
+
+constexpr uint32_t MakeTag(int field_number, uint32_t wire_type) {
+  return (static_cast<uint32_t>(field_number) << 3) | wire_type;
+}
+
+// Skips the value of the field `tag`. Groups are not supported as Input has
+// none.
+bool SkipField(mozc::protobuf::io::CodedInputStream &input, uint32_t tag) {
+  switch (tag & 7) {
+    case kWireTypeVarint: {
+      uint64_t value;
+      return input.ReadVarint64(&value);
+    }
+    case kWireTypeFixed64:
+      return input.Skip(8);
+    case kWireTypeLengthDelimited: {
+      uint32_t length;
+      return input.ReadVarint32(&length) && input.Skip(length);
+    }
+    case kWireTypeFixed32:
+      return input.Skip(4);
+    default:
+      return false;
+  }
+}
+
 }  // namespace
 
 namespace mozc {
@@ -69,6 +108,9 @@ SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
       session_handler_(
           std::make_unique<SessionHandler>(EngineFactory::Create().value())) {
+  // SessionHandler::EvalCommand() is thread-safe.
+  set_num_workers(absl::GetFlag(FLAGS_ipc_worker_threads));
+
   // start session watch dog timer
   session_handler_->StartWatchDog();
 
@@ -115,4 +157,49 @@ bool SessionServer::Process(absl::string_view request, std::string *response) {
 
   return true;
 }
+
+uint64_t SessionServer::GetOrderingKey(absl::string_view request) const {
+  // Reads only the type and the id, since the request is parsed in Process()
+  // anyway. A malformed request gets the key 0, and Process() rejects it.
+  protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t *>(request.data()), request.size());
+  uint32_t type = commands::Input::NONE;
+  uint64_t id = 0;
+  while (const uint32_t tag = input.ReadTag()) {
+    bool ok = true;
+    switch (tag) {
+      case MakeTag(commands::Input::kTypeFieldNumber, kWireTypeVarint): {
+        // Like the parser, ignores the values unknown to this version.
+        uint32_t value;
+        ok = input.ReadVarint32(&value);
+        if (ok && commands::Input::CommandType_IsValid(value)) {
+          type = value;
+        }
+        break;
+      }
+      case MakeTag(commands::Input::kIdFieldNumber, kWireTypeVarint):
+        ok = input.ReadVarint64(&id);
+        break;
+      default:
+        ok = SkipField(input, tag);
+        break;
+    }
+    if (!ok) {
+      return 0;
+    }
+  }
+  if (!input.ConsumedEntireMessage()) {
+    return 0;
+  }
+  switch (type) {
+    case commands::Input::SEND_KEY:
+    case commands::Input::TEST_SEND_KEY:
+    case commands::Input::SEND_COMMAND:
+      return id;
+    default:
+      // The other commands are not bound to a session. They are ordered with
+      // each other, and exclude the session commands in SessionHandler.
+      return 0;
+  }
+}
 }  // namespace mozc
@@ -32,6 +32,7 @@
 #ifndef MOZC_SESSION_SESSION_SERVER_H_
 #define MOZC_SESSION_SESSION_SERVER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -61,6 +62,9 @@ class SessionServer : public IPCServer {
 
   bool Process(absl::string_view request, std::string* response) override;
 
+  // Commands to a session are ordered by the session ID.
+  uint64_t GetOrderingKey(absl::string_view request) const override;
+
  private:
   std::unique_ptr<SessionHandler> session_handler_;
 };
@@ -133,6 +133,7 @@
       'target_name': 'session_key_handling_test',
       'type': 'executable',
       'sources': [
+        'candidate_delta_test.cc',
         'key_info_util_test.cc',
       ],
       'dependencies': [
@@ -140,6 +141,8 @@
         '<(mozc_oss_src_dir)/config/config.gyp:config_handler',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
         '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        '<(mozc_oss_src_dir)/testing/testing.gyp:testing_util',
+        'session_base.gyp:candidate_delta',
         'session_base.gyp:key_info_util',
       ],
       'variables': {
@@ -30,13 +30,18 @@
 #include "storage/encrypted_string_storage.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <ios>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/bits.h"
 #include "base/encryptor.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -58,6 +63,10 @@ constexpr size_t kSaltSize = 32;
 
 // Maximum file size (64Mbyte)
 constexpr size_t kMaxFileSize = 64 * 1024 * 1024;
+
+// Each record appended by Append() has the size of the encrypted body in the
+// network byte order, the salt, and the encrypted body.
+constexpr size_t kRecordHeaderSize = sizeof(uint32_t) + kSaltSize;
 }  // namespace
 
 bool EncryptedStringStorage::Load(std::string *output) const {
@@ -164,6 +173,82 @@ bool EncryptedStringStorage::Save(const std::string &input) const {
   return true;
 }
 
+bool EncryptedStringStorage::Append(const std::string &input) const {
+  const std::string salt = mozc::Random().ByteString(kSaltSize);
+
+  std::string output(input);
+  if (!Encrypt(salt, &output)) {
+    return false;
+  }
+
+  std::string header(sizeof(uint32_t), '\0');
+  StoreUnaligned<uint32_t>(HostToNet(static_cast<uint32_t>(output.size())),
+                           header.begin());
+  header.append(salt);
+
+  OutputFileStream ofs(filename_,
+                       std::ios::out | std::ios::app | std::ios::binary);
+  if (!ofs) {
+    LOG(ERROR) << "failed to open: " << filename_;
+    return false;
+  }
+  ofs.write(header.data(), header.size());
+  ofs.write(output.data(), output.size());
+  ofs.flush();
+  if (!ofs) {
+    LOG(ERROR) << "failed to append to: " << filename_;
+    return false;
+  }
+
+#ifdef _WIN32
+  if (!FileUtil::HideFile(filename_)) {
+    LOG(ERROR) << "Cannot make hidden: " << filename_ << " "
+               << ::GetLastError();
+  }
+#endif  // _WIN32
+
+  return true;
+}
+
+bool EncryptedStringStorage::LoadRecords(
+    std::vector<std::string> *output) const {
+  DCHECK(output);
+
+  const absl::StatusOr<Mmap> mmap = Mmap::Map(filename_, Mmap::READ_ONLY);
+  if (!mmap.ok()) {
+    MOZC_VLOG(1) << "cannot open: " << mmap.status();
+    return false;
+  }
+
+  if (mmap->size() > kMaxFileSize) {
+    LOG(ERROR) << "file size is too big.";
+    return false;
+  }
+
+  absl::string_view data(mmap->begin(), mmap->size());
+  while (!data.empty()) {
+    if (data.size() < kRecordHeaderSize) {
+      LOG(WARNING) << "truncated record header: " << filename_;
+      return false;
+    }
+    const size_t size = NetToHost(LoadUnaligned<uint32_t>(data.data()));
+    if (data.size() - kRecordHeaderSize < size) {
+      LOG(WARNING) << "truncated record: " << filename_;
+      return false;
+    }
+    const std::string salt(data.substr(sizeof(uint32_t), kSaltSize));
+    std::string record(data.substr(kRecordHeaderSize, size));
+    if (!Decrypt(salt, &record)) {
+      LOG(WARNING) << "broken record: " << filename_;
+      return false;
+    }
+    output->push_back(std::move(record));
+    data.remove_prefix(kRecordHeaderSize + size);
+  }
+
+  return true;
+}
+
 bool EncryptedStringStorage::Encrypt(const std::string &salt,
                                      std::string *data) const {
   DCHECK(data);
@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_ENCRYPTED_STRING_STORAGE_H_
 
 #include <string>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 
@@ -55,6 +56,18 @@ class EncryptedStringStorage : public StringStorageInterface {
   bool Load(std::string *output) const override;
   bool Save(const std::string &input) const override;
 
+  // Appends |input| to the file as an encrypted record, keeping the records
+  // appended before. Unlike Save(), it only writes the size of |input|, so it
+  // is suitable for journaling small changes.
+  bool Append(const std::string &input) const;
+
+  // Loads the records written by Append() in order. Returns false if the file
+  // cannot be read or has a broken record, e.g. the one partially written at
+  // a crash. In the latter case, the records before the broken one are still
+  // loaded, and the records after it are lost, so the caller should rewrite
+  // the file with Save().
+  bool LoadRecords(std::vector<std::string> *output) const;
+
  protected:
   virtual bool Encrypt(const std::string &salt, std::string *data) const;
   virtual bool Decrypt(const std::string &salt, std::string *data) const;
@@ -34,10 +34,14 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/system_util.h"
+#include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
 
@@ -45,6 +49,9 @@ namespace mozc {
 namespace storage {
 
 namespace {
+
+using ::testing::ElementsAre;
+
 #ifdef __ANDROID__
 // Mock the encryption/decryption for android.
 // For android, we use Java's library for encryption. However, we cannot use
@@ -103,6 +110,41 @@ TEST_F(EncryptedStringStorageTest, SaveAndLoad) {
 }
 
 #ifndef __ANDROID__
+TEST_F(EncryptedStringStorageTest, AppendAndLoadRecords) {
+  std::vector<std::string> records;
+  EXPECT_FALSE(storage_->LoadRecords(&records));
+
+  ASSERT_TRUE(storage_->Append("first"));
+  ASSERT_TRUE(storage_->Append(""));
+  ASSERT_TRUE(storage_->Append("third"));
+  ASSERT_TRUE(storage_->LoadRecords(&records));
+  EXPECT_THAT(records, ElementsAre("first", "", "third"));
+
+  // A partially written record is reported as broken.
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(filename_);
+  ASSERT_OK(contents);
+  ASSERT_OK(FileUtil::SetContents(
+      filename_, absl::string_view(*contents).substr(0, contents->size() - 1)));
+  records.clear();
+  EXPECT_FALSE(storage_->LoadRecords(&records));
+  EXPECT_THAT(records, ElementsAre("first", ""));
+
+  // The records appended after the torn one are not readable, and the file is
+  // still reported as broken.
+  ASSERT_TRUE(storage_->Append("fourth"));
+  ASSERT_TRUE(storage_->Append("fifth"));
+  records.clear();
+  EXPECT_FALSE(storage_->LoadRecords(&records));
+  EXPECT_THAT(records, ElementsAre("first", ""));
+
+  // A partially written header is reported as well.
+  ASSERT_OK(FileUtil::SetContents(filename_,
+                                  absl::string_view(*contents).substr(0, 3)));
+  records.clear();
+  EXPECT_FALSE(storage_->LoadRecords(&records));
+  EXPECT_TRUE(records.empty());
+}
+
 // Note: On Android, we cannot check the behavior of Encryption because
 // it depends on the JVM's behavior, which cannot be launched from native test.
 TEST_F(EncryptedStringStorageTest, Encrypt) {
@@ -34,7 +34,7 @@
 
 #include "absl/log/check.h"
 #include "base/bits.h"
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
 
 namespace mozc {
 namespace storage {
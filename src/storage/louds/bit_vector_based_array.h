@@ -33,7 +33,7 @@
 #include <cstddef>
 #include <cstdint>
 
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
 
 namespace mozc {
 namespace storage {
@@ -55,7 +55,7 @@ class BitVectorBasedArray {
   const char *Get(size_t index, size_t *length) const;
 
  private:
-  SimpleSuccinctBitVectorIndex index_;
+  RankSelectBitVectorIndex index_;
   size_t base_length_;
   size_t step_length_;
   const char *data_;
@@ -39,7 +39,7 @@
       ],
       'dependencies': [
         '<(mozc_oss_src_dir)/base/base.gyp:base',
-        'simple_succinct_bit_vector_index',
+        'rank_select_bit_vector_index',
       ],
     },
     {
@@ -54,7 +54,7 @@
         '<(mozc_oss_src_dir)/base/base.gyp:base',
         'bit_stream',
         'louds',
-        'simple_succinct_bit_vector_index',
+        'rank_select_bit_vector_index',
       ],
     },
     {
@@ -80,7 +80,7 @@
       'dependencies': [
         '<(mozc_oss_src_dir)/base/base.gyp:base',
         'bit_stream',
-        'simple_succinct_bit_vector_index',
+        'rank_select_bit_vector_index',
       ],
     },
     {
@@ -107,6 +107,17 @@
         '<(mozc_oss_src_dir)/base/base.gyp:base',
       ],
     },
+    {
+      'target_name': 'rank_select_bit_vector_index',
+      'type': 'static_library',
+      'toolsets': ['target', 'host'],
+      'sources': [
+        'rank_select_bit_vector_index.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/base/base.gyp:base',
+      ],
+    },
     # Bit stream implementation for builders.
     {
       'target_name': 'bit_stream',
@@ -34,7 +34,7 @@
 #include <cstdint>
 #include <memory>
 
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
 
 namespace mozc {
 namespace storage {
@@ -88,10 +88,11 @@ class Louds {
   ~Louds() = default;
 
   // Initializes this LOUDS from bit array.  To improve the performance of
-  // downward traversal (i.e., from root to leaves), set |bitvec_lb0_cache_size|
-  // and |select0_cache_size| to larger values.  On the other hand, to improve
-  // the performance of upward traversal (i.e., from leaves to the root), set
-  // |bitvec_lb1_cache_size| and |select1_cache_size| to larger values.
+  // downward traversal (i.e., from root to leaves), set |select0_cache_size|
+  // to a larger value.  On the other hand, to improve the performance of
+  // upward traversal (i.e., from leaves to the root), set |select1_cache_size|
+  // to a larger value.  |bitvec_lb0_cache_size| and |bitvec_lb1_cache_size|
+  // are no longer used by RankSelectBitVectorIndex.
   void Init(const uint8_t *image, int length, size_t bitvec_lb0_cache_size,
             size_t bitvec_lb1_cache_size, size_t select0_cache_size,
             size_t select1_cache_size);
@@ -139,6 +140,13 @@ class Louds {
     ++node->node_id_;
   }
 
+  // Moves the given node to its |n|-th next sibling, i.e., the same as calling
+  // MoveToNextSibling() |n| times.
+  static void MoveToNthNextSibling(int n, Node *node) {
+    node->edge_index_ += n;
+    node->node_id_ += n;
+  }
+
   // Moves the given node to its unique parent.  For example, in the above
   // diagram of tree, moves are as follows:
   //   * node 2 -> node 1
@@ -158,7 +166,7 @@ class Louds {
   }
 
  private:
-  SimpleSuccinctBitVectorIndex index_;
+  RankSelectBitVectorIndex index_;
   size_t select0_cache_size_ = 0;
   size_t select1_cache_size_ = 0;
   std::unique_ptr<int[]> select_cache_;
@@ -88,6 +88,22 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'rank_select_bit_vector_index_test',
+      'type': 'executable',
+      'sources': [
+        'rank_select_bit_vector_index_test.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_random',
+        '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        'louds.gyp:rank_select_bit_vector_index',
+        'louds.gyp:simple_succinct_bit_vector_index',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'bit_stream_test',
       'type': 'executable',
@@ -111,6 +127,7 @@
         'bit_vector_based_array_test',
         'louds_test',
         'louds_trie_test',
+        'rank_select_bit_vector_index_test',
         'simple_succinct_bit_vector_index_test',
       ],
     },
@@ -29,6 +29,8 @@
 
 #include "storage/louds/louds_trie.h"
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
 
@@ -36,7 +38,7 @@
 #include "absl/strings/string_view.h"
 #include "base/bits.h"
 #include "storage/louds/louds.h"
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
 
 namespace mozc {
 namespace storage {
@@ -46,7 +48,8 @@ bool LoudsTrie::Open(const uint8_t *image, size_t louds_lb0_cache_size,
                      size_t louds_lb1_cache_size,
                      size_t louds_select0_cache_size,
                      size_t louds_select1_cache_size,
-                     size_t termvec_lb1_cache_size) {
+                     size_t termvec_lb1_cache_size,
+                     size_t label_table_cache_size) {
   // Reads a binary image data, which is compatible with rx.
   // The format is as follows:
   // [trie size: little endian 4byte int]
@@ -88,6 +91,9 @@ bool LoudsTrie::Open(const uint8_t *image, size_t louds_lb0_cache_size,
                             termvec_lb1_cache_size);
   edge_character_ = reinterpret_cast<const char *>(edge_character);
 
+  // The edge characters have an entry for each node but the super root.
+  BuildLabelTables(label_table_cache_size, edge_character_size);
+
   return true;
 }
 
@@ -95,9 +101,71 @@ void LoudsTrie::Close() {
   louds_.Reset();
   terminal_bit_vector_.Reset();
   edge_character_ = nullptr;
+  label_table_index_.clear();
+  label_tables_.clear();
+}
+
+void LoudsTrie::BuildLabelTables(size_t cache_size, int num_nodes) {
+  label_table_index_.clear();
+  label_tables_.clear();
+  // Node IDs start from 1 (root).
+  const int size = std::min<size_t>(cache_size, num_nodes + 1);
+  if (size <= 1) {
+    return;
+  }
+  label_table_index_.assign(size, -1);
+  for (int node_id = 1; node_id < size; ++node_id) {
+    Node node;
+    louds_.InitNodeFromNodeId(node_id, &node);
+    MoveToFirstChild(&node);
+
+    LabelTable table = {};
+    table.first_child = node;
+    bool sorted = true;
+    int prev_label = -1;
+    for (; IsValidNode(node); MoveToNextSibling(&node)) {
+      const uint8_t label = GetEdgeLabelToParentNode(node);
+      sorted = sorted && prev_label < label;
+      prev_label = label;
+      table.label_bits[label / 32] |= uint32_t{1} << (label % 32);
+      ++table.num_children;
+    }
+    // The rank of a label gives the child only if the children are sorted,
+    // which LoudsTrieBuilder guarantees.
+    if (!sorted || table.num_children < kMinFanoutForLabelTable) {
+      continue;
+    }
+
+    int rank = 0;
+    for (int i = 0; i < 8; ++i) {
+      table.rank[i] = rank;
+      rank += std::popcount(table.label_bits[i]);
+    }
+    label_table_index_[node_id] = label_tables_.size();
+    label_tables_.push_back(table);
+  }
 }
 
 bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
+  if (static_cast<size_t>(node->node_id()) < label_table_index_.size()) {
+    const int index = label_table_index_[node->node_id()];
+    if (index >= 0) {
+      const LabelTable &table = label_tables_[index];
+      const uint8_t c = static_cast<uint8_t>(label);
+      const uint32_t word = table.label_bits[c / 32];
+      const uint32_t bit = uint32_t{1} << (c % 32);
+      *node = table.first_child;
+      if ((word & bit) == 0) {
+        // Leaves |node| invalid, just after the last child.
+        Louds::MoveToNthNextSibling(table.num_children, node);
+        return false;
+      }
+      Louds::MoveToNthNextSibling(
+          table.rank[c / 32] + std::popcount(word & (bit - 1)), node);
+      return true;
+    }
+  }
+
   MoveToFirstChild(node);
   while (IsValidNode(*node)) {
     if (GetEdgeLabelToParentNode(*node) == label) {
@@ -32,10 +32,11 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "storage/louds/louds.h"
-#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "storage/louds/rank_select_bit_vector_index.h"
 
 namespace mozc {
 namespace storage {
@@ -53,17 +54,24 @@ class LoudsTrie {
   LoudsTrie(const LoudsTrie &) = delete;
   LoudsTrie &operator=(const LoudsTrie &) = delete;
 
+  // The min number of children for a node to have a label table.
+  static constexpr int kMinFanoutForLabelTable = 8;
+
   // Opens the binary image and constructs the data structure.  The first four
   // cache sizes are passed to the underlying LOUDS.  See louds.h for more
-  // information of cache size.  The last one is passed to the underlying
-  // terminal bit vector.  This class doesn't own the "data", so it is caller's
-  // responsibility to keep the data alive until Close is invoked.  See .cc file
-  // for the detailed format of the binary image.
+  // information of cache size.  The fifth one is passed to the underlying
+  // terminal bit vector.  The last one is the number of nodes, counted from
+  // the root in BFS order, for which label tables are built; each of those
+  // nodes having kMinFanoutForLabelTable or more children finds its child by
+  // label in constant time.  This class doesn't own the "data", so it is
+  // caller's responsibility to keep the data alive until Close is invoked.
+  // See .cc file for the detailed format of the binary image.
   bool Open(const uint8_t *image, size_t louds_lb0_cache_size,
             size_t louds_lb1_cache_size, size_t louds_select0_cache_size,
-            size_t louds_select1_cache_size, size_t termvec_lb1_cache_size);
+            size_t louds_select1_cache_size, size_t termvec_lb1_cache_size,
+            size_t label_table_cache_size);
 
-  bool Open(const uint8_t *data) { return Open(data, 0, 0, 0, 0, 0); }
+  bool Open(const uint8_t *data) { return Open(data, 0, 0, 0, 0, 0, 0); }
 
   // Destructs the internal data structure explicitly (the destructor will do
   // clean up too).
@@ -186,6 +194,21 @@ class LoudsTrie {
   }
 
  private:
+  // The labels of the children of a node, as a bitmap over the 256 labels.
+  // The children are consecutive in LOUDS and sorted by label, so the child
+  // for a label is found by the rank of its bit.  Fits in a cache line.
+  struct alignas(64) LabelTable {
+    uint32_t label_bits[8];
+    // The number of children before each word of |label_bits|.
+    uint8_t rank[8];
+    Node first_child;
+    int num_children;
+  };
+
+  // Builds |label_tables_| for the high-fanout nodes among the first
+  // |cache_size| nodes.
+  void BuildLabelTables(size_t cache_size, int num_nodes);
+
   Louds louds_;  // Tree structure representation by LOUDS.
 
   // Bit-vector to represent whether each node in LOUDS tree is terminal.
@@ -194,12 +217,17 @@ class LoudsTrie {
   // id=10 in louds_ corresponds to id=9 in terminal_bit_vector_, and so on.
   // TODO(noriyukit): Simplify the id-mapping by introducing a bit for the
   // super root in this bit vector.
-  SimpleSuccinctBitVectorIndex terminal_bit_vector_;
+  RankSelectBitVectorIndex terminal_bit_vector_;
 
   // A sequence of characters, annotated to each edge.
   // This array also doesn't have an entry for super root.
   // In other words, id=2 in louds_ corresponds to edge_character_[1].
   const char *edge_character_ = nullptr;
+
+  // Maps node ID to the index of |label_tables_|, or -1 if the node doesn't
+  // have a label table.
+  std::vector<int> label_table_index_;
+  std::vector<LabelTable> label_tables_;
 };
 
 }  // namespace louds
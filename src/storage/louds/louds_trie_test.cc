@@ -31,6 +31,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
@@ -75,18 +76,21 @@ LoudsTrie::Node Traverse(const LoudsTrie &trie, absl::string_view key) {
 }
 
 struct CacheSizeParam {
-  CacheSizeParam(size_t lb0, size_t lb1, size_t s0, size_t s1, size_t term_lb1)
+  CacheSizeParam(size_t lb0, size_t lb1, size_t s0, size_t s1, size_t term_lb1,
+                 size_t label_table = 0)
       : louds_lb0_cache_size(lb0),
         louds_lb1_cache_size(lb1),
         louds_select0_cache_size(s0),
         louds_select1_cache_size(s1),
-        termvec_lb1_cache_size(term_lb1) {}
+        termvec_lb1_cache_size(term_lb1),
+        label_table_cache_size(label_table) {}
 
   size_t louds_lb0_cache_size;
   size_t louds_lb1_cache_size;
   size_t louds_select0_cache_size;
   size_t louds_select1_cache_size;
   size_t termvec_lb1_cache_size;
+  size_t label_table_cache_size;
 };
 
 class LoudsTrieTest : public ::testing::TestWithParam<CacheSizeParam> {};
@@ -112,7 +116,10 @@ class LoudsTrieTest : public ::testing::TestWithParam<CacheSizeParam> {};
           CacheSizeParam(1, 1, 1, 0, 0), CacheSizeParam(1, 1, 1, 0, 1), \
           CacheSizeParam(1, 1, 1, 1, 0), CacheSizeParam(1, 1, 1, 1, 1), \
           CacheSizeParam(2, 2, 2, 2, 2), CacheSizeParam(8, 8, 8, 8, 8), \
-          CacheSizeParam(1024, 1024, 1024, 1024, 1024)));
+          CacheSizeParam(1024, 1024, 1024, 1024, 1024),                 \
+          CacheSizeParam(0, 0, 0, 0, 0, 1),                             \
+          CacheSizeParam(0, 0, 0, 0, 0, 2),                             \
+          CacheSizeParam(1024, 1024, 1024, 1024, 1024, 1024)));
 
 TEST_P(LoudsTrieTest, NodeBasedApis) {
   // Create the following trie (* stands for non-terminal nodes):
@@ -140,7 +147,7 @@ TEST_P(LoudsTrieTest, NodeBasedApis) {
   trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
             param.louds_lb0_cache_size, param.louds_lb1_cache_size,
             param.louds_select0_cache_size, param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size, param.label_table_cache_size);
 
   char buf[LoudsTrie::kMaxDepth + 1];  // for RestoreKeyString().
 
@@ -358,7 +365,7 @@ TEST_P(LoudsTrieTest, HasKey) {
   trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
             param.louds_lb0_cache_size, param.louds_lb1_cache_size,
             param.louds_select0_cache_size, param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size, param.label_table_cache_size);
 
   EXPECT_TRUE(trie.HasKey("a"));
   EXPECT_TRUE(trie.HasKey("abc"));
@@ -431,7 +438,7 @@ TEST_P(LoudsTrieTest, PrefixSearch) {
   trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
             param.louds_lb0_cache_size, param.louds_lb1_cache_size,
             param.louds_select0_cache_size, param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size, param.label_table_cache_size);
   {
     const absl::string_view kKey = "abc";
     std::vector<RecordCallbackArgs::CallbackArgs> actual;
@@ -492,6 +499,41 @@ TEST_P(LoudsTrieTest, PrefixSearch) {
 }
 INSTANTIATE_TEST_CASE(GenPrefixSearchTest);
 
+TEST_P(LoudsTrieTest, HighFanout) {
+  // The root and "a" have enough children to have label tables.
+  LoudsTrieBuilder builder;
+  std::vector<std::string> keys;
+  for (int c = 1; c < 256; c += 3) {
+    keys.push_back(std::string(1, static_cast<char>(c)));
+    keys.push_back(std::string("a") + static_cast<char>(c));
+  }
+  for (const std::string &key : keys) {
+    builder.Add(key);
+  }
+  builder.Build();
+
+  const CacheSizeParam &param = GetParam();
+  LoudsTrie trie;
+  trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
+            param.louds_lb0_cache_size, param.louds_lb1_cache_size,
+            param.louds_select0_cache_size, param.louds_select1_cache_size,
+            param.termvec_lb1_cache_size, param.label_table_cache_size);
+
+  for (const std::string &key : keys) {
+    EXPECT_EQ(trie.ExactSearch(key), builder.GetId(key)) << key;
+  }
+  for (int c = 0; c < 256; c += 3) {
+    const std::string key(1, static_cast<char>(c));
+    EXPECT_FALSE(trie.HasKey(key)) << c;
+    EXPECT_FALSE(trie.HasKey("a" + key)) << c;
+  }
+
+  // A missing label leaves the node invalid.
+  LoudsTrie::Node node;
+  EXPECT_FALSE(trie.MoveToChildByLabel('\0', &node));
+  EXPECT_FALSE(trie.IsValidNode(node));
+}
+
 TEST_P(LoudsTrieTest, RestoreKeyString) {
   LoudsTrieBuilder builder;
   builder.Add("aa");
@@ -511,7 +553,7 @@ TEST_P(LoudsTrieTest, RestoreKeyString) {
   trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
             param.louds_lb0_cache_size, param.louds_lb1_cache_size,
             param.louds_select0_cache_size, param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size, param.label_table_cache_size);
 
   char buffer[LoudsTrie::kMaxDepth + 1];
   EXPECT_EQ(trie.RestoreKeyString(builder.GetId("aa"), buffer), "aa");
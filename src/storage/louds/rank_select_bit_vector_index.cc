@@ -0,0 +1,273 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/louds/rank_select_bit_vector_index.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "base/bits.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif  // __BMI2__
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+constexpr int kWordsPerBlock = RankSelectBitVectorIndex::kBlockBits / 64;
+
+// The binary search on the blocks switches to the linear scan when the range
+// fits in a few cache lines.
+constexpr int kMaxLinearScanBlocks = 8;
+
+// Returns the number of 1-bits in the preceding words of the j-th word in the
+// block (0 <= j < 8).
+inline int GetRelativeRank(uint64_t relative, int j) {
+  return j == 0 ? 0 : (relative >> (9 * (j - 1))) & 0x1FF;
+}
+
+#if !defined(__BMI2__)
+// kSelectInByteTable[n][b] is the position of the (n + 1)-th 1-bit in b.
+constexpr auto kSelectInByteTable = [] {
+  std::array<std::array<uint8_t, 256>, 8> table = {};
+  for (int b = 0; b < 256; ++b) {
+    int n = 0;
+    for (int i = 0; i < 8; ++i) {
+      if (b & (1 << i)) {
+        table[n++][b] = i;
+      }
+    }
+  }
+  return table;
+}();
+#endif  // !__BMI2__
+
+// Returns the position of the n-th 1-bit in the word (n is 1-origin).
+inline int SelectInWord(uint64_t word, int n) {
+  DCHECK_GT(n, 0);
+  DCHECK_LE(n, std::popcount(word));
+#if defined(__BMI2__)
+  return std::countr_zero(_pdep_u64(uint64_t{1} << (n - 1), word));
+#else   // __BMI2__
+  constexpr uint64_t kOnes = 0x0101010101010101;
+  constexpr uint64_t kHighs = 0x8080808080808080;
+  // The number of 1-bits in each byte.
+  uint64_t counts = word - ((word >> 1) & 0x5555555555555555);
+  counts = (counts & 0x3333333333333333) + ((counts >> 2) & 0x3333333333333333);
+  counts = (counts + (counts >> 4)) & 0x0F0F0F0F0F0F0F0F;
+  // The number of 1-bits in the byte and the preceding bytes.
+  const uint64_t prefix_counts = counts * kOnes;
+  // The high bit of each byte is set if the prefix count is at least n. The
+  // subtraction never borrows across bytes as the counts are at most 64.
+  const uint64_t reached = ((prefix_counts | kHighs) - n * kOnes) & kHighs;
+  const int byte_position = std::countr_zero(reached) & ~7;
+  if (byte_position > 0) {
+    n -= (prefix_counts >> (byte_position - 8)) & 0xFF;
+  }
+  const uint8_t byte = word >> byte_position;
+  return byte_position + kSelectInByteTable[n - 1][byte];
+#endif  // __BMI2__
+}
+
+}  // namespace
+
+uint64_t RankSelectBitVectorIndex::GetWord(int i) const {
+  if (8 * i + 8 <= length_) {
+    return LoadUnaligned<uint64_t>(data_ + 8 * i);
+  }
+  // The last 4 bytes.
+  return LoadUnaligned<uint32_t>(data_ + 8 * i);
+}
+
+void RankSelectBitVectorIndex::Init(const uint8_t *data, int length) {
+  DCHECK_EQ(length % 4, 0);
+  data_ = data;
+  length_ = length;
+
+  const int num_words = (length + 7) / 8;
+  const int num_blocks = (num_words + kWordsPerBlock - 1) / kWordsPerBlock;
+  blocks_.assign(num_blocks + 1, Block{0, 0});
+  select0_samples_.clear();
+  select1_samples_.clear();
+
+  // Iterate to the end of the last block so that the relative counts beyond
+  // the data are filled, too.
+  int num_0_bits = 0;
+  int num_1_bits = 0;
+  for (int i = 0; i < num_blocks * kWordsPerBlock; ++i) {
+    const int block = i / kWordsPerBlock;
+    const int j = i % kWordsPerBlock;
+    if (j == 0) {
+      blocks_[block].absolute = num_1_bits;
+    } else {
+      const uint64_t relative = num_1_bits - blocks_[block].absolute;
+      blocks_[block].relative |= relative << (9 * (j - 1));
+    }
+    if (i >= num_words) {
+      continue;
+    }
+
+    const uint64_t word = GetWord(i);
+    const int word_bits = 8 * i + 8 <= length ? 64 : 32;
+    const int count1 = std::popcount(word);
+    const int count0 = word_bits - count1;
+    // Sample the block if the next sampled bit is in this word. At most one
+    // sample falls in a word as the interval is longer than it.
+    const int num_0_samples = select0_samples_.size();
+    if (num_0_samples * kSelectSampleInterval < num_0_bits + count0) {
+      select0_samples_.push_back(block);
+    }
+    const int num_1_samples = select1_samples_.size();
+    if (num_1_samples * kSelectSampleInterval < num_1_bits + count1) {
+      select1_samples_.push_back(block);
+    }
+    num_0_bits += count0;
+    num_1_bits += count1;
+  }
+  blocks_[num_blocks].absolute = num_1_bits;
+  num_1_bits_ = num_1_bits;
+
+  const int last_block = num_blocks > 0 ? num_blocks - 1 : 0;
+  select0_samples_.push_back(last_block);
+  select1_samples_.push_back(last_block);
+}
+
+void RankSelectBitVectorIndex::Reset() {
+  data_ = nullptr;
+  length_ = 0;
+  num_1_bits_ = 0;
+  blocks_.clear();
+  select0_samples_.clear();
+  select1_samples_.clear();
+}
+
+int RankSelectBitVectorIndex::Rank1(int n) const {
+  const Block &block = blocks_[n / kBlockBits];
+  const int word_index = n / 64;
+  int result = static_cast<int>(block.absolute) +
+               GetRelativeRank(block.relative, word_index % kWordsPerBlock);
+  if (n % 64 > 0) {
+    const uint64_t mask = (uint64_t{1} << (n % 64)) - 1;
+    result += std::popcount(GetWord(word_index) & mask);
+  }
+  return result;
+}
+
+int RankSelectBitVectorIndex::FindBlock0(int n) const {
+  const int sample = (n - 1) / kSelectSampleInterval;
+  int lo = select0_samples_[sample];
+  int hi = select0_samples_[sample + 1];
+  // Finds the last block having less than n 0-bits before it.
+  auto num_0_bits_before = [this](int b) {
+    return kBlockBits * b - static_cast<int>(blocks_[b].absolute);
+  };
+  while (hi - lo > kMaxLinearScanBlocks) {
+    const int mid = lo + (hi - lo + 1) / 2;
+    if (num_0_bits_before(mid) < n) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  while (lo < hi && num_0_bits_before(lo + 1) < n) {
+    ++lo;
+  }
+  return lo;
+}
+
+int RankSelectBitVectorIndex::FindBlock1(int n) const {
+  const int sample = (n - 1) / kSelectSampleInterval;
+  int lo = select1_samples_[sample];
+  int hi = select1_samples_[sample + 1];
+  // Finds the last block having less than n 1-bits before it.
+  while (hi - lo > kMaxLinearScanBlocks) {
+    const int mid = lo + (hi - lo + 1) / 2;
+    if (static_cast<int>(blocks_[mid].absolute) < n) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  while (lo < hi && static_cast<int>(blocks_[lo + 1].absolute) < n) {
+    ++lo;
+  }
+  return lo;
+}
+
+int RankSelectBitVectorIndex::Select0(int n) const {
+  DCHECK_GT(n, 0);
+  DCHECK_LE(n, GetNum0Bits());
+
+  const int block_index = FindBlock0(n);
+  const Block &block = blocks_[block_index];
+  n -= kBlockBits * block_index - static_cast<int>(block.absolute);
+
+  // Finds the last word having less than n 0-bits before it in the block.
+  int j = 0;
+  while (j + 1 < kWordsPerBlock &&
+         64 * (j + 1) - GetRelativeRank(block.relative, j + 1) < n) {
+    ++j;
+  }
+  n -= 64 * j - GetRelativeRank(block.relative, j);
+
+  const int word_index = block_index * kWordsPerBlock + j;
+  return 64 * word_index + SelectInWord(~GetWord(word_index), n);
+}
+
+int RankSelectBitVectorIndex::Select1(int n) const {
+  DCHECK_GT(n, 0);
+  DCHECK_LE(n, GetNum1Bits());
+
+  const int block_index = FindBlock1(n);
+  const Block &block = blocks_[block_index];
+  n -= static_cast<int>(block.absolute);
+
+  // Finds the last word having less than n 1-bits before it in the block.
+  int j = 0;
+  while (j + 1 < kWordsPerBlock &&
+         GetRelativeRank(block.relative, j + 1) < n) {
+    ++j;
+  }
+  n -= GetRelativeRank(block.relative, j);
+
+  const int word_index = block_index * kWordsPerBlock + j;
+  return 64 * word_index + SelectInWord(GetWord(word_index), n);
+}
+
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
@@ -0,0 +1,137 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_STORAGE_LOUDS_RANK_SELECT_BIT_VECTOR_INDEX_H_
+#define MOZC_STORAGE_LOUDS_RANK_SELECT_BIT_VECTOR_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mozc {
+namespace storage {
+namespace louds {
+
+// Rank/select index of a bit vector, which is a drop-in replacement of
+// SimpleSuccinctBitVectorIndex with faster queries.
+//
+// The bit vector is split into blocks of 512 bits. Each block has a 16-byte
+// entry holding both the number of 1-bits preceding the block and the number
+// of 1-bits preceding each 64-bit word in the block (7 x 9 bits, as in
+// Vigna's rank9). Thus Rank1 touches exactly one entry of the index and one
+// word of the data, and the entries never straddle a cache line.
+//
+// Select0 and Select1 first look up the block from the samples taken at every
+// kSelectSampleInterval-th 0- and 1-bit, then pick the word by the relative
+// counts and finally find the bit in the word (with PDEP if BMI2 is
+// available at compile time).
+//
+// The index is built from the bit vector on Init(), so the serialized image
+// is the same as the one for SimpleSuccinctBitVectorIndex.
+class RankSelectBitVectorIndex {
+ public:
+  static constexpr int kBlockBits = 512;
+  static constexpr int kSelectSampleInterval = 512;
+
+  RankSelectBitVectorIndex() = default;
+
+  // Initializes the index. This class doesn't have the ownership of the memory
+  // pointed by data, so it is caller's responsibility to manage its life time.
+  // The length is in bytes and needs to be a multiple of 4.
+  void Init(const uint8_t *data, int length);
+
+  // The lower bound cache sizes are accepted for the compatibility with
+  // SimpleSuccinctBitVectorIndex. They are not used because the select
+  // samples always cover the whole bit vector.
+  void Init(const uint8_t *data, int length, size_t lb0_cache_size,
+            size_t lb1_cache_size) {
+    Init(data, length);
+  }
+
+  // Resets the internal state, especially releases the allocated memory
+  // for the index used internally.
+  void Reset();
+
+  // Returns the bit at the index in data. The index in a byte is as follows;
+  // MSB|XXXXXXXX|LSB
+  //     76543210
+  int Get(int index) const { return (data_[index / 8] >> (index % 8)) & 1; }
+
+  // Returns the number of 0-bit in [0, n) bits of data.
+  int Rank0(int n) const { return n - Rank1(n); }
+
+  // Returns the number of 1-bit in [0, n) bits of data.
+  int Rank1(int n) const;
+
+  // Returns the position of n-th 0-bit on the data. (n is 1-origin).
+  // Returned index is 0-origin.
+  int Select0(int n) const;
+
+  // Returns the position of n-th 1-bit in the data. (n is 1-origin).
+  // Returned index is 0-origin.
+  int Select1(int n) const;
+
+  int GetNum1Bits() const { return num_1_bits_; }
+  int GetNum0Bits() const { return 8 * length_ - num_1_bits_; }
+
+ private:
+  struct alignas(16) Block {
+    // The number of 1-bits in the preceding blocks.
+    uint64_t absolute;
+    // The number of 1-bits in the preceding words in this block. The i-th
+    // 9-bit field (i = 0, ..., 6) is for the (i + 1)-th word.
+    uint64_t relative;
+  };
+
+  // Returns the i-th 64-bit word of the data. The last word is padded with
+  // 0-bits if the length is not a multiple of 8.
+  uint64_t GetWord(int i) const;
+
+  // Returns the index of the block which contains the n-th 0-bit or 1-bit.
+  int FindBlock0(int n) const;
+  int FindBlock1(int n) const;
+
+  const uint8_t *data_ = nullptr;
+  int length_ = 0;
+  int num_1_bits_ = 0;
+  // Blocks followed by a sentinel.
+  std::vector<Block> blocks_;
+  // select0_samples_[i] is the index of the block containing the
+  // (i * kSelectSampleInterval + 1)-th 0-bit, and the last element is the
+  // index of the last block. The same for select1_samples_.
+  std::vector<int> select0_samples_;
+  std::vector<int> select1_samples_;
+};
+
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_LOUDS_RANK_SELECT_BIT_VECTOR_INDEX_H_
@@ -0,0 +1,129 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/louds/rank_select_bit_vector_index.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "storage/louds/simple_succinct_bit_vector_index.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+TEST(RankSelectBitVectorIndexTest, RankAndSelect) {
+  static constexpr char kData[] = "\x00\x00\xFF\xFF\x00\x00\xFF\xFF";
+  RankSelectBitVectorIndex bit_vector;
+  bit_vector.Init(reinterpret_cast<const uint8_t *>(kData), 8);
+  EXPECT_EQ(bit_vector.GetNum0Bits(), 32);
+  EXPECT_EQ(bit_vector.GetNum1Bits(), 32);
+
+  for (int i = 0; i <= 16; ++i) {
+    EXPECT_EQ(bit_vector.Rank0(i), i) << i;
+    EXPECT_EQ(bit_vector.Rank1(i), 0) << i;
+  }
+  for (int i = 17; i <= 32; ++i) {
+    EXPECT_EQ(bit_vector.Rank0(i), 16) << i;
+    EXPECT_EQ(bit_vector.Rank1(i), i - 16) << i;
+  }
+  for (int i = 33; i <= 48; ++i) {
+    EXPECT_EQ(bit_vector.Rank0(i), i - 16) << i;
+    EXPECT_EQ(bit_vector.Rank1(i), 16) << i;
+  }
+  for (int i = 49; i <= 64; ++i) {
+    EXPECT_EQ(bit_vector.Rank0(i), 32) << i;
+    EXPECT_EQ(bit_vector.Rank1(i), i - 32) << i;
+  }
+
+  for (int i = 1; i <= 16; ++i) {
+    EXPECT_EQ(bit_vector.Select0(i), i - 1) << i;
+    EXPECT_EQ(bit_vector.Select1(i), i + 15) << i;
+  }
+  for (int i = 17; i <= 32; ++i) {
+    EXPECT_EQ(bit_vector.Select0(i), i + 15) << i;
+    EXPECT_EQ(bit_vector.Select1(i), i + 31) << i;
+  }
+}
+
+TEST(RankSelectBitVectorIndexTest, Reset) {
+  const std::string data(64, '\x0F');
+  RankSelectBitVectorIndex bit_vector;
+  bit_vector.Init(reinterpret_cast<const uint8_t *>(data.data()),
+                  data.size());
+  EXPECT_EQ(bit_vector.GetNum1Bits(), 256);
+  bit_vector.Reset();
+  EXPECT_EQ(bit_vector.GetNum0Bits(), 0);
+  EXPECT_EQ(bit_vector.GetNum1Bits(), 0);
+}
+
+// Compares the results with SimpleSuccinctBitVectorIndex on random bit
+// vectors of various densities. The lengths are chosen so that the last
+// block is partial and the last word may have only 32 bits.
+TEST(RankSelectBitVectorIndexTest, CompareWithSimpleIndex) {
+  absl::BitGen gen;
+  for (const int length : {4, 8, 60, 64, 68, 1020, 4096, 10004}) {
+    for (const double density : {0.001, 0.1, 0.5, 0.9, 0.999}) {
+      std::vector<uint8_t> data(length);
+      for (int i = 0; i < length * 8; ++i) {
+        if (absl::Bernoulli(gen, density)) {
+          data[i / 8] |= 1 << (i % 8);
+        }
+      }
+      SimpleSuccinctBitVectorIndex expected;
+      expected.Init(data.data(), length);
+      RankSelectBitVectorIndex actual;
+      actual.Init(data.data(), length);
+
+      SCOPED_TRACE(testing::Message()
+                   << "length: " << length << ", density: " << density);
+      ASSERT_EQ(actual.GetNum0Bits(), expected.GetNum0Bits());
+      ASSERT_EQ(actual.GetNum1Bits(), expected.GetNum1Bits());
+      for (int i = 0; i <= length * 8; ++i) {
+        ASSERT_EQ(actual.Rank1(i), expected.Rank1(i)) << i;
+      }
+      for (int i = 1; i <= expected.GetNum0Bits(); ++i) {
+        ASSERT_EQ(actual.Select0(i), expected.Select0(i)) << i;
+      }
+      for (int i = 1; i <= expected.GetNum1Bits(); ++i) {
+        ASSERT_EQ(actual.Select1(i), expected.Select1(i)) << i;
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
@@ -36,7 +36,6 @@
 #include <ctime>
 #include <ios>
 #include <iterator>
-#include <list>
 #include <memory>
 #include <string>
 #include <utility>
@@ -48,6 +47,7 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "base/bits.h"
@@ -65,14 +65,60 @@ namespace {
 constexpr size_t kMaxLruSize = 1000000;  // 1M
 constexpr size_t kMaxValueSize = 1024;   // 1024 byte
 
-// The byte length used to store LRU properties.
+// The byte length used to store LRU properties in the version 0 layout.
 // * 4 bytes for user specified value size
 // * 4 bytes for LRU capacity
 // * 4 bytes for fingerprint seed
-constexpr size_t kFileHeaderSize = 12;
+constexpr size_t kVersion0HeaderSize = 12;
+
+// The header of the current layout. The first field never matches a valid
+// value size of the version 0 layout.
+constexpr uint32_t kFileMagic = 0x3155524c;  // "LRU1"
+constexpr size_t kMagicOffset = 0;
+constexpr size_t kValueSizeOffset = 4;
+constexpr size_t kSizeOffset = 8;
+constexpr size_t kSeedOffset = 12;
+constexpr size_t kFlagsOffset = 16;
+constexpr size_t kUsedSizeOffset = 20;
+constexpr size_t kHeadOffset = 24;
+constexpr size_t kTailOffset = 28;
+constexpr size_t kFileHeaderSize = 32;
+
+// Set while the file is open. The links and the index may be inconsistent
+// with the items if the process exits without closing the file.
+constexpr uint32_t kDirtyFlag = 1;
+
+// The byte length of the LRU links of each item.
+constexpr size_t kLinkSize = 8;
+// The byte length of each bucket of the hash index.
+constexpr size_t kBucketSize = 4;
 
 constexpr uint64_t k62DaysInSec = 62 * 24 * 60 * 60;
 
+size_t GetNumBuckets(size_t size) { return size * 2; }
+
+size_t GetFileSize(size_t value_size, size_t size) {
+  return kFileHeaderSize +
+         size * (value_size + LruStorage::kItemHeaderSize + kLinkSize) +
+         GetNumBuckets(size) * kBucketSize;
+}
+
+bool IsValidProperties(size_t value_size, size_t size) {
+  if (value_size == 0 || value_size > kMaxValueSize) {
+    LOG(ERROR) << "value_size is out of range: " << value_size;
+    return false;
+  }
+  if (size == 0 || size > kMaxLruSize) {
+    LOG(ERROR) << "size is out of range: " << size;
+    return false;
+  }
+  if (value_size % 4 != 0) {
+    LOG(ERROR) << "value_size_ must be 4 byte alignment";
+    return false;
+  }
+  return true;
+}
+
 uint64_t GetFP(const char *ptr) { return LoadUnaligned<uint64_t>(ptr); }
 
 uint32_t GetTimeStamp(const char *ptr) {
@@ -132,18 +178,7 @@ std::unique_ptr<LruStorage> LruStorage::Create(const char *filename,
 
 bool LruStorage::CreateStorageFile(const char *filename, size_t value_size,
                                    size_t size, uint32_t seed) {
-  if (value_size == 0 || value_size > kMaxValueSize) {
-    LOG(ERROR) << "value_size is out of range";
-    return false;
-  }
-
-  if (size == 0 || size > kMaxLruSize) {
-    LOG(ERROR) << "size is out of range";
-    return false;
-  }
-
-  if (value_size % 4 != 0) {
-    LOG(ERROR) << "value_size_ must be 4 byte alignment";
+  if (!IsValidProperties(value_size, size)) {
     return false;
   }
 
@@ -153,42 +188,32 @@ bool LruStorage::CreateStorageFile(const char *filename, size_t value_size,
     return false;
   }
 
-  const uint32_t value_size_uint32 = static_cast<uint32_t>(value_size);
-  const uint32_t size_uint32 = static_cast<uint32_t>(size);
-
-  ofs.write(reinterpret_cast<const char *>(&value_size_uint32),
-            sizeof(value_size_uint32));
-  ofs.write(reinterpret_cast<const char *>(&size_uint32), sizeof(size_uint32));
-  ofs.write(reinterpret_cast<const char *>(&seed), sizeof(seed));
-  std::vector<char> ary(value_size, '\0');
-  const uint32_t last_access_time = 0;
-  const uint64_t fp = 0;
-
-  for (size_t i = 0; i < size; ++i) {
-    ofs.write(reinterpret_cast<const char *>(&fp), sizeof(fp));
-    ofs.write(reinterpret_cast<const char *>(&last_access_time),
-              sizeof(last_access_time));
-    ofs.write(reinterpret_cast<const char *>(&ary[0]),
-              static_cast<std::streamsize>(ary.size() * sizeof(ary[0])));
-  }
+  // All the fields but the following are initialized to zero.
+  std::string header(kFileHeaderSize, '\0');
+  StoreUnaligned<uint32_t>(kFileMagic, header.data() + kMagicOffset);
+  StoreUnaligned<uint32_t>(value_size, header.data() + kValueSizeOffset);
+  StoreUnaligned<uint32_t>(size, header.data() + kSizeOffset);
+  StoreUnaligned<uint32_t>(seed, header.data() + kSeedOffset);
+  StoreUnaligned<uint32_t>(kNoItem, header.data() + kHeadOffset);
+  StoreUnaligned<uint32_t>(kNoItem, header.data() + kTailOffset);
+  ofs.write(header.data(), header.size());
 
+  const std::vector<char> zeros(GetFileSize(value_size, size) - header.size(),
+                                '\0');
+  ofs.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
   return true;
 }
 
 // Reopen file after initializing mapped page.
 bool LruStorage::Clear() {
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.empty() || lru_list_.empty()) {
+  if (mmap_.empty() || used_size() == 0) {
     return true;
   }
-  const size_t offset = sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
-  if (offset >= mmap_.size()) {  // should not happen
-    return false;
-  }
-  std::fill(mmap_.begin() + offset, mmap_.end(), 0);
-  lru_list_.clear();
-  lru_map_.clear();
-  Open(mmap_.begin(), mmap_.size());
+  std::fill(items_, mmap_.end(), 0);
+  SetHeaderField(kUsedSizeOffset, 0);
+  SetHeaderField(kHeadOffset, kNoItem);
+  SetHeaderField(kTailOffset, kNoItem);
   return true;
 }
 
@@ -212,23 +237,13 @@ bool LruStorage::Merge(const LruStorage &storage) {
   std::vector<const char *> ary;
 
   // this file
-  {
-    const char *begin = begin_;
-    const char *end = end_;
-    while (begin < end) {
-      ary.push_back(begin);
-      begin += item_size();
-    }
+  for (uint32_t i = 0; i < size_; ++i) {
+    ary.push_back(GetItem(i));
   }
 
   // target file
-  {
-    const char *begin = storage.begin_;
-    const char *end = storage.end_;
-    while (begin < end) {
-      ary.push_back(begin);
-      begin += item_size();
-    }
+  for (uint32_t i = 0; i < storage.size_; ++i) {
+    ary.push_back(storage.GetItem(i));
   }
 
   std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
@@ -242,18 +257,19 @@ bool LruStorage::Merge(const LruStorage &storage) {
     buf.append(const_cast<const char *>(ary[i]), item_size());
   }
 
-  const size_t old_size = static_cast<size_t>(end_ - begin_);
+  const size_t old_size = size_ * item_size();
   const size_t new_size = std::min(buf.size(), old_size);
 
   // TODO(taku): this part is not atomic.
   // If the converter process is killed while memcpy or memset is running,
   // the storage data will be broken.
-  char *new_end = absl::c_copy_n(buf, new_size, begin_);
+  char *new_end = absl::c_copy_n(buf, new_size, items_);
   if (new_size < old_size) {
-    std::fill(new_end, end_, 0);
+    std::fill(new_end, items_ + old_size, 0);
   }
 
-  return Open(mmap_.begin(), mmap_.size());
+  Rebuild();
+  return true;
 }
 
 bool LruStorage::OpenOrCreate(const char *filename, size_t new_value_size,
@@ -316,6 +332,9 @@ bool LruStorage::OpenOrCreate(const char *filename, size_t new_value_size,
 }
 
 bool LruStorage::Open(const char *filename) {
+  // Closes the current file first so that its dirty flag is cleared, e.g. when
+  // the same file is opened again on reload.
+  Close();
   absl::StatusOr<Mmap> mmap = Mmap::Map(filename, Mmap::READ_WRITE);
   if (!mmap.ok()) {
     LOG(ERROR) << "Cannot open " << filename
@@ -329,233 +348,318 @@ bool LruStorage::Open(const char *filename) {
     return false;
   }
 
+  if (LoadUnaligned<uint32_t>(mmap_.begin()) != kFileMagic &&
+      !MigrateFromVersion0(filename)) {
+    mmap_.Close();
+    return false;
+  }
+
   filename_ = filename;
   return Open(mmap_.begin(), mmap_.size());
 }
 
 bool LruStorage::Open(char *ptr, size_t ptr_size) {
-  begin_ = ptr;
-  end_ = ptr + ptr_size;
+  header_ = nullptr;
+  if (ptr_size < kFileHeaderSize ||
+      LoadUnaligned<uint32_t>(ptr + kMagicOffset) != kFileMagic) {
+    LOG(ERROR) << "LRU file is broken";
+    return false;
+  }
 
-  value_size_ = LoadUnalignedAdvance<uint32_t>(begin_);
-  size_ = LoadUnalignedAdvance<uint32_t>(begin_);
-  seed_ = LoadUnalignedAdvance<uint32_t>(begin_);
+  value_size_ = LoadUnaligned<uint32_t>(ptr + kValueSizeOffset);
+  size_ = LoadUnaligned<uint32_t>(ptr + kSizeOffset);
+  seed_ = LoadUnaligned<uint32_t>(ptr + kSeedOffset);
 
-  if (value_size_ % 4 != 0) {
-    LOG(ERROR) << "value_size_ must be 4 byte alignment";
+  if (!IsValidProperties(value_size_, size_)) {
     return false;
   }
 
-  if (size_ == 0 || size_ > kMaxLruSize) {
-    LOG(ERROR) << "LRU size is invalid: " << size_;
+  if (ptr_size != GetFileSize(value_size_, size_)) {
+    LOG(ERROR) << "LRU file is broken";
     return false;
   }
 
-  if (value_size_ == 0 || value_size_ > kMaxValueSize) {
-    LOG(ERROR) << "value_size is invalid: " << value_size_;
-    return false;
+  num_buckets_ = GetNumBuckets(size_);
+  header_ = ptr;
+  items_ = header_ + kFileHeaderSize;
+  links_ = items_ + size_ * item_size();
+  index_ = links_ + size_ * kLinkSize;
+
+  const uint32_t used = used_size();
+  const bool is_valid_list =
+      (used == 0 && head() == kNoItem && tail() == kNoItem) ||
+      (used <= size_ && head() < used && tail() < used);
+  if ((GetHeaderField(kFlagsOffset) & kDirtyFlag) || !is_valid_list) {
+    LOG(WARNING) << "LRU file was not closed cleanly. Rebuilding the index.";
+    Rebuild();
   }
+  SetHeaderField(kFlagsOffset, kDirtyFlag);
 
-  if (mmap_.size() != kFileHeaderSize + item_size() * size_) {
+  // At the time file is opened, perform clean up.
+  DeleteElementsUntouchedFor62Days();
+
+  return true;
+}
+
+bool LruStorage::MigrateFromVersion0(const char *filename) {
+  const char *ptr = mmap_.begin();
+  const uint32_t value_size = LoadUnalignedAdvance<uint32_t>(ptr);
+  const uint32_t size = LoadUnalignedAdvance<uint32_t>(ptr);
+  const uint32_t seed = LoadUnalignedAdvance<uint32_t>(ptr);
+  if (!IsValidProperties(value_size, size) ||
+      mmap_.size() !=
+          kVersion0HeaderSize + (value_size + kItemHeaderSize) * size) {
     LOG(ERROR) << "LRU file is broken";
     return false;
   }
 
+  // The items have the same layout in both versions.
+  const std::string tmp_filename = absl::StrCat(filename, ".tmp");
+  {
+    if (!CreateStorageFile(tmp_filename.c_str(), value_size, size, seed)) {
+      return false;
+    }
+    LruStorage storage;
+    if (!storage.Open(tmp_filename.c_str())) {
+      return false;
+    }
+    std::copy_n(ptr, (value_size + kItemHeaderSize) * size, storage.items_);
+    storage.Rebuild();
+  }
+  mmap_.Close();
+
+  if (absl::Status s = FileUtil::AtomicRename(tmp_filename, filename);
+      !s.ok()) {
+    LOG(ERROR) << "Cannot migrate " << filename << ": " << s;
+    FileUtil::UnlinkOrLogError(tmp_filename);
+    return false;
+  }
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename, Mmap::READ_WRITE);
+  if (!mmap.ok()) {
+    LOG(ERROR) << "Cannot open " << filename
+               << " with read+write mode: " << mmap.status();
+    return false;
+  }
+  mmap_ = *std::move(mmap);
+  MOZC_VLOG(1) << filename << " is migrated from version 0";
+  return true;
+}
+
+void LruStorage::Rebuild() {
+  // The items are sorted by the timestamps, which have only the resolution of
+  // seconds. The items in the LRU list come first in the list order as far as
+  // the links are consistent, so that the items with the same timestamp keep
+  // their order.
   std::vector<char *> ary;
-  for (char *begin = begin_; begin < end_; begin += item_size()) {
-    ary.push_back(begin);
+  std::vector<bool> listed(size_, false);
+  const uint32_t used_before = std::min<uint32_t>(used_size(), size_);
+  uint32_t prev = kNoItem;
+  for (uint32_t i = head(); i < used_before && !listed[i] && GetPrev(i) == prev;
+       i = GetNext(i)) {
+    listed[i] = true;
+    ary.push_back(GetItem(i));
+    prev = i;
+  }
+  for (uint32_t i = 0; i < size_; ++i) {
+    if (!listed[i]) {
+      ary.push_back(GetItem(i));
+    }
   }
   std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
 
-  lru_list_.clear();
-  lru_map_.clear();
-  char *next = nullptr;
-  for (size_t i = 0; i < ary.size(); ++i) {
-    if (GetTimeStamp(ary[i]) != 0) {
-      lru_list_.push_back(ary[i]);
-      lru_map_[GetFP(ary[i])] = std::prev(lru_list_.end());
-    } else if (next == nullptr) {
-      next = ary[i];
+  // Packs the items in use in the order from new to old.
+  std::string buf;
+  absl::flat_hash_set<uint64_t> seen;
+  for (const char *item : ary) {
+    if (GetTimeStamp(item) == 0) {
+      break;
+    }
+    if (seen.insert(GetFP(item)).second) {
+      buf.append(item, item_size());
     }
   }
-  next_item_ = (next != nullptr) ? next : end_;
-  DCHECK_LE(next_item_, end_);
-
-  // At the time file is opened, perform clean up.
-  DeleteElementsUntouchedFor62Days();
+  const uint32_t used = buf.size() / item_size();
+  char *end = absl::c_copy(buf, items_);
+  std::fill(end, items_ + size_ * item_size(), 0);
 
-  return true;
+  std::fill(links_, links_ + size_ * kLinkSize, 0);
+  std::fill(index_, index_ + num_buckets_ * kBucketSize, 0);
+  for (uint32_t i = 0; i < used; ++i) {
+    SetPrev(i, i == 0 ? kNoItem : i - 1);
+    SetNext(i, i + 1 == used ? kNoItem : i + 1);
+    AddToIndex(GetFP(GetItem(i)), i);
+  }
+  SetHeaderField(kUsedSizeOffset, used);
+  SetHeaderField(kHeadOffset, used == 0 ? kNoItem : 0);
+  SetHeaderField(kTailOffset, used == 0 ? kNoItem : used - 1);
 }
 
 void LruStorage::Close() {
-  // Perform clean up before closing the file.
-  DeleteElementsUntouchedFor62Days();
+  if (header_ != nullptr && !mmap_.empty()) {
+    // Perform clean up before closing the file.
+    DeleteElementsUntouchedFor62Days();
+    SetHeaderField(kFlagsOffset, 0);
+  }
 
   filename_.clear();
+  header_ = nullptr;
   mmap_.Close();
-  lru_list_.clear();
-  lru_map_.clear();
+}
+
+size_t LruStorage::used_size() const {
+  return header_ == nullptr ? 0 : GetHeaderField(kUsedSizeOffset);
 }
 
 const char *LruStorage::Lookup(const absl::string_view key,
                                uint32_t *last_access_time) const {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  const auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t i = FindItem(fp);
+  if (i == kNoItem) {
     return nullptr;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const uint32_t timestamp = GetTimeStamp(GetItem(i));
   if (IsOlderThan62Days(timestamp)) {
     return nullptr;
   }
   *last_access_time = timestamp;
-  return GetValue(*it->second);
+  return GetValue(GetItem(i));
 }
 
 void LruStorage::GetAllValues(std::vector<std::string> *values) const {
   DCHECK(values);
   values->clear();
   // Iterate data from the most recently used element to the least recently used
-  // element.
-  for (const char *ptr : lru_list_) {
+  // element. The number of steps is bounded in case the links are broken.
+  const uint32_t used = used_size();
+  for (uint32_t i = header_ == nullptr ? kNoItem : head();
+       i < used && values->size() < used; i = GetNext(i)) {
+    const char *ptr = GetItem(i);
     const uint32_t timestamp = GetTimeStamp(ptr);
     if (IsOlderThan62Days(timestamp)) {
       break;
     }
     // Default constructor of string is not applicable
     // because value's size() must return value_size_.
-    DCHECK(ptr);
     values->emplace_back(GetValue(ptr), value_size_);
   }
 }
 
 bool LruStorage::Touch(const absl::string_view key) {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t i = FindItem(fp);
+  if (i == kNoItem) {
     return false;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const uint32_t timestamp = GetTimeStamp(GetItem(i));
   if (IsOlderThan62Days(timestamp)) {
     return false;
   }
-  Update(*it->second);
-  // Move the node pointed to by it->second to the front.
-  lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  Update(GetItem(i));
+  MoveToFront(i);
   return true;
 }
 
 bool LruStorage::Insert(const absl::string_view key, const char *value) {
-  if (value == nullptr) {
+  if (value == nullptr || header_ == nullptr) {
     return false;
   }
   const uint64_t fp = FingerprintWithSeed(key, seed_);
 
   // If the data corresponding to |key| already exists in LRU, update it.
-  {
-    auto it = lru_map_.find(fp);
-    if (it != lru_map_.end()) {
-      // Overwrite the data pointed to by it->second and move it to the front.
-      Update(*it->second, fp, value, value_size_);
-      lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
-      return true;
-    }
-  }
-
-  // If the LRU is full or we run out of the mmap region, drop the least
-  // recently used element (actually, the least recently used element is
-  // overwritten with new data).
-  if (lru_map_.size() >= size_ || next_item_ == end_) {
-    auto it = std::prev(lru_list_.end());  // Least recently used data.
-    const uint64_t old_fp = GetFP(*it);
-    lru_map_.erase(old_fp);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it);  // Move to front.
-    Update(*it, fp, value, value_size_);
-    lru_map_[fp] = it;
+  if (const uint32_t i = FindItem(fp); i != kNoItem) {
+    Update(GetItem(i), fp, value, value_size_);
+    MoveToFront(i);
     return true;
   }
 
-  // A new item can be assigned in the mmap region.
-  if (next_item_ < end_) {
-    Update(next_item_, fp, value, value_size_);
-    lru_list_.push_front(next_item_);
-    lru_map_[fp] = lru_list_.begin();
-    // Advance next_item_ for next item.
-    next_item_ += item_size();
-    DCHECK_LE(next_item_, end_);
+  // If the LRU is full, drop the least recently used element (actually, the
+  // least recently used element is overwritten with new data).
+  const uint32_t used = used_size();
+  if (used >= size_) {
+    const uint32_t i = tail();
+    RemoveFromIndex(GetFP(GetItem(i)));
+    Update(GetItem(i), fp, value, value_size_);
+    AddToIndex(fp, i);
+    MoveToFront(i);
     return true;
   }
 
-  LOG(ERROR) << "Insertion failed because no more mmap region is available.";
-  return false;
+  // A new item is assigned next to the items in use.
+  Update(GetItem(used), fp, value, value_size_);
+  SetHeaderField(kUsedSizeOffset, used + 1);
+  AddToIndex(fp, used);
+  PushFront(used);
+  return true;
 }
 
 bool LruStorage::TryInsert(const absl::string_view key, const char *value) {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it != lru_map_.end()) {
-    Update(*it->second, fp, value, value_size_);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  if (const uint32_t i = FindItem(fp); i != kNoItem) {
+    Update(GetItem(i), fp, value, value_size_);
+    MoveToFront(i);
   }
   return true;
 }
 
 bool LruStorage::Delete(const absl::string_view key) {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  return Delete(fp);
+  const uint32_t i = FindItem(fp);
+  return (i == kNoItem || DeleteItem(i));
 }
 
-bool LruStorage::Delete(uint64_t fp) {
-  auto it = lru_map_.find(fp);
-  return (it == lru_map_.end() || Delete(fp, it->second));
-}
-
-bool LruStorage::Delete(std::list<char *>::iterator it) {
-  return (it == lru_list_.end() || Delete(GetFP(*it), it));
-}
-
-bool LruStorage::Delete(uint64_t fp, std::list<char *>::iterator it) {
-  // Determine the last element in the mmap region.
-  if (next_item_ < begin_ + item_size()) {
-    LOG(ERROR) << "next_item_ points to invalid location (broken?)";
+bool LruStorage::DeleteItem(uint32_t i) {
+  const uint32_t used = used_size();
+  if (i >= used) {
+    LOG(ERROR) << "Item index is out of range (broken?)";
     return false;
   }
-  next_item_ -= item_size();
-
-  // Backup the location of mmap region to which another element will be moved.
-  char *deleted_item_pos = *it;
-
-  // Erase the LRU structure for (fp, it).
-  lru_map_.erase(fp);
-  lru_list_.erase(it);
-
-  if (next_item_ != deleted_item_pos) {
-    // Move the region for the last element to the deleted location.  Then,
-    // update the LRU structure for the moved element (the pointer to mmap
-    // region in the list node is updated.)
-    std::copy_n(next_item_, item_size(), deleted_item_pos);
-    const uint64_t fp = GetFP(next_item_);
-    *lru_map_[fp] = deleted_item_pos;
+  const uint32_t last = used - 1;
+
+  RemoveFromIndex(GetFP(GetItem(i)));
+  Unlink(i);
+
+  if (i != last) {
+    // Move the last element to the deleted location to keep contiguity. Then,
+    // update the links and the index for the moved element.
+    std::copy_n(GetItem(last), item_size(), GetItem(i));
+    const uint32_t prev = GetPrev(last);
+    const uint32_t next = GetNext(last);
+    SetPrev(i, prev);
+    SetNext(i, next);
+    if (prev == kNoItem) {
+      SetHeaderField(kHeadOffset, i);
+    } else {
+      SetNext(prev, i);
+    }
+    if (next == kNoItem) {
+      SetHeaderField(kTailOffset, i);
+    } else {
+      SetPrev(next, i);
+    }
+    SetBucket(FindBucket(GetFP(GetItem(i))), i + 1);
   }
 
-  // Clear the region for the next_item_.
-  std::fill_n(next_item_, item_size(), 0);
+  // Clear the region for the last element.
+  std::fill_n(GetItem(last), item_size(), 0);
+  SetPrev(last, 0);
+  SetNext(last, 0);
+  SetHeaderField(kUsedSizeOffset, last);
 
   return true;
 }
 
 int LruStorage::DeleteElementsBefore(uint32_t timestamp) {
-  if (mmap_.empty() || begin_ >= end_) {
+  if (mmap_.empty() || header_ == nullptr) {
     return 0;
   }
   int num_deleted = 0;
-  while (!lru_list_.empty()) {
-    auto it = std::prev(lru_list_.end());
-    const uint32_t last_access_time = GetTimeStamp(*it);
+  while (used_size() > 0) {
+    const uint32_t i = tail();
+    const uint32_t last_access_time = GetTimeStamp(GetItem(i));
     if (last_access_time >= timestamp) {
       break;
     }
-    if (Delete(it)) {
+    if (DeleteItem(i)) {
       ++num_deleted;
       continue;
     }
@@ -575,7 +679,7 @@ int LruStorage::DeleteElementsUntouchedFor62Days() {
 void LruStorage::Write(size_t i, uint64_t fp, const absl::string_view value,
                        uint32_t last_access_time) {
   DCHECK_LT(i, size_);
-  char *ptr = begin_ + (i * item_size());
+  char *ptr = GetItem(i);
   ptr = StoreUnaligned<uint64_t>(fp, ptr);
   ptr = StoreUnaligned<uint32_t>(last_access_time, ptr);
   if (value.size() == value_size_) {
@@ -588,11 +692,135 @@ void LruStorage::Write(size_t i, uint64_t fp, const absl::string_view value,
 void LruStorage::Read(size_t i, uint64_t *fp, std::string *value,
                       uint32_t *last_access_time) const {
   DCHECK_LT(i, size_);
-  const char *ptr = begin_ + (i * item_size());
+  const char *ptr = GetItem(i);
   *fp = GetFP(ptr);
   value->assign(GetValue(ptr), value_size_);
   *last_access_time = GetTimeStamp(ptr);
 }
 
+uint32_t LruStorage::GetHeaderField(size_t offset) const {
+  return LoadUnaligned<uint32_t>(header_ + offset);
+}
+
+void LruStorage::SetHeaderField(size_t offset, uint32_t value) {
+  StoreUnaligned<uint32_t>(value, header_ + offset);
+}
+
+uint32_t LruStorage::head() const { return GetHeaderField(kHeadOffset); }
+
+uint32_t LruStorage::tail() const { return GetHeaderField(kTailOffset); }
+
+uint32_t LruStorage::GetPrev(uint32_t i) const {
+  return LoadUnaligned<uint32_t>(links_ + i * kLinkSize);
+}
+
+uint32_t LruStorage::GetNext(uint32_t i) const {
+  return LoadUnaligned<uint32_t>(links_ + i * kLinkSize + 4);
+}
+
+void LruStorage::SetPrev(uint32_t i, uint32_t prev) {
+  StoreUnaligned<uint32_t>(prev, links_ + i * kLinkSize);
+}
+
+void LruStorage::SetNext(uint32_t i, uint32_t next) {
+  StoreUnaligned<uint32_t>(next, links_ + i * kLinkSize + 4);
+}
+
+void LruStorage::Unlink(uint32_t i) {
+  const uint32_t prev = GetPrev(i);
+  const uint32_t next = GetNext(i);
+  if (prev == kNoItem) {
+    SetHeaderField(kHeadOffset, next);
+  } else {
+    SetNext(prev, next);
+  }
+  if (next == kNoItem) {
+    SetHeaderField(kTailOffset, prev);
+  } else {
+    SetPrev(next, prev);
+  }
+}
+
+void LruStorage::PushFront(uint32_t i) {
+  const uint32_t old_head = head();
+  SetPrev(i, kNoItem);
+  SetNext(i, old_head);
+  if (old_head == kNoItem) {
+    SetHeaderField(kTailOffset, i);
+  } else {
+    SetPrev(old_head, i);
+  }
+  SetHeaderField(kHeadOffset, i);
+}
+
+void LruStorage::MoveToFront(uint32_t i) {
+  if (head() != i) {
+    Unlink(i);
+    PushFront(i);
+  }
+}
+
+size_t LruStorage::FindBucket(uint64_t fp) const {
+  size_t bucket = fp % num_buckets_;
+  // The index has at least `size_` empty buckets, so the probing terminates.
+  for (size_t n = 0; n < num_buckets_; ++n) {
+    const uint32_t value = GetBucket(bucket);
+    if (value == 0 ||
+        (value <= size_ && GetFP(GetItem(value - 1)) == fp)) {
+      return bucket;
+    }
+    bucket = (bucket + 1) % num_buckets_;
+  }
+  return bucket;
+}
+
+uint32_t LruStorage::GetBucket(size_t bucket) const {
+  return LoadUnaligned<uint32_t>(index_ + bucket * kBucketSize);
+}
+
+void LruStorage::SetBucket(size_t bucket, uint32_t value) {
+  StoreUnaligned<uint32_t>(value, index_ + bucket * kBucketSize);
+}
+
+void LruStorage::AddToIndex(uint64_t fp, uint32_t i) {
+  SetBucket(FindBucket(fp), i + 1);
+}
+
+void LruStorage::RemoveFromIndex(uint64_t fp) {
+  size_t bucket = FindBucket(fp);
+  if (GetBucket(bucket) == 0) {
+    return;
+  }
+  // Shifts back the following entries of the probe sequence so that the index
+  // needs no tombstones.
+  for (size_t next = (bucket + 1) % num_buckets_;;
+       next = (next + 1) % num_buckets_) {
+    const uint32_t value = GetBucket(next);
+    if (value == 0 || value > size_ || next == bucket) {
+      break;
+    }
+    const size_t home = GetFP(GetItem(value - 1)) % num_buckets_;
+    // Moves the entry unless its home is cyclically in (bucket, next].
+    const bool in_range = (bucket < next) ? (bucket < home && home <= next)
+                                          : (bucket < home || home <= next);
+    if (!in_range) {
+      SetBucket(bucket, value);
+      bucket = next;
+    }
+  }
+  SetBucket(bucket, 0);
+}
+
+uint32_t LruStorage::FindItem(uint64_t fp) const {
+  if (header_ == nullptr) {
+    return kNoItem;
+  }
+  const uint32_t value = GetBucket(FindBucket(fp));
+  if (value == 0 || value > used_size()) {
+    return kNoItem;
+  }
+  return value - 1;
+}
+
 }  // namespace storage
 }  // namespace mozc
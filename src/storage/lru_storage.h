@@ -32,18 +32,46 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "base/mmap.h"
 
 namespace mozc {
 namespace storage {
 
+// LruStorage is a fixed size LRU cache of fixed size values backed by a
+// memory-mapped file. The LRU links and the hash index of the fingerprints are
+// also stored in the file, so opening the file costs O(1).
+//
+// * File layout (version 1, little endian)
+//
+// +---------------------------------------+
+// | Header (32 bytes)                     |
+// |   magic, value size, capacity, seed,  |
+// |   flags, used size, head, tail        |
+// +---------------------------------------+
+// | Items (capacity x item_size() bytes)  |
+// |   fingerprint (8 bytes)               |
+// |   timestamp (4 bytes)                 |
+// |   value (value_size() bytes)          |
+// +---------------------------------------+
+// | LRU links (capacity x 8 bytes)        |
+// |   prev and next item indices          |
+// +---------------------------------------+
+// | Hash index (capacity x 2 x 4 bytes)   |
+// |   item index + 1, or 0 if empty       |
+// +---------------------------------------+
+//
+// The items in use are always packed at the beginning of the item region. The
+// hash index uses open addressing with linear probing. While the file is open,
+// the dirty flag is set in the header; the links and the index are rebuilt
+// from the items when the file was not closed cleanly.
+//
+// The version 0 layout, which has only the 12 byte header (value size,
+// capacity and seed) and the items, is migrated to the current layout on open.
 class LruStorage {
  public:
   LruStorage() = default;
@@ -121,7 +149,7 @@ class LruStorage {
   size_t size() const { return size_; }
 
   // Returns the number of items in LRU.
-  size_t used_size() const { return lru_list_.size(); }
+  size_t used_size() const;
 
   // Returns the seed used for fingerprinting.
   uint32_t seed() const { return seed_; }
@@ -130,7 +158,7 @@ class LruStorage {
 
   // Writes one entry at |i| th index.
   // i must be 0 <= i < size.
-  // This data will not update the index of the storage.
+  // This data will not update the index and the LRU links of the storage.
   void Write(size_t i, uint64_t fp, absl::string_view value,
              uint32_t last_access_time);
 
@@ -160,22 +188,54 @@ class LruStorage {
   // Initializes this LRU from memory buffer.
   bool Open(char *ptr, size_t ptr_size);
 
-  // Deletes the element from |fp| or |it|.
-  bool Delete(uint64_t fp);
-  bool Delete(std::list<char *>::iterator it);
-
-  // Actual implementation of Delete() methods.
-  bool Delete(uint64_t fp, std::list<char *>::iterator it);
+  // Rewrites the version 0 file mapped to `mmap_` in the current layout.
+  bool MigrateFromVersion0(const char *filename);
+
+  // Rebuilds the LRU links and the hash index from the timestamps of the
+  // items, packing the items in use at the beginning.
+  void Rebuild();
+
+  // Deletes the |i|-th item.
+  bool DeleteItem(uint32_t i);
+
+  char *GetItem(uint32_t i) const { return items_ + i * item_size(); }
+
+  // Accessors to the mutable fields of the header.
+  uint32_t GetHeaderField(size_t offset) const;
+  void SetHeaderField(size_t offset, uint32_t value);
+  uint32_t head() const;
+  uint32_t tail() const;
+
+  // Accessors to the LRU links.
+  uint32_t GetPrev(uint32_t i) const;
+  uint32_t GetNext(uint32_t i) const;
+  void SetPrev(uint32_t i, uint32_t prev);
+  void SetNext(uint32_t i, uint32_t next);
+  void Unlink(uint32_t i);
+  void PushFront(uint32_t i);
+  void MoveToFront(uint32_t i);
+
+  // Accessors to the hash index. FindBucket() returns the bucket of `fp`, or
+  // the empty bucket to which `fp` is inserted.
+  size_t FindBucket(uint64_t fp) const;
+  uint32_t GetBucket(size_t bucket) const;
+  void SetBucket(size_t bucket, uint32_t value);
+  void AddToIndex(uint64_t fp, uint32_t i);
+  void RemoveFromIndex(uint64_t fp);
+  // Returns the index of the item of `fp`, or kNoItem if not found.
+  uint32_t FindItem(uint64_t fp) const;
+
+  static constexpr uint32_t kNoItem = 0xffffffff;
 
   size_t value_size_ = 0;
   size_t size_ = 0;
   uint32_t seed_ = 0;
-  char *next_item_ = nullptr;
-  char *begin_ = nullptr;
-  char *end_ = nullptr;
+  size_t num_buckets_ = 0;
+  char *header_ = nullptr;
+  char *items_ = nullptr;
+  char *links_ = nullptr;
+  char *index_ = nullptr;
   std::string filename_;
-  std::list<char *> lru_list_;  // Front is the most recently used data.
-  absl::flat_hash_map<uint64_t, std::list<char *>::iterator> lru_map_;
   Mmap mmap_;
 };
 
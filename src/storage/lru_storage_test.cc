@@ -42,10 +42,15 @@
 
 #include "absl/log/check.h"
 #include "absl/random/random.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "base/bits.h"
 #include "base/clock_mock.h"
 #include "base/file/temp_dir.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/random.h"
 #include "storage/lru_cache.h"
 #include "testing/gmock.h"
@@ -557,5 +562,169 @@ TEST_F(LruStorageTest, OldDataAreNotLookedUp) {
   EXPECT_TRUE(storage.Touch("4444"));
 }
 
+TEST_F(LruStorageTest, MigrateFromVersion0) {
+  ScopedClockMock clock(absl::FromUnixSeconds(100));
+
+  // Writes a file in the version 0 layout: value size, capacity and seed,
+  // followed by the items.
+  std::string data;
+  data.resize(12 + 4 * (12 + 4));
+  char *ptr = data.data();
+  ptr = StoreUnaligned<uint32_t>(4, ptr);
+  ptr = StoreUnaligned<uint32_t>(4, ptr);
+  ptr = StoreUnaligned<uint32_t>(kSeed, ptr);
+  const auto write_item = [&ptr](absl::string_view key, uint32_t timestamp,
+                                 absl::string_view value) {
+    ptr = StoreUnaligned<uint64_t>(FingerprintWithSeed(key, kSeed), ptr);
+    ptr = StoreUnaligned<uint32_t>(timestamp, ptr);
+    ptr = std::copy(value.begin(), value.end(), ptr);
+  };
+  write_item("1111", 10, "aaaa");
+  write_item("2222", 30, "bbbb");
+  write_item("3333", 20, "cccc");
+
+  TempFile file(testing::MakeTempFileOrDie());
+  ASSERT_OK(FileUtil::SetContents(file.path(), data));
+
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.Open(file.path().c_str()));
+    EXPECT_EQ(storage.value_size(), 4);
+    EXPECT_EQ(storage.size(), 4);
+    EXPECT_EQ(storage.seed(), kSeed);
+    EXPECT_EQ(storage.used_size(), 3);
+    EXPECT_EQ(storage.LookupAsString("1111"), "aaaa");
+    EXPECT_EQ(storage.LookupAsString("2222"), "bbbb");
+    EXPECT_EQ(storage.LookupAsString("3333"), "cccc");
+
+    std::vector<std::string> values;
+    storage.GetAllValues(&values);
+    EXPECT_THAT(values, ::testing::ElementsAre("bbbb", "cccc", "aaaa"));
+
+    EXPECT_TRUE(storage.Insert("4444", "dddd"));
+    EXPECT_TRUE(storage.Insert("5555", "eeee"));
+    EXPECT_TRUE(storage.Lookup("1111") == nullptr);
+  }
+
+  // The migrated file is opened as is.
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(file.path());
+  ASSERT_OK(contents);
+  EXPECT_NE(contents->size(), data.size());
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.Open(file.path().c_str()));
+    std::vector<std::string> values;
+    storage.GetAllValues(&values);
+    EXPECT_THAT(values,
+                ::testing::ElementsAre("eeee", "dddd", "bbbb", "cccc"));
+  }
+}
+
+TEST_F(LruStorageTest, KeepsIndexAcrossReopen) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1));
+
+  constexpr size_t kValueSize = 4;
+  constexpr size_t kNumElements = 64;
+  TempFile file(testing::MakeTempFileOrDie());
+
+  // Inserts, touches and deletes entries while comparing with LruCache.
+  LruCache<std::string, std::string> cache(kNumElements);
+  absl::BitGen gen;
+  for (int n = 0; n < 10; ++n) {
+    LruStorage storage;
+    ASSERT_TRUE(storage.OpenOrCreate(file.path().c_str(), kValueSize,
+                                     kNumElements, kSeed));
+    for (int i = 0; i < 200; ++i) {
+      clock->Advance(absl::Seconds(1));
+      const std::string key = absl::StrFormat(
+          "%04d", absl::Uniform(gen, 0, static_cast<int>(kNumElements * 2)));
+      const std::string value = absl::StrFormat("%04d", i);
+      switch (absl::Uniform(gen, 0, 3)) {
+        case 0:
+          EXPECT_TRUE(storage.Insert(key, value.data()));
+          cache.Insert(key, value);
+          break;
+        case 1:
+          EXPECT_EQ(storage.Touch(key), cache.Lookup(key) != nullptr);
+          break;
+        default:
+          EXPECT_TRUE(storage.Delete(key));
+          cache.Erase(key);
+          break;
+      }
+    }
+    for (int i = 0; i < kNumElements * 2; ++i) {
+      const std::string key = absl::StrFormat("%04d", i);
+      const std::string *expected = cache.LookupWithoutInsert(key);
+      if (expected == nullptr) {
+        EXPECT_TRUE(storage.Lookup(key) == nullptr) << key;
+      } else {
+        EXPECT_EQ(storage.LookupAsString(key), *expected) << key;
+      }
+    }
+  }
+}
+
+TEST_F(LruStorageTest, RecoverFromUncleanClose) {
+  ScopedClockMock clock(absl::FromUnixSeconds(100));
+
+  TempFile file1(testing::MakeTempFileOrDie());
+  TempFile file2(testing::MakeTempFileOrDie());
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(file1.path().c_str(), 4, 4, kSeed));
+  EXPECT_TRUE(storage.Insert("1111", "aaaa"));
+  clock->Advance(absl::Seconds(1));
+  EXPECT_TRUE(storage.Insert("2222", "bbbb"));
+  clock->Advance(absl::Seconds(1));
+  EXPECT_TRUE(storage.Touch("1111"));
+
+  // Copies the file while it is open, which has the dirty flag.
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(file1.path());
+  ASSERT_OK(contents);
+  ASSERT_OK(FileUtil::SetContents(file2.path(), *contents));
+
+  LruStorage copied;
+  ASSERT_TRUE(copied.Open(file2.path().c_str()));
+  EXPECT_EQ(copied.used_size(), 2);
+  EXPECT_EQ(copied.LookupAsString("1111"), "aaaa");
+  EXPECT_EQ(copied.LookupAsString("2222"), "bbbb");
+  std::vector<std::string> values;
+  copied.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("aaaa", "bbbb"));
+}
+
+TEST_F(LruStorageTest, OpenSameFileTwice) {
+  ScopedClockMock clock(absl::FromUnixSeconds(100));
+
+  TempFile file1(testing::MakeTempFileOrDie());
+  TempFile file2(testing::MakeTempFileOrDie());
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(file1.path().c_str(), 4, 4, kSeed));
+  // The items have the same timestamp.
+  EXPECT_TRUE(storage.Insert("1111", "aaaa"));
+  EXPECT_TRUE(storage.Insert("2222", "bbbb"));
+  EXPECT_TRUE(storage.Insert("3333", "cccc"));
+  EXPECT_TRUE(storage.Touch("1111"));
+
+  // Reopening the file, e.g. on reload, closes it cleanly first rather than
+  // rebuilding it from the timestamps.
+  ASSERT_TRUE(storage.OpenOrCreate(file1.path().c_str(), 4, 4, kSeed));
+  ASSERT_TRUE(storage.Open(file1.path().c_str()));
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("aaaa", "cccc", "bbbb"));
+
+  // Rebuilding the unclean file keeps the order of the items with the same
+  // timestamp.
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(file1.path());
+  ASSERT_OK(contents);
+  ASSERT_OK(FileUtil::SetContents(file2.path(), *contents));
+  LruStorage copied;
+  ASSERT_TRUE(copied.Open(file2.path().c_str()));
+  values.clear();
+  copied.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("aaaa", "cccc", "bbbb"));
+}
+
 }  // namespace storage
 }  // namespace mozc